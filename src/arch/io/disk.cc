@@ -81,6 +81,12 @@ public:
         return new accounting_diskmgr_t::account_t(&accounter, pri, outstanding_requests_limit);
     }
 
+    /* Other threads read this through `io_backender_t::get_queue_depth()`, so it's
+    only modified atomically. */
+    intptr_t get_outstanding_txn() {
+        return __sync_add_and_fetch(&outstanding_txn, 0);
+    }
+
     void delayed_destroy(void *_account) {
         on_thread_t t(home_thread());
 
@@ -95,7 +101,7 @@ public:
 
     void submit_action_to_stack_stats(action_t *a) {
         assert_thread();
-        outstanding_txn++;
+        __sync_add_and_fetch(&outstanding_txn, 1);
         stack_stats.submit(a);
     }
 
@@ -158,7 +164,7 @@ public:
 
     void done(stats_diskmgr_t::action_t *a) {
         assert_thread();
-        outstanding_txn--;
+        __sync_sub_and_fetch(&outstanding_txn, 1);
         action_t *a2 = static_cast<action_t *>(a);
         bool succeeded = a2->get_succeeded();
         if (succeeded) {
@@ -214,6 +220,10 @@ io_backender_t::~io_backender_t() { }
 
 file_direct_io_mode_t io_backender_t::get_direct_io_mode() const { return direct_io_mode; }
 
+intptr_t io_backender_t::get_queue_depth() const {
+    return diskmgr->get_outstanding_txn();
+}
+
 
 /* Disk file object */
 
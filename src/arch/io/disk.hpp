@@ -32,6 +32,9 @@ public:
                    int max_concurrent_io_requests = DEFAULT_MAX_CONCURRENT_IO_REQUESTS);
     ~io_backender_t();
     linux_disk_manager_t *get_diskmgr_ptr() { return diskmgr.get(); }
+    /* The number of disk operations that have been submitted but haven't completed
+    yet. Can be called from any thread. */
+    intptr_t get_queue_depth() const;
     file_direct_io_mode_t get_direct_io_mode() const;
 
 protected:
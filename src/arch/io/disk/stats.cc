@@ -1,14 +1,21 @@
 #include "arch/io/disk/stats.hpp"
 
+#include "config/args.hpp"
+
 stats_diskmgr_t::stats_diskmgr_t(perfmon_collection_t *stats, const std::string &name) :
     read_sampler(secs_to_ticks(1)),
     write_sampler(secs_to_ticks(1)),
+    read_latency(secs_to_ticks(LATENCY_HISTOGRAM_INTERVAL_SECS)),
+    write_latency(secs_to_ticks(LATENCY_HISTOGRAM_INTERVAL_SECS)),
     stats_membership(stats,
                      &read_sampler, (name + "_read").c_str(),
-                     &write_sampler, (name + "_write").c_str()) { }
+                     &write_sampler, (name + "_write").c_str(),
+                     &read_latency, (name + "_read_latency_ms").c_str(),
+                     &write_latency, (name + "_write_latency_ms").c_str()) { }
 
 
 void stats_diskmgr_t::submit(action_t *a) {
+    a->submit_time = get_ticks();
     if (a->get_is_read()) {
         read_sampler.begin(&a->start_time);
     } else {
@@ -21,8 +28,10 @@ void stats_diskmgr_t::done(conflict_resolving_diskmgr_action_t *p) {
     action_t *a = static_cast<action_t *>(p);
     if (a->get_is_read()) {
         read_sampler.end(&a->start_time);
+        read_latency.record(get_ticks() - a->submit_time);
     } else {
         write_sampler.end(&a->start_time);
+        write_latency.record(get_ticks() - a->submit_time);
     }
     done_fun(a);
 }
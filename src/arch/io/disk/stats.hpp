@@ -18,6 +18,7 @@ struct stats_diskmgr_t {
 
     struct action_t : public conflict_resolving_diskmgr_action_t {
         ticks_t start_time;
+        ticks_t submit_time;
     };
 
     void submit(action_t *a);
@@ -30,6 +31,7 @@ struct stats_diskmgr_t {
 
 private:
     perfmon_duration_sampler_t read_sampler, write_sampler;
+    perfmon_latency_histogram_t read_latency, write_latency;
     perfmon_multi_membership_t stats_membership;
 };
 
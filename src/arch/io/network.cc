@@ -4,6 +4,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <net/if.h>
 #include <netdb.h>
 #include <netinet/tcp.h>
@@ -11,6 +12,9 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+
+#include <algorithm>
 
 #include "utils.hpp"
 #include <boost/bind.hpp>
@@ -343,6 +347,8 @@ void linux_tcp_conn_t::write_handler_t::coro_pool_callback(write_queue_op_t *ope
             parent->release_write_buffer(operation->dealloc);
             parent->write_queue_limiter.unlock(operation->size);
         }
+    } else if (!operation->iov.empty()) {
+        parent->perform_writev(operation->iov.data(), operation->iov.size());
     }
 
     if (operation->cond != NULL) {
@@ -377,6 +383,13 @@ void linux_tcp_conn_t::internal_flush_write_buffer() {
 }
 
 void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
+    iovec iov;
+    iov.iov_base = const_cast<void *>(buf);
+    iov.iov_len = size;
+    perform_writev(&iov, 1);
+}
+
+void linux_tcp_conn_t::perform_writev(iovec *iov, size_t iovcnt) {
     assert_thread();
 
     if (write_closed.is_pulsed()) {
@@ -386,8 +399,16 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
         return;
     }
 
-    while (size > 0) {
-        ssize_t res = ::write(sock.get(), buf, size);
+    /* Skip leading empty buffers, so that a return value of 0 always means
+    something went wrong. */
+    while (iovcnt > 0 && iov->iov_len == 0) {
+        ++iov;
+        --iovcnt;
+    }
+
+    while (iovcnt > 0) {
+        ssize_t res = ::writev(sock.get(), iov,
+                               std::min<size_t>(iovcnt, IOV_MAX));
 
         if (res == -1 && (get_errno() == EAGAIN || get_errno() == EWOULDBLOCK)) {
             /* Wait for a notification from the event queue, or for an order to
@@ -425,10 +446,21 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
             break;
 
         } else {
-            rassert(res <= static_cast<ssize_t>(size));
-            buf = reinterpret_cast<const void *>(reinterpret_cast<const char *>(buf) + res);
-            size -= res;
             if (write_perfmon) write_perfmon->record(res);
+            /* Drop the buffers that were written completely, and advance into the
+            first one that wasn't. */
+            size_t written = res;
+            while (iovcnt > 0 && written >= iov->iov_len) {
+                written -= iov->iov_len;
+                ++iov;
+                --iovcnt;
+            }
+            if (iovcnt > 0) {
+                iov->iov_base = reinterpret_cast<char *>(iov->iov_base) + written;
+                iov->iov_len -= written;
+            } else {
+                rassert(written == 0);
+            }
         }
     }
 }
@@ -460,6 +492,30 @@ void linux_tcp_conn_t::write(const void *buf, size_t size, signal_t *closer) THR
     if (write_closed.is_pulsed()) throw tcp_conn_write_closed_exc_t();
 }
 
+void linux_tcp_conn_t::writev(const iovec *iov, size_t iovcnt, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+    write_op_wrapper_t sentry(this, closer);
+
+    write_queue_op_t op;
+    cond_t to_signal_when_done;
+
+    /* Flush out any data that's been buffered, so that things don't get out of order */
+    if (current_write_buffer->size > 0) internal_flush_write_buffer();
+
+    /* As in `write()`, we block until the write is done, so the caller's buffers
+    stay valid for as long as the kernel needs them. We copy the (small) list of
+    buffers because `perform_writev()` modifies it as it goes. */
+    op.buffer = NULL;
+    op.size = 0;
+    op.iov.assign(iov, iov + iovcnt);
+    op.dealloc = NULL;
+    op.cond = &to_signal_when_done;
+    write_queue.push(&op);
+
+    to_signal_when_done.wait();
+
+    if (write_closed.is_pulsed()) throw tcp_conn_write_closed_exc_t();
+}
+
 void linux_tcp_conn_t::write_buffered(const void *vbuf, size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
     write_op_wrapper_t sentry(this, closer);
 
@@ -5,6 +5,7 @@
 #include <stdarg.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <ifaddrs.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -105,6 +106,12 @@ public:
     pipe and throws `tcp_conn_write_closed_exc_t`. */
     void write(const void *buf, size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
 
+    /* writev() is like write(), but writes the `iovcnt` buffers described by `iov`
+    in order, handing them to the kernel directly with as few `::writev()` calls as
+    possible instead of copying them into a write buffer first. The buffers (but not
+    `iov` itself) must stay valid until it returns. */
+    void writev(const iovec *iov, size_t iovcnt, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
+
     /* write_buffered() is like write(), but it might not send the data until
     flush_buffer*() or write() is called. Internally, it bundles together the
     buffered writes; this may improve performance. */
@@ -243,6 +250,8 @@ private:
         write_buffer_t *dealloc;
         const void *buffer;
         size_t size;
+        /* If non-empty, the op writes these buffers instead of `buffer`. */
+        std::vector<iovec> iov;
         cond_t *cond;
         auto_drainer_t::lock_t keepalive;
     };
@@ -301,6 +310,10 @@ private:
     `size` bytes from `buffer` to the socket. */
     void perform_write(const void *buffer, size_t size);
 
+    /* Like `perform_write()`, but for a list of buffers. Modifies the entries of
+    `iov` to keep track of what has been written so far. */
+    void perform_writev(iovec *iov, size_t iovcnt);
+
     scoped_ptr_t<auto_drainer_t> drainer;
 };
 
@@ -5,6 +5,8 @@
 #include <sys/mman.h>
 #include <unistd.h>
 
+#include <vector>
+
 #ifndef NDEBUG
 #include <cxxabi.h>   // For __cxa_current_exception_type (see below)
 #endif
@@ -181,6 +183,29 @@ bool artificial_stack_t::address_is_stack_overflow(void *addr) {
     return get_stack_bound() == addr_base;
 }
 
+size_t artificial_stack_t::get_high_water_usage() const {
+    /* Stack pages start out unmapped (see the constructor), so the lowest page that
+    the kernel has backed with memory is as deep as the stack has ever gone. The
+    protection page is never touched, so we skip it. */
+    const size_t page_size = getpagesize();
+    const size_t num_pages = stack_size / page_size - 1;
+    char *const first_page = static_cast<char *>(stack) + page_size;
+#ifdef __MACH__
+    std::vector<char> residency(num_pages);
+#else
+    std::vector<unsigned char> residency(num_pages);
+#endif
+    if (mincore(first_page, num_pages * page_size, residency.data()) != 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < num_pages; ++i) {
+        if ((residency[i] & 1) != 0) {
+            return (num_pages - i) * page_size;
+        }
+    }
+    return 0;
+}
+
 extern "C" {
 // `lightweight_swapcontext` is defined in assembly further down.  If we didn't add the
 // asm("_lightweight_swapcontext") here, we'd have to conditionally compile the symbol name in the
@@ -517,6 +542,13 @@ void *threaded_stack_t::get_stack_bound() {
     return stackaddr;
 }
 
+size_t threaded_stack_t::get_stack_size() {
+    void *stackaddr;
+    size_t stacksize;
+    get_stack_addr_size(&stackaddr, &stacksize);
+    return stacksize;
+}
+
 void threaded_stack_t::get_stack_addr_size(void **stackaddr_out,
                                            size_t *stacksize_out) {
 #ifdef __MACH__
@@ -65,6 +65,14 @@ public:
     /* Returns the end of the stack */
     void *get_stack_bound() { return stack; }
 
+    /* Returns the size of the stack, including the protection page */
+    size_t get_stack_size() const { return stack_size; }
+
+    /* Returns how many bytes at the base of the stack have been touched since the
+    stack was created. Stacks are reused, so this is the deepest that any of the
+    contexts that ran on it have gone. Costs a system call. */
+    size_t get_high_water_usage() const;
+
 private:
     void *stack;
     size_t stack_size;
@@ -177,6 +185,13 @@ public:
     /* Returns the end of the stack */
     void *get_stack_bound();
 
+    /* Returns the size of the stack */
+    size_t get_stack_size();
+
+    /* The pages of a thread's stack aren't ours to inspect, so this always returns
+    zero. */
+    size_t get_high_water_usage() const { return 0; }
+
 private:
     static void *internal_run(void *p);
     void get_stack_addr_size(void **stackaddr_out, size_t *stacksize_out);
@@ -42,6 +42,7 @@
  * If you want to use the profiler in release mode, compile with
  * `make CORO_PROFILING=1 NO_OMIT_FRAME_POINTER=1`
  * Keep in mind though that backtraces can be unreliable in release.
+ * For a cheaper profile that is always available, see `sampling_profiler_t`.
  *
  * The coro profiler records a sample whenever it encounters a `PROFILER_RECORD_SAMPLE`
  * and also every time a coroutine yields.
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
 #include <functional>
 #ifndef NDEBUG
 #include <map>
@@ -19,6 +20,7 @@
 #include "debug.hpp"
 #include "do_on_thread.hpp"
 #include "perfmon/perfmon.hpp"
+#include "perfmon/resource_usage.hpp"
 #include "rethinkdb_backtrace.hpp"
 #include "thread_local.hpp"
 #include "utils.hpp"
@@ -41,8 +43,17 @@ struct coro_globals_t {
     /* The previous context. */
     coro_t *prev_coro;
 
-    /* A list of coro_t objects that are not in use. */
-    intrusive_list_t<coro_t> free_coros;
+    /* The coro_t objects that are not in use, one list for each stack class. The
+    most recently used ones are at the tail, and that's where we take them from, since
+    their stacks are the most likely to still be in the CPU cache. */
+    intrusive_list_t<coro_t> free_coros[NUM_CORO_STACK_CLASSES];
+
+    /* The total size of the stacks in `free_coros`. */
+    size_t free_coros_bytes;
+
+    /* How many coroutines have finished since we last measured the stack usage of
+    one. */
+    int coros_finished_since_stack_sample;
 
 #ifndef NDEBUG
 
@@ -72,6 +83,8 @@ struct coro_globals_t {
     coro_globals_t()
         : current_coro(NULL)
         , prev_coro(NULL)
+        , free_coros_bytes(0)
+        , coros_finished_since_stack_sample(0)
 #ifndef NDEBUG
         , coro_count(0)
         , printed_high_coro_count_warning(false)
@@ -85,9 +98,11 @@ struct coro_globals_t {
         rassert(!current_coro);
 
         /* Destroy remaining coroutines */
-        while (coro_t *s = free_coros.head()) {
-            free_coros.remove(s);
-            delete s;
+        for (size_t i = 0; i < NUM_CORO_STACK_CLASSES; ++i) {
+            while (coro_t *s = free_coros[i].head()) {
+                free_coros[i].remove(s);
+                delete s;
+            }
         }
     }
 
@@ -103,6 +118,24 @@ static perfmon_multi_membership_t pm_coroutines_membership(&get_global_perfmon_c
     &pm_active_coroutines, "active_coroutines",
     &pm_allocated_coroutines, "allocated_coroutines");
 
+/* If the free lists are too small for the workload, stacks get freed and allocated
+over and over, which shows up here. */
+static perfmon_rate_monitor_t pm_coroutine_stack_allocations(secs_to_ticks(1));
+static perfmon_sampler_t
+    pm_small_stack_high_water(secs_to_ticks(60), false),
+    pm_medium_stack_high_water(secs_to_ticks(60), false),
+    pm_default_stack_high_water(secs_to_ticks(60), false);
+static perfmon_sampler_t *const pm_stack_high_water[NUM_CORO_STACK_CLASSES] = {
+    &pm_small_stack_high_water,
+    &pm_medium_stack_high_water,
+    &pm_default_stack_high_water };
+static perfmon_multi_membership_t pm_coroutine_stacks_membership(
+    &get_global_perfmon_collection(),
+    &pm_coroutine_stack_allocations, "coroutine_stack_allocations_per_sec",
+    &pm_small_stack_high_water, "coroutine_stack_high_water_small",
+    &pm_medium_stack_high_water, "coroutine_stack_high_water_medium",
+    &pm_default_stack_high_water, "coroutine_stack_high_water_default");
+
 coro_runtime_t::coro_runtime_t() {
     rassert(!TLS_get_cglobals(), "coro runtime initialized twice on this thread");
     TLS_set_cglobals(new coro_globals_t);
@@ -127,11 +160,15 @@ void coro_runtime_t::get_coroutine_counts(std::map<std::string, size_t> *dest) {
 TLS_with_init(int64_t, coro_selfname_counter, 0);
 #endif
 
-coro_t::coro_t() :
-    stack(&coro_t::run, coro_stack_size),
+coro_t::coro_t(coro_stack_class_t stack_class) :
+    stack_class_(stack_class),
+    stack(&coro_t::run, get_stack_size(stack_class)),
     current_thread_(linux_thread_pool_t::get_thread_id()),
     notified_(false),
-    waiting_(false)
+    waiting_(false),
+    spawn_site(NULL),
+    resource_usage(NULL),
+    resource_usage_since(0)
 #ifndef NDEBUG
     , selfname_number(get_thread_id().threadnum + MAX_THREADS *
           // The comma here is the comma operator, to implement the semantics
@@ -144,6 +181,7 @@ coro_t::coro_t() :
 #endif
 {
     ++pm_allocated_coroutines;
+    pm_coroutine_stack_allocations.record();
 
 #ifndef NDEBUG
     TLS_get_cglobals()->coro_count++;
@@ -157,14 +195,44 @@ coro_t::coro_t() :
 }
 
 void coro_t::return_coro_to_free_list(coro_t *coro) {
-    TLS_get_cglobals()->free_coros.push_back(coro);
+    coro_globals_t *cglobals = TLS_get_cglobals();
+    const size_t stack_class = static_cast<size_t>(coro->stack_class_);
+
+    /* Measuring the stack usage costs a system call, so we only do it for a sample of
+    the coroutines. */
+    ++cglobals->coros_finished_since_stack_sample;
+    if (cglobals->coros_finished_since_stack_sample
+            >= COROUTINE_STACK_USAGE_SAMPLE_INTERVAL) {
+        cglobals->coros_finished_since_stack_sample = 0;
+        size_t usage = coro->stack.get_high_water_usage();
+        if (usage > 0) {
+            pm_stack_high_water[stack_class]->record(static_cast<double>(usage));
+        }
+    }
+
+    cglobals->free_coros[stack_class].push_back(coro);
+    cglobals->free_coros_bytes += get_stack_size(coro->stack_class_);
 }
 
-void coro_t::maybe_evict_from_free_list() {
+void coro_t::maybe_evict_from_free_lists() {
     coro_globals_t *cglobals = TLS_get_cglobals();
-    while (cglobals->free_coros.size() > COROUTINE_FREE_LIST_SIZE) {
-        coro_t *coro_to_delete = cglobals->free_coros.tail();
-        cglobals->free_coros.remove(coro_to_delete);
+    while (cglobals->free_coros_bytes > COROUTINE_FREE_LIST_BYTES) {
+        /* We take from the class that holds the most memory, so that a burst of
+        coroutines of one class can't push out all of the others. */
+        size_t largest = 0;
+        size_t largest_bytes = 0;
+        for (size_t i = 0; i < NUM_CORO_STACK_CLASSES; ++i) {
+            const size_t bytes = cglobals->free_coros[i].size()
+                * get_stack_size(static_cast<coro_stack_class_t>(i));
+            if (bytes > largest_bytes) {
+                largest = i;
+                largest_bytes = bytes;
+            }
+        }
+        /* The head has been unused for the longest time. */
+        coro_t *coro_to_delete = cglobals->free_coros[largest].head();
+        cglobals->free_coros[largest].remove(coro_to_delete);
+        cglobals->free_coros_bytes -= get_stack_size(coro_to_delete->stack_class_);
         delete coro_to_delete;
     }
 }
@@ -255,18 +323,30 @@ void coro_t::wait() {   /* class method */
     self()->waiting_ = true;
 
     PROFILER_CORO_YIELD(1);
+    self()->charge_cpu_time();
     if (TLS_get_cglobals()->prev_coro) {
         context_switch(&self()->stack.context, &TLS_get_cglobals()->prev_coro->stack.context);
     } else {
         context_switch(&self()->stack.context, &TLS_get_cglobals()->scheduler);
     }
     PROFILER_CORO_RESUME;
+    if (self()->resource_usage != NULL) {
+        self()->resource_usage_since = get_ticks();
+    }
 
     rassert(self());
     rassert(self()->waiting_);
     self()->waiting_ = false;
 }
 
+void coro_t::charge_cpu_time() {
+    if (resource_usage != NULL) {
+        const ticks_t now = get_ticks();
+        resource_usage->cpu_time += now - resource_usage_since;
+        resource_usage_since = now;
+    }
+}
+
 void coro_t::yield() {  /* class method */
     rassert(self(), "Not in a coroutine context");
     self()->notify_sometime();
@@ -297,6 +377,7 @@ void coro_t::notify_now_deprecated() {
 
     if (coro_t::self() != NULL) {
         PROFILER_CORO_YIELD(1);
+        coro_t::self()->charge_cpu_time();
     }
     coro_t *prev_prev_coro = TLS_get_cglobals()->prev_coro;
     TLS_get_cglobals()->prev_coro = TLS_get_cglobals()->current_coro;
@@ -313,6 +394,9 @@ void coro_t::notify_now_deprecated() {
     TLS_get_cglobals()->prev_coro = prev_prev_coro;
     if (coro_t::self() != NULL) {
         PROFILER_CORO_RESUME;
+        if (coro_t::self()->resource_usage != NULL) {
+            coro_t::self()->resource_usage_since = get_ticks();
+        }
     }
 
 #ifndef NDEBUG
@@ -365,6 +449,19 @@ void coro_t::set_coroutine_stack_size(size_t size) {
     coro_stack_size = size;
 }
 
+size_t coro_t::get_stack_size(coro_stack_class_t stack_class) {
+    switch (stack_class) {
+    case coro_stack_class_t::SMALL:
+        return std::min<size_t>(COROUTINE_SMALL_STACK_SIZE, coro_stack_size);
+    case coro_stack_class_t::MEDIUM:
+        return std::min<size_t>(COROUTINE_MEDIUM_STACK_SIZE, coro_stack_size);
+    case coro_stack_class_t::DEFAULT:
+        return coro_stack_size;
+    default:
+        unreachable();
+    }
+}
+
 coro_stack_t* coro_t::get_stack() {
     return &stack;
 }
@@ -381,15 +478,20 @@ bool coroutines_have_been_initialized() {
     return TLS_get_cglobals() != NULL;
 }
 
-coro_t * coro_t::get_coro() {
+coro_t * coro_t::get_coro(coro_stack_class_t stack_class) {
     rassert(coroutines_have_been_initialized());
     coro_t *coro;
+    intrusive_list_t<coro_t> *free_coros =
+        &TLS_get_cglobals()->free_coros[static_cast<size_t>(stack_class)];
 
-    if (TLS_get_cglobals()->free_coros.size() == 0) {
-        coro = new coro_t();
+    if (free_coros->size() == 0) {
+        coro = new coro_t(stack_class);
+        /* The stacks of the other classes may still be over the limit. */
+        maybe_evict_from_free_lists();
     } else {
-        coro = TLS_get_cglobals()->free_coros.tail();
-        TLS_get_cglobals()->free_coros.remove(coro);
+        coro = free_coros->tail();
+        free_coros->remove(coro);
+        TLS_get_cglobals()->free_coros_bytes -= get_stack_size(stack_class);
 
         /* We cannot easily delete coroutines at the time where we return
         them to the free list, because coro_t::run() requires the coro_t pointer to remain
@@ -401,7 +503,7 @@ coro_t * coro_t::get_coro() {
         Instead, we delete unused coroutines from the free list here. It's not perfect,
         but the important thing is that unused coroutines get evicted eventually
         so we can reclaim the memory. */
-        maybe_evict_from_free_list();
+        maybe_evict_from_free_lists();
     }
 
     rassert(!coro->intrusive_list_node_t<coro_t>::in_a_list());
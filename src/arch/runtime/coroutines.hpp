@@ -22,7 +22,20 @@ const size_t MAX_COROUTINE_STACK_SIZE = 8*1024*1024;
 
 threadnum_t get_thread_id();
 struct coro_globals_t;
-
+class resource_usage_t;
+
+
+/* Every coroutine gets a stack of one of these sizes. Most coroutines have to use
+`DEFAULT`, because they can run arbitrary code. Spawn sites that start a lot of
+coroutines which only ever run a few shallow frames can ask for a smaller stack, which
+makes the coroutines cheaper to keep around. The small sizes are capped by the size
+that `set_coroutine_stack_size()` sets. */
+enum class coro_stack_class_t {
+    SMALL = 0,  // COROUTINE_SMALL_STACK_SIZE
+    MEDIUM,     // COROUTINE_MEDIUM_STACK_SIZE
+    DEFAULT,    // the size set by `set_coroutine_stack_size()`
+};
+const size_t NUM_CORO_STACK_CLASSES = 3;
 
 struct coro_profiler_mixin_t {
 #ifdef ENABLE_CORO_PROFILER
@@ -48,14 +61,18 @@ public:
     friend bool is_coroutine_stack_overflow(void *);
 
     template<class Callable>
-    static void spawn_now_dangerously(Callable &&action) {
-        coro_t *coro = get_and_init_coro(std::forward<Callable>(action));
+    static void spawn_now_dangerously(
+            Callable &&action,
+            coro_stack_class_t stack_class = coro_stack_class_t::DEFAULT) {
+        coro_t *coro = get_and_init_coro(std::forward<Callable>(action), stack_class);
         coro->notify_now_deprecated();
     }
 
     template<class Callable>
-    static coro_t *spawn_sometime(Callable &&action) {
-        coro_t *coro = get_and_init_coro(std::forward<Callable>(action));
+    static coro_t *spawn_sometime(
+            Callable &&action,
+            coro_stack_class_t stack_class = coro_stack_class_t::DEFAULT) {
+        coro_t *coro = get_and_init_coro(std::forward<Callable>(action), stack_class);
         coro->notify_sometime();
         return coro;
     }
@@ -64,15 +81,19 @@ public:
     `spawn_later_ordered()` (or `spawn_ordered()`). `spawn_later_ordered()` does not
     honor scheduler priorities. */
     template<class Callable>
-    static coro_t *spawn_later_ordered(Callable &&action) {
-        coro_t *coro = get_and_init_coro(std::forward<Callable>(action));
+    static coro_t *spawn_later_ordered(
+            Callable &&action,
+            coro_stack_class_t stack_class = coro_stack_class_t::DEFAULT) {
+        coro_t *coro = get_and_init_coro(std::forward<Callable>(action), stack_class);
         coro->notify_later_ordered();
         return coro;
     }
 
     template<class Callable>
-    static void spawn_ordered(Callable &&action) {
-        spawn_later_ordered(std::forward<Callable>(action));
+    static void spawn_ordered(
+            Callable &&action,
+            coro_stack_class_t stack_class = coro_stack_class_t::DEFAULT) {
+        spawn_later_ordered(std::forward<Callable>(action), stack_class);
     }
 
     // Use coro_t::spawn_*(std::bind(...)) for spawning with parameters.
@@ -132,9 +153,23 @@ public:
     const std::string& get_coroutine_type() { return coroutine_type; }
 #endif
 
+    /* The `__PRETTY_FUNCTION__` of the `get_and_init_coro()` instantiation that
+    spawned this coroutine, which names the type of the spawned callable. It's a
+    string literal, so it's cheap to set and safe to read from a signal handler, which
+    is what the `sampling_profiler_t` does. */
+    const char *get_spawn_site() const { return spawn_site; }
+
+    /* The `resource_usage_t` that the work of this coroutine is charged to, or `NULL`.
+    Use a `resource_usage_scope_t` to change it. */
+    resource_usage_t *get_resource_usage() const { return resource_usage; }
+
     static void set_coroutine_stack_size(size_t size);
 
+    /* The size of the stacks of the given class. */
+    static size_t get_stack_size(coro_stack_class_t stack_class);
+
     coro_stack_t *get_stack();
+    coro_stack_class_t get_stack_class() const { return stack_class_; }
 
     void set_priority(int _priority) {
         linux_thread_message_t::set_priority(_priority);
@@ -158,15 +193,17 @@ private:
 
     // Constructor sets up the stack, get_and_init_coro will load a function to be run
     //  at which point the coroutine can be notified
-    coro_t();
+    explicit coro_t(coro_stack_class_t stack_class);
 
     // Generates a spawn-time backtrace and stores it into `spawn_backtrace`.
     void grab_spawn_backtrace();
 
     // If this function footprint ever changes, you may need to update the parse_coroutine_info function
     template<class Callable>
-    static coro_t *get_and_init_coro(Callable &&action) {
-        coro_t *coro = get_coro();
+    static coro_t *get_and_init_coro(Callable &&action,
+                                     coro_stack_class_t stack_class) {
+        coro_t *coro = get_coro(stack_class);
+        coro->spawn_site = __PRETTY_FUNCTION__;
 #ifndef NDEBUG
         coro->parse_coroutine_type(__PRETTY_FUNCTION__);
 #endif
@@ -185,19 +222,21 @@ private:
         return coro;
     }
 
-    static coro_t *get_coro();
+    static coro_t *get_coro(coro_stack_class_t stack_class);
 
     static void return_coro_to_free_list(coro_t *coro);
-    static void maybe_evict_from_free_list();
+    static void maybe_evict_from_free_lists();
 
     static void run() NORETURN;
 
     friend class coro_profiler_t;
     friend struct coro_globals_t;
+    friend class resource_usage_scope_t;
     ~coro_t();
 
     virtual void on_thread_switch();
 
+    const coro_stack_class_t stack_class_;
     coro_stack_t stack;
 
     threadnum_t current_thread_;
@@ -208,6 +247,14 @@ private:
 
     callable_action_wrapper_t action_wrapper;
 
+    const char *spawn_site;
+
+    // Charges the CPU time since `resource_usage_since` to `resource_usage`, if any.
+    void charge_cpu_time();
+
+    resource_usage_t *resource_usage;
+    ticks_t resource_usage_since;
+
 #ifndef NDEBUG
     int64_t selfname_number;
     std::string coroutine_type;
@@ -0,0 +1,176 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "arch/runtime/numa.hpp"
+
+#include <dirent.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <set>
+
+#include "arch/runtime/runtime_utils.hpp"
+#include "errors.hpp"
+
+numa_topology_t::numa_topology_t(
+        const std::map<int, std::vector<int> > &cpus_by_node_id) {
+    for (const auto &pair : cpus_by_node_id) {
+        if (!pair.second.empty()) {
+            node_t node;
+            node.id = pair.first;
+            node.cpus = pair.second;
+            nodes.push_back(node);
+        }
+    }
+    guarantee(!nodes.empty(), "A NUMA topology needs at least one CPU");
+}
+
+static bool read_small_file(const std::string &path, std::string *contents_out) {
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == NULL) {
+        return false;
+    }
+    char buffer[4096];
+    size_t size = fread(buffer, 1, sizeof(buffer) - 1, file);
+    fclose(file);
+    contents_out->assign(buffer, size);
+    return true;
+}
+
+numa_topology_t numa_topology_t::discover() {
+    // The CPUs that we are allowed to run on, or all of them if we can't tell
+    std::set<int> allowed_cpus;
+#if defined(__linux__) && defined(_GNU_SOURCE)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &mask)) {
+                allowed_cpus.insert(cpu);
+            }
+        }
+    }
+#endif
+    if (allowed_cpus.empty()) {
+        for (int cpu = 0; cpu < get_cpu_count(); ++cpu) {
+            allowed_cpus.insert(cpu);
+        }
+    }
+
+    std::map<int, std::vector<int> > cpus_by_node_id;
+    const std::string node_dir = "/sys/devices/system/node";
+    DIR *dir = opendir(node_dir.c_str());
+    if (dir != NULL) {
+        while (struct dirent *entry = readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4
+                || name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+            const int node_id = atoi(name.c_str() + 4);
+            std::string cpu_list;
+            std::vector<int> cpus;
+            if (!read_small_file(node_dir + "/" + name + "/cpulist", &cpu_list)
+                || !parse_cpu_list(cpu_list, &cpus)) {
+                // We'd rather not know about NUMA than know half of it.
+                cpus_by_node_id.clear();
+                break;
+            }
+            std::vector<int> *node_cpus = &cpus_by_node_id[node_id];
+            for (int cpu : cpus) {
+                if (allowed_cpus.count(cpu) != 0) {
+                    node_cpus->push_back(cpu);
+                }
+            }
+        }
+        closedir(dir);
+    }
+
+    size_t num_cpus = 0;
+    for (const auto &pair : cpus_by_node_id) {
+        num_cpus += pair.second.size();
+    }
+    if (num_cpus == 0) {
+        cpus_by_node_id.clear();
+        cpus_by_node_id[0].assign(allowed_cpus.begin(), allowed_cpus.end());
+    }
+    return numa_topology_t(cpus_by_node_id);
+}
+
+std::vector<size_t> numa_topology_t::assign_threads(int num_threads) const {
+    guarantee(num_threads > 0);
+    size_t total_cpus = 0;
+    for (const node_t &node : nodes) {
+        total_cpus += node.cpus.size();
+    }
+
+    std::vector<size_t> node_of_thread;
+    node_of_thread.reserve(num_threads);
+    size_t node = 0;
+    size_t cpus_before_node = 0;
+    for (int i = 0; i < num_threads; ++i) {
+        // Thread `i` takes the place of CPU `position` in the machine's CPUs.
+        const size_t position = static_cast<size_t>(i) * total_cpus / num_threads;
+        while (position >= cpus_before_node + nodes[node].cpus.size()) {
+            cpus_before_node += nodes[node].cpus.size();
+            ++node;
+        }
+        node_of_thread.push_back(node);
+    }
+    return node_of_thread;
+}
+
+bool parse_cpu_list(const std::string &list, std::vector<int> *cpus_out) {
+    cpus_out->clear();
+    size_t pos = 0;
+    const size_t end = list.find_last_not_of(" \n");
+    if (end == std::string::npos) {
+        // An empty list is valid; that's what a node without CPUs has.
+        return true;
+    }
+    while (pos <= end) {
+        const size_t comma = std::min(list.find(',', pos), end + 1);
+        const std::string range = list.substr(pos, comma - pos);
+        const size_t dash = range.find('-');
+        const std::string first_str = range.substr(0, dash);
+        const std::string last_str =
+            dash == std::string::npos ? first_str : range.substr(dash + 1);
+        if (first_str.empty() || last_str.empty()
+            || first_str.find_first_not_of("0123456789") != std::string::npos
+            || last_str.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        const int first = atoi(first_str.c_str());
+        const int last = atoi(last_str.c_str());
+        if (first > last) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus_out->push_back(cpu);
+        }
+        pos = comma + 1;
+    }
+    return true;
+}
+
+bool prefer_numa_node_for_this_thread(UNUSED int node_id) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    // From <numaif.h>, which we don't want to depend on just for this
+    const int MPOL_PREFERRED_MODE = 1;
+    const size_t NODE_MASK_WORDS = 16;
+    const size_t BITS_PER_WORD = 8 * sizeof(unsigned long);  // NOLINT(runtime/int)
+    if (node_id < 0 || static_cast<size_t>(node_id) >= NODE_MASK_WORDS * BITS_PER_WORD) {
+        return false;
+    }
+    unsigned long node_mask[NODE_MASK_WORDS] = { 0 };  // NOLINT(runtime/int)
+    node_mask[node_id / BITS_PER_WORD] |= 1UL << (node_id % BITS_PER_WORD);
+    return syscall(SYS_set_mempolicy, MPOL_PREFERRED_MODE, node_mask,
+                   NODE_MASK_WORDS * BITS_PER_WORD) == 0;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,51 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_NUMA_HPP_
+#define ARCH_RUNTIME_NUMA_HPP_
+
+#include <stddef.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/* `numa_topology_t` is what the thread pool knows about the machine's NUMA nodes:
+which CPUs belong to which node. Nodes are referred to by their index in the topology,
+which is not necessarily the kernel's node id. */
+class numa_topology_t {
+public:
+    /* Maps kernel node ids to the CPUs on those nodes. Nodes without any CPUs are
+    left out. */
+    explicit numa_topology_t(const std::map<int, std::vector<int> > &cpus_by_node_id);
+
+    /* Reads the topology from `/sys/devices/system/node`, leaving out the CPUs that
+    the process isn't allowed to run on. On machines without NUMA, or if the topology
+    can't be read, there is a single node with all of the CPUs. */
+    static numa_topology_t discover();
+
+    size_t num_nodes() const { return nodes.size(); }
+    int node_id(size_t node) const { return nodes[node].id; }
+    const std::vector<int> &node_cpus(size_t node) const { return nodes[node].cpus; }
+
+    /* Spreads `num_threads` threads over the nodes in proportion to how many CPUs
+    each node has. Neighbouring threads go to the same node. Returns the node of each
+    thread. */
+    std::vector<size_t> assign_threads(int num_threads) const;
+
+private:
+    struct node_t {
+        int id;
+        std::vector<int> cpus;
+    };
+    std::vector<node_t> nodes;
+};
+
+/* Parses a list of CPUs in the format that the kernel uses in sysfs, such as
+"0-3,8-11". Returns `false` if the list is malformed. */
+bool parse_cpu_list(const std::string &list, std::vector<int> *cpus_out);
+
+/* Asks the kernel to take the memory that the calling thread faults in from the node
+with the given kernel id, as long as that node has memory to spare. Returns `false`
+if the kernel doesn't support it. */
+bool prefer_numa_node_for_this_thread(int node_id);
+
+#endif  // ARCH_RUNTIME_NUMA_HPP_
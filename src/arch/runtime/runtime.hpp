@@ -11,6 +11,14 @@ threadnum_t get_thread_id();
 
 int get_num_threads();
 
+/* The number of NUMA nodes that the threads are spread over. It's 1 unless the thread
+pool is NUMA-aware and runs on a NUMA machine. */
+int get_num_numa_nodes();
+
+/* The NUMA node, from 0 to `get_num_numa_nodes() - 1`, whose CPUs and memory the
+given thread uses. Threads with neighbouring ids are on the same node. */
+int get_numa_node(threadnum_t thread);
+
 #ifndef NDEBUG
 void assert_good_thread_id(threadnum_t thread);
 #else
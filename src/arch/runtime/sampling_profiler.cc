@@ -0,0 +1,450 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "arch/runtime/sampling_profiler.hpp"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "arch/io/io_utils.hpp"
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime_utils.hpp"
+#include "arch/spinlock.hpp"
+#include "backtrace.hpp"
+#include "perfmon/perfmon.hpp"
+#include "thread_local.hpp"
+
+#ifdef __linux
+// See the comment in `timer_signal_provider.cc`.
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#endif
+
+TLS_with_init(sampling_profiler_t *, thread_profiler, NULL);
+
+void sampling_profiler_t::profile_t::merge(const profile_t &other) {
+    for (auto const &pair : other.counts) {
+        counts[pair.first] += pair.second;
+    }
+    samples += other.samples;
+    dropped += other.dropped;
+}
+
+sampling_profiler_t::sampling_profiler_t(int frequency_hz)
+    : ring(SAMPLING_PROFILER_RING_SIZE),
+      ring_head(0),
+      ring_tail(0),
+      ring_dropped(0),
+      current_interval(get_ticks() / secs_to_ticks(SAMPLING_PROFILER_INTERVAL_SECS)),
+      interval_length(secs_to_ticks(SAMPLING_PROFILER_INTERVAL_SECS)),
+#ifdef __linux
+      has_timer(false),
+#endif
+      thread_stack_bound(0),
+      thread_stack_base(0),
+      drain_timer(SAMPLING_PROFILER_DRAIN_INTERVAL_MS,
+                  std::bind(&sampling_profiler_t::drain, this)) {
+    guarantee(TLS_get_thread_profiler() == NULL,
+              "sampling profiler initialized twice on this thread");
+    TLS_set_thread_profiler(this);
+
+#ifdef __linux
+    if (frequency_hz > 0) {
+        // The signal handler needs to know where the thread's stack is, and
+        // `pthread_getattr_np()` isn't safe to call from there.
+        pthread_attr_t attr;
+        if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+            void *stack_addr;
+            size_t stack_size;
+            if (pthread_attr_getstack(&attr, &stack_addr, &stack_size) == 0) {
+                thread_stack_bound = reinterpret_cast<uintptr_t>(stack_addr);
+                thread_stack_base = thread_stack_bound + stack_size;
+            }
+            pthread_attr_destroy(&attr);
+        }
+
+        // The handler is process-wide. It's harmless to install it again for every
+        // thread, and it's never removed, because other threads may still be sampled.
+        struct sigaction sa = make_sa_sigaction(SA_SIGINFO | SA_RESTART,
+                                                &sampling_profiler_t::sigprof_handler);
+        int res = sigaction(SIGPROF, &sa, NULL);
+        guarantee_err(res == 0, "sampling profiler could not register the signal handler");
+
+        struct sigevent evp;
+        memset(&evp, 0, sizeof(evp));
+        evp.sigev_signo = SIGPROF;
+        evp.sigev_notify = SIGEV_THREAD_ID;
+        evp.sigev_notify_thread_id = _gettid();
+
+        res = timer_create(CLOCK_THREAD_CPUTIME_ID, &evp, &timerid);
+        guarantee_err(res == 0, "Could not create sampling profiler timer");
+        has_timer = true;
+
+        const int64_t period = BILLION / frequency_hz;
+        itimerspec spec;
+        spec.it_value.tv_sec = period / BILLION;
+        spec.it_value.tv_nsec = period % BILLION;
+        spec.it_interval = spec.it_value;
+        res = timer_settime(timerid, 0, &spec, NULL);
+        guarantee_err(res == 0, "Could not arm sampling profiler timer");
+    }
+#else
+    (void)frequency_hz;
+#endif
+}
+
+sampling_profiler_t::~sampling_profiler_t() {
+#ifdef __linux
+    if (has_timer) {
+        int res = timer_delete(timerid);
+        guarantee_err(res == 0, "timer_delete failed");
+    }
+#endif
+    // A signal that was already pending will find no profiler and be ignored.
+    TLS_set_thread_profiler(NULL);
+}
+
+sampling_profiler_t *sampling_profiler_t::get_thread_profiler() {
+    return TLS_get_thread_profiler();
+}
+
+void sampling_profiler_t::get_profile(profile_t *profile_out) {
+    drain();
+    *profile_out = last;
+}
+
+void sampling_profiler_t::get_current_profile(profile_t *profile_out) {
+    drain();
+    *profile_out = current;
+}
+
+int sampling_profiler_t::walk_frame_pointers(uintptr_t pc, uintptr_t sp, uintptr_t fp,
+                                             uintptr_t stack_base,
+                                             void **frames_out, int max_frames) {
+    if (max_frames <= 0) {
+        return 0;
+    }
+    int depth = 0;
+    frames_out[depth++] = reinterpret_cast<void *>(pc);
+    uintptr_t lowest = sp;
+    while (depth < max_frames) {
+        // A frame starts with the caller's frame pointer, followed by the return
+        // address.
+        if (fp < lowest || fp >= stack_base
+            || stack_base - fp < 2 * sizeof(uintptr_t)
+            || fp % sizeof(uintptr_t) != 0) {
+            break;
+        }
+        const uintptr_t *frame = reinterpret_cast<const uintptr_t *>(fp);
+        const uintptr_t return_address = frame[1];
+        if (return_address == 0) {
+            break;
+        }
+        frames_out[depth++] = reinterpret_cast<void *>(return_address);
+        lowest = fp + 2 * sizeof(uintptr_t);
+        fp = frame[0];
+    }
+    return depth;
+}
+
+void sampling_profiler_t::sigprof_handler(UNUSED int signum,
+                                          UNUSED siginfo_t *siginfo,
+                                          void *uctx) {
+    const int saved_errno = errno;
+    sampling_profiler_t *profiler = TLS_get_thread_profiler();
+    if (profiler != NULL) {
+        profiler->record_sample(uctx);
+    }
+    errno = saved_errno;
+}
+
+void sampling_profiler_t::record_sample(void *uctx) {
+    const uint64_t head = ring_head.load(std::memory_order_relaxed);
+    if (head - ring_tail.load(std::memory_order_relaxed) >= ring.size()) {
+        ring_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    sample_t *sample = &ring[head % ring.size()];
+
+    coro_t *coro = coro_t::self();
+    sample->spawn_site = coro == NULL ? NULL : coro->get_spawn_site();
+
+    sample->trace.fill(NULL);
+#if defined(__linux) && defined(__x86_64__)
+    const mcontext_t &mcontext = static_cast<ucontext_t *>(uctx)->uc_mcontext;
+    const uintptr_t pc = mcontext.gregs[REG_RIP];
+    const uintptr_t sp = mcontext.gregs[REG_RSP];
+    const uintptr_t fp = mcontext.gregs[REG_RBP];
+    uintptr_t stack_bound = thread_stack_bound;
+    uintptr_t stack_base = thread_stack_base;
+#ifndef THREADED_COROUTINES
+    if (coro != NULL) {
+        stack_bound = reinterpret_cast<uintptr_t>(coro->get_stack()->get_stack_bound());
+        stack_base = reinterpret_cast<uintptr_t>(coro->get_stack()->get_stack_base());
+    }
+#endif
+    if (sp < stack_bound || sp >= stack_base) {
+        // We were interrupted in the middle of a context switch, or on a stack that
+        // we don't know the bounds of. The interrupted instruction is all we can
+        // safely record.
+        stack_base = 0;
+    }
+    walk_frame_pointers(pc, sp, fp, stack_base,
+                        sample->trace.data(), sample->trace.size());
+#else
+    (void)uctx;
+#endif
+
+    std::atomic_signal_fence(std::memory_order_release);
+    ring_head.store(head + 1, std::memory_order_relaxed);
+}
+
+void sampling_profiler_t::drain() {
+    const int interval = get_ticks() / interval_length;
+    if (interval != current_interval) {
+        if (current_interval + 1 == interval) {
+            last = std::move(current);
+        } else {
+            last = profile_t();
+        }
+        current = profile_t();
+        current_interval = interval;
+    }
+
+    const uint64_t head = ring_head.load(std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_acquire);
+    for (uint64_t i = ring_tail.load(std::memory_order_relaxed); i < head; ++i) {
+        const sample_t &sample = ring[i % ring.size()];
+        execution_point_t point(sample.spawn_site, sample.trace);
+        auto it = current.counts.find(point);
+        if (it != current.counts.end()) {
+            ++it->second;
+            ++current.samples;
+        } else if (current.counts.size() < SAMPLING_PROFILER_MAX_EXECUTION_POINTS) {
+            current.counts.insert(std::make_pair(point, 1));
+            ++current.samples;
+        } else {
+            ++current.dropped;
+        }
+    }
+    std::atomic_signal_fence(std::memory_order_release);
+    ring_tail.store(head, std::memory_order_relaxed);
+
+    current.dropped += ring_dropped.exchange(0, std::memory_order_relaxed);
+}
+
+/* The `coroutine_profile` perfmon */
+
+// `spawn_site` is the `__PRETTY_FUNCTION__` of `coro_t::get_and_init_coro()`. Both
+// GCC and Clang end it with "Callable = <type>]", and the type is all we want.
+static std::string spawn_site_name(const char *spawn_site) {
+    if (spawn_site == NULL) {
+        return "[no coroutine]";
+    }
+    const std::string pretty_function(spawn_site);
+    const std::string marker = "Callable = ";
+    size_t start = pretty_function.find(marker);
+    if (start == std::string::npos) {
+        return pretty_function;
+    }
+    start += marker.size();
+    size_t end = pretty_function.rfind(']');
+    if (end == std::string::npos || end < start) {
+        end = pretty_function.size();
+    }
+    return pretty_function.substr(start, end - start);
+}
+
+// Symbolizing is slow, and the same return addresses come up over and over, so the
+// names are cached. The cache is emptied when it reaches
+// `SAMPLING_PROFILER_MAX_CACHED_FRAME_NAMES`, so that code that keeps producing new
+// return addresses (JIT code, for example) doesn't grow it forever.
+static std::string frame_name(void *addr) {
+    static spinlock_t cache_lock;
+    static std::map<void *, std::string> cache;
+    {
+        spinlock_acq_t acq(&cache_lock);
+        auto it = cache.find(addr);
+        if (it != cache.end()) {
+            return it->second;
+        }
+    }
+
+    backtrace_frame_t frame(addr);
+    frame.initialize_symbols();
+    std::string name;
+    try {
+        name = frame.get_demangled_name();
+    } catch (const demangle_failed_exc_t &) {
+        name = frame.get_name();
+    }
+    if (name.empty()) {
+        name = strprintf("%p", addr);
+    }
+    // Flame graphs are unreadable with full parameter lists, and `;` separates
+    // frames in the folded format.
+    name = name.substr(0, name.find('('));
+    std::replace(name.begin(), name.end(), ';', ':');
+
+    spinlock_acq_t acq(&cache_lock);
+    if (cache.size() >= SAMPLING_PROFILER_MAX_CACHED_FRAME_NAMES) {
+        cache.clear();
+    }
+    return cache.insert(std::make_pair(addr, name)).first->second;
+}
+
+// What the `coroutine_profile` perfmon reports for one interval
+struct coroutine_profile_report_t {
+    uint64_t samples;
+    uint64_t dropped;
+    // Sample counts by spawn site, most frequent first
+    std::vector<std::pair<uint64_t, std::string> > spawn_sites;
+    // The most frequent stacks in the input format of `flamegraph.pl`
+    std::vector<std::string> folded;
+};
+
+static void make_report(const sampling_profiler_t::profile_t &profile,
+                        coroutine_profile_report_t *report_out) {
+    std::vector<std::pair<uint64_t, const sampling_profiler_t::execution_point_t *> >
+        points;
+    std::map<std::string, uint64_t> spawn_site_samples;
+    for (auto const &pair : profile.counts) {
+        points.push_back(std::make_pair(pair.second, &pair.first));
+        spawn_site_samples[spawn_site_name(pair.first.first)] += pair.second;
+    }
+    std::sort(points.begin(), points.end(),
+        [](const std::pair<uint64_t, const sampling_profiler_t::execution_point_t *> &a,
+           const std::pair<uint64_t, const sampling_profiler_t::execution_point_t *> &b) {
+            return a.first > b.first;
+        });
+    if (points.size() > SAMPLING_PROFILER_MAX_REPORTED_STACKS) {
+        points.resize(SAMPLING_PROFILER_MAX_REPORTED_STACKS);
+    }
+
+    report_out->samples = profile.samples;
+    report_out->dropped = profile.dropped;
+
+    // One line per stack, outermost frame first, followed by the number of samples.
+    report_out->folded.clear();
+    for (auto const &point : points) {
+        std::string line = spawn_site_name(point.second->first);
+        const sampling_profiler_t::small_trace_t &trace = point.second->second;
+        for (size_t i = trace.size(); i-- > 0;) {
+            if (trace[i] != NULL) {
+                line += ";" + frame_name(trace[i]);
+            }
+        }
+        line += strprintf(" %" PRIu64, point.first);
+        report_out->folded.push_back(line);
+    }
+
+    report_out->spawn_sites.clear();
+    for (auto const &pair : spawn_site_samples) {
+        report_out->spawn_sites.push_back(std::make_pair(pair.second, pair.first));
+    }
+    std::sort(report_out->spawn_sites.rbegin(), report_out->spawn_sites.rend());
+}
+
+static ql::datum_t report_to_datum(const coroutine_profile_report_t &report) {
+    ql::datum_array_builder_t spawn_sites_builder(ql::configured_limits_t::unlimited);
+    for (auto const &pair : report.spawn_sites) {
+        ql::datum_object_builder_t site_builder;
+        site_builder.overwrite("spawn_site", ql::datum_t(datum_string_t(pair.second)));
+        site_builder.overwrite("samples", ql::datum_t(static_cast<double>(pair.first)));
+        spawn_sites_builder.add(std::move(site_builder).to_datum());
+    }
+
+    ql::datum_array_builder_t folded_builder(ql::configured_limits_t::unlimited);
+    for (auto const &line : report.folded) {
+        folded_builder.add(ql::datum_t(datum_string_t(line)));
+    }
+
+    ql::datum_object_builder_t builder;
+    builder.overwrite("frequency_hz",
+                      ql::datum_t(static_cast<double>(SAMPLING_PROFILER_FREQUENCY_HZ)));
+    builder.overwrite("interval_secs",
+                      ql::datum_t(static_cast<double>(SAMPLING_PROFILER_INTERVAL_SECS)));
+    builder.overwrite("samples", ql::datum_t(static_cast<double>(report.samples)));
+    builder.overwrite("dropped", ql::datum_t(static_cast<double>(report.dropped)));
+    builder.overwrite("spawn_sites", std::move(spawn_sites_builder).to_datum());
+    builder.overwrite("folded", std::move(folded_builder).to_datum());
+    return std::move(builder).to_datum();
+}
+
+/* The profiles only change once per interval, but the stats are polled much more
+often than that, and merging and symbolizing the profiles is expensive. So the
+threads' profiles are only collected when the cached report is from an earlier
+interval. */
+class perfmon_coroutine_profile_t : public perfmon_t {
+public:
+    perfmon_coroutine_profile_t() : report_interval(-1) { }
+
+    void *begin_stats() {
+        stats_context_t *ctx = new stats_context_t;
+        ctx->interval =
+            get_ticks() / secs_to_ticks(SAMPLING_PROFILER_INTERVAL_SECS);
+        {
+            spinlock_acq_t acq(&report_lock);
+            ctx->refresh = report == nullptr || report_interval != ctx->interval;
+        }
+        if (ctx->refresh) {
+            ctx->profiles.resize(get_num_threads());
+        }
+        return ctx;
+    }
+
+    void visit_stats(void *v_ctx) {
+        stats_context_t *ctx = static_cast<stats_context_t *>(v_ctx);
+        sampling_profiler_t *profiler = sampling_profiler_t::get_thread_profiler();
+        if (ctx->refresh && profiler != NULL) {
+            profiler->get_profile(&ctx->profiles[get_thread_id().threadnum]);
+        }
+    }
+
+    ql::datum_t end_stats(void *v_ctx) {
+        std::unique_ptr<stats_context_t> ctx(static_cast<stats_context_t *>(v_ctx));
+        std::shared_ptr<const coroutine_profile_report_t> to_output;
+        if (ctx->refresh) {
+            sampling_profiler_t::profile_t combined;
+            for (auto const &profile : ctx->profiles) {
+                combined.merge(profile);
+            }
+            auto fresh = std::make_shared<coroutine_profile_report_t>();
+            make_report(combined, fresh.get());
+            to_output = fresh;
+
+            spinlock_acq_t acq(&report_lock);
+            if (report == nullptr || report_interval <= ctx->interval) {
+                report = to_output;
+                report_interval = ctx->interval;
+            }
+        } else {
+            spinlock_acq_t acq(&report_lock);
+            to_output = report;
+        }
+        return report_to_datum(*to_output);
+    }
+
+private:
+    struct stats_context_t {
+        int64_t interval;
+        bool refresh;
+        std::vector<sampling_profiler_t::profile_t> profiles;
+    };
+
+    // Stats can be requested from any thread.
+    spinlock_t report_lock;
+    std::shared_ptr<const coroutine_profile_report_t> report;
+    int64_t report_interval;
+};
+
+static perfmon_coroutine_profile_t pm_coroutine_profile;
+static perfmon_membership_t pm_coroutine_profile_membership(
+    &get_global_perfmon_collection(), &pm_coroutine_profile, "coroutine_profile");
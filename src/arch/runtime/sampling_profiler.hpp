@@ -0,0 +1,128 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_SAMPLING_PROFILER_HPP_
+#define ARCH_RUNTIME_SAMPLING_PROFILER_HPP_
+
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "arch/timing.hpp"
+#include "config/args.hpp"
+#include "time.hpp"
+
+/*
+ * The `sampling_profiler_t` tells us which coroutines are burning CPU, without
+ * needing a special build. Unlike `coro_profiler_t`, which records a sample every
+ * time a coroutine yields and therefore has to be compiled in, it is cheap enough to
+ * be always on.
+ *
+ * Every thread in the thread pool owns one. It creates a POSIX timer on the thread's
+ * CPU-time clock, which sends the thread a `SIGPROF` every
+ * 1/`SAMPLING_PROFILER_FREQUENCY_HZ` seconds of CPU time. The signal handler records
+ * the spawn site of the running coroutine (see `coro_t::get_spawn_site()`) and a
+ * short backtrace into a ring buffer; if the ring buffer is full, the sample is
+ * dropped and counted. Every `SAMPLING_PROFILER_DRAIN_INTERVAL_MS` the thread folds
+ * the ring buffer into a map from execution point to sample count.
+ *
+ * The signal can arrive anywhere, including inside `malloc()` or the unwinder, so the
+ * handler must stay async-signal-safe. It doesn't lock, allocate or call `backtrace()`
+ * (which takes the unwinder's locks). Instead it follows the frame pointers from the
+ * interrupted register state, and only reads memory between the interrupted stack
+ * pointer and the base of the stack that it was running on. In builds that omit frame
+ * pointers (the default release build; see `NO_OMIT_FRAME_POINTER`) the walk stops
+ * early and usually only the interrupted instruction is recorded.
+ *
+ * The profiles of all threads are reported through the `coroutine_profile` perfmon,
+ * which shows up in `rethinkdb._debug_stats`. Its `folded` field is in the input
+ * format of `flamegraph.pl`. The report only changes once per interval, so it's
+ * computed the first time that it's asked for in each interval and cached.
+ *
+ * Only Linux on x86-64 has what the profiler needs; on other platforms it never
+ * records anything.
+ */
+class sampling_profiler_t {
+public:
+    typedef std::array<void *, SAMPLING_PROFILER_BACKTRACE_DEPTH> small_trace_t;
+    // We identify an execution point by the spawn site of the coroutine that was
+    // running (or `NULL` outside of coroutines) and a backtrace, innermost frame
+    // first, padded with `NULL`s.
+    typedef std::pair<const char *, small_trace_t> execution_point_t;
+
+    struct profile_t {
+        profile_t() : samples(0), dropped(0) { }
+        void merge(const profile_t &other);
+
+        std::map<execution_point_t, uint64_t> counts;
+        uint64_t samples;
+        // Samples that didn't fit into the ring buffer or into `counts`
+        uint64_t dropped;
+    };
+
+    // Starts sampling the current thread, which must be a thread of the thread pool.
+    explicit sampling_profiler_t(int frequency_hz);
+    ~sampling_profiler_t();
+
+    // Returns the profiler of the current thread, or `NULL`.
+    static sampling_profiler_t *get_thread_profiler();
+
+    // Returns the profile of the last complete interval.
+    void get_profile(profile_t *profile_out);
+
+    // Returns the profile of the interval that is in progress.
+    void get_current_profile(profile_t *profile_out);
+
+    // Follows the chain of frame pointers that starts at `fp`, and writes `pc`
+    // followed by the return address of each frame to `frames_out`. Only the memory in
+    // [`sp`, `stack_base`) is read, and each frame has to be further out than the one
+    // before, so a corrupt or missing chain just ends the walk. Returns the number of
+    // frames written, at most `max_frames`. It's async-signal-safe.
+    static int walk_frame_pointers(uintptr_t pc, uintptr_t sp, uintptr_t fp,
+                                   uintptr_t stack_base,
+                                   void **frames_out, int max_frames);
+
+private:
+    struct sample_t {
+        const char *spawn_site;
+        small_trace_t trace;
+    };
+
+    static void sigprof_handler(int signum, siginfo_t *siginfo, void *uctx);
+
+    // Called from the signal handler with the interrupted register state
+    void record_sample(void *uctx);
+
+    // Moves the samples from the ring buffer into `current`.
+    void drain();
+
+    std::vector<sample_t> ring;
+    // `ring_head` is only written by the signal handler, and `ring_tail` is only
+    // written by `drain()`. Both run on this thread, so nothing needs to be stronger
+    // than a signal fence; `std::atomic` just makes the compiler see that.
+    std::atomic<uint64_t> ring_head;
+    std::atomic<uint64_t> ring_tail;
+    std::atomic<uint64_t> ring_dropped;
+
+    profile_t current, last;
+    int current_interval;
+    const ticks_t interval_length;
+
+#ifdef __linux
+    bool has_timer;
+    timer_t timerid;
+#endif
+
+    // The stack of the thread itself, which is where we run outside of coroutines
+    uintptr_t thread_stack_bound, thread_stack_base;
+
+    repeating_timer_t drain_timer;
+
+    DISABLE_COPYING(sampling_profiler_t);
+};
+
+#endif  // ARCH_RUNTIME_SAMPLING_PROFILER_HPP_
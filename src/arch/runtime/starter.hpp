@@ -8,8 +8,10 @@
 
 /* `run_in_thread_pool()` starts a RethinkDB thread pool, runs the given
 function in a coroutine inside of it, waits for the function to return, and then
-shuts down the thread pool. */
+shuts down the thread pool. If `numa_aware` is true, the threads and their memory are
+placed on the machine's NUMA nodes; see `linux_thread_pool_t`. */
 
-void run_in_thread_pool(const std::function<void()> &fun, int worker_threads);
+void run_in_thread_pool(const std::function<void()> &fun, int worker_threads,
+                        bool numa_aware = false);
 
 #endif  // ARCH_RUNTIME_STARTER_HPP_
@@ -10,8 +10,10 @@
 #include "arch/barrier.hpp"
 #include "arch/os_signal.hpp"
 #include "arch/io/timer_provider.hpp"
+#include "arch/runtime/coroutines.hpp"
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/runtime.hpp"
+#include "arch/runtime/sampling_profiler.hpp"
 #include "errors.hpp"
 #include "logger.hpp"
 #include "utils.hpp"
@@ -43,18 +45,36 @@ NOINLINE void linux_thread_pool_t::set_thread(linux_thread_t *val) {
     thread = val;
 }
 
-linux_thread_pool_t::linux_thread_pool_t(int worker_threads, bool _do_set_affinity) :
+static numa_topology_t get_numa_topology(bool numa_aware) {
+    if (numa_aware) {
+        return numa_topology_t::discover();
+    }
+    std::map<int, std::vector<int> > single_node;
+    for (int cpu = 0; cpu < get_cpu_count(); ++cpu) {
+        single_node[0].push_back(cpu);
+    }
+    return numa_topology_t(single_node);
+}
+
+linux_thread_pool_t::linux_thread_pool_t(int worker_threads, bool _do_set_affinity,
+                                         bool numa_aware) :
 #ifndef NDEBUG
       coroutine_summary(false),
 #endif
       interrupt_message(NULL),
       generic_blocker_pool(NULL),
       n_threads(worker_threads + 1),    // we create an extra utility thread
-      do_set_affinity(_do_set_affinity)
+      do_set_affinity(_do_set_affinity),
+      numa_topology(get_numa_topology(numa_aware))
 {
     rassert(n_threads > 1);             // we want at least one non-utility thread
     rassert(n_threads <= MAX_THREADS);
 
+    std::vector<size_t> nodes = numa_topology.assign_threads(n_threads);
+    for (int i = 0; i < n_threads; ++i) {
+        thread_numa_nodes[i] = nodes[i];
+    }
+
     int res;
 
     res = pthread_cond_init(&shutdown_cond, NULL);
@@ -84,8 +104,8 @@ struct thread_data_t {
 };
 
 void *linux_thread_pool_t::start_thread(void *arg) {
-    // Block all signals but `SIGSEGV` (will be unblocked by the event queue in
-    // case of poll).
+    // Block all signals but `SIGSEGV` and the sampling profiler's `SIGPROF` (will be
+    // unblocked by the event queue in case of poll).
     {
         sigset_t sigmask;
         int res = sigfillset(&sigmask);
@@ -94,6 +114,9 @@ void *linux_thread_pool_t::start_thread(void *arg) {
         res = sigdelset(&sigmask, SIGSEGV);
         guarantee_err(res == 0, "Could not remove SIGSEGV from sigmask");
 
+        res = sigdelset(&sigmask, SIGPROF);
+        guarantee_err(res == 0, "Could not remove SIGPROF from sigmask");
+
         res = pthread_sigmask(SIG_SETMASK, &sigmask, NULL);
         guarantee_xerr(res == 0, res, "Could not block signal");
     }
@@ -104,6 +127,13 @@ void *linux_thread_pool_t::start_thread(void *arg) {
     set_thread_pool(tdata->thread_pool);
     set_thread_id(tdata->current_thread);
 
+    // Everything that this thread allocates from now on, including its event queue,
+    // its coroutine stacks and the cache blocks that it reads, should be close to it.
+    if (tdata->thread_pool->numa_topology.num_nodes() > 1) {
+        const size_t node = tdata->thread_pool->thread_numa_nodes[tdata->current_thread];
+        prefer_numa_node_for_this_thread(tdata->thread_pool->numa_topology.node_id(node));
+    }
+
     // Use a separate block so that it's very clear how long the thread lives for
     // It's not really necessary, but I like it.
     {
@@ -132,6 +162,10 @@ void *linux_thread_pool_t::start_thread(void *arg) {
 
 #endif  // VALGRIND
 
+        // This needs `set_thread()`, because it starts a timer on this thread.
+        scoped_ptr_t<sampling_profiler_t> sampling_profiler(
+            new sampling_profiler_t(SAMPLING_PROFILER_FREQUENCY_HZ));
+
         // First thread should initialize generic_blocker_pool before the start barrier
         if (tdata->initial_message) {
             rassert(tdata->thread_pool->generic_blocker_pool == NULL, "generic_blocker_pool already initialized");
@@ -154,6 +188,8 @@ void *linux_thread_pool_t::start_thread(void *arg) {
 
         local_thread.queue.run();
 
+        sampling_profiler.reset();
+
         // If one thread is allowed to delete itself before another one has
         // broken out of its loop, it might delete something that the other thread
         // needed to access.
@@ -210,6 +246,21 @@ void linux_thread_pool_t::run_thread_pool(linux_thread_message_t *initial_messag
             CPU_SET(i % ncpus, &mask);
             res = pthread_setaffinity_np(pthreads[i], sizeof(cpu_set_t), &mask);
             guarantee_xerr(res == 0, res, "Could not set thread affinity");
+#endif
+        } else if (numa_topology.num_nodes() > 1) {
+#ifdef _GNU_SOURCE
+            // Keep the thread on the CPUs of its NUMA node
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            for (int cpu : numa_topology.node_cpus(thread_numa_nodes[i])) {
+                CPU_SET(cpu, &mask);
+            }
+            res = pthread_setaffinity_np(pthreads[i], sizeof(cpu_set_t), &mask);
+            if (res != 0) {
+                logWRN("Could not keep thread %d on NUMA node %d: %s",
+                       i, numa_topology.node_id(thread_numa_nodes[i]),
+                       errno_string(res).c_str());
+            }
 #endif
         }
     }
@@ -338,7 +389,11 @@ void linux_thread_pool_t::interrupt_handler(int signo, siginfo_t *siginfo, void
 void linux_thread_pool_t::sigsegv_handler(int signum, siginfo_t *info, UNUSED void *data) {
     if (signum == SIGSEGV) {
         if (is_coroutine_stack_overflow(info->si_addr)) {
-            crash("Callstack overflow in a coroutine");
+            coro_t *coro = coro_t::self();
+            const char *spawn_site = coro->get_spawn_site();
+            crash("Callstack overflow in a coroutine with a %zu byte stack, spawned by %s",
+                  coro->get_stack()->get_stack_size(),
+                  spawn_site != NULL ? spawn_site : "an unknown site");
         } else {
             crash("Segmentation fault from reading the address %p.", info->si_addr);
         }
@@ -12,6 +12,8 @@
 #include "arch/runtime/system_event.hpp"
 #include "arch/runtime/message_hub.hpp"
 #include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/numa.hpp"
+#include "arch/spinlock.hpp"
 #include "arch/io/blocker_pool.hpp"
 #include "arch/io/timer_provider.hpp"
 #include "arch/timer.hpp"
@@ -35,11 +37,16 @@ struct coro_runtime_t {
 
 /* A thread pool represents a group of threads, each of which is associated with an
 event queue. There is one thread pool per server. It is responsible for starting up
-and shutting down the threads and event queues. */
+and shutting down the threads and event queues.
+
+If the thread pool is NUMA-aware and the machine has more than one NUMA node, the
+threads are spread over the nodes in blocks of neighbouring thread ids. Each thread is
+allowed to run on the CPUs of its node, and the kernel is asked to take the memory that
+it faults in from that node. */
 
 class linux_thread_pool_t {
 public:
-    linux_thread_pool_t(int worker_threads, bool do_set_affinity);
+    linux_thread_pool_t(int worker_threads, bool do_set_affinity, bool numa_aware);
 
     // When the process receives a SIGINT or SIGTERM, interrupt_message will be delivered to the
     // same thread that initial_message was delivered to, and interrupt_message will be set to
@@ -92,6 +99,11 @@ public:
     int n_threads;
     bool do_set_affinity;
 
+    /* The topology that the threads were placed on; it has a single node if the thread
+    pool isn't NUMA-aware. `thread_numa_nodes[i]` is thread `i`'s node in it. */
+    numa_topology_t numa_topology;
+    size_t thread_numa_nodes[MAX_THREADS];
+
     // Non-inlinable getters and setters for the thread local variables.
     // See thread_local.hpp for an explanation of why these must not be
     // inlined.
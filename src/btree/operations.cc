@@ -7,6 +7,7 @@
 #include "buffer_cache/alt.hpp"
 #include "buffer_cache/blob.hpp"
 #include "containers/archive/vector_stream.hpp"
+#include "perfmon/resource_usage.hpp"
 #include "rdb_protocol/profile.hpp"
 #include "rdb_protocol/store.hpp"
 
@@ -468,6 +469,7 @@ void find_keyvalue_location_for_read(
         btree_stats_t *stats, profile::trace_t *trace) {
     stats->pm_keys_read.record();
     stats->pm_total_keys_read += 1;
+    resource_usage_t::note_rows_scanned(1);
 
     const block_id_t root_id = superblock->get_root_block_id();
     rassert(root_id != SUPERBLOCK_ID);
@@ -538,6 +540,103 @@ void find_keyvalue_location_for_read(
     }
 }
 
+/* Looks up `keys[begin]` through `keys[end - 1]` in the subtree rooted at `*buf`. */
+static void find_keyvalue_locations_in_subtree(
+        value_sizer_t *sizer,
+        buf_lock_t *buf,
+        const std::vector<const btree_key_t *> &keys, size_t begin, size_t end,
+        keyvalue_locations_read_callback_t *cb,
+        profile::trace_t *trace) {
+#ifndef NDEBUG
+    {
+        buf_read_t read(buf);
+        node::validate(sizer, static_cast<const node_t *>(read.get_data_read()));
+    }
+#endif  // NDEBUG
+
+    bool is_leaf;
+    {
+        buf_read_t read(buf);
+        is_leaf = !node::is_internal(static_cast<const node_t *>(read.get_data_read()));
+    }
+
+    if (is_leaf) {
+        scoped_malloc_t<void> value(sizer->max_possible_size());
+        for (size_t i = begin; i < end; ++i) {
+            bool value_found;
+            {
+                buf_read_t read(buf);
+                const leaf_node_t *leaf
+                    = static_cast<const leaf_node_t *>(read.get_data_read());
+                value_found = leaf::lookup(sizer, leaf, keys[i], value.get());
+            }
+            if (value_found) {
+                cb->on_value(i, value.get(), buf_parent_t(buf));
+            }
+        }
+        return;
+    }
+
+    /* The keys are sorted, so the ones that belong to the same child are next to
+    each other. */
+    size_t i = begin;
+    while (i < end) {
+        block_id_t node_id;
+        size_t j = i + 1;
+        {
+            buf_read_t read(buf);
+            const internal_node_t *node
+                = static_cast<const internal_node_t *>(read.get_data_read());
+            node_id = internal_node::lookup(node, keys[i]);
+            while (j < end && internal_node::lookup(node, keys[j]) == node_id) {
+                ++j;
+            }
+        }
+        rassert(node_id != NULL_BLOCK_ID && node_id != SUPERBLOCK_ID);
+
+        buf_lock_t child;
+        {
+            profile::starter_t starter("Acquire a block for read.", trace);
+            child = buf_lock_t(buf, node_id, access_t::read);
+        }
+        find_keyvalue_locations_in_subtree(sizer, &child, keys, i, j, cb, trace);
+        i = j;
+    }
+}
+
+void find_keyvalue_locations_for_read(
+        value_sizer_t *sizer,
+        superblock_t *superblock, const std::vector<const btree_key_t *> &keys,
+        keyvalue_locations_read_callback_t *cb,
+        btree_stats_t *stats, profile::trace_t *trace) {
+#ifndef NDEBUG
+    for (size_t i = 1; i < keys.size(); ++i) {
+        rassert(btree_key_cmp(keys[i - 1], keys[i]) <= 0);
+    }
+#endif
+    stats->pm_keys_read.record(keys.size());
+    stats->pm_total_keys_read += keys.size();
+    resource_usage_t::note_rows_scanned(keys.size());
+
+    const block_id_t root_id = superblock->get_root_block_id();
+    rassert(root_id != SUPERBLOCK_ID);
+
+    if (root_id == NULL_BLOCK_ID || keys.empty()) {
+        superblock->release();
+        return;
+    }
+
+    buf_lock_t buf;
+    {
+        profile::starter_t starter("Acquire a block for read.", trace);
+        buf_lock_t tmp(superblock->expose_buf(), root_id, access_t::read);
+        superblock->release();
+        buf = std::move(tmp);
+    }
+
+    find_keyvalue_locations_in_subtree(sizer, &buf, keys, 0, keys.size(), cb, trace);
+}
+
 void apply_keyvalue_change(
         value_sizer_t *sizer,
         keyvalue_location_t *kv_loc,
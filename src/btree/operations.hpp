@@ -209,6 +209,24 @@ void find_keyvalue_location_for_read(
         keyvalue_location_t *keyvalue_location_out,
         btree_stats_t *stats, profile::trace_t *trace);
 
+/* `find_keyvalue_locations_for_read()` calls `on_value()` for each of the keys that
+has a value, in key order, while the leaf node holding the value is still acquired. */
+class keyvalue_locations_read_callback_t {
+public:
+    virtual void on_value(size_t key_index, const void *value, buf_parent_t leaf) = 0;
+protected:
+    virtual ~keyvalue_locations_read_callback_t() { }
+};
+
+/* Looks up all of `keys`, which must be sorted, in one ordered walk down the tree.
+Every node on the way to one of the keys is acquired only once, no matter how many of
+the keys are below it. Releases the superblock. */
+void find_keyvalue_locations_for_read(
+        value_sizer_t *sizer,
+        superblock_t *superblock, const std::vector<const btree_key_t *> &keys,
+        keyvalue_locations_read_callback_t *cb,
+        btree_stats_t *stats, profile::trace_t *trace);
+
 /* Specifies whether `apply_keyvalue_change` should delete or erase a value.
 The difference is that deleting a value updates the node's replication timestamp
 and creates a deletion entry in the leaf. This means that the deletion is going
@@ -6,6 +6,7 @@
 #include "arch/runtime/coroutines.hpp"
 #include "buffer_cache/stats.hpp"
 #include "concurrency/auto_drainer.hpp"
+#include "perfmon/resource_usage.hpp"
 #include "utils.hpp"
 
 #define ALT_DEBUG 0
@@ -724,7 +725,11 @@ page_t *buf_lock_t::get_held_page_for_read() {
     current_page_acq_t *cpa = current_page_acq();
     guarantee(cpa != NULL);
     // We only wait here so that we can guarantee(!empty()) after it's pulsed.
-    cpa->read_acq_signal()->wait();
+    if (!cpa->read_acq_signal()->is_pulsed()) {
+        const ticks_t start_time = get_ticks();
+        cpa->read_acq_signal()->wait();
+        resource_usage_t::note_lock_wait(get_ticks() - start_time);
+    }
 
     ASSERT_FINITE_CORO_WAITING;
     guarantee(!empty());
@@ -735,7 +740,11 @@ page_t *buf_lock_t::get_held_page_for_write() {
     guarantee(!empty());
     rassert(snapshot_node_ == NULL);
     // We only wait here so that we can guarantee(!empty()) after it's pulsed.
-    current_page_acq_->write_acq_signal()->wait();
+    if (!current_page_acq_->write_acq_signal()->is_pulsed()) {
+        const ticks_t start_time = get_ticks();
+        current_page_acq_->write_acq_signal()->wait();
+        resource_usage_t::note_lock_wait(get_ticks() - start_time);
+    }
 
     ASSERT_FINITE_CORO_WAITING;
     guarantee(!empty());
@@ -758,6 +767,7 @@ const void *buf_read_t::get_data_read(uint32_t *block_size_out) {
     if (!page_acq_.has()) {
         page_acq_.init(page, &lock_->cache()->page_cache_,
                        lock_->txn()->account());
+        resource_usage_t::note_block_read(page_acq_.buf_ready_signal()->is_pulsed());
     }
     page_acq_.buf_ready_signal()->wait();
     *block_size_out = page_acq_.get_buf_size().value();
@@ -780,6 +790,7 @@ void *buf_write_t::get_data_write(uint32_t block_size) {
     if (!page_acq_.has()) {
         page_acq_.init(page, &lock_->cache()->page_cache_,
                        lock_->txn()->account());
+        resource_usage_t::note_block_read(page_acq_.buf_ready_signal()->is_pulsed());
     }
     page_acq_.buf_ready_signal()->wait();
     return page_acq_.get_buf_write(block_size_t::make_from_cache(block_size));
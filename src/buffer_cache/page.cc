@@ -2,6 +2,7 @@
 
 #include "arch/runtime/coroutines.hpp"
 #include "buffer_cache/page_cache.hpp"
+#include "perfmon/perfmon.hpp"
 #include "serializer/serializer.hpp"
 
 namespace alt {
@@ -262,6 +263,7 @@ void page_t::catch_up_with_deferred_load(
     page_cache->evicter().catch_up_deferred_load(page);
 
     buf_ptr_t buf;
+    const ticks_t start_time = get_ticks();
     {
         serializer_t *const serializer = page_cache->serializer();
 
@@ -274,6 +276,7 @@ void page_t::catch_up_with_deferred_load(
         buf = serializer->block_read(block_token_ptr->token,
                                      account->get());
     }
+    page_cache->load_latency()->record(get_ticks() - start_time);
 
     ASSERT_FINITE_CORO_WAITING;
     if (our_loader.abandon_page()) {
@@ -349,6 +352,7 @@ void page_t::load_with_block_id(page_t *page, block_id_t block_id,
     buf_ptr_t buf;
     counted_t<standard_block_token_t> block_token;
 
+    const ticks_t start_time = get_ticks();
     {
         serializer_t *const serializer = page_cache->serializer();
         on_thread_t th(serializer->home_thread());
@@ -357,6 +361,7 @@ void page_t::load_with_block_id(page_t *page, block_id_t block_id,
         buf = serializer->block_read(block_token,
                                      account->get());
     }
+    page_cache->load_latency()->record(get_ticks() - start_time);
 
     ASSERT_FINITE_CORO_WAITING;
     if (loader.abandon_page()) {
@@ -11,7 +11,9 @@
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/new_mutex.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "config/args.hpp"
 #include "do_on_thread.hpp"
+#include "perfmon/perfmon.hpp"
 #include "serializer/serializer.hpp"
 #include "stl_utils.hpp"
 
@@ -198,6 +200,8 @@ page_cache_t::page_cache_t(serializer_t *serializer,
       serializer_(serializer),
       free_list_(serializer),
       evicter_(),
+      load_latency_(make_scoped<perfmon_latency_histogram_t>(
+                        secs_to_ticks(LATENCY_HISTOGRAM_INTERVAL_SECS))),
       read_ahead_cb_(NULL),
       drainer_(make_scoped<auto_drainer_t>()) {
 
@@ -30,6 +30,7 @@ class cache_balancer_t;
 class auto_drainer_t;
 class cache_t;
 class file_account_t;
+class perfmon_latency_histogram_t;
 
 namespace alt {
 class current_page_acq_t;
@@ -352,6 +353,9 @@ public:
     auto_drainer_t::lock_t drainer_lock() { return drainer_->lock(); }
     serializer_t *serializer() { return serializer_; }
 
+    // How long it takes to load a page that wasn't in memory.
+    perfmon_latency_histogram_t *load_latency() { return load_latency_.get(); }
+
 private:
     friend class page_read_ahead_cb_t;
     void add_read_ahead_buf(block_id_t block_id,
@@ -443,6 +447,8 @@ private:
 
     evicter_t evicter_;
 
+    scoped_ptr_t<perfmon_latency_histogram_t> load_latency_;
+
     // KSI: I bet this read_ahead_cb_ and read_ahead_cb_existence_ type could be
     // packaged in some new cross_thread_ptr type.
     page_read_ahead_cb_t *read_ahead_cb_;
@@ -11,6 +11,8 @@ alt_cache_stats_t::alt_cache_stats_t(alt::page_cache_t *_page_cache,
     in_use_bytes(this),
     in_use_bytes_membership(&cache_collection,
                             &in_use_bytes, "in_use_bytes"),
+    miss_latency_membership(&cache_collection,
+                            _page_cache->load_latency(), "miss_latency_ms"),
     cache_collection_membership(&cache_collection) { }
 
 alt_cache_stats_t::perfmon_value_t::perfmon_value_t(alt_cache_stats_t *_parent) :
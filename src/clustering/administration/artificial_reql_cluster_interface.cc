@@ -320,11 +320,23 @@ admin_artificial_tables_t::admin_artificial_tables_t(
             _mailbox_manager,
             _directory_map_view,
             _server_config_client,
-            static_cast<admin_identifier_format_t>(i)));
+            static_cast<admin_identifier_format_t>(i),
+            log_file_t::server_log));
     }
     backends[name_string_t::guarantee_valid("logs")] =
         std::make_pair(logs_backend[0].get(), logs_backend[1].get());
 
+    for (int i = 0; i < 2; ++i) {
+        slow_queries_backend[i].init(new logs_artificial_table_backend_t(
+            _mailbox_manager,
+            _directory_map_view,
+            _server_config_client,
+            static_cast<admin_identifier_format_t>(i),
+            log_file_t::slow_query_log));
+    }
+    backends[name_string_t::guarantee_valid("slow_queries")] =
+        std::make_pair(slow_queries_backend[0].get(), slow_queries_backend[1].get());
+
     server_config_backend.init(new server_config_artificial_table_backend_t(
         metadata_field(&cluster_semilattice_metadata_t::servers,
             _semilattice_view),
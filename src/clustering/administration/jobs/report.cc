@@ -218,12 +218,16 @@ query_job_report_t::query_job_report_t(
         double _duration,
         server_id_t const &_server_id,
         ip_and_port_t const &_client_addr_port,
-        std::string const &_query)
+        std::string const &_query,
+        resource_usage_t const &_resource_usage)
     : job_report_base_t<query_job_report_t>("query", _id, _duration, _server_id),
       client_addr_port(_client_addr_port),
-      query(_query) { }
+      query(_query),
+      resource_usage(_resource_usage) { }
 
-void query_job_report_t::merge_derived(query_job_report_t const &) { }
+void query_job_report_t::merge_derived(query_job_report_t const &job_report) {
+    resource_usage.add(job_report.resource_usage);
+}
 
 bool query_job_report_t::info_derived(
         UNUSED admin_identifier_format_t identifier_format,
@@ -235,9 +239,46 @@ bool query_job_report_t::info_derived(
     info_builder_out->overwrite("client_port",
         convert_port_to_datum(client_addr_port.port().value()));
     info_builder_out->overwrite("query", convert_string_to_datum(query));
+    info_builder_out->overwrite("resources", resource_usage.to_datum());
 
     return true;
 }
 
-RDB_IMPL_SERIALIZABLE_6_FOR_CLUSTER(
-    query_job_report_t, type, id, duration, servers, client_addr_port, query);
+// `resource_usage` was added in v2_1.
+template <cluster_version_t W>
+void serialize(write_message_t *wm, const query_job_report_t &r) {
+    serialize<W>(wm, r.type);
+    serialize<W>(wm, r.id);
+    serialize<W>(wm, r.duration);
+    serialize<W>(wm, r.servers);
+    serialize<W>(wm, r.client_addr_port);
+    serialize<W>(wm, r.query);
+    if (W >= cluster_version_t::v2_1) {
+        serialize<W>(wm, r.resource_usage);
+    }
+}
+
+template <cluster_version_t W>
+archive_result_t deserialize(read_stream_t *s, query_job_report_t *r) {
+    archive_result_t res = deserialize<W>(s, &r->type);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &r->id);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &r->duration);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &r->servers);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &r->client_addr_port);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &r->query);
+    if (bad(res)) { return res; }
+    if (W >= cluster_version_t::v2_1) {
+        res = deserialize<W>(s, &r->resource_usage);
+        if (bad(res)) { return res; }
+    } else {
+        r->resource_usage = resource_usage_t();
+    }
+    return archive_result_t::SUCCESS;
+}
+
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(query_job_report_t);
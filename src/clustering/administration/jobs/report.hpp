@@ -10,6 +10,7 @@
 #include "concurrency/signal.hpp"
 #include "containers/archive/stl_types.hpp"
 #include "containers/uuid.hpp"
+#include "perfmon/resource_usage.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rpc/serialize_macros.hpp"
 #include "time.hpp"
@@ -133,7 +134,8 @@ public:
             double duration,
             server_id_t const &server_id,
             ip_and_port_t const &client_addr_port,
-            std::string const &query);
+            std::string const &query,
+            resource_usage_t const &resource_usage);
 
     void merge_derived(query_job_report_t const &job_report);
 
@@ -145,8 +147,9 @@ public:
 
     ip_and_port_t client_addr_port;
     std::string query;
+    resource_usage_t resource_usage;
 };
-RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(query_job_report_t);
+RDB_DECLARE_SERIALIZABLE(query_job_report_t);
 
 #include "clustering/administration/jobs/report.tcc"
 
@@ -6,19 +6,24 @@
 #include "concurrency/promise.hpp"
 #include "containers/archive/boost_types.hpp"
 
-RDB_IMPL_SERIALIZABLE_1_SINCE_v1_13(log_server_business_card_t, address);
+RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(log_server_business_card_t,
+                                    address, slow_query_address);
 
 
-log_server_t::log_server_t(mailbox_manager_t *mm, thread_pool_log_writer_t *lw) :
-    mailbox_manager(mm), writer(lw),
-    request_mailbox(mailbox_manager, std::bind(&log_server_t::handle_request, this, ph::_1, ph::_2, ph::_3, ph::_4, ph::_5))
+log_server_t::log_server_t(mailbox_manager_t *mm, thread_pool_log_writer_t *lw,
+                           slow_query_log_t *sql) :
+    mailbox_manager(mm), writer(lw), slow_query_log(sql),
+    request_mailbox(mailbox_manager, std::bind(&log_server_t::handle_request, this, log_file_t::server_log, ph::_1, ph::_2, ph::_3, ph::_4, ph::_5)),
+    slow_query_request_mailbox(mailbox_manager, std::bind(&log_server_t::handle_request, this, log_file_t::slow_query_log, ph::_1, ph::_2, ph::_3, ph::_4, ph::_5))
     { }
 
 log_server_business_card_t log_server_t::get_business_card() {
-    return log_server_business_card_t(request_mailbox.get_address());
+    return log_server_business_card_t(request_mailbox.get_address(),
+                                      slow_query_request_mailbox.get_address());
 }
 
 void log_server_t::handle_request(
+        log_file_t which,
         signal_t *interruptor,
         int max_lines,
         timespec min_timestamp,
@@ -26,8 +31,9 @@ void log_server_t::handle_request(
         log_server_business_card_t::result_mailbox_t::address_t cont) {
     std::string error;
     try {
-        std::vector<log_message_t> messages =
-            writer->tail(max_lines, min_timestamp, max_timestamp, interruptor);
+        std::vector<log_message_t> messages = which == log_file_t::server_log
+            ? writer->tail(max_lines, min_timestamp, max_timestamp, interruptor)
+            : slow_query_log->tail(max_lines, min_timestamp, max_timestamp, interruptor);
         send(mailbox_manager, cont, boost::variant<std::vector<log_message_t>, std::string>(messages));
         return;
     } catch (const std::runtime_error &e) {
@@ -44,6 +50,7 @@ void log_server_t::handle_request(
 std::vector<log_message_t> fetch_log_file(
         mailbox_manager_t *mm,
         const log_server_business_card_t &bcard,
+        log_file_t which,
         int max_lines, timespec min_timestamp, timespec max_timestamp,
         signal_t *interruptor) THROWS_ONLY(resource_lost_exc_t, std::runtime_error, interrupted_exc_t) {
     promise_t<boost::variant<std::vector<log_message_t>, std::string> > promise;
@@ -53,9 +60,9 @@ std::vector<log_message_t> fetch_log_file(
                 const boost::variant<std::vector<log_message_t>, std::string> &r) {
             promise.pulse(r);
         });
-    send(mm, bcard.address, max_lines, min_timestamp, max_timestamp, reply_mailbox.get_address());
+    send(mm, bcard.get_address(which), max_lines, min_timestamp, max_timestamp, reply_mailbox.get_address());
     {
-        disconnect_watcher_t dw(mm, bcard.address.get_peer());
+        disconnect_watcher_t dw(mm, bcard.get_address(which).get_peer());
         wait_any_t waiter(promise.get_ready_signal(), &dw);
         wait_interruptible(&waiter, interruptor);
     }
@@ -6,48 +6,66 @@
 #include <vector>
 
 #include "clustering/administration/logs/log_writer.hpp"
+#include "clustering/administration/logs/slow_query_log.hpp"
 #include "clustering/generic/resource.hpp"
 
+/* Every server has two files in the log format: the log file itself and the slow query
+log. */
+enum class log_file_t { server_log, slow_query_log };
+
 class log_server_business_card_t {
 public:
     typedef mailbox_t<void(boost::variant<std::vector<log_message_t>, std::string>)> result_mailbox_t;
     typedef mailbox_t<void(int, struct timespec, struct timespec, result_mailbox_t::address_t)> request_mailbox_t;
 
     log_server_business_card_t() { }
-    explicit log_server_business_card_t(const request_mailbox_t::address_t &a) : address(a) { }
+    log_server_business_card_t(const request_mailbox_t::address_t &a,
+                               const request_mailbox_t::address_t &sqa) :
+        address(a), slow_query_address(sqa) { }
+
+    const request_mailbox_t::address_t &get_address(log_file_t which) const {
+        return which == log_file_t::server_log ? address : slow_query_address;
+    }
 
     request_mailbox_t::address_t address;
+    request_mailbox_t::address_t slow_query_address;
 };
 
-RDB_DECLARE_SERIALIZABLE(log_server_business_card_t);
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(log_server_business_card_t);
 
-RDB_MAKE_EQUALITY_COMPARABLE_1(log_server_business_card_t, address);
+RDB_MAKE_EQUALITY_COMPARABLE_2(log_server_business_card_t, address, slow_query_address);
 
 class log_server_t {
 public:
-    log_server_t(mailbox_manager_t *mm, thread_pool_log_writer_t *w);
+    log_server_t(mailbox_manager_t *mm, thread_pool_log_writer_t *w,
+                 slow_query_log_t *sql);
     log_server_business_card_t get_business_card();
 private:
     void handle_request(
+        log_file_t which,
         signal_t *interruptor,
         int max_lines, struct timespec min_timestamp, struct timespec max_timestamp,
         log_server_business_card_t::result_mailbox_t::address_t cont);
     mailbox_manager_t *mailbox_manager;
     thread_pool_log_writer_t *writer;
+    slow_query_log_t *slow_query_log;
     log_server_business_card_t::request_mailbox_t request_mailbox;
+    log_server_business_card_t::request_mailbox_t slow_query_request_mailbox;
 
 private:
     DISABLE_COPYING(log_server_t);
 };
 
-/* Fetches a block of entries from another server's log file. It examines the last
-`max_entries` entries from the server's log, and filters out those whose timestamps are
-not between `min_timestamp` and `max_timestamp`, inclusive. It returns the results in
-reverse chronological order. Throws `resource_lost_exc_t` if the server disconnected or
-`std::runtime_error` if there's a problem with reading the log file. */
+/* Fetches a block of entries from another server's log file, or from its slow query log
+if `which` says so. It examines the last `max_entries` entries from the server's log, and
+filters out those whose timestamps are not between `min_timestamp` and `max_timestamp`,
+inclusive. It returns the results in reverse chronological order. Throws
+`resource_lost_exc_t` if the server disconnected or `std::runtime_error` if there's a
+problem with reading the log file. */
 std::vector<log_message_t> fetch_log_file(
     mailbox_manager_t *mailbox_manager,
     const log_server_business_card_t &server_bcard,
+    log_file_t which,
     int max_entries,
     struct timespec min_timestamp,
     struct timespec max_timestamp,
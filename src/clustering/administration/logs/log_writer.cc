@@ -456,7 +456,35 @@ thread_pool_log_writer_t::~thread_pool_log_writer_t() {
     pmap(get_num_threads(), boost::bind(&thread_pool_log_writer_t::uninstall_on_thread, this, _1));
 }
 
-std::vector<log_message_t> thread_pool_log_writer_t::tail(int max_lines, struct timespec min_timestamp, struct timespec max_timestamp, signal_t *interruptor) THROWS_ONLY(std::runtime_error, interrupted_exc_t) {
+static void tail_log_file_blocking(const std::string &filename, int max_lines, struct timespec min_timestamp, struct timespec max_timestamp, volatile bool *cancel, std::vector<log_message_t> *messages_out, std::string *error_out, bool *ok_out) {
+    try {
+        scoped_fd_t fd;
+        do {
+            fd.reset(open(filename.c_str(), O_RDONLY));
+        } while (fd.get() == INVALID_FD && get_errno() == EINTR);
+        throw_unless(fd.get() != INVALID_FD,
+            strprintf("could not open '%s' for reading.", filename.c_str()));
+        file_reverse_reader_t reader(std::move(fd));
+        std::string line;
+        while (max_lines-- > 0 && reader.get_next(&line) && !*cancel) {
+            if (line == "") {
+                continue;
+            }
+            log_message_t lm = parse_log_message(line);
+            if (lm.timestamp > max_timestamp) continue;
+            if (lm.timestamp < min_timestamp) break;
+            messages_out->push_back(lm);
+        }
+        *ok_out = true;
+        return;
+    } catch (const std::runtime_error &e) {
+        *error_out = e.what();
+        *ok_out = false;
+        return;
+    }
+}
+
+std::vector<log_message_t> tail_log_file(const std::string &filename, int max_lines, struct timespec min_timestamp, struct timespec max_timestamp, signal_t *interruptor) THROWS_ONLY(std::runtime_error, interrupted_exc_t) {
     volatile bool cancel = false;
     class cancel_subscription_t : public signal_t::subscription_t {
     public:
@@ -473,7 +501,7 @@ std::vector<log_message_t> thread_pool_log_writer_t::tail(int max_lines, struct
 
 
     bool ok;
-    thread_pool_t::run_in_blocker_pool(boost::bind(&thread_pool_log_writer_t::tail_blocking, this, max_lines, min_timestamp, max_timestamp, &cancel, &log_messages, &error_message, &ok));
+    thread_pool_t::run_in_blocker_pool(boost::bind(&tail_log_file_blocking, filename, max_lines, min_timestamp, max_timestamp, &cancel, &log_messages, &error_message, &ok));
     if (ok) {
         if (cancel) {
             throw interrupted_exc_t();
@@ -485,6 +513,10 @@ std::vector<log_message_t> thread_pool_log_writer_t::tail(int max_lines, struct
     }
 }
 
+std::vector<log_message_t> thread_pool_log_writer_t::tail(int max_lines, struct timespec min_timestamp, struct timespec max_timestamp, signal_t *interruptor) THROWS_ONLY(std::runtime_error, interrupted_exc_t) {
+    return tail_log_file(fallback_log_writer.filename.path(), max_lines, min_timestamp, max_timestamp, interruptor);
+}
+
 void thread_pool_log_writer_t::install_on_thread(int i) {
     on_thread_t thread_switcher((threadnum_t(i)));
     guarantee(TLS_get_global_log_writer() == NULL);
@@ -517,35 +549,6 @@ void thread_pool_log_writer_t::write_blocking(const log_message_t &msg, std::str
     return;
 }
 
-void thread_pool_log_writer_t::tail_blocking(int max_lines, struct timespec min_timestamp, struct timespec max_timestamp, volatile bool *cancel, std::vector<log_message_t> *messages_out, std::string *error_out, bool *ok_out) {
-    try {
-        scoped_fd_t fd;
-        do {
-            fd.reset(open(fallback_log_writer.filename.path().c_str(), O_RDONLY));
-        } while (fd.get() == INVALID_FD && get_errno() == EINTR);
-        throw_unless(fd.get() != INVALID_FD,
-            strprintf("could not open '%s' for reading.",
-                fallback_log_writer.filename.path().c_str()));
-        file_reverse_reader_t reader(std::move(fd));
-        std::string line;
-        while (max_lines-- > 0 && reader.get_next(&line) && !*cancel) {
-            if (line == "") {
-                continue;
-            }
-            log_message_t lm = parse_log_message(line);
-            if (lm.timestamp > max_timestamp) continue;
-            if (lm.timestamp < min_timestamp) break;
-            messages_out->push_back(lm);
-        }
-        *ok_out = true;
-        return;
-    } catch (const std::runtime_error &e) {
-        *error_out = e.what();
-        *ok_out = false;
-        return;
-    }
-}
-
 void log_coro(thread_pool_log_writer_t *writer, log_level_t level, const std::string &message, auto_drainer_t::lock_t) {
     on_thread_t thread_switcher(writer->home_thread());
 
@@ -568,7 +571,8 @@ void vlog_internal(UNUSED const char *src_file, UNUSED int src_line, log_level_t
         auto_drainer_t::lock_t lock(TLS_get_global_log_drainer());
 
         std::string message = vstrprintf(format, args);
-        coro_t::spawn_sometime(boost::bind(&log_coro, writer, level, message, lock));
+        coro_t::spawn_sometime(boost::bind(&log_coro, writer, level, message, lock),
+                               coro_stack_class_t::MEDIUM);
 
     } else {
         std::string message = vstrprintf(format, args);
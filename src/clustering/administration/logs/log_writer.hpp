@@ -56,6 +56,17 @@ private:
     DISABLE_COPYING(file_reverse_reader_t);
 };
 
+/* Reads the last `max_lines` lines of a file in the format of the log file, and returns
+the messages whose timestamps are between `min_timestamp` and `max_timestamp`, inclusive,
+newest first. The file is read in the blocker pool. */
+std::vector<log_message_t> tail_log_file(
+        const std::string &filename,
+        int max_lines,
+        struct timespec min_timestamp,
+        struct timespec max_timestamp,
+        signal_t *interruptor)
+        THROWS_ONLY(std::runtime_error, interrupted_exc_t);
+
 void log_internal(const char *src_file, int src_line, log_level_t level, const char *format, ...) __attribute__((format (printf, 4, 5)));
 void vlog_internal(const char *src_file, int src_line, log_level_t level, const char *format, va_list args) __attribute__((format (printf, 4, 0)));
 
@@ -74,13 +85,6 @@ private:
     void uninstall_on_thread(int i);
     void write(const log_message_t &msg);
     void write_blocking(const log_message_t &msg, std::string *error_out, bool *ok_out);
-    void tail_blocking(int max_lines,
-                       struct timespec min_timestamp,
-                       struct timespec max_timestamp,
-                       volatile bool *cancel,
-                       std::vector<log_message_t> *messages_out,
-                       std::string *error_out,
-                       bool *ok_out);
 
     mutex_t write_mutex;
     log_write_issue_tracker_t log_write_issue_tracker;
@@ -58,6 +58,27 @@ ql::datum_t convert_log_message_to_datum(
     return std::move(builder).to_datum();
 }
 
+ql::datum_t convert_slow_query_to_datum(
+        const log_message_t &msg, const server_id_t &server_id,
+        const ql::datum_t &server_datum) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("id", convert_log_key_to_datum(msg.timestamp, server_id));
+    builder.overwrite("server", server_datum);
+    builder.overwrite("timestamp", convert_timespec_to_datum(msg.timestamp));
+    ql::datum_t entry = parse_slow_query_message(msg.message);
+    if (entry.has()) {
+        for (size_t i = 0; i < entry.obj_size(); ++i) {
+            std::pair<datum_string_t, ql::datum_t> pair = entry.get_pair(i);
+            builder.overwrite(pair.first, pair.second);
+        }
+    } else {
+        /* Somebody edited the file, or it was cut off in the middle of a write. Show
+        what's there instead of hiding it. */
+        builder.overwrite("message", ql::datum_t(datum_string_t(msg.message)));
+    }
+    return std::move(builder).to_datum();
+}
+
 logs_artificial_table_backend_t::~logs_artificial_table_backend_t() {
     begin_changefeed_destruction();
 }
@@ -66,13 +87,26 @@ std::string logs_artificial_table_backend_t::get_primary_key_name() {
     return "id";
 }
 
+ql::datum_t logs_artificial_table_backend_t::message_to_datum(
+        const log_message_t &msg,
+        const server_id_t &server_id,
+        const ql::datum_t &server_datum) {
+    switch (which_log) {
+        case log_file_t::server_log:
+            return convert_log_message_to_datum(msg, server_id, server_datum);
+        case log_file_t::slow_query_log:
+            return convert_slow_query_to_datum(msg, server_id, server_datum);
+        default: unreachable();
+    }
+}
+
 bool logs_artificial_table_backend_t::read_all_rows_as_vector(
         signal_t *interruptor,
         std::vector<ql::datum_t> *rows_out,
         std::string *error_out) {
     return read_all_rows_raw(
         [&](const log_message_t &msg, const server_id_t &si, const ql::datum_t &sd) {
-            rows_out->push_back(convert_log_message_to_datum(msg, si, sd));
+            rows_out->push_back(message_to_datum(msg, si, sd));
         },
         interruptor,
         error_out);
@@ -129,7 +163,7 @@ bool logs_artificial_table_backend_t::read_row(
     try {
         /* The timestamp filter is set so that we'll only get messages with the exact
         timestamp we're looking for, and there should be at most one such message. */
-        messages = fetch_log_file(mailbox_manager, *bcard,
+        messages = fetch_log_file(mailbox_manager, *bcard, which_log,
             entries_per_server, timestamp, timestamp, interruptor);
     } catch (const resource_lost_exc_t &) {
         /* Server disconnected during the query. */
@@ -155,7 +189,7 @@ bool logs_artificial_table_backend_t::read_row(
         return false;
     }
 
-    *row_out = convert_log_message_to_datum(messages[0], server_id, server_datum);
+    *row_out = message_to_datum(messages[0], server_id, server_datum);
 
     /* The `id` field should be present and mostly correct. But since the conversion
     between `timespec` and ReQL time objects is not perfect, the timestamp in the `id`
@@ -174,7 +208,9 @@ bool logs_artificial_table_backend_t::write_row(
         UNUSED ql::datum_t *new_value_inout,
         UNUSED signal_t *interruptor,
         std::string *error_out) {
-    *error_out = "It's illegal to write to the `rethinkdb.logs` system table.";
+    *error_out = which_log == log_file_t::server_log
+        ? "It's illegal to write to the `rethinkdb.logs` system table."
+        : "It's illegal to write to the `rethinkdb.slow_queries` system table.";
     return false;
 }
 
@@ -258,6 +294,7 @@ void logs_artificial_table_backend_t::cfeed_machinery_t::run(
                 messages = fetch_log_file(
                     parent->mailbox_manager,
                     bcard,
+                    parent->which_log,
                     1,   /* only fetch latest entry */
                     min_time,
                     max_time,
@@ -312,6 +349,7 @@ void logs_artificial_table_backend_t::cfeed_machinery_t::run(
                 messages = fetch_log_file(
                     parent->mailbox_manager,
                     bcard,
+                    parent->which_log,
                     /* We might miss some notifications if more than `entries_per_server`
                     entries are appended to the log file in one iteration of the loop.
                     But this table already "cheats" regarding the relationship between
@@ -349,7 +387,7 @@ void logs_artificial_table_backend_t::cfeed_machinery_t::run(
                     }
                     *last_timestamp.get_value() = it->timestamp;
 
-                    ql::datum_t row = convert_log_message_to_datum(
+                    ql::datum_t row = parent->message_to_datum(
                         *it, server_id, server_datum);
                     store_key_t key(
                         convert_log_key_to_datum(
@@ -394,7 +432,7 @@ bool logs_artificial_table_backend_t::cfeed_machinery_t::get_initial_values(
     std::string dummy_error;
     return parent->read_all_rows_raw(
         [&](const log_message_t &msg, const server_id_t &si, const ql::datum_t &sd) {
-            ql::datum_t row = convert_log_message_to_datum(msg, si, sd);
+            ql::datum_t row = parent->message_to_datum(msg, si, sd);
             initial_values_out->push_back(row);
             auto it = last_timestamps.find(si);
             if (it != last_timestamps.end() && it->second < msg.timestamp) {
@@ -438,6 +476,7 @@ bool logs_artificial_table_backend_t::read_all_rows_raw(
                 messages = fetch_log_file(
                     mailbox_manager,
                     server.second,
+                    which_log,
                     entries_per_server,
                     min_time,
                     max_time,
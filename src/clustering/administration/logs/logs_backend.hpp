@@ -6,11 +6,16 @@
 #include <vector>
 
 #include "rdb_protocol/artificial_table/caching_cfeed_backend.hpp"
+#include "clustering/administration/logs/log_transfer.hpp"
 #include "clustering/administration/metadata.hpp"
 
 class server_config_client_t;
 
-/* This backend assumes that the entries in the log file have timestamps that are unique
+/* This backend serves both `rethinkdb.logs` and `rethinkdb.slow_queries`, depending on
+`which_log`. The rows of `rethinkdb.slow_queries` have the fields of the entry that was
+recorded in place of `level`, `uptime` and `message`.
+
+This backend assumes that the entries in the log file have timestamps that are unique
 and monotonically increasing. These assumptions can be broken if the system clock runs
 backwards while the server is turned off, or if the user manually edits the log file. If
 these assumptions are broken, the system shouldn't crash, but the contents of
@@ -29,11 +34,13 @@ public:
             mailbox_manager_t *_mailbox_manager,
             watchable_map_t<peer_id_t, cluster_directory_metadata_t> *_directory,
             server_config_client_t *_server_config_client,
-            admin_identifier_format_t _identifier_format) :
+            admin_identifier_format_t _identifier_format,
+            log_file_t _which_log) :
         mailbox_manager(_mailbox_manager),
         directory(_directory),
         server_config_client(_server_config_client),
-        identifier_format(_identifier_format) { }
+        identifier_format(_identifier_format),
+        which_log(_which_log) { }
     ~logs_artificial_table_backend_t();
 
     std::string get_primary_key_name();
@@ -107,6 +114,11 @@ private:
         watchable_map_t<peer_id_t, cluster_directory_metadata_t>::all_subs_t dir_subs;
     };
 
+    ql::datum_t message_to_datum(
+        const log_message_t &msg,
+        const server_id_t &server_id,
+        const ql::datum_t &server_datum);
+
     bool read_all_rows_raw(
         const std::function<void(
             const log_message_t &msg,
@@ -122,6 +134,7 @@ private:
     watchable_map_t<peer_id_t, cluster_directory_metadata_t> *directory;
     server_config_client_t *server_config_client;
     admin_identifier_format_t identifier_format;
+    log_file_t which_log;
 };
 
 #endif /* CLUSTERING_ADMINISTRATION_LOGS_LOGS_BACKEND_HPP_ */
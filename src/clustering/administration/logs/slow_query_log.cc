@@ -0,0 +1,183 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "clustering/administration/logs/slow_query_log.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <functional>
+
+#include "arch/runtime/thread_pool.hpp"
+#include "config/args.hpp"
+#include "http/json.hpp"
+#include "logger.hpp"
+#include "parsing/utf8.hpp"
+#include "utils.hpp"
+
+/* The log file format only allows printable ASCII, so the other characters in the JSON
+are written as `\u` escapes, which the JSON parser turns back into UTF-8. */
+static std::string escape_non_ascii(const std::string &json) {
+    std::string out;
+    out.reserve(json.size());
+    auto it = json.begin();
+    while (it != json.end()) {
+        if (*it >= ' ' && *it <= '~') {
+            out.push_back(*it);
+            ++it;
+            continue;
+        }
+        char32_t codepoint;
+        utf8::reason_t reason;
+        auto next = utf8::next_codepoint(it, json.end(), &codepoint, &reason);
+        if (next == it) {
+            // Datum strings are valid UTF-8, so this shouldn't happen.
+            out.push_back('?');
+            ++it;
+            continue;
+        }
+        it = next;
+        if (codepoint >= 0x10000) {
+            codepoint -= 0x10000;
+            out += strprintf("\\u%04x\\u%04x",
+                             static_cast<unsigned int>(0xd800 + (codepoint >> 10)),
+                             static_cast<unsigned int>(0xdc00 + (codepoint & 0x3ff)));
+        } else {
+            out += strprintf("\\u%04x", static_cast<unsigned int>(codepoint));
+        }
+    }
+    return out;
+}
+
+slow_query_log_options_t::slow_query_log_options_t()
+    : threshold_ms(static_cast<int64_t>(SLOW_QUERY_LOG_DEFAULT_THRESHOLD_MS)),
+      profile_rate(SLOW_QUERY_LOG_DEFAULT_PROFILE_RATE) { }
+
+slow_query_log_t::slow_query_log_t(const slow_query_log_options_t &_options)
+    : options(_options),
+      uptime_reference(clock_monotonic()),
+      last_timestamp(clock_realtime()),
+      write_failed(false) {
+    if (!static_cast<bool>(options.threshold_ms)) {
+        return;
+    }
+    int res;
+    do {
+        res = open(options.filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    } while (res == INVALID_FD && get_errno() == EINTR);
+    fd.reset(res);
+    if (fd.get() == INVALID_FD) {
+        logWRN("Failed to open the slow query log '%s': %s",
+               options.filename.c_str(), errno_string(get_errno()).c_str());
+    }
+}
+
+slow_query_log_t::~slow_query_log_t() { }
+
+bool slow_query_log_t::sample_profile() {
+    return static_cast<bool>(options.threshold_ms)
+        && options.profile_rate > 0
+        && randdouble() < options.profile_rate;
+}
+
+bool slow_query_log_t::is_slow(ticks_t execution_time) const {
+    return static_cast<bool>(options.threshold_ms)
+        && execution_time >= static_cast<ticks_t>(*options.threshold_ms) * MILLION;
+}
+
+void slow_query_log_t::record(const ql::datum_t &entry) {
+    // Datums can't be shared between threads, so we print it before leaving this one.
+    std::string message = escape_non_ascii(entry.as_json().PrintUnformatted());
+    coro_t::spawn_sometime(std::bind(&slow_query_log_t::write_coro, this,
+                                     message,
+                                     auto_drainer_t::lock_t(drainers.get())));
+}
+
+std::vector<log_message_t> slow_query_log_t::tail(
+        int max_lines,
+        struct timespec min_timestamp,
+        struct timespec max_timestamp,
+        signal_t *interruptor)
+        THROWS_ONLY(std::runtime_error, interrupted_exc_t) {
+    if (!static_cast<bool>(options.threshold_ms)) {
+        return std::vector<log_message_t>();
+    }
+    return tail_log_file(
+        options.filename, max_lines, min_timestamp, max_timestamp, interruptor);
+}
+
+void slow_query_log_t::write_coro(const std::string &message,
+                                  auto_drainer_t::lock_t) {
+    on_thread_t thread_switcher(home_thread());
+    mutex_t::acq_t write_mutex_acq(&write_mutex);
+
+    /* Timestamps double as primary keys in `rethinkdb.slow_queries`, so they must be
+    unique. Since all writes go through this mutex, that's easy. */
+    struct timespec timestamp = clock_realtime();
+    struct timespec last_plus = last_timestamp;
+    add_to_timespec(&last_plus, 1);
+    if (last_plus > timestamp) {
+        timestamp = last_plus;
+    }
+    last_timestamp = timestamp;
+
+    log_message_t log_msg(
+        timestamp,
+        subtract_timespecs(clock_monotonic(), uptime_reference),
+        log_level_info,
+        message);
+    std::string line = format_log_message(log_msg) + "\n";
+
+    std::string error_message;
+    bool ok;
+    thread_pool_t::run_in_blocker_pool(std::bind(&slow_query_log_t::write_blocking,
+                                                 this, line, &error_message, &ok));
+    if (!ok && !write_failed) {
+        logWRN("Failed to write to the slow query log: %s", error_message.c_str());
+    }
+    write_failed = !ok;
+}
+
+void slow_query_log_t::write_blocking(const std::string &line,
+                                      std::string *error_out,
+                                      bool *ok_out) {
+    if (fd.get() == INVALID_FD) {
+        error_out->assign("cannot open or find the slow query log file");
+        *ok_out = false;
+        return;
+    }
+    ssize_t write_res = ::write(fd.get(), line.data(), line.length());
+    if (write_res != static_cast<ssize_t>(line.length())) {
+        error_out->assign("cannot write to the slow query log file: " +
+                          errno_string(get_errno()));
+        *ok_out = false;
+        return;
+    }
+    *ok_out = true;
+}
+
+ql::datum_t parse_slow_query_message(const std::string &message) {
+    /* `format_log_message()` escaped the backslashes, but there are no newlines or tabs
+    to undo, because the JSON has them escaped already. */
+    std::string json;
+    json.reserve(message.size());
+    for (size_t i = 0; i < message.size(); ++i) {
+        if (message[i] == '\\' && i + 1 < message.size() && message[i + 1] == '\\') {
+            ++i;
+        }
+        json.push_back(message[i]);
+    }
+    scoped_cJSON_t parsed(cJSON_Parse(json.c_str()));
+    if (parsed.get() == NULL) {
+        return ql::datum_t();
+    }
+    ql::datum_t entry;
+    try {
+        entry = ql::to_datum(parsed.get(), ql::configured_limits_t::unlimited,
+                             reql_version_t::LATEST);
+    } catch (const ql::base_exc_t &) {
+        return ql::datum_t();
+    }
+    if (entry.get_type() != ql::datum_t::R_OBJECT) {
+        return ql::datum_t();
+    }
+    return entry;
+}
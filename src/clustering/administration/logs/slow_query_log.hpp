@@ -0,0 +1,88 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_LOGS_SLOW_QUERY_LOG_HPP_
+#define CLUSTERING_ADMINISTRATION_LOGS_SLOW_QUERY_LOG_HPP_
+
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/optional.hpp>
+
+#include "clustering/administration/logs/log_writer.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/mutex.hpp"
+#include "concurrency/one_per_thread.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "time.hpp"
+
+class slow_query_log_options_t {
+public:
+    slow_query_log_options_t();
+
+    std::string filename;
+    /* Queries that spend at least this long executing are logged. If it's empty, the
+    slow query log is turned off. */
+    boost::optional<int64_t> threshold_ms;
+    /* The fraction of queries that are profiled, whether the client asked for a profile
+    or not. If one of them turns out to be slow, its profile goes into the log. */
+    double profile_rate;
+};
+
+/* `slow_query_log_t` keeps a record of the queries that took a long time, so that
+regressions can be tracked down after the fact. It writes them into a file of its own
+next to the log file, and `rethinkdb.slow_queries` reads them back from every server.
+
+Each entry is stored like a message in the log file, with a JSON object as the text of
+the message. That way the slow query log can be read with the same code as the log
+file, and its entries get unique timestamps that serve as their primary keys. */
+class slow_query_log_t : public home_thread_mixin_t {
+public:
+    explicit slow_query_log_t(const slow_query_log_options_t &options);
+    ~slow_query_log_t();
+
+    /* Decides whether a query that is about to start should be profiled. Can be called
+    on any thread. */
+    bool sample_profile();
+
+    /* Whether a query that spent `execution_time` executing should be logged. */
+    bool is_slow(ticks_t execution_time) const;
+
+    /* Appends `entry` to the log. It never blocks, so it's safe to call from a
+    destructor; the entry is written in the background. Can be called on any thread. */
+    void record(const ql::datum_t &entry);
+
+    /* Like `thread_pool_log_writer_t::tail()`, but for the slow query log. */
+    std::vector<log_message_t> tail(
+            int max_lines,
+            struct timespec min_timestamp,
+            struct timespec max_timestamp,
+            signal_t *interruptor)
+            THROWS_ONLY(std::runtime_error, interrupted_exc_t);
+
+private:
+    void write_coro(const std::string &message, auto_drainer_t::lock_t keepalive);
+    void write_blocking(const std::string &line, std::string *error_out, bool *ok_out);
+
+    const slow_query_log_options_t options;
+    scoped_fd_t fd;
+
+    struct timespec uptime_reference;
+    struct timespec last_timestamp;
+    /* Whether the last write failed, so that we only warn once about a broken file */
+    bool write_failed;
+    mutex_t write_mutex;
+
+    /* `record()` spawns the writing coroutine on the calling thread, so each thread
+    needs its own drainer. */
+    one_per_thread_t<auto_drainer_t> drainers;
+
+    DISABLE_COPYING(slow_query_log_t);
+};
+
+/* Turns the text of a message in the slow query log back into the entry that was passed
+to `record()`. Returns an empty `datum_t` if the message can't be parsed. */
+ql::datum_t parse_slow_query_message(const std::string &message);
+
+#endif /* CLUSTERING_ADMINISTRATION_LOGS_SLOW_QUERY_LOG_HPP_ */
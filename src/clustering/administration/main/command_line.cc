@@ -378,6 +378,47 @@ serializer_filepath_t get_auth_metadata_filename(const base_path_t& dirpath) {
     return serializer_filepath_t(dirpath, "auth_metadata");
 }
 
+/* The slow query log lives in the data directory, so proxies don't have one. */
+slow_query_log_options_t parse_slow_query_log_options(
+        const std::map<std::string, options::values_t> &opts,
+        const base_path_t &dirpath) {
+    slow_query_log_options_t options;
+    options.filename = dirpath.path() + "/slow_query_log";
+    if (exists_option(opts, "--slow-query-threshold")) {
+        const std::string threshold_opt =
+            get_single_option(opts, "--slow-query-threshold");
+        uint64_t threshold_ms;
+        if (threshold_opt == "none") {
+            options.threshold_ms = boost::none;
+        } else if (strtou64_strict(threshold_opt, 10, &threshold_ms)
+                   && threshold_ms <= static_cast<uint64_t>(INT64_MAX / MILLION)) {
+            options.threshold_ms = static_cast<int64_t>(threshold_ms);
+        } else {
+            throw std::runtime_error(strprintf(
+                "ERROR: slow-query-threshold should be a number of milliseconds or "
+                "'none', got '%s'", threshold_opt.c_str()));
+        }
+    }
+    if (exists_option(opts, "--slow-query-profile-rate")) {
+        const std::string rate_opt = get_single_option(opts, "--slow-query-profile-rate");
+        char *end;
+        const double rate = strtod(rate_opt.c_str(), &end);
+        if (rate_opt.empty() || *end != '\0' || !(rate >= 0 && rate <= 1)) {
+            throw std::runtime_error(strprintf(
+                "ERROR: slow-query-profile-rate should be a number between 0 and 1, "
+                "got '%s'", rate_opt.c_str()));
+        }
+        options.profile_rate = rate;
+    }
+    return options;
+}
+
+slow_query_log_options_t disabled_slow_query_log_options() {
+    slow_query_log_options_t options;
+    options.threshold_ms = boost::none;
+    return options;
+}
+
 void initialize_logfile(const std::map<std::string, options::values_t> &opts,
                         const base_path_t& dirpath) {
     std::string filename;
@@ -647,7 +688,8 @@ service_address_ports_t get_service_address_ports(const std::map<std::string, op
         exists_option(opts, "--no-http-admin"),
         offseted_port(get_single_int(opts, "--http-port"), port_offset),
         offseted_port(get_single_int(opts, "--driver-port"), port_offset),
-        port_offset);
+        port_offset,
+        exists_option(opts, "--cluster-compression"));
 }
 
 
@@ -892,6 +934,11 @@ options::help_section_t get_server_options(std::vector<options::option_t> *optio
                                              options::OPTIONAL_REPEAT));
     help.add("-t [ --server-tag ] arg",
              "a tag for this server. Can be specified multiple times.");
+    options_out->push_back(options::option_t(options::names_t("--auto-rebalance"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--auto-rebalance",
+             "periodically move the split points of the tables to balance the recent "
+             "load between their shards.  It's enough to enable this on one server.");
     return help;
 }
 
@@ -900,6 +947,17 @@ options::help_section_t get_log_options(std::vector<options::option_t> *options_
     options_out->push_back(options::option_t(options::names_t("--log-file"),
                                              options::OPTIONAL));
     help.add("--log-file file", "specify the file to log to, defaults to 'log_file'");
+    options_out->push_back(options::option_t(options::names_t("--slow-query-threshold"),
+                                             options::OPTIONAL));
+    help.add("--slow-query-threshold ms|none", "log queries that take at least this "
+             "many milliseconds to 'slow_query_log' in the data directory, defaults to "
+             + strprintf("%d", SLOW_QUERY_LOG_DEFAULT_THRESHOLD_MS) + "; the log can be "
+             "read from the rethinkdb.slow_queries table");
+    options_out->push_back(options::option_t(options::names_t("--slow-query-profile-rate"),
+                                             options::OPTIONAL));
+    help.add("--slow-query-profile-rate fraction", "the fraction of queries to profile, "
+             "so that slow queries can be logged with their profile, defaults to "
+             + strprintf("%g", SLOW_QUERY_LOG_DEFAULT_PROFILE_RATE));
     options_out->push_back(options::option_t(options::names_t("--no-update-check"),
                                             options::OPTIONAL_NO_PARAMETER));
     help.add("--no-update-check", "disable checking for available updates.  Also turns "
@@ -1095,6 +1153,10 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                              options::OPTIONAL_REPEAT));
     help.add("--canonical-address addr", "address that other rethinkdb instances will use to connect to us, can be specified multiple times");
 
+    options_out->push_back(options::option_t(options::names_t("--cluster-compression"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--cluster-compression", "compress the connections between this server and other servers (a connection is compressed if either end asks for it)");
+
     return help;
 }
 
@@ -1104,6 +1166,10 @@ options::help_section_t get_cpu_options(std::vector<options::option_t> *options_
                                              options::OPTIONAL,
                                              strprintf("%d", get_cpu_count())));
     help.add("-c [ --cores ] n", "the number of cores to use");
+    options_out->push_back(options::option_t(options::names_t("--numa"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--numa", "keep threads, tables and their memory on the same NUMA node "
+             "(each table then runs on a single node)");
     return help;
 }
 
@@ -1463,6 +1529,8 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
                                 do_update_checking,
                                 address_ports,
                                 get_optional_option(opts, "--config-file"),
+                                exists_option(opts, "--auto-rebalance"),
+                                parse_slow_query_log_options(opts, base_path),
                                 std::vector<std::string>(argv, argv + argc));
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
@@ -1478,7 +1546,8 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
                                      static_cast<cluster_semilattice_metadata_t*>(NULL),
                                      &data_directory_lock,
                                      &result),
-                           num_workers);
+                           num_workers,
+                           exists_option(opts, "--numa"));
         return result ? EXIT_SUCCESS : EXIT_FAILURE;
     } catch (const options::named_error_t &ex) {
         output_named_error(ex, help);
@@ -1546,6 +1615,8 @@ int main_rethinkdb_proxy(int argc, char *argv[]) {
                                 update_check_t::do_not_perform,
                                 address_ports,
                                 get_optional_option(opts, "--config-file"),
+                                exists_option(opts, "--auto-rebalance"),
+                                disabled_slow_query_log_options(),
                                 std::vector<std::string>(argv, argv + argc));
 
         bool result;
@@ -1713,6 +1784,8 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                 do_update_checking,
                                 address_ports,
                                 get_optional_option(opts, "--config-file"),
+                                exists_option(opts, "--auto-rebalance"),
+                                parse_slow_query_log_options(opts, base_path),
                                 std::vector<std::string>(argv, argv + argc));
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
@@ -1729,7 +1802,8 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                      &serve_info,
                                      &data_directory_lock,
                                      &result),
-                           num_workers);
+                           num_workers,
+                           exists_option(opts, "--numa"));
 
         return result ? EXIT_SUCCESS : EXIT_FAILURE;
     } catch (const options::named_error_t &ex) {
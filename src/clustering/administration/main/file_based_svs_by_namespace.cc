@@ -4,6 +4,7 @@
 #include "errors.hpp"
 #include <boost/bind.hpp>
 
+#include "arch/runtime/runtime.hpp"
 #include "clustering/immediate_consistency/branch/multistore.hpp"
 #include "clustering/reactor/reactor.hpp"
 #include "logger.hpp"
@@ -123,10 +124,11 @@ file_based_svs_by_namespace_t::get_svs(
         = stores_out->stores();
     stores_out_stores->init(num_stores);
 
-    const threadnum_t serializer_thread = next_thread(num_db_threads);
+    const int numa_node = next_numa_node(num_db_threads);
+    const threadnum_t serializer_thread = next_thread(numa_node, num_db_threads);
     std::vector<threadnum_t> store_threads;
     for (int i = 0; i < num_stores; ++i) {
-        store_threads.push_back(next_thread(num_db_threads));
+        store_threads.push_back(next_thread(numa_node, num_db_threads));
     }
 
     scoped_ptr_t<serializer_t> serializer;
@@ -238,7 +240,30 @@ serializer_filepath_t file_based_svs_by_namespace_t::file_name_for(namespace_id_
     return serializer_filepath_t(base_path_, uuid_to_str(namespace_id));
 }
 
-threadnum_t file_based_svs_by_namespace_t::next_thread(int num_db_threads) {
-    thread_counter_ = (thread_counter_ + 1) % num_db_threads;
-    return threadnum_t(thread_counter_);
+int file_based_svs_by_namespace_t::next_numa_node(int num_db_threads) {
+    const int num_nodes = get_num_numa_nodes();
+    // Skip the nodes that only have the utility thread, if any.
+    for (int i = 0; i < num_nodes; ++i) {
+        numa_node_counter_ = (numa_node_counter_ + 1) % num_nodes;
+        for (int t = 0; t < num_db_threads; ++t) {
+            if (get_numa_node(threadnum_t(t)) == numa_node_counter_) {
+                return numa_node_counter_;
+            }
+        }
+    }
+    return get_numa_node(threadnum_t(0));
+}
+
+threadnum_t file_based_svs_by_namespace_t::next_thread(int numa_node,
+                                                        int num_db_threads) {
+    std::vector<threadnum_t> threads;
+    for (int t = 0; t < num_db_threads; ++t) {
+        if (get_numa_node(threadnum_t(t)) == numa_node) {
+            threads.push_back(threadnum_t(t));
+        }
+    }
+    guarantee(!threads.empty());
+    int *counter = &thread_counters_[numa_node];
+    *counter = (*counter + 1) % static_cast<int>(threads.size());
+    return threads[*counter];
 }
@@ -2,6 +2,7 @@
 #ifndef CLUSTERING_ADMINISTRATION_MAIN_FILE_BASED_SVS_BY_NAMESPACE_HPP_
 #define CLUSTERING_ADMINISTRATION_MAIN_FILE_BASED_SVS_BY_NAMESPACE_HPP_
 
+#include <map>
 #include <string>
 
 #include "clustering/administration/reactor_driver.hpp"
@@ -17,7 +18,7 @@ public:
                                   const base_path_t& base_path,
                                   local_issue_aggregator_t *local_issue_aggregator)
         : io_backender_(io_backender), balancer_(balancer),
-          base_path_(base_path), thread_counter_(0),
+          base_path_(base_path), numa_node_counter_(0),
           outdated_index_tracker(local_issue_aggregator) { }
 
     void get_svs(perfmon_collection_t *serializers_perfmon_collection,
@@ -35,8 +36,15 @@ private:
     cache_balancer_t *balancer_;
     const base_path_t base_path_;
 
-    threadnum_t next_thread(int num_db_threads);
-    int thread_counter_; // should only be used by `next_thread`
+    /* With `--numa`, a table's serializer and its stores go on threads of the same
+    NUMA node, because the serializer allocates the cache blocks that the stores use.
+    The tables take turns between the nodes, and within a node between its threads.
+    Without it there is a single node, and the tables simply take turns between all
+    of the threads. */
+    int next_numa_node(int num_db_threads);
+    threadnum_t next_thread(int numa_node, int num_db_threads);
+    int numa_node_counter_; // should only be used by `next_numa_node`
+    std::map<int, int> thread_counters_; // should only be used by `next_thread`
 
     outdated_index_issue_tracker_t outdated_index_tracker;
 
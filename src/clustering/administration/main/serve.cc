@@ -13,6 +13,7 @@
 #include "clustering/administration/issues/server.hpp"
 #include "clustering/administration/jobs/manager.hpp"
 #include "clustering/administration/logs/log_writer.hpp"
+#include "clustering/administration/logs/slow_query_log.hpp"
 #include "clustering/administration/main/file_based_svs_by_namespace.hpp"
 #include "clustering/administration/main/initial_join.hpp"
 #include "clustering/administration/main/ports.hpp"
@@ -27,6 +28,7 @@
 #include "clustering/administration/servers/config_server.hpp"
 #include "clustering/administration/servers/config_client.hpp"
 #include "clustering/administration/servers/network_logger.hpp"
+#include "clustering/administration/tables/auto_rebalancer.hpp"
 #include "containers/incremental_lenses.hpp"
 #include "extproc/extproc_pool.hpp"
 #include "rdb_protocol/query_server.hpp"
@@ -96,6 +98,7 @@ bool do_serve(io_backender_t *io_backender,
         local_issue_aggregator_t local_issue_aggregator;
 
         thread_pool_log_writer_t log_writer(&local_issue_aggregator);
+        slow_query_log_t slow_query_log(serve_info.slow_query_log);
 
         cluster_semilattice_metadata_t cluster_metadata;
         auth_semilattice_metadata_t auth_metadata;
@@ -129,7 +132,7 @@ bool do_serve(io_backender_t *io_backender,
         directory_map_read_manager_t<namespace_id_t, namespace_directory_metadata_t>
             reactor_directory_read_manager(&connectivity_cluster, 'R');
 
-        log_server_t log_server(&mailbox_manager, &log_writer);
+        log_server_t log_server(&mailbox_manager, &log_writer, &slow_query_log);
 
         scoped_ptr_t<server_config_server_t> server_config_server;
         if (i_am_a_server) {
@@ -222,7 +225,8 @@ bool do_serve(io_backender_t *io_backender,
                 serve_info.ports.local_addresses,
                 serve_info.ports.canonical_addresses,
                 serve_info.ports.port,
-                serve_info.ports.client_port));
+                serve_info.ports.client_port,
+                serve_info.ports.cluster_compression));
         } catch (const address_in_use_exc_t &ex) {
             throw address_in_use_exc_t(strprintf("Could not bind to cluster port: %s", ex.what()));
         }
@@ -275,7 +279,8 @@ bool do_serve(io_backender_t *io_backender,
                               NULL,   /* we'll fill this in later */
                               semilattice_manager_auth.get_root_view(),
                               &get_global_perfmon_collection(),
-                              serve_info.reql_http_proxy);
+                              serve_info.reql_http_proxy,
+                              &slow_query_log);
         jobs_manager.set_rdb_context(&rdb_ctx);
 
         real_reql_cluster_interface_t real_reql_cluster_interface(
@@ -382,6 +387,12 @@ bool do_serve(io_backender_t *io_backender,
                         semilattice_manager_auth.get_root_view()));
                 }
 
+                scoped_ptr_t<auto_rebalancer_t> auto_rebalancer;
+                if (i_am_a_server && serve_info.auto_rebalance) {
+                    auto_rebalancer.init(
+                        new auto_rebalancer_t(&real_reql_cluster_interface));
+                }
+
                 {
                     scoped_ptr_t<administrative_http_server_manager_t> admin_server_ptr;
                     if (serve_info.ports.http_admin_is_disabled) {
@@ -7,6 +7,7 @@
 #include <utility>
 #include <vector>
 
+#include "clustering/administration/logs/slow_query_log.hpp"
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/persist.hpp"
 #include "clustering/administration/main/version_check.hpp"
@@ -46,7 +47,8 @@ struct service_address_ports_t {
         client_port(0),
         http_port(0),
         reql_port(0),
-        port_offset(0) { }
+        port_offset(0),
+        cluster_compression(false) { }
 
     service_address_ports_t(const std::set<ip_address_t> &_local_addresses,
                             const peer_address_t &_canonical_addresses,
@@ -55,7 +57,8 @@ struct service_address_ports_t {
                             bool _http_admin_is_disabled,
                             int _http_port,
                             int _reql_port,
-                            int _port_offset) :
+                            int _port_offset,
+                            bool _cluster_compression) :
         local_addresses(_local_addresses),
         canonical_addresses(_canonical_addresses),
         port(_port),
@@ -63,7 +66,8 @@ struct service_address_ports_t {
         http_admin_is_disabled(_http_admin_is_disabled),
         http_port(_http_port),
         reql_port(_reql_port),
-        port_offset(_port_offset)
+        port_offset(_port_offset),
+        cluster_compression(_cluster_compression)
     {
             sanitize_port(port, "port", port_offset);
             sanitize_port(client_port, "client_port", port_offset);
@@ -83,6 +87,7 @@ struct service_address_ports_t {
     int http_port;
     int reql_port;
     int port_offset;
+    bool cluster_compression;
 };
 
 peer_address_set_t look_up_peers_addresses(const std::vector<host_and_port_t> &names);
@@ -95,6 +100,8 @@ public:
                  update_check_t _do_version_checking,
                  service_address_ports_t _ports,
                  boost::optional<std::string> _config_file,
+                 bool _auto_rebalance,
+                 const slow_query_log_options_t &_slow_query_log,
                  std::vector<std::string> &&_argv) :
         joins(std::move(_joins)),
         reql_http_proxy(std::move(_reql_http_proxy)),
@@ -102,6 +109,8 @@ public:
         do_version_checking(_do_version_checking),
         ports(_ports),
         config_file(_config_file),
+        auto_rebalance(_auto_rebalance),
+        slow_query_log(_slow_query_log),
         argv(std::move(_argv))
     { }
 
@@ -116,6 +125,9 @@ public:
     update_check_t do_version_checking;
     service_address_ports_t ports;
     boost::optional<std::string> config_file;
+    /* Whether to run an `auto_rebalancer_t`. Proxies ignore this. */
+    bool auto_rebalance;
+    slow_query_log_options_t slow_query_log;
     /* The original arguments, so we can display them in `server_status`. All the
     argument parsing has already been completed at this point. */
     std::vector<std::string> argv;
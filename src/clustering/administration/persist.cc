@@ -197,7 +197,8 @@ void read_metadata_blob(buf_parent_t sb_buf,
                     case cluster_version_t::v1_15:
                         return deserialize<cluster_version_t::v1_15>(s, &old_metadata);
                     case cluster_version_t::v1_16:
-                    case cluster_version_t::v2_0_is_latest:
+                    case cluster_version_t::v2_0_is_latest_disk:
+                    case cluster_version_t::v2_1_is_latest:
                     default:
                         unreachable();
                 }
@@ -213,14 +214,16 @@ void read_metadata_blob(buf_parent_t sb_buf,
             cluster_metadata_superblock_t::METADATA_BLOB_MAXREFLEN,
             [&](read_stream_t *s) -> archive_result_t {
                 switch (v) {
-                    case cluster_version_t::v2_0_is_latest:
-                        return deserialize<cluster_version_t::v2_0_is_latest>(s, out);
+                    case cluster_version_t::v2_0_is_latest_disk:
+                        return deserialize<cluster_version_t::v2_0_is_latest_disk>(
+                            s, out);
                     case cluster_version_t::v1_16:
                         return deserialize<cluster_version_t::v1_16>(s, out);
                     case cluster_version_t::v1_13:
                     case cluster_version_t::v1_13_2:
                     case cluster_version_t::v1_14:
                     case cluster_version_t::v1_15:
+                    case cluster_version_t::v2_1_is_latest:
                     default:
                         unreachable();
                 }
@@ -435,7 +438,8 @@ auth_semilattice_metadata_t auth_persistent_file_t::read_metadata() {
                     case cluster_version_t::v1_15:
                         return deserialize<cluster_version_t::v1_15>(s, &old_metadata);
                     case cluster_version_t::v1_16:
-                    case cluster_version_t::v2_0_is_latest:
+                    case cluster_version_t::v2_0_is_latest_disk:
+                    case cluster_version_t::v2_1_is_latest:
                     default:
                         unreachable();
                 }
@@ -452,8 +456,8 @@ auth_semilattice_metadata_t auth_persistent_file_t::read_metadata() {
             auth_metadata_superblock_t::METADATA_BLOB_MAXREFLEN,
             [&](read_stream_t *s) -> archive_result_t {
                 switch (v) {
-                    case cluster_version_t::v2_0_is_latest:
-                        return deserialize<cluster_version_t::v2_0_is_latest>(
+                    case cluster_version_t::v2_0_is_latest_disk:
+                        return deserialize<cluster_version_t::v2_0_is_latest_disk>(
                             s, &metadata);
                     case cluster_version_t::v1_16:
                         return deserialize<cluster_version_t::v1_16>(s, &metadata);
@@ -461,6 +465,7 @@ auth_semilattice_metadata_t auth_persistent_file_t::read_metadata() {
                     case cluster_version_t::v1_13_2:
                     case cluster_version_t::v1_14:
                     case cluster_version_t::v1_15:
+                    case cluster_version_t::v2_1_is_latest:
                     default:
                         unreachable();
                 }
@@ -6,10 +6,12 @@
 #include "clustering/administration/main/watchable_fields.hpp"
 #include "clustering/administration/reactor_driver.hpp"
 #include "clustering/administration/servers/config_client.hpp"
+#include "clustering/administration/tables/auto_rebalancer.hpp"
 #include "clustering/administration/tables/generate_config.hpp"
 #include "clustering/administration/tables/split_points.hpp"
 #include "clustering/administration/tables/table_config.hpp"
 #include "concurrency/cross_thread_signal.hpp"
+#include "logger.hpp"
 #include "rdb_protocol/artificial_table/artificial_table.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/table_common.hpp"
@@ -851,7 +853,7 @@ bool real_reql_cluster_interface_t::rebalance_internal(
         ns_change.get()->namespaces.at(table_id).get_mutable();
 
     std::map<store_key_t, int64_t> counts;
-    if (!fetch_distribution(table_id, this, interruptor, &counts, error_out)) {
+    if (!fetch_distribution(table_id, this, interruptor, &counts, NULL, error_out)) {
         *error_out = strprintf("When measuring document distribution for table "
             "`%s.%s`: %s", db->name.c_str(), table_name.c_str(), error_out->c_str());
         return false;
@@ -885,6 +887,87 @@ bool real_reql_cluster_interface_t::rebalance_internal(
     return true;
 }
 
+void real_reql_cluster_interface_t::rebalance_tables_by_load(
+        std::map<namespace_id_t, table_load_rebalance_state_t> *table_states,
+        signal_t *interruptor) {
+    cross_thread_signal_t ct_interruptor(interruptor,
+        server_config_client->home_thread());
+    on_thread_t thread_switcher(server_config_client->home_thread());
+    cow_ptr_t<namespaces_semilattice_metadata_t> namespaces_copy =
+        semilattice_root_view->get().rdb_namespaces;
+    for (const auto &pair : namespaces_copy->namespaces) {
+        if (pair.second.is_deleted()) {
+            table_states->erase(pair.first);
+            continue;
+        }
+        const std::string &table_name = pair.second.get_ref().name.get_ref().str();
+        table_load_rebalance_state_t *state = &(*table_states)[pair.first];
+        if (state->skip_round()) {
+            continue;
+        }
+        const table_replication_info_t &old_repli_info =
+            pair.second.get_ref().replication_info.get_ref();
+
+        std::map<store_key_t, int64_t> counts, loads;
+        std::string error;
+        if (!fetch_distribution(pair.first, this, &ct_interruptor, &counts, &loads,
+                                &error)) {
+            /* The table isn't available right now. We'll try again next time. */
+            continue;
+        }
+        int64_t total_load;
+        double imbalance = calculate_load_imbalance(
+            loads, old_repli_info.shard_scheme, &total_load);
+        if (!state->check_last_rebalance(imbalance)) {
+            logINF("Rebalancing table `%s` (%s) by load didn't help; its busiest shard "
+                   "still has %.1f times the average load. Leaving it alone for a "
+                   "while.", table_name.c_str(), uuid_to_str(pair.first).c_str(),
+                   imbalance);
+            continue;
+        }
+        if (total_load < AUTO_REBALANCE_MIN_LOAD
+            || imbalance <= AUTO_REBALANCE_IMBALANCE_THRESHOLD) {
+            continue;
+        }
+        table_shard_scheme_t new_shard_scheme;
+        if (!calculate_split_points_with_load(counts, loads,
+                old_repli_info.config.shards.size(), &new_shard_scheme, &error)) {
+            continue;
+        }
+        int64_t unused_total_load;
+        double predicted_imbalance = calculate_load_imbalance(
+            loads, new_shard_scheme, &unused_total_load);
+        if (!table_load_rebalance_state_t::is_worth_rebalancing(
+                imbalance, predicted_imbalance)) {
+            continue;
+        }
+
+        /* The metadata may have changed while we were fetching the distribution.
+        Only move the split points if nobody else did. */
+        cluster_semilattice_metadata_t cluster_md = semilattice_root_view->get();
+        cow_ptr_t<namespaces_semilattice_metadata_t>::change_t ns_change(
+                &cluster_md.rdb_namespaces);
+        auto it = ns_change.get()->namespaces.find(pair.first);
+        if (it == ns_change.get()->namespaces.end() || it->second.is_deleted()) {
+            continue;
+        }
+        namespace_semilattice_metadata_t *table_md = it->second.get_mutable();
+        table_replication_info_t new_repli_info = table_md->replication_info.get_ref();
+        if (!(new_repli_info.shard_scheme == old_repli_info.shard_scheme)
+            || new_repli_info.config.shards.size() != new_shard_scheme.num_shards()) {
+            continue;
+        }
+        new_repli_info.shard_scheme = new_shard_scheme;
+        table_md->replication_info.set(new_repli_info);
+        semilattice_root_view->join(cluster_md);
+        state->note_rebalanced(imbalance);
+
+        logINF("Rebalanced table `%s` (%s) by load; its busiest shard had %.1f times "
+               "the average load, and should now have %.1f times.", table_name.c_str(),
+               uuid_to_str(pair.first).c_str(), imbalance, predicted_imbalance);
+    }
+}
+
 bool real_reql_cluster_interface_t::table_rebalance(
         counted_t<const ql::db_t> db,
         const name_string_t &name,
@@ -2,6 +2,7 @@
 #ifndef CLUSTERING_ADMINISTRATION_REAL_REQL_CLUSTER_INTERFACE_HPP_
 #define CLUSTERING_ADMINISTRATION_REAL_REQL_CLUSTER_INTERFACE_HPP_
 
+#include <map>
 #include <set>
 #include <string>
 
@@ -15,6 +16,7 @@
 class admin_artificial_tables_t;
 class artificial_table_backend_t;
 class server_config_client_t;
+class table_load_rebalance_state_t;
 
 /* `real_reql_cluster_interface_t` is a concrete subclass of `reql_cluster_interface_t`
 that translates the user's `table_create()`, `table_drop()`, etc. requests into specific
@@ -127,6 +129,15 @@ public:
             ql::datum_t *result_out,
             std::string *error_out);
 
+    /* `rebalance_tables_by_load()` moves the split points of every table whose load
+    is spread unevenly over its shards, so that each shard gets about the same share
+    of the recent reads and writes. See `AUTO_REBALANCE_IMBALANCE_THRESHOLD`. It's
+    called periodically by `auto_rebalancer_t`, which keeps `table_states` between
+    calls. */
+    void rebalance_tables_by_load(
+            std::map<namespace_id_t, table_load_rebalance_state_t> *table_states,
+            signal_t *interruptor);
+
     /* `calculate_split_points_with_distribution` needs access to the underlying
     `namespace_interface_t` */
     namespace_repo_t *get_namespace_repo() {
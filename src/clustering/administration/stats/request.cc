@@ -30,6 +30,22 @@ const char *table_server_stats_request_t::table_server_request_type = "table_ser
     (BUILDER).overwrite(#NAME, ql::datum_t( \
         (STATS).accumulate_server(SERVER, &parsed_stats_t::table_stats_t::NAME)));
 
+// Latency histograms are shown as their percentiles
+#define ADD_LATENCY_STAT(BUILDER, SUB_STATS, NAME) \
+    (BUILDER).overwrite(#NAME, (SUB_STATS).NAME.percentiles_to_datum())
+
+#define ADD_CLUSTER_LATENCY_STAT(BUILDER, STATS, NAME) \
+    (BUILDER).overwrite(#NAME, \
+        (STATS).accumulate(&parsed_stats_t::table_stats_t::NAME).percentiles_to_datum());
+
+#define ADD_TABLE_LATENCY_STAT(BUILDER, STATS, TABLE, NAME) \
+    (BUILDER).overwrite(#NAME, (STATS).accumulate_table( \
+        TABLE, &parsed_stats_t::table_stats_t::NAME).percentiles_to_datum());
+
+#define ADD_SERVER_LATENCY_STAT(BUILDER, STATS, SERVER, NAME) \
+    (BUILDER).overwrite(#NAME, (STATS).accumulate_server( \
+        SERVER, &parsed_stats_t::table_stats_t::NAME).percentiles_to_datum());
+
 parsed_stats_t::server_stats_t::server_stats_t() :
     responsive(false),
     queries_per_sec(0), queries_total(0),
@@ -124,6 +140,12 @@ void parsed_stats_t::store_shard_values(const ql::datum_t &shard_perf,
                 } else if (key == "cache") {
                     add_perfmon_value(sub_pair.second, "in_use_bytes",
                                       &stats_out->in_use_bytes);
+                } else if (key == "read_latency_ms") {
+                    bool res = stats_out->read_latency_ms.merge_datum(sub_pair.second);
+                    r_sanity_check(res);
+                } else if (key == "write_latency_ms") {
+                    bool res = stats_out->write_latency_ms.merge_datum(sub_pair.second);
+                    r_sanity_check(res);
                 }
             }
         }
@@ -228,6 +250,42 @@ double parsed_stats_t::accumulate_server(const server_id_t &server_id,
     return res;
 }
 
+latency_histogram_t parsed_stats_t::accumulate(
+        latency_histogram_t table_stats_t::*field) const {
+    latency_histogram_t res;
+    for (auto const &server_pair : servers) {
+        for (auto const &table_pair : server_pair.second.tables) {
+            res.merge(table_pair.second.*field);
+        }
+    }
+    return res;
+}
+
+latency_histogram_t parsed_stats_t::accumulate_table(
+        const namespace_id_t &table_id,
+        latency_histogram_t table_stats_t::*field) const {
+    latency_histogram_t res;
+    for (auto const &server_pair : servers) {
+        auto const &table_it = server_pair.second.tables.find(table_id);
+        if (table_it != server_pair.second.tables.end()) {
+            res.merge(table_it->second.*field);
+        }
+    }
+    return res;
+}
+
+latency_histogram_t parsed_stats_t::accumulate_server(
+        const server_id_t &server_id,
+        latency_histogram_t table_stats_t::*field) const {
+    latency_histogram_t res;
+    auto const server_it = servers.find(server_id);
+    r_sanity_check(server_it != servers.end());
+    for (auto const &table_pair : server_it->second.tables) {
+        res.merge(table_pair.second.*field);
+    }
+    return res;
+}
+
 bool add_table_fields(const namespace_id_t &table_id,
                       const cluster_semilattice_metadata_t &metadata,
                       admin_identifier_format_t admin_format,
@@ -284,7 +342,8 @@ cluster_stats_request_t::cluster_stats_request_t() { }
 std::set<std::vector<std::string> > cluster_stats_request_t::get_filter() const {
     return std::set<std::vector<std::string> >(
         { {"query_engine" },
-          {".*", "serializers", "shard_[0-9]+", "btree-.*", "keys_.*" } });
+          {".*", "serializers", "shard_[0-9]+", "btree-.*", "keys_.*" },
+          {".*", "serializers", "shard_[0-9]+", "(read|write)_latency_ms" } });
 }
 
 std::vector<peer_id_t> cluster_stats_request_t::get_peers(
@@ -313,6 +372,8 @@ bool cluster_stats_request_t::to_datum(const parsed_stats_t &stats,
     ADD_CLUSTER_SERVER_STAT(qe_builder, stats, clients_active);
     ADD_CLUSTER_TABLE_STAT(qe_builder, stats, read_docs_per_sec);
     ADD_CLUSTER_TABLE_STAT(qe_builder, stats, written_docs_per_sec);
+    ADD_CLUSTER_LATENCY_STAT(qe_builder, stats, read_latency_ms);
+    ADD_CLUSTER_LATENCY_STAT(qe_builder, stats, write_latency_ms);
     row_builder.overwrite("query_engine", std::move(qe_builder).to_datum());
 
     *result_out = std::move(row_builder).to_datum();
@@ -345,7 +406,9 @@ table_stats_request_t::table_stats_request_t(const namespace_id_t &_table_id) :
 
 std::set<std::vector<std::string> > table_stats_request_t::get_filter() const {
     return std::set<std::vector<std::string> >({
-        { uuid_to_str(table_id), "serializers", "shard_[0-9]+", "btree-.*", "keys_.*" }
+        { uuid_to_str(table_id), "serializers", "shard_[0-9]+", "btree-.*", "keys_.*" },
+        { uuid_to_str(table_id), "serializers", "shard_[0-9]+",
+          "(read|write)_latency_ms" }
         });
 }
 
@@ -380,6 +443,8 @@ bool table_stats_request_t::to_datum(const parsed_stats_t &stats,
     ql::datum_object_builder_t qe_builder;
     ADD_TABLE_STAT(qe_builder, stats, table_id, read_docs_per_sec);
     ADD_TABLE_STAT(qe_builder, stats, table_id, written_docs_per_sec);
+    ADD_TABLE_LATENCY_STAT(qe_builder, stats, table_id, read_latency_ms);
+    ADD_TABLE_LATENCY_STAT(qe_builder, stats, table_id, write_latency_ms);
     row_builder.overwrite("query_engine", std::move(qe_builder).to_datum());
 
     *result_out = std::move(row_builder).to_datum();
@@ -413,7 +478,8 @@ server_stats_request_t::server_stats_request_t(const server_id_t &_server_id) :
 std::set<std::vector<std::string> > server_stats_request_t::get_filter() const {
     return std::set<std::vector<std::string> >(
         { {"query_engine"},
-          {".*", "serializers", "shard_[0-9]+", "btree-.*" } });
+          {".*", "serializers", "shard_[0-9]+", "btree-.*" },
+          {".*", "serializers", "shard_[0-9]+", "(read|write)_latency_ms" } });
 }
 
 std::vector<peer_id_t> server_stats_request_t::get_peers(
@@ -466,6 +532,8 @@ bool server_stats_request_t::to_datum(const parsed_stats_t &stats,
         ADD_SERVER_STAT(qe_builder, stats, server_id, read_docs_total);
         ADD_SERVER_STAT(qe_builder, stats, server_id, written_docs_per_sec);
         ADD_SERVER_STAT(qe_builder, stats, server_id, written_docs_total);
+        ADD_SERVER_LATENCY_STAT(qe_builder, stats, server_id, read_latency_ms);
+        ADD_SERVER_LATENCY_STAT(qe_builder, stats, server_id, write_latency_ms);
         row_builder.overwrite("query_engine", std::move(qe_builder).to_datum());
     }
     *result_out = std::move(row_builder).to_datum();
@@ -569,6 +637,8 @@ bool table_server_stats_request_t::to_datum(const parsed_stats_t &stats,
         ADD_STAT(qe_builder, table_stats, read_docs_total);
         ADD_STAT(qe_builder, table_stats, written_docs_per_sec);
         ADD_STAT(qe_builder, table_stats, written_docs_total);
+        ADD_LATENCY_STAT(qe_builder, table_stats, read_latency_ms);
+        ADD_LATENCY_STAT(qe_builder, table_stats, write_latency_ms);
 
         ql::datum_object_builder_t se_cache_builder;
         ADD_STAT(se_cache_builder, table_stats, in_use_bytes);
@@ -9,6 +9,7 @@
 
 #include "clustering/administration/metadata.hpp"
 #include "containers/uuid.hpp"
+#include "perfmon/latency_histogram.hpp"
 #include "rdb_protocol/datum.hpp"
 
 class server_config_client_t;
@@ -35,6 +36,11 @@ public:
         double read_bytes_total;
         double written_bytes_per_sec;
         double written_bytes_total;
+
+        // Merged across shards, so that percentiles can be computed over any
+        // combination of servers and tables.
+        latency_histogram_t read_latency_ms;
+        latency_histogram_t write_latency_ms;
     };
 
     struct server_stats_t {
@@ -65,6 +71,13 @@ public:
     double accumulate_server(const server_id_t &server_id,
                              double table_stats_t::*field) const;
 
+    // The same, but merging latency histograms instead of summing values
+    latency_histogram_t accumulate(latency_histogram_t table_stats_t::*field) const;
+    latency_histogram_t accumulate_table(const namespace_id_t &table_id,
+                                         latency_histogram_t table_stats_t::*field) const;
+    latency_histogram_t accumulate_server(const server_id_t &server_id,
+                                          latency_histogram_t table_stats_t::*field) const;
+
     std::map<server_id_t, server_stats_t> servers;
 
 private:
@@ -0,0 +1,65 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "clustering/administration/tables/auto_rebalancer.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/timing.hpp"
+#include "clustering/administration/real_reql_cluster_interface.hpp"
+#include "config/args.hpp"
+
+table_load_rebalance_state_t::table_load_rebalance_state_t() :
+    imbalance_before_rebalance(0), rounds_to_skip(0), backoff_rounds(0) { }
+
+bool table_load_rebalance_state_t::skip_round() {
+    if (rounds_to_skip > 0) {
+        --rounds_to_skip;
+        return true;
+    }
+    return false;
+}
+
+bool table_load_rebalance_state_t::check_last_rebalance(double imbalance) {
+    if (imbalance_before_rebalance == 0) {
+        return true;
+    }
+    bool helped = is_worth_rebalancing(imbalance_before_rebalance, imbalance);
+    imbalance_before_rebalance = 0;
+    if (helped) {
+        backoff_rounds = 0;
+    } else {
+        backoff_rounds = std::min(std::max(1, 2 * backoff_rounds),
+                                  AUTO_REBALANCE_MAX_BACKOFF_ROUNDS);
+        rounds_to_skip = backoff_rounds;
+    }
+    return helped;
+}
+
+bool table_load_rebalance_state_t::is_worth_rebalancing(
+        double imbalance, double predicted_imbalance) {
+    return predicted_imbalance * AUTO_REBALANCE_MIN_IMPROVEMENT <= imbalance;
+}
+
+void table_load_rebalance_state_t::note_rebalanced(double imbalance) {
+    imbalance_before_rebalance = imbalance;
+}
+
+auto_rebalancer_t::auto_rebalancer_t(
+        real_reql_cluster_interface_t *_reql_cluster_interface) :
+    reql_cluster_interface(_reql_cluster_interface) {
+    coro_t::spawn_sometime(std::bind(&auto_rebalancer_t::rebalance_loop, this,
+                                     auto_drainer_t::lock_t(&drainer)));
+}
+
+void auto_rebalancer_t::rebalance_loop(auto_drainer_t::lock_t keepalive) {
+    try {
+        for (;;) {
+            nap(AUTO_REBALANCE_INTERVAL_SECS * THOUSAND, keepalive.get_drain_signal());
+            reql_cluster_interface->rebalance_tables_by_load(
+                &table_states, keepalive.get_drain_signal());
+        }
+    } catch (const interrupted_exc_t &) {
+        // We're shutting down.
+    }
+}
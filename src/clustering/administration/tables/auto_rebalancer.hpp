@@ -0,0 +1,68 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_TABLES_AUTO_REBALANCER_HPP_
+#define CLUSTERING_ADMINISTRATION_TABLES_AUTO_REBALANCER_HPP_
+
+#include <map>
+
+#include "concurrency/auto_drainer.hpp"
+#include "containers/uuid.hpp"
+
+class real_reql_cluster_interface_t;
+
+/* `table_load_rebalance_state_t` is what the auto rebalancer remembers about a table
+between rounds. It keeps it from moving a table's split points back and forth without
+getting anywhere:
+ - A table is only rebalanced if the new split points would lower its imbalance by a
+   factor of at least `AUTO_REBALANCE_MIN_IMPROVEMENT`.
+ - The next round checks whether the imbalance really went down by that much. If it
+   didn't, for example because the load moved in the meantime, the table is left
+   alone for a number of rounds that doubles every time, up to
+   `AUTO_REBALANCE_MAX_BACKOFF_ROUNDS`. */
+class table_load_rebalance_state_t {
+public:
+    table_load_rebalance_state_t();
+
+    /* Called at the start of every round. Returns `true` if the table should be left
+    alone this round. */
+    bool skip_round();
+
+    /* Called with the table's current imbalance. Returns `false` if our last rebalance
+    of the table didn't help, in which case the table is left alone for a while. */
+    bool check_last_rebalance(double imbalance);
+
+    /* Whether it's worth moving the split points so that the imbalance goes from
+    `imbalance` to `predicted_imbalance`. */
+    static bool is_worth_rebalancing(double imbalance, double predicted_imbalance);
+
+    /* Called after we moved the table's split points. */
+    void note_rebalanced(double imbalance);
+
+private:
+    /* The imbalance right before our last rebalance, if the next round hasn't checked
+    yet whether it helped; 0 otherwise. */
+    double imbalance_before_rebalance;
+    int rounds_to_skip;
+    int backoff_rounds;
+};
+
+/* `auto_rebalancer_t` calls `rebalance_tables_by_load()` every
+`AUTO_REBALANCE_INTERVAL_SECS`. It's only created if the server was started with
+`--auto-rebalance`. The split points are in the semilattice metadata, so it's enough to
+enable this on one server of the cluster. */
+class auto_rebalancer_t {
+public:
+    explicit auto_rebalancer_t(real_reql_cluster_interface_t *reql_cluster_interface);
+
+private:
+    void rebalance_loop(auto_drainer_t::lock_t keepalive);
+
+    real_reql_cluster_interface_t *reql_cluster_interface;
+
+    std::map<namespace_id_t, table_load_rebalance_state_t> table_states;
+
+    auto_drainer_t drainer;
+
+    DISABLE_COPYING(auto_rebalancer_t);
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_TABLES_AUTO_REBALANCER_HPP_ */
@@ -1,5 +1,7 @@
 #include "clustering/administration/tables/split_points.hpp"
 
+#include <algorithm>
+
 #include "clustering/administration/real_reql_cluster_interface.hpp"
 #include "math.hpp"   /* for `clamp()` */
 #include "rdb_protocol/real_table.hpp"
@@ -90,6 +92,7 @@ bool fetch_distribution(
         real_reql_cluster_interface_t *reql_cluster_interface,
         signal_t *interruptor,
         std::map<store_key_t, int64_t> *counts_out,
+        std::map<store_key_t, int64_t> *loads_out,
         std::string *error_out) {
     namespace_interface_access_t ns_if_access =
         reql_cluster_interface->get_namespace_repo()->get_namespace_interface(
@@ -106,8 +109,12 @@ bool fetch_distribution(
             "currently available for reading.";
         return false;
     }
-    *counts_out = std::move(
-        boost::get<distribution_read_response_t>(resp.response).key_counts);
+    distribution_read_response_t *dist =
+        boost::get<distribution_read_response_t>(&resp.response);
+    *counts_out = std::move(dist->key_counts);
+    if (loads_out != NULL) {
+        *loads_out = std::move(dist->key_loads);
+    }
     return true;
 }
 
@@ -153,6 +160,57 @@ bool calculate_split_points_with_distribution(
     return true;
 }
 
+bool calculate_split_points_with_load(
+        const std::map<store_key_t, int64_t> &counts,
+        const std::map<store_key_t, int64_t> &loads,
+        size_t num_shards,
+        table_shard_scheme_t *split_points_out,
+        std::string *error_out) {
+    int64_t total_count = 0, total_load = 0;
+    for (auto const &pair : counts) {
+        total_count += pair.second;
+    }
+    for (auto const &pair : loads) {
+        total_load += pair.second;
+    }
+    if (total_load == 0) {
+        return calculate_split_points_with_distribution(
+            counts, num_shards, split_points_out, error_out);
+    }
+
+    /* Give the documents and the load the same total weight. */
+    static const double scale = 1e9;
+    std::map<store_key_t, int64_t> weights;
+    if (total_count > 0) {
+        for (auto const &pair : counts) {
+            weights[pair.first] += static_cast<int64_t>(
+                pair.second * (scale / total_count));
+        }
+    }
+    for (auto const &pair : loads) {
+        weights[pair.first] += static_cast<int64_t>(pair.second * (scale / total_load));
+    }
+    return calculate_split_points_with_distribution(
+        weights, num_shards, split_points_out, error_out);
+}
+
+double calculate_load_imbalance(
+        const std::map<store_key_t, int64_t> &loads,
+        const table_shard_scheme_t &split_points,
+        int64_t *total_load_out) {
+    std::vector<int64_t> shard_loads(split_points.num_shards(), 0);
+    *total_load_out = 0;
+    for (auto const &pair : loads) {
+        shard_loads[split_points.find_shard_for_key(pair.first)] += pair.second;
+        *total_load_out += pair.second;
+    }
+    if (*total_load_out == 0) {
+        return 0;
+    }
+    int64_t max_load = *std::max_element(shard_loads.begin(), shard_loads.end());
+    return max_load * static_cast<double>(shard_loads.size()) / *total_load_out;
+}
+
 store_key_t key_for_uuid(uint64_t first_8_bytes) {
     uuid_u uuid;
     bzero(uuid.data(), uuid_u::static_size());
@@ -223,7 +281,7 @@ bool calculate_split_points_intelligently(
     if (num_shards > old_split_points.num_shards()) {
         std::map<store_key_t, int64_t> counts;
         if (!fetch_distribution(table_id, reql_cluster_interface,
-                interruptor, &counts, error_out)) {
+                interruptor, &counts, NULL, error_out)) {
             return false;
         }
         std::string dummy_error;
@@ -13,12 +13,15 @@ class real_reql_cluster_interface_t;
 class signal_t;
 class table_shard_scheme_t;
 
-/* `fetch_distribution` fetches the distribution information from the database. */
+/* `fetch_distribution` fetches the distribution information from the database. If
+`loads_out` isn't `NULL`, it also fetches how the recent reads and writes are
+distributed, see `key_access_histogram_t`. */
 bool fetch_distribution(
         const namespace_id_t &table_id,
         real_reql_cluster_interface_t *reql_cluster_interface,
         signal_t *interruptor,
         std::map<store_key_t, int64_t> *counts_out,
+        std::map<store_key_t, int64_t> *loads_out,
         std::string *error_out);
 
 /* `calculate_split_points_with_distribution` generates a set of split points that are
@@ -30,6 +33,24 @@ bool calculate_split_points_with_distribution(
         table_shard_scheme_t *split_points_out,
         std::string *error_out);
 
+/* `calculate_split_points_with_load` is like `calculate_split_points_with_distribution`,
+but it balances the sum of each shard's share of the documents and its share of the
+recent reads and writes. */
+bool calculate_split_points_with_load(
+        const std::map<store_key_t, int64_t> &counts,
+        const std::map<store_key_t, int64_t> &loads,
+        size_t num_shards,
+        table_shard_scheme_t *split_points_out,
+        std::string *error_out);
+
+/* `calculate_load_imbalance` returns how many times the average load per shard the
+busiest shard gets under the given split points, or 0 if there is no load at all.
+`total_load_out` is set to the total load. */
+double calculate_load_imbalance(
+        const std::map<store_key_t, int64_t> &loads,
+        const table_shard_scheme_t &split_points,
+        int64_t *total_load_out);
+
 /* `calculate_split_points_for_uuids` generates a set of split points that will divide
 the range of UUIDs evenly. */
 void calculate_split_points_for_uuids(
@@ -1,6 +1,7 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/branch/backfillee.hpp"
 
+#include <algorithm>
 #include <functional>
 
 #include "errors.hpp"
@@ -14,6 +15,7 @@
 #include "concurrency/promise.hpp"
 #include "concurrency/queue/unlimited_fifo.hpp"
 #include "containers/death_runner.hpp"
+#include "containers/scoped.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "store_view.hpp"
 
@@ -89,11 +91,13 @@ public:
         /* Warning: This function is called with the chunks in the right order.
         No re-ordering must happen before apply_backfill_chunk is called. */
         try {
-            if (progress_out != nullptr) {
-                *progress_out = chunk.progress;
-            }
-
             if (chunk.is_not_last_backfill_chunk) {
+                /* The backfiller estimates the progress of the whole backfill, so
+                the latest estimate of any stream is the current one. */
+                if (progress_out != nullptr) {
+                    *progress_out = std::max(*progress_out, chunk.progress);
+                }
+
                 /* This is an actual backfill chunk */
 
                 /* Before letting the next thing go, increment
@@ -163,6 +167,224 @@ private:
     DISABLE_COPYING(chunk_callback_t);
 };
 
+/* The backfillee's end of one stream of a backfill, see
+`backfill_stream_business_card_t`. */
+class backfillee_stream_t {
+public:
+    explicit backfillee_stream_t(mailbox_manager_t *mailbox_manager) :
+        /* The backfiller will notify `done_mailbox` when it has sent all chunks
+        of the stream. */
+        done_mailbox(
+            mailbox_manager,
+            [this](signal_t *, const fifo_enforcer_write_token_t &token) {
+                chunk_queue.push(token,
+                    backfill_queue_entry_t(false, backfill_chunk_t(), 1.0, token));
+            }),
+        /* The backfiller will send individual chunks of the backfill to
+        `chunk_mailbox`. */
+        chunk_mailbox(
+            mailbox_manager,
+            [this](signal_t *,
+                    const backfill_chunk_t &chunk,
+                    double progress,
+                    fifo_enforcer_write_token_t token) {
+                // Here we reconstruct the ordering of the backfill chunks.
+                // (note how `chunk_queue` is a `fifo_enforcer_queue_t`)
+                chunk_queue.push(token,
+                    backfill_queue_entry_t(true, chunk, progress, token));
+            }),
+        /* The backfiller will register for allocations on the allocation
+         * registration box. */
+        alloc_registration_mbox(
+            mailbox_manager,
+            [this](signal_t *, const mailbox_addr_t<void(int)> &addr) {
+                alloc_mailbox_promise.pulse(addr);
+            })
+        { }
+
+    backfill_stream_business_card_t get_business_card() {
+        return backfill_stream_business_card_t(chunk_mailbox.get_address(),
+                                               done_mailbox.get_address(),
+                                               alloc_registration_mbox.get_address());
+    }
+
+    /* Starts applying the chunks once we have the allocation mailbox. */
+    void start(store_view_t *svs, mailbox_manager_t *mailbox_manager,
+               double *progress_out) {
+        mailbox_addr_t<void(int)> allocation_mailbox;
+        bool got_value = alloc_mailbox_promise.try_get_value(&allocation_mailbox);
+        guarantee(got_value);
+        chunk_callback.init(new chunk_callback_t(
+            svs, &chunk_queue, mailbox_manager, allocation_mailbox, progress_out));
+        backfill_workers.init(new coro_pool_t<backfill_queue_entry_t>(
+            CHUNK_PROCESSING_CONCURRENCY, &chunk_queue, chunk_callback.get()));
+    }
+
+    /* A queue of the requests the backfill chunk mailbox receives, a coro
+     * pool services these requests and poops them off one at a time to
+     * perform them. */
+    fifo_enforcer_queue_t<backfill_queue_entry_t> chunk_queue;
+
+    mailbox_t<void(fifo_enforcer_write_token_t)> done_mailbox;
+    mailbox_t<void(backfill_chunk_t, double, fifo_enforcer_write_token_t)>
+        chunk_mailbox;
+
+    promise_t<mailbox_addr_t<void(int)> > alloc_mailbox_promise;
+    mailbox_t<void(mailbox_addr_t<void(int)>)> alloc_registration_mbox;
+
+    scoped_ptr_t<chunk_callback_t> chunk_callback;
+    scoped_ptr_t<coro_pool_t<backfill_queue_entry_t> > backfill_workers;
+
+private:
+    DISABLE_COPYING(backfillee_stream_t);
+};
+
+/* Splits `range` into pieces at `split_keys`, which must be inside it and in
+ascending order. */
+void split_region(const region_t &range,
+                  const std::vector<store_key_t> &split_keys,
+                  std::vector<region_t> *pieces_out) {
+    region_t piece = range;
+    for (const store_key_t &key : split_keys) {
+        piece.inner.right = key_range_t::right_bound_t(key);
+        pieces_out->push_back(piece);
+        piece.inner.left = key;
+    }
+    piece.inner.right = range.inner.right;
+    pieces_out->push_back(piece);
+}
+
+/* Compares hashes of our data with the backfiller's, top-down: each round sends
+the hashes of the ranges that differed in the previous round, split into smaller
+pieces. Returns the backfiller's timestamp for the parts of `region` that are in
+sync, and `state_timestamp_t::zero()` for the rest. This lets a backfillee that
+missed many writes, but whose data is still mostly the same, skip most of the
+backfill. */
+region_map_t<state_timestamp_t> find_in_sync_ranges(
+        mailbox_manager_t *mailbox_manager,
+        store_view_t *svs,
+        const region_t &region,
+        const region_map_t<version_range_t> &start_point,
+        resource_access_t<backfiller_business_card_t> *backfiller,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, resource_lost_exc_t) {
+    std::vector<std::pair<region_t, state_timestamp_t> > parts;
+    std::vector<region_t> candidates;
+
+    /* There is nothing to compare if we don't have any data yet. */
+    state_timestamp_t our_timestamp = state_timestamp_t::zero();
+    bool have_data = false;
+    for (auto it = start_point.begin(); it != start_point.end(); ++it) {
+        if (it->second != version_range_t(version_t::zero())) {
+            our_timestamp = have_data
+                ? std::min(our_timestamp, it->second.earliest.timestamp)
+                : it->second.earliest.timestamp;
+            have_data = true;
+        }
+    }
+    if (have_data) {
+        candidates.push_back(region);
+    }
+
+    for (int round = 0;
+         round < BACKFILL_HASH_MAX_ROUNDS && !candidates.empty();
+         ++round) {
+        std::vector<range_hash_t> our_hashes;
+        {
+            read_token_t token;
+            svs->new_read_token(&token);
+            region_map_t<binary_blob_t> our_metainfo;
+            svs->get_range_hashes(candidates, BACKFILL_HASH_FANOUT - 1, &our_hashes,
+                                  &our_metainfo, &token, interruptor);
+        }
+        uint64_t num_pairs = 0;
+        for (const range_hash_t &h : our_hashes) {
+            num_pairs += h.num_pairs;
+        }
+
+        promise_t<std::pair<std::vector<uint64_t>, std::vector<state_timestamp_t> > >
+            reply;
+        mailbox_t<void(std::vector<uint64_t>, std::vector<state_timestamp_t>)>
+            reply_mailbox(
+                mailbox_manager,
+                [&](signal_t *,
+                        const std::vector<uint64_t> &hashes,
+                        const std::vector<state_timestamp_t> &timestamps) {
+                    reply.pulse(std::make_pair(hashes, timestamps));
+                });
+        send(mailbox_manager, backfiller->access().range_hashes_mailbox,
+             candidates, num_pairs, our_timestamp, reply_mailbox.get_address());
+        {
+            wait_any_t waiter(reply.get_ready_signal(), backfiller->get_failed_signal());
+            wait_interruptible(&waiter, interruptor);
+
+            /* Throw an exception if backfiller died */
+            backfiller->access();
+            guarantee(reply.get_ready_signal()->is_pulsed());
+        }
+        const std::vector<uint64_t> &their_hashes = reply.wait().first;
+        const std::vector<state_timestamp_t> &their_timestamps = reply.wait().second;
+        if (their_hashes.empty()) {
+            /* The backfiller thinks that a regular backfill is cheaper. */
+            break;
+        }
+        guarantee(their_hashes.size() == candidates.size());
+        guarantee(their_timestamps.size() == candidates.size());
+
+        /* If most of the data differs, it's not worth reading it again to narrow
+        the differences down. */
+        uint64_t differing_pairs = 0;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (our_hashes[i].hash != their_hashes[i]) {
+                differing_pairs += our_hashes[i].num_pairs;
+            }
+        }
+        bool keep_splitting = round == 0 || differing_pairs * 2 <= num_pairs;
+
+        std::vector<region_t> next_candidates;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (our_hashes[i].hash == their_hashes[i]) {
+                parts.push_back(std::make_pair(candidates[i], their_timestamps[i]));
+            } else if (!keep_splitting
+                       || our_hashes[i].num_pairs < BACKFILL_HASH_MIN_PAIRS
+                       || our_hashes[i].split_keys.empty()
+                       || next_candidates.size() + our_hashes[i].split_keys.size() + 1
+                          > BACKFILL_HASH_MAX_RANGES) {
+                parts.push_back(std::make_pair(candidates[i], state_timestamp_t::zero()));
+            } else {
+                split_region(candidates[i], our_hashes[i].split_keys, &next_candidates);
+            }
+        }
+        candidates.swap(next_candidates);
+    }
+
+    if (!have_data) {
+        parts.push_back(std::make_pair(region, state_timestamp_t::zero()));
+    }
+    for (const region_t &r : candidates) {
+        parts.push_back(std::make_pair(r, state_timestamp_t::zero()));
+    }
+
+    /* Merge neighbouring ranges with the same timestamp, so that the backfiller
+    doesn't have to traverse each of them separately. */
+    std::sort(parts.begin(), parts.end(),
+              [](const std::pair<region_t, state_timestamp_t> &a,
+                 const std::pair<region_t, state_timestamp_t> &b) {
+                  return a.first.inner.left < b.first.inner.left;
+              });
+    std::vector<std::pair<region_t, state_timestamp_t> > merged_parts;
+    for (const auto &part : parts) {
+        if (!merged_parts.empty() && merged_parts.back().second == part.second) {
+            rassert(merged_parts.back().first.inner.right
+                    == key_range_t::right_bound_t(part.first.inner.left));
+            merged_parts.back().first.inner.right = part.first.inner.right;
+        } else {
+            merged_parts.push_back(part);
+        }
+    }
+    return region_map_t<state_timestamp_t>(merged_parts.begin(), merged_parts.end());
+}
+
 void backfillee(
         mailbox_manager_t *mailbox_manager,
         branch_history_manager_t *branch_history_manager,
@@ -210,56 +432,28 @@ void backfillee(
         });
 
     {
-        typedef backfill_chunk_t backfill_chunk_t;
-
-        /* A queue of the requests the backfill chunk mailbox receives, a coro
-         * pool services these requests and poops them off one at a time to
-         * perform them. */
-
-        fifo_enforcer_queue_t<backfill_queue_entry_t> chunk_queue;
+        /* The backfiller splits the region into key ranges and sends each of
+        them over a separate stream. Each stream applies its chunks in order, but
+        independently of the other streams. */
+        std::vector<scoped_ptr_t<backfillee_stream_t> > streams;
+        std::vector<backfill_stream_business_card_t> stream_bcards;
+        for (size_t i = 0; i < BACKFILL_NUM_STREAMS; ++i) {
+            streams.push_back(scoped_ptr_t<backfillee_stream_t>(
+                new backfillee_stream_t(mailbox_manager)));
+            stream_bcards.push_back(streams.back()->get_business_card());
+        }
 
-        /* The backfiller will notify `done_mailbox` when the backfill is all over
-        and the version described in `end_point_mailbox` has been achieved. */
-        mailbox_t<void(fifo_enforcer_write_token_t)> done_mailbox(
-            mailbox_manager,
-            [&](signal_t *, const fifo_enforcer_write_token_t &token) {
-                chunk_queue.push(token,
-                    backfill_queue_entry_t(false, backfill_chunk_t(), 1.0, token));
-            });
-
-        /* The backfiller will send individual chunks of the backfill to
-        `chunk_mailbox`. */
-        mailbox_t<void(backfill_chunk_t, double, fifo_enforcer_write_token_t)>
-            chunk_mailbox(
-                mailbox_manager,
-                [&](signal_t *,
-                        const backfill_chunk_t &chunk,
-                        double progress,
-                        fifo_enforcer_write_token_t token) {
-                    // Here we reconstruct the ordering of the backfill chunks.
-                    // (note how `chunk_queue` is a `fifo_enforcer_queue_t`)
-                    chunk_queue.push(token,
-                        backfill_queue_entry_t(true, chunk, progress, token));
-                });
-
-        /* The backfiller will register for allocations on the allocation
-         * registration box. */
-        promise_t<mailbox_addr_t<void(int)> > alloc_mailbox_promise;
-        mailbox_t<void(mailbox_addr_t<void(int)>)>  alloc_registration_mbox(
-                mailbox_manager,
-                [&](signal_t *, const mailbox_addr_t<void(int)> &addr) {
-                    alloc_mailbox_promise.pulse(addr);
-                });
+        /* Find the parts of the region that we already have */
+        region_map_t<state_timestamp_t> in_sync_point = find_in_sync_ranges(
+            mailbox_manager, svs, region, start_point, &backfiller, interruptor);
 
         /* Send off the backfill request */
         send(mailbox_manager,
             backfiller.access().backfill_mailbox,
             backfill_session_id,
-            start_point, start_point_associated_history,
+            start_point, start_point_associated_history, in_sync_point,
             end_point_mailbox.get_address(),
-            chunk_mailbox.get_address(),
-            done_mailbox.get_address(),
-            alloc_registration_mbox.get_address());
+            stream_bcards);
 
         /* If something goes wrong, we'd like to inform the backfiller that it
         it has gone wrong, so it doesn't just keep blindly sending us chunks.
@@ -280,16 +474,14 @@ void backfillee(
                 backfill_session_id);
         }
 
-        /* Wait to get an allocation mailbox */
-        mailbox_addr_t<void(int)> allocation_mailbox;
-        {
-            wait_any_t waiter(alloc_mailbox_promise.get_ready_signal(), backfiller.get_failed_signal());
+        /* Wait to get an allocation mailbox for every stream */
+        for (const auto &stream : streams) {
+            wait_any_t waiter(stream->alloc_mailbox_promise.get_ready_signal(),
+                              backfiller.get_failed_signal());
             wait_interruptible(&waiter, interruptor);
 
             /* Throw an exception if backfiller died */
             backfiller.access();
-            bool got_value = alloc_mailbox_promise.try_get_value(&allocation_mailbox);
-            guarantee(got_value);
         }
 
         /* Wait until we get a message in `end_point_mailbox`. */
@@ -357,21 +549,23 @@ void backfillee(
             &write_token,
             interruptor);
 
-        chunk_callback_t chunk_callback(
-            svs, &chunk_queue, mailbox_manager, allocation_mailbox, progress_out);
-
-        coro_pool_t<backfill_queue_entry_t> backfill_workers(CHUNK_PROCESSING_CONCURRENCY,
-                                                             &chunk_queue, &chunk_callback);
+        for (const auto &stream : streams) {
+            stream->start(svs, mailbox_manager, progress_out);
+        }
 
-        /* Now wait for the backfill to be over */
-        {
-            wait_any_t waiter(&chunk_callback.done_cond, backfiller.get_failed_signal());
+        /* Now wait for the backfill to be over on every stream */
+        for (const auto &stream : streams) {
+            wait_any_t waiter(&stream->chunk_callback->done_cond,
+                              backfiller.get_failed_signal());
             wait_interruptible(&waiter, interruptor);
 
             /* Throw an exception if backfiller died */
             backfiller.access();
 
-            guarantee(chunk_callback.done_cond.is_pulsed());
+            guarantee(stream->chunk_callback->done_cond.is_pulsed());
+        }
+        if (progress_out != nullptr) {
+            *progress_out = 1.0;
         }
 
         /* All went well, so don't send a cancel message to the backfiller */
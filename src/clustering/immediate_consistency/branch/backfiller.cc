@@ -1,12 +1,14 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/branch/backfiller.hpp"
 
+#include <algorithm>
 #include <functional>
 
 #include "btree/parallel_traversal.hpp"
 #include "clustering/immediate_consistency/branch/history.hpp"
 #include "concurrency/fifo_enforcer.hpp"
 #include "concurrency/semaphore.hpp"
+#include "containers/scoped.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "rpc/semilattice/view.hpp"
 #include "stl_utils.hpp"
@@ -17,28 +19,123 @@
 // Each chunk can contain multiple key/value pairs, but its (approximate) maximum
 // size is limited by BACKFILL_MAX_KVPAIRS_SIZE as defined in btree/backfill.hpp.
 // When setting this value, keep memory consumption in mind.
-// Must be >= ALLOCATION_CHUNK in backfillee.cc, or backfilling will stall and
-// never finish.
+// The chunks are split evenly between the streams of a backfill, so this must be
+// >= ALLOCATION_CHUNK in backfillee.cc times BACKFILL_NUM_STREAMS, or backfilling
+// will stall and never finish.
 #define MAX_CHUNKS_OUT 64
 
 inline state_timestamp_t get_earliest_timestamp_of_version_range(const version_range_t &vr) {
     return vr.earliest.timestamp;
 }
 
+/* Backfills everything that changed since the backfillee's version, except where
+the range hash comparison found the backfillee to be in sync with a newer version of
+our data. There only the changes since that version are needed. */
+region_map_t<state_timestamp_t> get_backfill_start_timestamps(
+        const region_map_t<version_range_t> &start_point,
+        const region_map_t<state_timestamp_t> &in_sync_point) {
+    guarantee(start_point.get_domain() == in_sync_point.get_domain());
+    std::vector<std::pair<region_t, state_timestamp_t> > parts;
+    for (auto it = start_point.begin(); it != start_point.end(); ++it) {
+        for (auto jt = in_sync_point.begin(); jt != in_sync_point.end(); ++jt) {
+            region_t ixn = region_intersection(it->first, jt->first);
+            if (!region_is_empty(ixn)) {
+                parts.push_back(std::make_pair(
+                    ixn,
+                    std::max(get_earliest_timestamp_of_version_range(it->second),
+                             jt->second)));
+            }
+        }
+    }
+    return region_map_t<state_timestamp_t>(parts.begin(), parts.end());
+}
+
+/* Picks up to `num_streams - 1` keys that split `region` into ranges with about
+the same number of keys each, based on the key distribution of our store. Returns
+fewer keys if there's too little data to split it that finely. */
+std::vector<store_key_t> get_stream_split_keys(store_view_t *svs,
+                                               const region_t &region,
+                                               size_t num_streams,
+                                               signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    std::vector<store_key_t> split_keys;
+    if (num_streams <= 1) {
+        return split_keys;
+    }
+
+    static const int depth = 2;
+    static const size_t limit = 128;
+    distribution_read_t inner_read(depth, limit);
+    inner_read.region = region;
+    read_t read(inner_read, profile_bool_t::DONT_PROFILE);
+    read_response_t response;
+    read_token_t token;
+    svs->new_read_token(&token);
+#ifndef NDEBUG
+    trivial_metainfo_checker_callback_t metainfo_checker_callback;
+    metainfo_checker_t metainfo_checker(&metainfo_checker_callback, region);
+#endif
+    svs->read(DEBUG_ONLY(metainfo_checker, ) read, &response, &token, interruptor);
+    const std::map<store_key_t, int64_t> &counts =
+        boost::get<distribution_read_response_t>(response.response).key_counts;
+
+    int64_t total_count = 0;
+    for (const auto &pair : counts) {
+        total_count += pair.second;
+    }
+    int64_t count_before = 0;
+    for (const auto &pair : counts) {
+        int64_t split_count =
+            ((split_keys.size() + 1) * total_count) / num_streams;
+        if (split_keys.size() + 1 < num_streams
+            && count_before >= split_count
+            && pair.second != 0
+            && region.inner.left < pair.first) {
+            split_keys.push_back(pair.first);
+        }
+        count_before += pair.second;
+    }
+    return split_keys;
+}
+
+/* Splits the parts of `start_timestamps` at `split_keys`, so that each of them lies
+within one stream's range and is sent over a single stream. */
+region_map_t<state_timestamp_t> split_start_timestamps(
+        const region_map_t<state_timestamp_t> &start_timestamps,
+        const std::vector<store_key_t> &split_keys) {
+    std::vector<std::pair<region_t, state_timestamp_t> > parts;
+    for (auto it = start_timestamps.begin(); it != start_timestamps.end(); ++it) {
+        region_t piece = it->first;
+        for (const store_key_t &key : split_keys) {
+            if (piece.inner.contains_key(key) && piece.inner.left != key) {
+                region_t left_piece = piece;
+                left_piece.inner.right = key_range_t::right_bound_t(key);
+                parts.push_back(std::make_pair(left_piece, it->second));
+                piece.inner.left = key;
+            }
+        }
+        parts.push_back(std::make_pair(piece, it->second));
+    }
+    return region_map_t<state_timestamp_t>(parts.begin(), parts.end());
+}
+
 backfiller_t::backfiller_t(mailbox_manager_t *mm,
                            branch_history_manager_t *bhm,
                            store_view_t *_svs)
     : mailbox_manager(mm), branch_history_manager(bhm),
       svs(_svs),
       backfill_mailbox(mailbox_manager,
-                       std::bind(&backfiller_t::on_backfill, this, ph::_1, ph::_2, ph::_3, ph::_4, ph::_5, ph::_6, ph::_7, ph::_8)),
+                       std::bind(&backfiller_t::on_backfill, this, ph::_1, ph::_2, ph::_3, ph::_4, ph::_5, ph::_6, ph::_7)),
       cancel_backfill_mailbox(mailbox_manager,
-                              std::bind(&backfiller_t::on_cancel_backfill, this, ph::_1, ph::_2))
+                              std::bind(&backfiller_t::on_cancel_backfill, this, ph::_1, ph::_2)),
+      range_hashes_mailbox(mailbox_manager,
+                           std::bind(&backfiller_t::on_range_hashes, this, ph::_1, ph::_2, ph::_3, ph::_4, ph::_5))
       { }
 
 backfiller_business_card_t backfiller_t::get_business_card() {
     return backfiller_business_card_t(backfill_mailbox.get_address(),
-                                                  cancel_backfill_mailbox.get_address());
+                                                  cancel_backfill_mailbox.get_address(),
+                                                  range_hashes_mailbox.get_address());
 }
 
 bool backfiller_t::confirm_and_send_metainfo(region_map_t<binary_blob_t> metainfo,
@@ -91,26 +188,52 @@ bool backfiller_t::confirm_and_send_metainfo(region_map_t<binary_blob_t> metainf
     return true;
 }
 
+/* The flow control and chunk ordering of one stream of a backfill */
+struct backfill_stream_t {
+    backfill_stream_t(const backfill_stream_business_card_t &_bcard,
+                      int64_t max_chunks_out) :
+        bcard(_bcard), chunk_semaphore(max_chunks_out) { }
+
+    backfill_stream_business_card_t bcard;
+    static_semaphore_t chunk_semaphore;
+    // TODO: Describe this fifo source's purpose a bit.  It's for ordering backfill operations, right?
+    fifo_enforcer_source_t fifo_src;
+    scoped_ptr_t<mailbox_t<void(int)> > receive_allocations_mbox;
+};
+
+/* Returns the key that determines which stream a chunk is sent over, or nothing if
+it isn't specific to a key range. */
+class backfill_chunk_key_visitor_t : public boost::static_visitor<boost::optional<store_key_t> > {
+public:
+    boost::optional<store_key_t> operator()(const backfill_chunk_t::delete_key_t &del) const {
+        return del.key;
+    }
+    boost::optional<store_key_t> operator()(const backfill_chunk_t::delete_range_t &del) const {
+        return del.range.inner.left;
+    }
+    boost::optional<store_key_t> operator()(const backfill_chunk_t::key_value_pairs_t &kv) const {
+        guarantee(!kv.backfill_atoms.empty());
+        return kv.backfill_atoms.front().key;
+    }
+    boost::optional<store_key_t> operator()(const backfill_chunk_t::sindexes_t &) const {
+        return boost::none;
+    }
+};
+
 class backfiller_send_backfill_callback_t : public send_backfill_callback_t {
 public:
     backfiller_send_backfill_callback_t(
             const region_map_t<version_range_t> *start_point,
             mailbox_addr_t<void(region_map_t<version_range_t>, branch_history_t)> end_point_cont,
             mailbox_manager_t *mailbox_manager,
-            mailbox_addr_t<void(
-                backfill_chunk_t,
-                double,
-                fifo_enforcer_write_token_t
-                )> chunk_cont,
-            fifo_enforcer_source_t *fifo_src,
-            co_semaphore_t *chunk_semaphore,
+            const std::vector<store_key_t> *split_keys,
+            std::vector<scoped_ptr_t<backfill_stream_t> > *streams,
             backfiller_t *backfiller)
         : start_point_(start_point),
           end_point_cont_(end_point_cont),
           mailbox_manager_(mailbox_manager),
-          chunk_cont_(chunk_cont),
-          fifo_src_(fifo_src),
-          chunk_semaphore_(chunk_semaphore),
+          split_keys_(split_keys),
+          streams_(streams),
           backfiller_(backfiller) { }
 
     traversal_progress_combiner_t progress_combiner_;
@@ -120,27 +243,37 @@ public:
     }
 
     void send_chunk(const backfill_chunk_t &chunk, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
-        chunk_semaphore_->co_lock_interruptible(interruptor);
+        /* The start timestamps are split at the split keys, so all of a chunk's keys
+        belong to the same stream. Chunks that aren't specific to a key range (the
+        secondary index definitions) go over the first stream. The backfillee brings
+        new secondary indexes up to date on its own, so the other streams don't have
+        to wait for them. */
+        size_t stream_index = 0;
+        boost::optional<store_key_t> key =
+            boost::apply_visitor(backfill_chunk_key_visitor_t(), chunk.val);
+        if (key) {
+            stream_index = std::upper_bound(split_keys_->begin(), split_keys_->end(),
+                                            *key)
+                - split_keys_->begin();
+        }
+        backfill_stream_t *stream = (*streams_)[stream_index].get();
+
+        stream->chunk_semaphore.co_lock_interruptible(interruptor);
         progress_completion_fraction_t frac = progress_combiner_.guess_completion();
-        send(mailbox_manager_, chunk_cont_,
+        send(mailbox_manager_, stream->bcard.chunk_mailbox,
             chunk,
             frac.invalid()
                 ? 0.0   /* `frac.invalid()` is only true at start (I think) */
                 : static_cast<double>(frac.estimate_of_released_nodes) /
                     frac.estimate_of_total_nodes,
-            fifo_src_->enter_write());
+            stream->fifo_src.enter_write());
     }
 private:
     const region_map_t<version_range_t> *start_point_;
     mailbox_addr_t<void(region_map_t<version_range_t>, branch_history_t)> end_point_cont_;
     mailbox_manager_t *mailbox_manager_;
-    mailbox_addr_t<void(
-        backfill_chunk_t,
-        double,
-        fifo_enforcer_write_token_t
-        )> chunk_cont_;
-    fifo_enforcer_source_t *fifo_src_;
-    co_semaphore_t *chunk_semaphore_;
+    const std::vector<store_key_t> *split_keys_;
+    std::vector<scoped_ptr_t<backfill_stream_t> > *streams_;
     backfiller_t *backfiller_;
 
     DISABLE_COPYING(backfiller_send_backfill_callback_t);
@@ -151,17 +284,14 @@ void backfiller_t::on_backfill(
         backfill_session_id_t session_id,
         const region_map_t<version_range_t> &start_point,
         const branch_history_t &start_point_associated_branch_history,
+        const region_map_t<state_timestamp_t> &in_sync_point,
         mailbox_addr_t<void(region_map_t<version_range_t>, branch_history_t)> end_point_cont,
-        mailbox_addr_t<void(
-            backfill_chunk_t,
-            double,
-            fifo_enforcer_write_token_t
-            )> chunk_cont,
-        mailbox_addr_t<void(fifo_enforcer_write_token_t)> done_cont,
-        mailbox_addr_t<void(mailbox_addr_t<void(int)>)> allocation_registration_box) {
+        const std::vector<backfill_stream_business_card_t> &stream_bcards) {
 
     assert_thread();
     guarantee(region_is_superset(svs->get_region(), start_point.get_domain()));
+    guarantee(!stream_bcards.empty());
+    guarantee(stream_bcards.size() <= BACKFILL_NUM_STREAMS);
 
     /* Set up a local interruptor cond and put it in the map so that this
        session can be interrupted if the backfillee decides to abort */
@@ -173,12 +303,18 @@ void backfiller_t::on_backfill(
        wait on that cond yet. */
     wait_any_t interrupted(&local_interruptor, interruptor);
 
-    static_semaphore_t chunk_semaphore(MAX_CHUNKS_OUT);
-    mailbox_t<void(int)> receive_allocations_mbox(mailbox_manager,
-        [&](signal_t *, int allocs) {
-            chunk_semaphore.unlock(allocs);
-        });
-    send(mailbox_manager, allocation_registration_box, receive_allocations_mbox.get_address());
+    std::vector<scoped_ptr_t<backfill_stream_t> > streams;
+    for (const backfill_stream_business_card_t &bcard : stream_bcards) {
+        backfill_stream_t *stream =
+            new backfill_stream_t(bcard, MAX_CHUNKS_OUT / stream_bcards.size());
+        streams.push_back(scoped_ptr_t<backfill_stream_t>(stream));
+        stream->receive_allocations_mbox.init(new mailbox_t<void(int)>(mailbox_manager,
+            [stream](signal_t *, int allocs) {
+                stream->chunk_semaphore.unlock(allocs);
+            }));
+        send(mailbox_manager, bcard.allocation_registration_mailbox,
+             stream->receive_allocations_mbox->get_address());
+    }
 
     try {
         {
@@ -188,29 +324,34 @@ void backfiller_t::on_backfill(
                 interruptor);
         }
 
-        // TODO: Describe this fifo source's purpose a bit.  It's for ordering backfill operations, right?
-        fifo_enforcer_source_t fifo_src;
+        /* All streams are sent from the same snapshot, so there is a single end
+        point. The backfillee relies on that, since it only knows which writes to
+        skip after the backfill from the end point's timestamp. */
+        std::vector<store_key_t> split_keys = get_stream_split_keys(
+            svs, start_point.get_domain(), streams.size(), &interrupted);
 
         read_token_t send_backfill_token;
         svs->new_read_token(&send_backfill_token);
 
         backfiller_send_backfill_callback_t send_backfill_cb(
-            &start_point, end_point_cont, mailbox_manager, chunk_cont, &fifo_src,
-            &chunk_semaphore, this);
+            &start_point, end_point_cont, mailbox_manager, &split_keys, &streams,
+            this);
 
         /* Actually perform the backfill */
         svs->send_backfill(
-                     region_map_transform<version_range_t, state_timestamp_t>(
-                                                      start_point,
-                                                      &get_earliest_timestamp_of_version_range
-                                                      ),
-                     &send_backfill_cb,
-                     &send_backfill_cb.progress_combiner_,
-                     &send_backfill_token,
-                     &interrupted);
-
-        /* Send a confirmation */
-        send(mailbox_manager, done_cont, fifo_src.enter_write());
+            split_start_timestamps(
+                get_backfill_start_timestamps(start_point, in_sync_point),
+                split_keys),
+            &send_backfill_cb,
+            &send_backfill_cb.progress_combiner_,
+            &send_backfill_token,
+            &interrupted);
+
+        /* Send a confirmation on every stream */
+        for (const auto &stream : streams) {
+            send(mailbox_manager, stream->bcard.done_mailbox,
+                 stream->fifo_src.enter_write());
+        }
 
     } catch (const interrupted_exc_t &) {
         /* Ignore. If we were interrupted by the backfillee, then it already
@@ -239,3 +380,66 @@ void backfiller_t::on_cancel_backfill(
     }
 }
 
+void backfiller_t::on_range_hashes(
+        signal_t *interruptor,
+        const std::vector<region_t> &regions,
+        uint64_t backfillee_num_pairs,
+        state_timestamp_t backfillee_timestamp,
+        mailbox_addr_t<void(std::vector<uint64_t>, std::vector<state_timestamp_t>)> reply_cont) {
+
+    assert_thread();
+    for (const region_t &r : regions) {
+        guarantee(region_is_superset(svs->get_region(), r));
+    }
+
+    std::vector<uint64_t> hashes;
+    std::vector<state_timestamp_t> timestamps;
+    try {
+        /* Every write advances the timestamp by one, so this tells us how many
+        writes the backfillee missed. If there were only a few, a regular backfill
+        only has to visit the parts of the tree they touched. */
+        read_token_t metainfo_token;
+        svs->new_read_token(&metainfo_token);
+        region_map_t<binary_blob_t> current_blob;
+        svs->do_get_metainfo(order_token_t::ignore.with_read_mode(), &metainfo_token,
+                             interruptor, &current_blob);
+        state_timestamp_t current_timestamp = state_timestamp_t::zero();
+        for (const auto &pair : to_version_range_map(current_blob)) {
+            current_timestamp = std::max(current_timestamp, pair.second.latest.timestamp);
+        }
+        uint64_t missed_writes = backfillee_timestamp < current_timestamp
+            ? current_timestamp.to_repli_timestamp().longtime
+                - backfillee_timestamp.to_repli_timestamp().longtime
+            : 0;
+
+        if (missed_writes * BACKFILL_HASH_PAIRS_PER_WRITE >= backfillee_num_pairs) {
+            read_token_t hash_token;
+            svs->new_read_token(&hash_token);
+            std::vector<range_hash_t> range_hashes;
+            region_map_t<binary_blob_t> metainfo_blob;
+            svs->get_range_hashes(regions, 0, &range_hashes, &metainfo_blob,
+                                  &hash_token, interruptor);
+            region_map_t<version_range_t> metainfo = to_version_range_map(metainfo_blob);
+
+            /* The hashes are of our data at the snapshot's version, which is where
+            the backfill can start for the ranges that turn out to be in sync. */
+            for (size_t i = 0; i < regions.size(); ++i) {
+                hashes.push_back(range_hashes[i].hash);
+                boost::optional<state_timestamp_t> earliest;
+                for (const auto &pair : metainfo) {
+                    if (!region_is_empty(region_intersection(pair.first, regions[i]))
+                        && (!earliest || pair.second.earliest.timestamp < *earliest)) {
+                        earliest = pair.second.earliest.timestamp;
+                    }
+                }
+                guarantee(static_cast<bool>(earliest));
+                timestamps.push_back(*earliest);
+            }
+        }
+    } catch (const interrupted_exc_t &) {
+        /* The backfillee will notice that we went away. */
+        return;
+    }
+
+    send(mailbox_manager, reply_cont, hashes, timestamps);
+}
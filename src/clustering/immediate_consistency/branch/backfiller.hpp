@@ -4,6 +4,7 @@
 
 #include <map>
 #include <utility>
+#include <vector>
 
 #include "clustering/immediate_consistency/branch/history.hpp"
 #include "clustering/immediate_consistency/branch/metadata.hpp"
@@ -38,17 +39,19 @@ private:
             backfill_session_id_t session_id,
             const region_map_t<version_range_t> &start_point,
             const branch_history_t &start_point_associated_branch_history,
+            const region_map_t<state_timestamp_t> &in_sync_point,
             mailbox_addr_t<void(region_map_t<version_range_t>, branch_history_t)> end_point_cont,
-            mailbox_addr_t<void(
-                backfill_chunk_t,
-                double,
-                fifo_enforcer_write_token_t
-                )> chunk_cont,
-            mailbox_addr_t<void(fifo_enforcer_write_token_t)> done_cont,
-            mailbox_addr_t<void(mailbox_addr_t<void(int)>)> allocation_registration_box);
+            const std::vector<backfill_stream_business_card_t> &stream_bcards);
 
     void on_cancel_backfill(signal_t *interruptor, backfill_session_id_t session_id);
 
+    void on_range_hashes(
+            signal_t *interruptor,
+            const std::vector<region_t> &regions,
+            uint64_t backfillee_num_pairs,
+            state_timestamp_t backfillee_timestamp,
+            mailbox_addr_t<void(std::vector<uint64_t>, std::vector<state_timestamp_t>)> reply_cont);
+
     mailbox_manager_t *const mailbox_manager;
     branch_history_manager_t *const branch_history_manager;
 
@@ -58,6 +61,7 @@ private:
 
     backfiller_business_card_t::backfill_mailbox_t backfill_mailbox;
     backfiller_business_card_t::cancel_backfill_mailbox_t cancel_backfill_mailbox;
+    backfiller_business_card_t::range_hashes_mailbox_t range_hashes_mailbox;
 
     DISABLE_COPYING(backfiller_t);
 };
@@ -1,12 +1,15 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/branch/broadcaster.hpp"
 
+#include <deque>
 #include <functional>
 
 #include "errors.hpp"
 #include <boost/make_shared.hpp>
 #include <boost/bind.hpp>
 
+#include "arch/timing.hpp"
+#include "config/args.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/coro_pool.hpp"
 #include "concurrency/cross_thread_signal.hpp"
@@ -20,6 +23,7 @@
 #include "rpc/semilattice/view/member.hpp"
 #include "logger.hpp"
 #include "store_view.hpp"
+#include "time.hpp"
 
 /* Limits how many writes should be sent to a listener at once. */
 const size_t DISPATCH_WRITES_CORO_POOL_SIZE = 64;
@@ -205,21 +209,29 @@ private:
 class broadcaster_t::dispatchee_t : public intrusive_list_node_t<dispatchee_t> {
 public:
     dispatchee_t(broadcaster_t *c, listener_business_card_t d) THROWS_NOTHING :
-        write_mailbox(d.write_mailbox), is_readable(false), server_id(d.server_id),
+        write_mailbox(d.write_mailbox), heartbeat_mailbox(d.heartbeat_mailbox),
+        is_readable(false), server_id(d.server_id),
         local_listener(NULL), listener_id(generate_uuid()),
         queue_count(),
         queue_count_membership(&c->broadcaster_collection, &queue_count,
                                uuid_to_str(d.write_mailbox.get_peer().get_uuid())
                                            + "_broadcast_queue_count"),
         background_write_queue(&queue_count),
+        write_batch_queue(&queue_count),
         background_write_workers(DISPATCH_WRITES_CORO_POOL_SIZE, &background_write_queue,
                                  &background_write_caller),
+        write_batch_senders(BROADCASTER_MAX_WRITE_BATCHES_IN_FLIGHT, &write_batch_queue,
+                            &background_write_caller),
         controller(c),
         latest_acked_write(state_timestamp_t::zero()),
         upgrade_mailbox(controller->mailbox_manager,
             boost::bind(&dispatchee_t::upgrade, this, _1, _2, _3)),
         downgrade_mailbox(controller->mailbox_manager,
-            boost::bind(&dispatchee_t::downgrade, this, _1, _2))
+            boost::bind(&dispatchee_t::downgrade, this, _1, _2)),
+        heartbeats_requested_until(0),
+        sending_heartbeats(false),
+        heartbeat_request_mailbox(controller->mailbox_manager,
+            boost::bind(&dispatchee_t::on_heartbeat_request, this, _1))
     {
         controller->assert_thread();
         controller->sanity_check();
@@ -285,6 +297,7 @@ private:
              listener_intro_t(intro_timestamp,
                               upgrade_mailbox.get_address(),
                               downgrade_mailbox.get_address(),
+                              heartbeat_request_mailbox.get_address(),
                               listener_id));
     }
 
@@ -318,8 +331,40 @@ private:
         }
     }
 
+    /* The listener asks for heartbeats while it's serving reads with a
+    `max_staleness`. We start sending them right away, and keep sending them every
+    `BROADCASTER_HEARTBEAT_INTERVAL_MS` until `BROADCASTER_HEARTBEAT_LEASE_MS` after
+    the last request, so that replicas nobody reads from with a `max_staleness` don't
+    get any. */
+    void on_heartbeat_request(UNUSED signal_t *interruptor) THROWS_NOTHING {
+        heartbeats_requested_until = get_ticks()
+            + static_cast<ticks_t>(BROADCASTER_HEARTBEAT_LEASE_MS) * MILLION;
+        if (!sending_heartbeats) {
+            sending_heartbeats = true;
+            coro_t::spawn_sometime(std::bind(&dispatchee_t::send_heartbeats, this,
+                                             auto_drainer_t::lock_t(&drainer)));
+        }
+    }
+
+    /* Tells the listener our newest timestamp, so that it can tell how far behind
+    it is even when there are no writes. See `freshness_tracker_t`. */
+    void send_heartbeats(auto_drainer_t::lock_t keepalive) THROWS_NOTHING {
+        keepalive.assert_is_holding(&drainer);
+        try {
+            while (get_ticks() < heartbeats_requested_until) {
+                send(controller->mailbox_manager, heartbeat_mailbox,
+                     controller->current_timestamp);
+                nap(BROADCASTER_HEARTBEAT_INTERVAL_MS, keepalive.get_drain_signal());
+            }
+        } catch (const interrupted_exc_t &) {
+            /* pass */
+        }
+        sending_heartbeats = false;
+    }
+
 public:
     listener_business_card_t::write_mailbox_t::address_t write_mailbox;
+    listener_business_card_t::heartbeat_mailbox_t::address_t heartbeat_mailbox;
     bool is_readable;
     listener_business_card_t::writeread_mailbox_t::address_t writeread_mailbox;
     listener_business_card_t::read_mailbox_t::address_t read_mailbox;
@@ -344,13 +389,32 @@ public:
     // TODO: Is something wrong with the ordering guarantees between background writes and other writes?
     order_source_t order_source;
 
+    /* A remote listener gets its writes in batches, with one message and one ack
+    per batch. `write_batches` holds the batches that haven't been sent yet, oldest
+    first. Each has a `send_write_batch()` call waiting in `write_batch_queue`. New
+    writes are added to the last batch until a sender picks it up; since at most
+    `BROADCASTER_MAX_WRITE_BATCHES_IN_FLIGHT` batches are sent at once, the batches
+    get bigger when the listener is slow to ack. */
+    class write_batch_t {
+    public:
+        explicit write_batch_t(bool _is_writeread) : is_writeread(_is_writeread) { }
+        bool is_writeread;
+        std::vector<incomplete_write_ref_t> write_refs;
+        std::vector<order_token_t> order_tokens;
+        std::vector<fifo_enforcer_write_token_t> fifo_tokens;
+        std::vector<write_durability_t> durabilities;
+    };
+    std::deque<write_batch_t> write_batches;
+
     perfmon_counter_t queue_count;
     perfmon_membership_t queue_count_membership;
     unlimited_fifo_queue_t<std::function<void()> > background_write_queue;
+    unlimited_fifo_queue_t<std::function<void()> > write_batch_queue;
     calling_callback_t background_write_caller;
 
 private:
     coro_pool_t<std::function<void()> > background_write_workers;
+    coro_pool_t<std::function<void()> > write_batch_senders;
     broadcaster_t *controller;
 
     state_timestamp_t latest_acked_write;
@@ -359,6 +423,10 @@ private:
     listener_business_card_t::upgrade_mailbox_t upgrade_mailbox;
     listener_business_card_t::downgrade_mailbox_t downgrade_mailbox;
 
+    ticks_t heartbeats_requested_until;
+    bool sending_heartbeats;
+    listener_business_card_t::heartbeat_request_mailbox_t heartbeat_request_mailbox;
+
     DISABLE_COPYING(dispatchee_t);
 };
 
@@ -397,7 +465,9 @@ void broadcaster_t::listener_write(
             [&](signal_t *) { ack_cond.pulse(); });
 
         send(mailbox_manager, mirror->write_mailbox,
-             w, ts, order_token, token, ack_mailbox.get_address());
+             std::vector<listener_batched_write_t>(1, listener_batched_write_t(
+                 w, ts, order_token, token, write_durability_t::SOFT)),
+             ack_mailbox.get_address());
 
         wait_interruptible(&ack_cond, interruptor);
     }
@@ -518,7 +588,12 @@ void broadcaster_t::spawn_write(const write_t &write,
         that we don't check `interruptor` until the write is on its way
         to every dispatchee. */
         fifo_enforcer_write_token_t fifo_enforcer_token = it->first->fifo_source.enter_write();
-        if (it->first->is_readable) {
+        if (!it->first->is_local()) {
+            /* Writes to a local listener are plain function calls, so only remote
+            listeners get their writes in batches. */
+            add_to_write_batch(it->first, it->second, write_ref, order_token,
+                               fifo_enforcer_token, durability);
+        } else if (it->first->is_readable) {
             it->first->background_write_queue.push(boost::bind(&broadcaster_t::background_writeread, this,
                 it->first, it->second, write_ref, order_token, fifo_enforcer_token, durability));
         } else {
@@ -616,59 +691,127 @@ void broadcaster_t::background_writeread(
         incomplete_write_ref_t write_ref, order_token_t order_token,
         fifo_enforcer_write_token_t token, const write_durability_t durability)
         THROWS_NOTHING {
+    /* Remote listeners get their writes through `send_write_batch()` instead. */
+    guarantee(mirror->is_local());
     try {
-        write_response_t response;
-        if (mirror->local_listener != NULL) {
-            response = mirror->local_listener->local_writeread(
-                    write_ref.get()->write, write_ref.get()->timestamp, order_token,
-                    token, durability, mirror_lock.get_drain_signal());
-        } else {
-            cond_t response_cond;
-            mailbox_t<void(write_response_t)> response_mailbox(
+        write_response_t response = mirror->local_listener->local_writeread(
+            write_ref.get()->write, write_ref.get()->timestamp, order_token,
+            token, durability, mirror_lock.get_drain_signal());
+        handle_writeread_response(mirror, write_ref, response);
+    } catch (const interrupted_exc_t &) {
+        return;
+    }
+}
+
+void broadcaster_t::handle_writeread_response(
+        dispatchee_t *mirror, incomplete_write_ref_t write_ref,
+        const write_response_t &response) THROWS_NOTHING {
+    /* Update latest acked write on the distpatchee so we can route queries
+    to the fastest replica and avoid blocking there. */
+    mirror->bump_latest_acked_write(write_ref.get()->timestamp);
+
+    /* The write could potentially get acked now. So make sure all reads started
+    after this point will see this write. */
+    /* Note: At the moment we could move this into the `is_acceptable_ack_set`
+    `if` below and it would still be correct. However Tim mentioned that this
+    will become a little bit more difficult after some of his changes and
+    so we use this more conservative variant of increasing the timestamp
+    as soon as *the first* write comes back independent of whether that
+    actually satisfies the ack requirements or not. */
+    most_recent_acked_write_timestamp
+        = std::max(most_recent_acked_write_timestamp, write_ref.get()->timestamp);
+
+    write_ref.get()->ack_set.insert(mirror->server_id);
+    if (write_ref.get()->ack_checker->is_acceptable_ack_set(write_ref.get()->ack_set)) {
+        /* We might get here multiple times, if `is_acceptable_ack_set()`
+        returns `true` before all of the acks have come back. To avoid
+        calling the callback multiple times, we set `callback` to `NULL`
+        after the first time. This also signals `end_write()` not to call
+        `on_failure()`. */
+
+        if (write_ref.get()->callback != NULL) {
+            guarantee(write_ref.get()->callback->write == write_ref.get().get());
+            write_ref.get()->callback->write = NULL;
+            write_ref.get()->callback->on_success(response);
+            write_ref.get()->callback = NULL;
+        }
+    }
+}
+
+void broadcaster_t::add_to_write_batch(
+        dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock,
+        incomplete_write_ref_t write_ref, order_token_t order_token,
+        fifo_enforcer_write_token_t token, write_durability_t durability)
+        THROWS_NOTHING {
+    ASSERT_NO_CORO_WAITING;
+    std::deque<dispatchee_t::write_batch_t> *batches = &mirror->write_batches;
+    if (batches->empty()
+            || batches->back().is_writeread != mirror->is_readable
+            || batches->back().write_refs.size() >= BROADCASTER_MAX_WRITE_BATCH_SIZE) {
+        batches->push_back(dispatchee_t::write_batch_t(mirror->is_readable));
+        mirror->write_batch_queue.push(boost::bind(&broadcaster_t::send_write_batch,
+            this, mirror, mirror_lock));
+    }
+    dispatchee_t::write_batch_t *batch = &batches->back();
+    batch->write_refs.push_back(write_ref);
+    batch->order_tokens.push_back(order_token);
+    batch->fifo_tokens.push_back(token);
+    batch->durabilities.push_back(durability);
+}
+
+void broadcaster_t::send_write_batch(
+        dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock) THROWS_NOTHING {
+    /* Every call takes the oldest batch, which isn't necessarily the one it was
+    queued for. That's OK because the listener orders the writes by their FIFO
+    tokens anyway. */
+    guarantee(!mirror->write_batches.empty());
+    dispatchee_t::write_batch_t batch = std::move(mirror->write_batches.front());
+    mirror->write_batches.pop_front();
+
+    std::vector<listener_batched_write_t> writes;
+    writes.reserve(batch.write_refs.size());
+    for (size_t i = 0; i < batch.write_refs.size(); ++i) {
+        writes.push_back(listener_batched_write_t(
+            batch.write_refs[i].get()->write, batch.write_refs[i].get()->timestamp,
+            batch.order_tokens[i], batch.fifo_tokens[i], batch.durabilities[i]));
+    }
+
+    try {
+        if (batch.is_writeread) {
+            /* The listener replies to each write as soon as it's done, so writes
+            are acked to their clients without waiting for the rest of the batch. */
+            std::vector<bool> responded(batch.write_refs.size(), false);
+            size_t responses_left = batch.write_refs.size();
+            cond_t all_responded_cond;
+            mailbox_t<void(uint64_t, write_response_t)> response_mailbox(
                 mailbox_manager,
-                [&](signal_t *, const write_response_t &resp) {
-                    response = resp;
-                    response_cond.pulse();
+                [&](signal_t *, uint64_t index, const write_response_t &response) {
+                    guarantee(index < batch.write_refs.size());
+                    guarantee(!responded[index]);
+                    responded[index] = true;
+                    handle_writeread_response(mirror, batch.write_refs[index], response);
+                    --responses_left;
+                    if (responses_left == 0) {
+                        all_responded_cond.pulse();
+                    }
                 });
 
-            send(mailbox_manager, mirror->writeread_mailbox, write_ref.get()->write,
-                 write_ref.get()->timestamp, order_token, token,
-                 response_mailbox.get_address(), durability);
+            send(mailbox_manager, mirror->writeread_mailbox, writes,
+                 response_mailbox.get_address());
 
-            wait_interruptible(&response_cond, mirror_lock.get_drain_signal());
-        }
+            wait_interruptible(&all_responded_cond, mirror_lock.get_drain_signal());
+        } else {
+            cond_t ack_cond;
+            mailbox_t<void()> ack_mailbox(
+                mailbox_manager,
+                [&](signal_t *) { ack_cond.pulse(); });
 
-        /* Update latest acked write on the distpatchee so we can route queries
-        to the fastest replica and avoid blocking there. */
-        mirror->bump_latest_acked_write(write_ref.get()->timestamp);
-
-        /* The write could potentially get acked now. So make sure all reads started
-        after this point will see this write. */
-        /* Note: At the moment we could move this into the `is_acceptable_ack_set`
-        `if` below and it would still be correct. However Tim mentioned that this
-        will become a little bit more difficult after some of his changes and
-        so we use this more conservative variant of increasing the timestamp
-        as soon as *the first* write comes back independent of whether that
-        actually satisfies the ack requirements or not. */
-        most_recent_acked_write_timestamp
-            = std::max(most_recent_acked_write_timestamp, write_ref.get()->timestamp);
-
-        write_ref.get()->ack_set.insert(mirror->server_id);
-        if (write_ref.get()->ack_checker->is_acceptable_ack_set(write_ref.get()->ack_set)) {
-            /* We might get here multiple times, if `is_acceptable_ack_set()`
-            returns `true` before all of the acks have come back. To avoid
-            calling the callback multiple times, we set `callback` to `NULL`
-            after the first time. This also signals `end_write()` not to call
-            `on_failure()`. */
-
-            if (write_ref.get()->callback != NULL) {
-                guarantee(write_ref.get()->callback->write == write_ref.get().get());
-                write_ref.get()->callback->write = NULL;
-                write_ref.get()->callback->on_success(response);
-                write_ref.get()->callback = NULL;
-            }
-        }
+            send(mailbox_manager, mirror->write_mailbox, writes,
+                 ack_mailbox.get_address());
 
+            wait_interruptible(&ack_cond, mirror_lock.get_drain_signal());
+            mirror->bump_latest_acked_write(writes.back().timestamp);
+        }
     } catch (const interrupted_exc_t &) {
         return;
     }
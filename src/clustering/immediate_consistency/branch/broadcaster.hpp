@@ -145,6 +145,18 @@ private:
         dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock,
         incomplete_write_ref_t write_ref, order_token_t order_token,
         fifo_enforcer_write_token_t token, write_durability_t durability) THROWS_NOTHING;
+    void handle_writeread_response(
+        dispatchee_t *mirror, incomplete_write_ref_t write_ref,
+        const write_response_t &response) THROWS_NOTHING;
+
+    /* `add_to_write_batch()` queues a write for a remote listener, and
+    `send_write_batch()` sends the oldest queued batch of writes to it. */
+    void add_to_write_batch(
+        dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock,
+        incomplete_write_ref_t write_ref, order_token_t order_token,
+        fifo_enforcer_write_token_t token, write_durability_t durability) THROWS_NOTHING;
+    void send_write_batch(
+        dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock) THROWS_NOTHING;
     void end_write(boost::shared_ptr<incomplete_write_t> write) THROWS_NOTHING;
 
     void single_read(
@@ -0,0 +1,39 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "clustering/immediate_consistency/branch/freshness_tracker.hpp"
+
+#include <algorithm>
+
+#include "config/args.hpp"
+
+void freshness_tracker_t::note_primary_timestamp(
+        ticks_t now, state_timestamp_t timestamp) {
+    if (!heartbeats_.empty()) {
+        /* Heartbeats may overtake each other on the network. */
+        rassert(now >= heartbeats_.back().first);
+        timestamp = std::max(timestamp, heartbeats_.back().second);
+    }
+    heartbeats_.push_back(std::make_pair(now, timestamp));
+
+    const ticks_t history = static_cast<ticks_t>(LISTENER_FRESHNESS_HISTORY_MS) * MILLION;
+    while (heartbeats_.front().first + history < now) {
+        heartbeats_.pop_front();
+    }
+}
+
+boost::optional<state_timestamp_t> freshness_tracker_t::get_required_timestamp(
+        ticks_t now, ticks_t max_staleness) const {
+    /* The first heartbeat that arrived at most `max_staleness` ago tells us the
+    newest timestamp that the primary replica had handed out by then. If the history
+    doesn't reach back that far, the oldest heartbeat we still have is a stricter
+    requirement than necessary, but still a correct one. */
+    const ticks_t cutoff = now > max_staleness ? now - max_staleness : 0;
+    auto it = std::lower_bound(
+        heartbeats_.begin(), heartbeats_.end(), cutoff,
+        [](const std::pair<ticks_t, state_timestamp_t> &heartbeat, ticks_t t) {
+            return heartbeat.first < t;
+        });
+    if (it == heartbeats_.end()) {
+        return boost::none;
+    }
+    return it->second;
+}
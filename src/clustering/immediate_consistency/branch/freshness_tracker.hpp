@@ -0,0 +1,44 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_IMMEDIATE_CONSISTENCY_BRANCH_FRESHNESS_TRACKER_HPP_
+#define CLUSTERING_IMMEDIATE_CONSISTENCY_BRANCH_FRESHNESS_TRACKER_HPP_
+
+#include <deque>
+#include <utility>
+
+#include "errors.hpp"
+#include <boost/optional.hpp>
+
+#include "time.hpp"
+#include "timestamps.hpp"
+
+/* `freshness_tracker_t` remembers how far the primary replica had got at recent
+points in time, so that a replica can tell which writes a read has to see to be at
+most a given interval out of date. The broadcaster sends its newest timestamp to
+every listener every `BROADCASTER_HEARTBEAT_INTERVAL_MS`, and the listener passes it
+to `note_primary_timestamp()` together with the local time it arrived. All times are
+local `get_ticks()` values, so the servers' clocks don't have to agree; the time a
+heartbeat spends on the network isn't counted. */
+
+class freshness_tracker_t {
+public:
+    freshness_tracker_t() { }
+
+    void note_primary_timestamp(ticks_t now, state_timestamp_t timestamp);
+
+    /* Returns the timestamp that a read at `now` must see so that it doesn't miss
+    any write that the primary replica started more than `max_staleness` ago. Returns
+    nothing if we haven't heard from the primary replica since then, because then we
+    can't know what we're missing. */
+    boost::optional<state_timestamp_t> get_required_timestamp(
+            ticks_t now, ticks_t max_staleness) const;
+
+private:
+    /* The local time at which each heartbeat arrived, and the primary replica's
+    timestamp at that point. Both are non-decreasing, and heartbeats older than
+    `LISTENER_FRESHNESS_HISTORY_MS` are dropped. */
+    std::deque<std::pair<ticks_t, state_timestamp_t> > heartbeats_;
+
+    DISABLE_COPYING(freshness_tracker_t);
+};
+
+#endif /* CLUSTERING_IMMEDIATE_CONSISTENCY_BRANCH_FRESHNESS_TRACKER_HPP_ */
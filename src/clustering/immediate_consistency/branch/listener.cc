@@ -6,17 +6,21 @@
 #include "errors.hpp"
 #include <boost/bind.hpp>
 
+#include "arch/timing.hpp"
 #include "clustering/generic/registrant.hpp"
 #include "clustering/generic/resource.hpp"
 #include "clustering/immediate_consistency/branch/backfillee.hpp"
 #include "clustering/immediate_consistency/branch/backfill_throttler.hpp"
 #include "clustering/immediate_consistency/branch/broadcaster.hpp"
 #include "clustering/immediate_consistency/branch/history.hpp"
+#include "config/args.hpp"
 #include "concurrency/cond_var.hpp"
 #include "concurrency/coro_pool.hpp"
 #include "concurrency/cross_thread_signal.hpp"
+#include "concurrency/pmap.hpp"
 #include "concurrency/wait_any.hpp"
 #include "containers/archive/versioned.hpp"
+#include "containers/map_sentries.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "store_view.hpp"
 
@@ -80,17 +84,20 @@ listener_t::listener_t(const base_path_t &base_path,
     uuid_(generate_uuid()),
     perfmon_collection_(),
     perfmon_collection_membership_(backfill_stats_parent, &perfmon_collection_, "backfill-serialization-" + uuid_to_str(uuid_)),
+    last_heartbeat_request_(0),
     write_queue_(io_backender,
                  serializer_filepath_t(base_path, "backfill-serialization-" + uuid_to_str(uuid_)),
                  &perfmon_collection_),
     write_queue_semaphore_(SEMAPHORE_NO_LIMIT,
         WRITE_QUEUE_SEMAPHORE_TRICKLE_FRACTION),
     write_mailbox_(mailbox_manager_,
-        std::bind(&listener_t::on_write, this, ph::_1, ph::_2, ph::_3, ph::_4, ph::_5, ph::_6)),
+        std::bind(&listener_t::on_write, this, ph::_1, ph::_2, ph::_3)),
     writeread_mailbox_(mailbox_manager_,
-        std::bind(&listener_t::on_writeread, this, ph::_1, ph::_2, ph::_3, ph::_4, ph::_5, ph::_6, ph::_7)),
+        std::bind(&listener_t::on_writeread, this, ph::_1, ph::_2, ph::_3)),
     read_mailbox_(mailbox_manager_,
-        std::bind(&listener_t::on_read, this, ph::_1, ph::_2, ph::_3, ph::_4))
+        std::bind(&listener_t::on_read, this, ph::_1, ph::_2, ph::_3, ph::_4)),
+    heartbeat_mailbox_(mailbox_manager_,
+        std::bind(&listener_t::on_heartbeat, this, ph::_1, ph::_2))
 {
     boost::optional<boost::optional<broadcaster_business_card_t> > business_card =
         broadcaster_metadata->get();
@@ -259,15 +266,18 @@ listener_t::listener_t(const base_path_t &base_path,
     uuid_(generate_uuid()),
     perfmon_collection_(),
     perfmon_collection_membership_(backfill_stats_parent, &perfmon_collection_, "backfill-serialization-" + uuid_to_str(uuid_)),
+    last_heartbeat_request_(0),
     write_queue_(io_backender, serializer_filepath_t(base_path, "backfill-serialization-" + uuid_to_str(uuid_)), &perfmon_collection_),
     write_queue_semaphore_(WRITE_QUEUE_SEMAPHORE_LONG_TERM_CAPACITY,
         WRITE_QUEUE_SEMAPHORE_TRICKLE_FRACTION),
     write_mailbox_(mailbox_manager_,
-        std::bind(&listener_t::on_write, this, ph::_1, ph::_2, ph::_3, ph::_4, ph::_5, ph::_6)),
+        std::bind(&listener_t::on_write, this, ph::_1, ph::_2, ph::_3)),
     writeread_mailbox_(mailbox_manager_,
-        std::bind(&listener_t::on_writeread, this, ph::_1, ph::_2, ph::_3, ph::_4, ph::_5, ph::_6, ph::_7)),
+        std::bind(&listener_t::on_writeread, this, ph::_1, ph::_2, ph::_3)),
     read_mailbox_(mailbox_manager_,
-        std::bind(&listener_t::on_read, this, ph::_1, ph::_2, ph::_3, ph::_4))
+        std::bind(&listener_t::on_read, this, ph::_1, ph::_2, ph::_3, ph::_4)),
+    heartbeat_mailbox_(mailbox_manager_,
+        std::bind(&listener_t::on_heartbeat, this, ph::_1, ph::_2))
 {
     branch_birth_certificate_t this_branch_history;
     {
@@ -328,11 +338,12 @@ listener_t::listener_t(const base_path_t &base_path,
 }
 
 listener_t::~listener_t() {
-    /* Shut down all three in parallel so we don't have to wait for each one's coroutines
+    /* Shut down all four in parallel so we don't have to wait for each one's coroutines
     to stop before we start stopping the next one's coroutines */
     write_mailbox_.begin_shutdown();
     writeread_mailbox_.begin_shutdown();
     read_mailbox_.begin_shutdown();
+    heartbeat_mailbox_.begin_shutdown();
 }
 
 signal_t *listener_t::get_broadcaster_lost_signal() {
@@ -383,7 +394,8 @@ void listener_t::try_start_receiving_writes(
 
     try {
         listener_business_card_t our_bcard(
-            intro_mailbox.get_address(), write_mailbox_.get_address(), server_id_);
+            intro_mailbox.get_address(), write_mailbox_.get_address(),
+            heartbeat_mailbox_.get_address(), server_id_);
         registrant_.init(new registrant_t<listener_business_card_t>(
             mailbox_manager_,
             broadcaster->subview(&listener_t::get_registrar_from_broadcaster_bcard),
@@ -405,14 +417,15 @@ void listener_t::try_start_receiving_writes(
 
 void listener_t::on_write(
         signal_t *interruptor,
-        const write_t &write,
-        state_timestamp_t timestamp,
-        order_token_t order_token,
-        fifo_enforcer_write_token_t fifo_token,
+        const std::vector<listener_batched_write_t> &writes,
         mailbox_addr_t<void()> ack_addr)
         THROWS_NOTHING {
     try {
-        local_write(write, timestamp, order_token, fifo_token, interruptor);
+        /* `local_write()` only puts the write on the write queue, so there's no point
+        in running the writes of a batch concurrently. */
+        for (const listener_batched_write_t &w : writes) {
+            local_write(w.write, w.timestamp, w.order_token, w.fifo_token, interruptor);
+        }
         send(mailbox_manager_, ack_addr);
     } catch (const interrupted_exc_t &) {
         /* pass */
@@ -492,21 +505,23 @@ void listener_t::perform_enqueued_write(const write_queue_entry_t &qe,
 
 void listener_t::on_writeread(
         signal_t *interruptor,
-        const write_t &write,
-        state_timestamp_t timestamp,
-        order_token_t order_token,
-        fifo_enforcer_write_token_t fifo_token,
-        mailbox_addr_t<void(write_response_t)> ack_addr,
-        write_durability_t durability)
+        const std::vector<listener_batched_write_t> &writes,
+        mailbox_addr_t<void(uint64_t, write_response_t)> ack_addr)
         THROWS_NOTHING {
-    try {
-        write_response_t response = local_writeread(write, timestamp,
-                                                    order_token, fifo_token,
-                                                    durability, interruptor);
-        send(mailbox_manager_, ack_addr, response);
-    } catch (const interrupted_exc_t &) {
-        /* pass */
-    }
+    /* The writes of a batch are performed concurrently, just as if they had been
+    sent separately. `local_writeread()` makes them enter the store in the order of
+    their FIFO tokens. Each write is replied to as soon as it's done, so that a slow
+    write (e.g. one with hard durability) doesn't hold up the others in its batch. */
+    pmap(writes.size(), [&](int64_t i) {
+        try {
+            write_response_t response = local_writeread(
+                writes[i].write, writes[i].timestamp, writes[i].order_token,
+                writes[i].fifo_token, writes[i].durability, interruptor);
+            send(mailbox_manager_, ack_addr, static_cast<uint64_t>(i), response);
+        } catch (const interrupted_exc_t &) {
+            /* pass */
+        }
+    });
 }
 
 write_response_t listener_t::local_writeread(const write_t &write,
@@ -631,6 +646,71 @@ void listener_t::wait_for_version(state_timestamp_t timestamp, signal_t *interru
     }
 }
 
+bool listener_t::wait_until_fresh(int64_t max_staleness_ms, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    auto_drainer_t::lock_t keepalive = drainer_.lock();
+    if (get_broadcaster_lost_signal()->is_pulsed()) {
+        return false;
+    }
+    request_heartbeats();
+
+    signal_timer_t timeout;
+    timeout.start(READ_MAX_STALENESS_WAIT_MS);
+    wait_any_t waiter(&timeout, keepalive.get_drain_signal(),
+                      get_broadcaster_lost_signal(), interruptor);
+    try {
+        const ticks_t max_staleness = static_cast<ticks_t>(max_staleness_ms) * MILLION;
+        boost::optional<state_timestamp_t> required =
+            freshness_tracker_.get_required_timestamp(get_ticks(), max_staleness);
+        if (!required) {
+            /* Either nobody has read from us with a `max_staleness` in a while, so the
+            broadcaster isn't sending heartbeats right now, or the bound is shorter than
+            the heartbeat interval. Either way the next heartbeat tells us what we have
+            to see. */
+            cond_t heartbeat_arrived;
+            multimap_insertion_sentry_t<ticks_t, cond_t *> sentry(
+                &heartbeat_waiters_, get_ticks(), &heartbeat_arrived);
+            wait_interruptible(&heartbeat_arrived, &waiter);
+            required = freshness_tracker_.get_required_timestamp(
+                get_ticks(), max_staleness);
+            if (!required) {
+                return false;
+            }
+        }
+        read_min_timestamp_enforcer_.wait_interruptible(
+            min_timestamp_token_t(*required), &waiter);
+    } catch (const interrupted_exc_t &) {
+        if (interruptor->is_pulsed()) {
+            throw;
+        }
+        return false;
+    }
+    return true;
+}
+
+void listener_t::request_heartbeats() {
+    const ticks_t now = get_ticks();
+    const ticks_t renew_after =
+        static_cast<ticks_t>(BROADCASTER_HEARTBEAT_LEASE_MS) * MILLION / 2;
+    if (last_heartbeat_request_ != 0 && now < last_heartbeat_request_ + renew_after) {
+        return;
+    }
+    last_heartbeat_request_ = now;
+    send(mailbox_manager_,
+         registration_done_cond_.wait().heartbeat_request_mailbox);
+}
+
+void listener_t::on_heartbeat(UNUSED signal_t *interruptor,
+                              state_timestamp_t primary_timestamp) THROWS_NOTHING {
+    const ticks_t now = get_ticks();
+    freshness_tracker_.note_primary_timestamp(now, primary_timestamp);
+    for (auto it = heartbeat_waiters_.begin();
+         it != heartbeat_waiters_.upper_bound(now);
+         ++it) {
+        it->second->pulse_if_not_already_pulsed();
+    }
+}
+
 void listener_t::advance_current_timestamp_and_pulse_waiters(state_timestamp_t timestamp) {
     guarantee(timestamp == current_timestamp_.next());
     current_timestamp_ = timestamp;
@@ -669,3 +749,7 @@ void listener_t::mark_write_done(
 RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(
         listener_t::write_queue_entry_t, write, order_token, timestamp,
         fifo_token);
+
+RDB_IMPL_SERIALIZABLE_5_FOR_CLUSTER(
+        listener_batched_write_t, write, timestamp, order_token, fifo_token,
+        durability);
@@ -4,7 +4,9 @@
 
 #include <map>
 #include <utility>
+#include <vector>
 
+#include "clustering/immediate_consistency/branch/freshness_tracker.hpp"
 #include "clustering/immediate_consistency/branch/metadata.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/fifo_enforcer.hpp"
@@ -31,6 +33,30 @@ template <class> class semilattice_readwrite_view_t;
 template <class> class watchable_t;
 class backfill_throttler_t;
 
+/* `listener_batched_write_t` is one of the writes that the `broadcaster_t` sends to
+a listener together in a single message. Every write keeps its own timestamp, FIFO
+token, and durability, so the listener applies it exactly as if it had been sent on
+its own. */
+
+class listener_batched_write_t {
+public:
+    listener_batched_write_t() { }
+    listener_batched_write_t(const write_t &w, state_timestamp_t ts,
+                             order_token_t ot, fifo_enforcer_write_token_t ft,
+                             write_durability_t d)
+        : write(w), timestamp(ts), order_token(ot), fifo_token(ft), durability(d) { }
+
+    write_t write;
+    state_timestamp_t timestamp;
+    order_token_t order_token;
+    fifo_enforcer_write_token_t fifo_token;
+    /* Ignored for writes sent to a listener's `write_mailbox`, because those aren't
+    acked to the user. */
+    write_durability_t durability;
+};
+
+RDB_DECLARE_SERIALIZABLE(listener_batched_write_t);
+
 /* `listener_t` keeps a store-view in sync with a branch. Its constructor
 contacts a `broadcaster_t` to sign up for real-time updates, and also backfills
 from a `replier_t` to get a copy of all the existing data. As long as the
@@ -124,6 +150,15 @@ public:
 
     void wait_for_version(state_timestamp_t timestamp, signal_t *interruptor);
 
+    /* Waits until every write that the primary replica started more than
+    `max_staleness_ms` ago is visible to reads. If we haven't heard from the
+    broadcaster within `max_staleness_ms`, we wait for its next heartbeat, since until
+    then we can't know what we're missing. Returns `false` if all of that takes longer
+    than `READ_MAX_STALENESS_WAIT_MS`. See `freshness_tracker_t` for how the staleness
+    is measured. */
+    bool wait_until_fresh(int64_t max_staleness_ms, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
     const listener_intro_t &registration_done_cond_value() const {
         return registration_done_cond_.wait();
     }
@@ -183,10 +218,7 @@ private:
 
     void on_write(
             signal_t *interruptor,
-            const write_t &write,
-            state_timestamp_t timestamp,
-            order_token_t order_token,
-            fifo_enforcer_write_token_t fifo_token,
+            const std::vector<listener_batched_write_t> &writes,
             mailbox_addr_t<void()> ack_addr)
         THROWS_NOTHING;
 
@@ -198,12 +230,8 @@ private:
 
     void on_writeread(
             signal_t *interruptor,
-            const write_t &write,
-            state_timestamp_t timestamp,
-            order_token_t order_token,
-            fifo_enforcer_write_token_t fifo_token,
-            mailbox_addr_t<void(write_response_t)> ack_addr,
-            write_durability_t durability)
+            const std::vector<listener_batched_write_t> &writes,
+            mailbox_addr_t<void(uint64_t, write_response_t)> ack_addr)
         THROWS_NOTHING;
 
     void on_read(
@@ -213,6 +241,14 @@ private:
             mailbox_addr_t<void(read_response_t)> ack_addr)
         THROWS_NOTHING;
 
+    /* Asks the broadcaster to keep sending us heartbeats, unless we asked recently
+    enough that it still is. */
+    void request_heartbeats();
+
+    /* Mailbox callback for the broadcaster's heartbeats */
+    void on_heartbeat(signal_t *interruptor, state_timestamp_t primary_timestamp)
+        THROWS_NOTHING;
+
     /* Must be called while holding an exit_write_t on the store_entrance_sink_ */
     void advance_current_timestamp_and_pulse_waiters(state_timestamp_t timestamp);
 
@@ -262,6 +298,15 @@ private:
     fifo_enforcer_queue_t<std::pair<state_timestamp_t, fifo_enforcer_write_token_t> >
         mark_done_timestamps_queue_;
 
+    /* Fed by the broadcaster's heartbeats, used by `wait_until_fresh()` */
+    freshness_tracker_t freshness_tracker_;
+
+    /* When we last asked the broadcaster for heartbeats, or 0 if we never have */
+    ticks_t last_heartbeat_request_;
+
+    /* Reads that are waiting for a heartbeat that arrives after the given time */
+    std::multimap<ticks_t, cond_t *> heartbeat_waiters_;
+
 
     // Used by the replier_t which needs to be able to tell
     // backfillees how up to date it is.
@@ -291,6 +336,7 @@ private:
     have all the query-handling code in one place. */
     listener_business_card_t::writeread_mailbox_t writeread_mailbox_;
     listener_business_card_t::read_mailbox_t read_mailbox_;
+    listener_business_card_t::heartbeat_mailbox_t heartbeat_mailbox_;
 
     /* The local listener registration is released after the registrant_'s destructor
     has unregistered with the broadcaster. That's why we must make sure that
@@ -2,20 +2,26 @@
 #include "clustering/immediate_consistency/branch/metadata.hpp"
 
 
-RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
+RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(
         listener_business_card_t,
-        intro_mailbox, write_mailbox, server_id);
+        intro_mailbox, write_mailbox, heartbeat_mailbox, server_id);
 
-RDB_IMPL_SERIALIZABLE_4_SINCE_v1_13(
+RDB_IMPL_SERIALIZABLE_5_FOR_CLUSTER(
         listener_intro_t, broadcaster_begin_timestamp, upgrade_mailbox,
-        downgrade_mailbox, listener_id);
+        downgrade_mailbox, heartbeat_request_mailbox, listener_id);
 
-RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
-        backfiller_business_card_t, backfill_mailbox, cancel_backfill_mailbox);
+RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
+        backfill_stream_business_card_t, chunk_mailbox, done_mailbox,
+        allocation_registration_mailbox);
+
+RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
+        backfiller_business_card_t, backfill_mailbox, cancel_backfill_mailbox,
+        range_hashes_mailbox);
 
-RDB_IMPL_EQUALITY_COMPARABLE_2(backfiller_business_card_t,
+RDB_IMPL_EQUALITY_COMPARABLE_3(backfiller_business_card_t,
                                backfill_mailbox,
-                               cancel_backfill_mailbox);
+                               cancel_backfill_mailbox,
+                               range_hashes_mailbox);
 
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
         broadcaster_business_card_t, branch_id, branch_id_associated_branch_history,
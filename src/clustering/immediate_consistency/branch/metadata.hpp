@@ -4,6 +4,7 @@
 
 #include <map>
 #include <utility>
+#include <vector>
 
 #include "clustering/generic/registration_metadata.hpp"
 #include "clustering/immediate_consistency/branch/history.hpp"
@@ -18,6 +19,8 @@
 #include "rpc/semilattice/joins/map.hpp"
 #include "timestamps.hpp"
 
+/* `listener_batched_write_t` is defined in `listener.hpp`. */
+class listener_batched_write_t;
 class listener_intro_t;
 
 /* Every `listener_t` constructs a `listener_business_card_t` and sends it to
@@ -26,20 +29,17 @@ the `broadcaster_t`. */
 class listener_business_card_t {
 public:
     /* These are the types of mailboxes that the master uses to communicate with
-    the mirrors. */
+    the mirrors. Writes are sent in batches. The listener acks a batch sent to
+    `write_mailbox_t` once it has performed all of its writes. `writeread_mailbox_t`
+    replies to each write of a batch as soon as it's done, with its position in the
+    batch and its response. */
 
-    typedef mailbox_t<void(write_t,
-                           state_timestamp_t,
-                           order_token_t,
-                           fifo_enforcer_write_token_t,
+    typedef mailbox_t<void(std::vector<listener_batched_write_t>,
                            mailbox_addr_t<void()> ack_addr)> write_mailbox_t;
 
-    typedef mailbox_t<void(write_t,
-                           state_timestamp_t,
-                           order_token_t,
-                           fifo_enforcer_write_token_t,
-                           mailbox_addr_t<void(write_response_t)>,
-                           write_durability_t)> writeread_mailbox_t;
+    typedef mailbox_t<void(std::vector<listener_batched_write_t>,
+                           mailbox_addr_t<void(uint64_t, write_response_t)>)>
+        writeread_mailbox_t;
 
     typedef mailbox_t<void(read_t,
                            min_timestamp_token_t,
@@ -57,14 +57,25 @@ public:
 
     typedef mailbox_t<void(listener_intro_t)> intro_mailbox_t;
 
+    /* While the mirror is serving reads with a `max_staleness`, it sends messages to
+    the master's `heartbeat_request_mailbox`. For a while after each request, the
+    master periodically sends its newest timestamp to `heartbeat_mailbox`, so that the
+    mirror knows how far behind it is. */
+
+    typedef mailbox_t<void()> heartbeat_request_mailbox_t;
+
+    typedef mailbox_t<void(state_timestamp_t)> heartbeat_mailbox_t;
+
     listener_business_card_t() { }
     listener_business_card_t(const intro_mailbox_t::address_t &im,
                              const write_mailbox_t::address_t &wm,
+                             const heartbeat_mailbox_t::address_t &hm,
                              const server_id_t &si)
-        : intro_mailbox(im), write_mailbox(wm), server_id(si) { }
+        : intro_mailbox(im), write_mailbox(wm), heartbeat_mailbox(hm), server_id(si) { }
 
     intro_mailbox_t::address_t intro_mailbox;
     write_mailbox_t::address_t write_mailbox;
+    heartbeat_mailbox_t::address_t heartbeat_mailbox;
     server_id_t server_id;
 };
 
@@ -76,54 +87,104 @@ public:
     state_timestamp_t broadcaster_begin_timestamp;
     listener_business_card_t::upgrade_mailbox_t::address_t upgrade_mailbox;
     listener_business_card_t::downgrade_mailbox_t::address_t downgrade_mailbox;
+    listener_business_card_t::heartbeat_request_mailbox_t::address_t
+        heartbeat_request_mailbox;
     uuid_u listener_id;
 
     listener_intro_t() { }
     listener_intro_t(state_timestamp_t _broadcaster_begin_timestamp,
                      listener_business_card_t::upgrade_mailbox_t::address_t _upgrade_mailbox,
                      listener_business_card_t::downgrade_mailbox_t::address_t _downgrade_mailbox,
+                     listener_business_card_t::heartbeat_request_mailbox_t::address_t
+                         _heartbeat_request_mailbox,
                      uuid_u _listener_id)
         : broadcaster_begin_timestamp(_broadcaster_begin_timestamp),
           upgrade_mailbox(_upgrade_mailbox), downgrade_mailbox(_downgrade_mailbox),
+          heartbeat_request_mailbox(_heartbeat_request_mailbox),
           listener_id(_listener_id) { }
 };
 
-RDB_DECLARE_SERIALIZABLE(listener_intro_t);
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(listener_intro_t);
+
+
+/* `backfill_stream_business_card_t` is the backfillee's end of one stream of a
+backfill. The backfiller splits the region into as many key ranges as there are
+streams and sends the chunks of each range over its own stream, so that the
+backfillee can apply them independently of the chunks of the other ranges. Each
+stream has its own chunk ordering and flow control. */
+
+struct backfill_stream_business_card_t {
+    backfill_stream_business_card_t() { }
+    backfill_stream_business_card_t(
+            const mailbox_addr_t<void(
+                backfill_chunk_t,
+                double,
+                fifo_enforcer_write_token_t
+                )> &cm,
+            const mailbox_addr_t<void(fifo_enforcer_write_token_t)> &dm,
+            const mailbox_addr_t<void(mailbox_addr_t<void(int)>)> &arm) :
+        chunk_mailbox(cm), done_mailbox(dm), allocation_registration_mailbox(arm)
+        { }
 
+    mailbox_addr_t<void(
+        backfill_chunk_t,
+        double,
+        fifo_enforcer_write_token_t
+        )> chunk_mailbox;
+    mailbox_addr_t<void(fifo_enforcer_write_token_t)> done_mailbox;
+    mailbox_addr_t<void(mailbox_addr_t<void(int)>)> allocation_registration_mailbox;
+};
+
+RDB_DECLARE_SERIALIZABLE(backfill_stream_business_card_t);
 
 /* `backfiller_business_card_t` represents a thing that is willing to serve
 backfills over the network. It appears in the directory. */
 
 struct backfiller_business_card_t {
 
+    /* The last `region_map_t<state_timestamp_t>` holds, for the parts of the
+    region that the range hash comparison found to be in sync, the timestamp of the
+    backfiller's data that the comparison was made against. It's
+    `state_timestamp_t::zero()` elsewhere. The chunks are sent over one or more
+    streams, see `backfill_stream_business_card_t`. */
     typedef mailbox_t< void(
         backfill_session_id_t,
         region_map_t<version_range_t>,
         branch_history_t,
+        region_map_t<state_timestamp_t>,
         mailbox_addr_t< void(
             region_map_t<version_range_t>,
             branch_history_t
             ) >,
-        mailbox_addr_t< void(
-            backfill_chunk_t,
-            double,
-            fifo_enforcer_write_token_t
-            ) >,
-        mailbox_t<void(fifo_enforcer_write_token_t)>::address_t,
-        mailbox_t<void(mailbox_addr_t<void(int)>)>::address_t
+        std::vector<backfill_stream_business_card_t>
         )> backfill_mailbox_t;
 
     typedef mailbox_t<void(backfill_session_id_t)> cancel_backfill_mailbox_t;
 
+    /* Before requesting a backfill, the backfillee compares the hashes of its key
+    ranges with the backfiller's, see `backfillee()`. The request carries the
+    ranges, the backfillee's number of key/value pairs in them, and the oldest
+    timestamp of the backfillee's data. The reply holds a hash and the backfiller's
+    timestamp for each range, or nothing if the backfiller expects a regular
+    backfill to be cheaper. */
+    typedef mailbox_t<void(
+        std::vector<region_t>,
+        uint64_t,
+        state_timestamp_t,
+        mailbox_addr_t<void(std::vector<uint64_t>, std::vector<state_timestamp_t>)>
+        )> range_hashes_mailbox_t;
+
     backfiller_business_card_t() { }
     backfiller_business_card_t(
             const backfill_mailbox_t::address_t &ba,
-            const cancel_backfill_mailbox_t::address_t &cba) :
-        backfill_mailbox(ba), cancel_backfill_mailbox(cba)
+            const cancel_backfill_mailbox_t::address_t &cba,
+            const range_hashes_mailbox_t::address_t &rha) :
+        backfill_mailbox(ba), cancel_backfill_mailbox(cba), range_hashes_mailbox(rha)
         { }
 
     backfill_mailbox_t::address_t backfill_mailbox;
     cancel_backfill_mailbox_t::address_t cancel_backfill_mailbox;
+    range_hashes_mailbox_t::address_t range_hashes_mailbox;
 };
 
 RDB_DECLARE_SERIALIZABLE(backfiller_business_card_t);
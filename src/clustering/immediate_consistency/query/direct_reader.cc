@@ -1,14 +1,17 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/query/direct_reader.hpp"
 
+#include "clustering/immediate_consistency/branch/listener.hpp"
 #include "protocol_api.hpp"
 #include "store_view.hpp"
 
 direct_reader_t::direct_reader_t(
         mailbox_manager_t *mm,
-        store_view_t *svs_) :
+        store_view_t *svs_,
+        listener_t *listener_) :
     mailbox_manager(mm),
     svs(svs_),
+    listener(listener_),
     read_mailbox(mm, std::bind(&direct_reader_t::on_read, this,
                                ph::_1, ph::_2, ph::_3))
     { }
@@ -20,9 +23,17 @@ direct_reader_business_card_t direct_reader_t::get_business_card() {
 void direct_reader_t::on_read(
         signal_t *interruptor,
         const read_t &read,
-        const mailbox_addr_t<void(read_response_t)> &cont) {
+        const mailbox_addr_t<void(boost::optional<read_response_t>)> &cont) {
 
     try {
+        if (static_cast<bool>(read.max_staleness_ms)) {
+            if (listener == NULL ||
+                    !listener->wait_until_fresh(*read.max_staleness_ms, interruptor)) {
+                send(mailbox_manager, cont, boost::optional<read_response_t>());
+                return;
+            }
+        }
+
         /* Leave the token empty. We're not actually interested in ordering here. */
         read_token_t token;
 
@@ -37,7 +48,7 @@ void direct_reader_t::on_read(
                   &response,
                   &token,
                   interruptor);
-        send(mailbox_manager, cont, response);
+        send(mailbox_manager, cont, boost::optional<read_response_t>(response));
     } catch (const interrupted_exc_t &) {
         /* ignore */
     }
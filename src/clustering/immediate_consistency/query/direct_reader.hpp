@@ -5,19 +5,23 @@
 #include "clustering/immediate_consistency/query/direct_reader_metadata.hpp"
 #include "concurrency/fifo_checker.hpp"
 
+class listener_t;
 class store_view_t;
 
 /* For each primary or secondary replica of each shard, there is a `direct_reader_t`.
 The `direct_reader_t` allows the `cluster_namespace_interface_t` to bypass the
 `broadcaster_t` and read directly from the B-tree itself. This reduces network traffic
 and is possible even when the primary replica is unavailable, but the data it returns
-might be out of date. */
+might be out of date. Reads that set `max_staleness_ms` are only answered if
+`listener` can vouch for the bound; `listener` is `NULL` if we aren't following a
+primary replica, and then such reads are always refused. */
 
 class direct_reader_t {
 public:
     direct_reader_t(
             mailbox_manager_t *mm,
-            store_view_t *svs);
+            store_view_t *svs,
+            listener_t *listener);
 
     direct_reader_business_card_t get_business_card();
 
@@ -25,10 +29,11 @@ private:
     void on_read(
             signal_t *interruptor,
             const read_t &,
-            const mailbox_addr_t<void(read_response_t)> &);
+            const mailbox_addr_t<void(boost::optional<read_response_t>)> &);
 
     mailbox_manager_t *mailbox_manager;
     store_view_t *svs;
+    listener_t *listener;
 
     order_source_t order_source;  // TODO: order_token_t::ignore
 
@@ -2,17 +2,19 @@
 #ifndef CLUSTERING_IMMEDIATE_CONSISTENCY_QUERY_DIRECT_READER_METADATA_HPP_
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_QUERY_DIRECT_READER_METADATA_HPP_
 
+#include "containers/archive/boost_types.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "rpc/mailbox/typed.hpp"
 
 /* Each replica exposes a `direct_reader_business_card_t` for each shard that it
-is a primary or secondary replica for. */
+is a primary or secondary replica for. The reply to a read is empty if the read set
+`max_staleness_ms` and the replica couldn't guarantee that bound. */
 
 class direct_reader_business_card_t {
 public:
     typedef mailbox_t< void(
             read_t,
-            mailbox_addr_t< void(read_response_t)>
+            mailbox_addr_t< void(boost::optional<read_response_t>)>
             )> read_mailbox_t;
 
     direct_reader_business_card_t() { }
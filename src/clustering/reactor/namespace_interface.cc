@@ -6,6 +6,7 @@
 #include "clustering/immediate_consistency/query/master_access.hpp"
 #include "concurrency/fifo_enforcer.hpp"
 #include "concurrency/watchable.hpp"
+#include "perfmon/perfmon.hpp"
 #include "rdb_protocol/env.hpp"
 
 cluster_namespace_interface_t::cluster_namespace_interface_t(
@@ -239,12 +240,14 @@ void cluster_namespace_interface_t::perform_immediate_op(
         = (*masters_to_contact)[i].get();
 
     try {
+        const ticks_t start_time = get_ticks();
         (master_to_contact->master_access->*how_to_run_query)(
             master_to_contact->sharded_op,
             &results->at(i),
             order_token,
             &master_to_contact->enforcement_token,
             interruptor);
+        ctx->stats.shard_round_trip_latency.record(get_ticks() - start_time);
     } catch (const resource_lost_exc_t&) {
         failures->at(i).assign("lost contact with primary replica");
     } catch (const cannot_perform_query_exc_t& e) {
@@ -308,8 +311,9 @@ cluster_namespace_interface_t::dispatch_outdated_read(
 
     std::vector<read_response_t> results(direct_readers_to_contact.size());
     std::vector<std::string> failures(direct_readers_to_contact.size());
+    std::vector<bool> too_stale(direct_readers_to_contact.size(), false);
     pmap(direct_readers_to_contact.size(), std::bind(&cluster_namespace_interface_t::perform_outdated_read, this,
-                                                     &direct_readers_to_contact, &results, &failures, ph::_1, interruptor));
+                                                     &direct_readers_to_contact, &results, &failures, &too_stale, ph::_1, interruptor));
 
     if (interruptor->is_pulsed()) throw interrupted_exc_t();
 
@@ -319,6 +323,15 @@ cluster_namespace_interface_t::dispatch_outdated_read(
         }
     }
 
+    /* If one of the replicas couldn't meet `op.max_staleness_ms`, the primary
+    replicas have to answer the whole read instead. */
+    for (size_t i = 0; i < direct_readers_to_contact.size(); ++i) {
+        if (too_stale[i]) {
+            read(op, response, order_token_t::ignore, interruptor);
+            return;
+        }
+    }
+
     op.unshard(results.data(), results.size(), response, ctx, interruptor);
 }
 
@@ -326,22 +339,29 @@ void cluster_namespace_interface_t::perform_outdated_read(
         std::vector<scoped_ptr_t<outdated_read_info_t> > *direct_readers_to_contact,
         std::vector<read_response_t> *results,
         std::vector<std::string> *failures,
+        std::vector<bool> *too_stale,
         int i,
         signal_t *interruptor) THROWS_NOTHING {
     outdated_read_info_t *direct_reader_to_contact = (*direct_readers_to_contact)[i].get();
 
     try {
         cond_t done;
-        mailbox_t<void(read_response_t)> cont(mailbox_manager,
-            [&](signal_t *, const read_response_t &res) {
-                results->at(i) = res;
+        mailbox_t<void(boost::optional<read_response_t>)> cont(mailbox_manager,
+            [&](signal_t *, const boost::optional<read_response_t> &res) {
+                if (static_cast<bool>(res)) {
+                    results->at(i) = *res;
+                } else {
+                    (*too_stale)[i] = true;
+                }
                 done.pulse();
             });
 
+        const ticks_t start_time = get_ticks();
         send(mailbox_manager, direct_reader_to_contact->direct_reader_access->access().read_mailbox, direct_reader_to_contact->sharded_op, cont.get_address());
         wait_any_t waiter(direct_reader_to_contact->direct_reader_access->get_failed_signal(), &done);
         wait_interruptible(&waiter, interruptor);
         direct_reader_to_contact->direct_reader_access->access();   /* throws if `get_failed_signal()->is_pulsed()` */
+        ctx->stats.shard_round_trip_latency.record(get_ticks() - start_time);
     } catch (const resource_lost_exc_t &) {
         failures->at(i).assign("lost contact with direct reader");
     } catch (const interrupted_exc_t &) {
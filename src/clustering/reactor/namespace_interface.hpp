@@ -125,6 +125,7 @@ private:
             std::vector<scoped_ptr_t<outdated_read_info_t> > *direct_readers_to_contact,
             std::vector<read_response_t> *results,
             std::vector<std::string> *failures,
+            std::vector<bool> *too_stale,
             int i,
             signal_t *interruptor)
         THROWS_NOTHING;
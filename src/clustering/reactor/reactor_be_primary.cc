@@ -523,7 +523,7 @@ void reactor_t::be_primary(region_t region, store_view_t *svs, const clone_ptr_t
             &order_source);
         replier_t replier(&listener, mailbox_manager, branch_history_manager);
         master_t master(mailbox_manager, ack_checker, region, &broadcaster);
-        direct_reader_t direct_reader(mailbox_manager, svs);
+        direct_reader_t direct_reader(mailbox_manager, svs, &listener);
 
         on_thread_t th4(this->home_thread());
 
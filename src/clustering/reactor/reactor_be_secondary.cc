@@ -172,7 +172,7 @@ void reactor_t::be_secondary(region_t region, store_view_t *svs, const clone_ptr
                 region_map_t<binary_blob_t> metainfo_blob;
                 svs->do_get_metainfo(order_source.check_in("reactor_t::be_secondary").with_read_mode(), &read_token, &ct_interruptor, &metainfo_blob);
 
-                direct_reader_t direct_reader(mailbox_manager, svs);
+                direct_reader_t direct_reader(mailbox_manager, svs, NULL);
 
                 on_thread_t th2(this->home_thread());
 
@@ -264,7 +264,7 @@ void reactor_t::be_secondary(region_t region, store_view_t *svs, const clone_ptr
                  * us for backfills. */
                 replier_t replier(&listener, mailbox_manager, branch_history_manager);
 
-                direct_reader_t direct_reader(mailbox_manager, svs);
+                direct_reader_t direct_reader(mailbox_manager, svs, &listener);
 
                 cross_thread_signal_t ct_broadcaster_lost_signal(listener.get_broadcaster_lost_signal(), this->home_thread());
                 on_thread_t th2(this->home_thread());
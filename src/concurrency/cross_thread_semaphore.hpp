@@ -2,6 +2,8 @@
 #ifndef CONCURRENCY_CROSS_THREAD_SEMAPHORE_HPP_
 #define CONCURRENCY_CROSS_THREAD_SEMAPHORE_HPP_
 
+#include <algorithm>
+
 #include "containers/scoped.hpp"
 #include "containers/intrusive_list.hpp"
 #include "concurrency/interruptor.hpp"
@@ -13,6 +15,8 @@
 // This class implements a semaphore that can be used across threads
 // Each element acquired from the semaphore is an item of type value_t, which may
 //  be changed before being returned to the semaphore with `unlock()`
+// Available elements are handed out most recently released first, unless the lock
+//  asks for something else
 template <class value_t>
 class cross_thread_semaphore_t {
 public:
@@ -29,10 +33,23 @@ public:
     // Acquires all outstanding elements before destruction completes
     ~cross_thread_semaphore_t();
 
+    // Which element to hand out if more than one is available
+    enum class pick_t { MOST_RECENTLY_USED, LEAST_RECENTLY_USED };
+
     class lock_t {
     public:
         explicit lock_t(cross_thread_semaphore_t *_parent, signal_t *interruptor) :
-            parent(_parent), value(parent->lock(interruptor)) { }
+            parent(_parent),
+            value(parent->lock(interruptor, NULL, pick_t::MOST_RECENTLY_USED)) { }
+
+        // Takes `preferred` if it is available, or else any element
+        lock_t(cross_thread_semaphore_t *_parent, signal_t *interruptor,
+               value_t *preferred) :
+            parent(_parent),
+            value(parent->lock(interruptor, preferred, pick_t::MOST_RECENTLY_USED)) { }
+
+        lock_t(cross_thread_semaphore_t *_parent, signal_t *interruptor, pick_t pick) :
+            parent(_parent), value(parent->lock(interruptor, NULL, pick)) { }
 
         ~lock_t() {
             parent->unlock(value);
@@ -92,7 +109,7 @@ private:
         request_node_t *request;
     };
 
-    value_t *lock(signal_t *interruptor);
+    value_t *lock(signal_t *interruptor, value_t *preferred, pick_t pick);
     void unlock(value_t *value);
 
     // Mutex to control access, since a lock may be constructed from any thread
@@ -114,7 +131,7 @@ private:
 template <class value_t>
 cross_thread_semaphore_t<value_t>::~cross_thread_semaphore_t() {
     for (size_t i = 0; i < values.size(); ++i) {
-        delete lock(NULL);
+        delete lock(NULL, NULL, pick_t::MOST_RECENTLY_USED);
     }
 }
 
@@ -134,15 +151,37 @@ void cross_thread_semaphore_t<value_t>::pass_value_coroutine(request_node_t *req
 }
 
 template <class value_t>
-value_t *cross_thread_semaphore_t<value_t>::lock(signal_t *interruptor) {
+value_t *cross_thread_semaphore_t<value_t>::lock(signal_t *interruptor,
+                                                 value_t *preferred,
+                                                 pick_t pick) {
     system_mutex_t::lock_t lock(&mutex);
     value_t *result = NULL;
 
     if (available_value_index == values.size()) {
+        // Preferences only apply to available elements, waiters are served in order
         request_t request(this);
         lock.unlock();
         result = request.wait_and_get(interruptor);
     } else {
+        // The available elements are stored from the most recently released one at
+        //  `available_value_index` to the least recently released one at the end, so
+        //  we move the one we want to the front without changing the order of the rest
+        size_t chosen = available_value_index;
+        if (pick == pick_t::LEAST_RECENTLY_USED) {
+            chosen = values.size() - 1;
+        }
+        if (preferred != NULL) {
+            for (size_t i = available_value_index; i < values.size(); ++i) {
+                if (values[i] == preferred) {
+                    chosen = i;
+                    break;
+                }
+            }
+        }
+        std::rotate(values.data() + available_value_index,
+                    values.data() + chosen,
+                    values.data() + chosen + 1);
+
         result = values[available_value_index];
         values[available_value_index] = NULL;
         ++available_value_index;
@@ -172,7 +211,8 @@ void cross_thread_semaphore_t<value_t>::unlock(value_t *value) {
 
         if (request != NULL) {
             coro_t::spawn_sometime(std::bind(&cross_thread_semaphore_t<value_t>::pass_value_coroutine,
-                                             this, request, value));
+                                             this, request, value),
+                                   coro_stack_class_t::MEDIUM);
             return;
         }
     }
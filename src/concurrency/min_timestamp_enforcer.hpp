@@ -40,6 +40,10 @@ public:
     /* All reads that are waiting on a timestamp <= `new_ts` can now pass. */
     void bump_timestamp(state_timestamp_t new_ts);
 
+    state_timestamp_t get_current_timestamp() const {
+        return current_timestamp;
+    }
+
     /* Blocks until the desired version has been reached (or the interruptor
     gets pulsed). */
     void wait_interruptible(min_timestamp_token_t token, const signal_t *interruptor)
@@ -73,6 +73,14 @@
 // 0 = minimal priority
 #define SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY   5
 
+// Secondary index post construction sorts the new index entries in a memory
+// buffer of about this many bytes.  Each time the buffer fills up it is spilled
+// to disk as a sorted run, and the runs are merged when writing the index.
+#define SINDEX_POST_CONSTRUCTION_SORT_BUFFER_SIZE (64 * MEGABYTE)
+
+// How many sorted index entries post construction writes per write transaction
+#define SINDEX_POST_CONSTRUCTION_WRITE_CHUNK_SIZE 100
+
 // Size of the buffer used to perform IO operations (in bytes).
 #define IO_BUFFER_SIZE                            (4 * KILOBYTE)
 
@@ -168,14 +176,47 @@
 
 #define COROUTINE_STACK_SIZE                      131072
 
-// How many unused coroutine stacks to keep around (maximally), before they are
-// freed. This value is per thread.
-#define COROUTINE_FREE_LIST_SIZE                  64
+// The sizes of the smaller coroutine stacks, for spawn sites that ask for
+// `coro_stack_class_t::SMALL` or `coro_stack_class_t::MEDIUM`.
+#define COROUTINE_SMALL_STACK_SIZE                16384
+#define COROUTINE_MEDIUM_STACK_SIZE               65536
+
+// How many bytes of unused coroutine stacks to keep around (maximally), before they
+// are freed. This value is per thread, and covers the stacks of all sizes together.
+// Freeing a stack and allocating a new one costs several system calls, so the pool has
+// to be large enough to absorb bursts of coroutines.
+#define COROUTINE_FREE_LIST_BYTES                 (16 * MEGABYTE)
+
+// Every `COROUTINE_STACK_USAGE_SAMPLE_INTERVAL` coroutines that finish on a thread,
+// we measure how much of the finished coroutine's stack has ever been touched, for the
+// `coroutine_stack_high_water` stats.
+#define COROUTINE_STACK_USAGE_SAMPLE_INTERVAL     1024
 
 // In debug mode, we print a warning if more than this many coroutines have been
 // allocated on one thread.
 #define COROS_PER_THREAD_WARN_LEVEL               10000
 
+// The sampling profiler interrupts each thread `SAMPLING_PROFILER_FREQUENCY_HZ` times
+// per second of CPU time that the thread uses (0 turns it off), and records a
+// backtrace of up to `SAMPLING_PROFILER_BACKTRACE_DEPTH` frames.  Samples wait in a
+// ring buffer of `SAMPLING_PROFILER_RING_SIZE` entries until the thread folds them
+// into its profile every `SAMPLING_PROFILER_DRAIN_INTERVAL_MS`.  The profile covers
+// the last complete interval of `SAMPLING_PROFILER_INTERVAL_SECS`, and keeps at most
+// `SAMPLING_PROFILER_MAX_EXECUTION_POINTS` distinct stacks per thread.
+#define SAMPLING_PROFILER_FREQUENCY_HZ            19
+#define SAMPLING_PROFILER_BACKTRACE_DEPTH         12
+#define SAMPLING_PROFILER_RING_SIZE               128
+#define SAMPLING_PROFILER_DRAIN_INTERVAL_MS       1000
+#define SAMPLING_PROFILER_INTERVAL_SECS           60
+#define SAMPLING_PROFILER_MAX_EXECUTION_POINTS    4096
+
+// The `coroutine_profile` perfmon lists this many of the most frequent stacks.
+#define SAMPLING_PROFILER_MAX_REPORTED_STACKS     100
+
+// The profiler remembers the names of up to this many return addresses, and forgets
+// all of them when it runs out of room.
+#define SAMPLING_PROFILER_MAX_CACHED_FRAME_NAMES  4096
+
 
 // Minimal time we nap before re-checking if a goal is satisfied in the reactor (in ms).
 // This is an optimization to save CPU time. Checking for whether the goal is
@@ -183,6 +224,140 @@
 // that the event we are waiting for has occurred in the meantime.
 #define REACTOR_RUN_UNTIL_SATISFIED_NAP           100
 
+// A changefeed server collects the messages for each client for up to
+// `CHANGEFEED_BATCH_WINDOW_MS` milliseconds and sends them as a single mailbox
+// message.  A batch is sent early once it holds `CHANGEFEED_BATCH_MAX_MSGS`
+// messages.  Setting the window to 0 sends every message right away.
+#define CHANGEFEED_BATCH_WINDOW_MS                5
+#define CHANGEFEED_BATCH_MAX_MSGS                 1000
+
+// How many recent changes each changefeed server keeps in its on-disk change
+// log, which lets range changefeeds resume from a `resume_token` after a
+// disconnect.  Writes only append to memory; the log is written out in the
+// background, and up to this many changes may wait in memory if the disk is slow.
+// The log is only created once a table has a changefeed.  0 disables it.
+#define CHANGEFEED_LOG_MAX_CHANGES                100000
+
+// Before a backfill, the backfillee compares hashes of its key ranges with the
+// backfiller's, top-down, so that ranges which are already in sync are skipped.
+// Each round splits the ranges that differ into `BACKFILL_HASH_FANOUT` pieces,
+// unless they have fewer than `BACKFILL_HASH_MIN_PAIRS` pairs or the round would
+// exceed `BACKFILL_HASH_MAX_RANGES` ranges.  Hashing reads all of the data on both
+// servers, so the backfiller declines if there was less than one write per
+// `BACKFILL_HASH_PAIRS_PER_WRITE` pairs since the backfillee's data.  In that case
+// the regular backfill, which only visits recently written parts of the tree, is
+// cheaper.
+#define BACKFILL_HASH_FANOUT                      16
+#define BACKFILL_HASH_MAX_ROUNDS                  4
+#define BACKFILL_HASH_MAX_RANGES                  256
+#define BACKFILL_HASH_MIN_PAIRS                   1000
+#define BACKFILL_HASH_PAIRS_PER_WRITE             16
+
+// A backfill is split into up to `BACKFILL_NUM_STREAMS` key ranges with about the
+// same number of keys each.  Their chunks are sent over separate streams, each with
+// its own flow control, and are applied concurrently by the backfillee.
+#define BACKFILL_NUM_STREAMS                      4
+
+// Each store applies backfill chunks at between `BACKFILL_MIN_BANDWIDTH` and
+// `BACKFILL_MAX_BANDWIDTH` bytes per second.  Every
+// `BACKFILL_RATE_ADJUST_INTERVAL_MS` the rate is halved if the average latency of
+// the store's reads and writes exceeded `BACKFILL_TARGET_FOREGROUND_LATENCY_MS`, or
+// more than `BACKFILL_TARGET_DISK_QUEUE_DEPTH` disk operations were outstanding.
+// Otherwise it goes up by a `BACKFILL_RATE_INCREASE_STEPS`th of the range.
+#define BACKFILL_MIN_BANDWIDTH                    MEGABYTE
+#define BACKFILL_MAX_BANDWIDTH                    (64 * MEGABYTE)
+#define BACKFILL_RATE_ADJUST_INTERVAL_MS          100
+#define BACKFILL_TARGET_FOREGROUND_LATENCY_MS     20
+#define BACKFILL_TARGET_DISK_QUEUE_DEPTH          32
+#define BACKFILL_RATE_INCREASE_STEPS              16
+
+// The broadcaster sends writes to each remote replica in batches of at most
+// `BROADCASTER_MAX_WRITE_BATCH_SIZE` writes, with at most
+// `BROADCASTER_MAX_WRITE_BATCHES_IN_FLIGHT` unacked batches per replica.  Writes that
+// arrive while that many batches are in flight are grouped into the next batch.
+#define BROADCASTER_MAX_WRITE_BATCH_SIZE          256
+#define BROADCASTER_MAX_WRITE_BATCHES_IN_FLIGHT   8
+
+// Latency histograms report percentiles over intervals of this length
+#define LATENCY_HISTOGRAM_INTERVAL_SECS           10
+
+// `get_all` on the primary key sends at most this many keys in each read.
+#define MULTI_POINT_READ_MAX_KEYS                 1024
+
+// A read with a `max_staleness` waits at most `READ_MAX_STALENESS_WAIT_MS` for the
+// replica it was sent to to catch up, before it is retried on the primary replica.
+#define READ_MAX_STALENESS_WAIT_MS                100
+
+// A replica that serves reads with a `max_staleness` asks the broadcaster for
+// heartbeats.  The broadcaster then tells it its newest timestamp every
+// `BROADCASTER_HEARTBEAT_INTERVAL_MS`, until `BROADCASTER_HEARTBEAT_LEASE_MS` after
+// the last request, so replicas can check a `max_staleness` even when there are no
+// writes.  Replicas renew the lease when it's half over.  A read that finds no
+// heartbeat from within its `max_staleness` waits for the next one.  Replicas keep
+// the heartbeats of the last `LISTENER_FRESHNESS_HISTORY_MS`; longer bounds are
+// enforced as if they were that long.
+#define BROADCASTER_HEARTBEAT_INTERVAL_MS         50
+#define BROADCASTER_HEARTBEAT_LEASE_MS            (10 * THOUSAND)
+#define LISTENER_FRESHNESS_HISTORY_MS             (60 * THOUSAND)
+
+// Each store keeps a histogram of the keys of its recent reads and writes with
+// about `KEY_ACCESS_HISTOGRAM_BUCKETS` buckets.  Accesses lose half of their
+// weight every `KEY_ACCESS_HALF_LIFE_SECS`.
+#define KEY_ACCESS_HISTOGRAM_BUCKETS              128
+// Primary key range reads record one of every `KEY_ACCESS_RANGE_SAMPLE_ROWS` rows
+// they scan in the histogram, weighted by that number.
+#define KEY_ACCESS_RANGE_SAMPLE_ROWS              64
+#define KEY_ACCESS_HALF_LIFE_SECS                 120.0
+
+// With `--auto-rebalance`, every `AUTO_REBALANCE_INTERVAL_SECS` the server moves the
+// split points of every table whose busiest shard gets more than
+// `AUTO_REBALANCE_IMBALANCE_THRESHOLD` times the average load per shard, so that
+// the recent reads and writes are spread evenly.  Tables with less than
+// `AUTO_REBALANCE_MIN_LOAD` recent accesses are left alone.  A table is only
+// rebalanced if that lowers its imbalance by a factor of at least
+// `AUTO_REBALANCE_MIN_IMPROVEMENT`.  If the imbalance hasn't gone down by that much
+// at the next round, the table is left alone for a number of rounds that doubles
+// every time, up to `AUTO_REBALANCE_MAX_BACKOFF_ROUNDS`.
+#define AUTO_REBALANCE_INTERVAL_SECS              300
+#define AUTO_REBALANCE_IMBALANCE_THRESHOLD        2.0
+#define AUTO_REBALANCE_MIN_LOAD                   10000
+#define AUTO_REBALANCE_MIN_IMPROVEMENT            1.25
+#define AUTO_REBALANCE_MAX_BACKOFF_ROUNDS         16
+
+// Intra-cluster connections can be compressed with zlib (`--cluster-compression`).
+// We use the fastest level, since the point is to save bandwidth on slow links
+// without making the CPU the bottleneck on fast ones.  The buffer size is the
+// amount of compressed data that is read from or written to the socket at once.
+#define CLUSTER_COMPRESSION_LEVEL                 1
+#define CLUSTER_COMPRESSION_BUFFER_SIZE           (64 * KILOBYTE)
+
+// Queries that spend at least `SLOW_QUERY_LOG_DEFAULT_THRESHOLD_MS` executing are
+// written to the slow query log, unless `--slow-query-threshold` says otherwise.  A
+// fraction `SLOW_QUERY_LOG_DEFAULT_PROFILE_RATE` of all queries is profiled, so that
+// the slow ones among them can be logged with their profile.  The query is cut off
+// after `SLOW_QUERY_LOG_MAX_QUERY_LENGTH` characters.
+#define SLOW_QUERY_LOG_DEFAULT_THRESHOLD_MS       1000
+#define SLOW_QUERY_LOG_DEFAULT_PROFILE_RATE       0.01
+#define SLOW_QUERY_LOG_MAX_QUERY_LENGTH           2000
+
+// `map` and `filter` send the rows for a JavaScript function to the worker process in
+// batches of up to `JS_CALL_BATCH_SIZE` calls, each batch in one message.  The worker
+// stops any call that runs for longer than the function's timeout.
+#define JS_CALL_BATCH_SIZE                        100
+
+// JavaScript worker processes keep the compiled code of up to
+// `JS_WORKER_SCRIPT_CACHE_SIZE` functions between queries.  The extproc pool remembers
+// which worker compiled each of the last `EXTPROC_AFFINITY_INDEX_SIZE` sources, and
+// sends queries that use them there.
+#define JS_WORKER_SCRIPT_CACHE_SIZE               1000
+#define EXTPROC_AFFINITY_INDEX_SIZE               10000
+
+// `map` sends the `r.http` requests for a batch of rows to one worker process, which
+// keeps up to `HTTP_MAX_CONCURRENT_REQUESTS` of them in flight at once.  Each worker
+// keeps up to `HTTP_RESPONSE_CACHE_SIZE` responses to requests made with `cache_ttl`.
+#define HTTP_MAX_CONCURRENT_REQUESTS              16
+#define HTTP_RESPONSE_CACHE_SIZE                  1000
+
 
 /**
  * Message scheduler configuration
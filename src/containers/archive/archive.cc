@@ -5,6 +5,7 @@
 #include <netinet/in.h>
 
 #include <algorithm>
+#include <vector>
 
 #include "containers/archive/versioned.hpp"
 #include "containers/uuid.hpp"
@@ -84,15 +85,36 @@ size_t write_message_t::size() const {
     return ret;
 }
 
-int send_write_message(write_stream_t *s, const write_message_t *wm) {
-    intrusive_list_t<write_buffer_t> *list = const_cast<write_message_t *>(wm)->unsafe_expose_buffers();
-    for (write_buffer_t *p = list->head(); p; p = list->next(p)) {
-        int64_t res = s->write(p->data, p->size);
+int64_t write_stream_t::writev(const iovec *iov, size_t iovcnt) {
+    int64_t total = 0;
+    for (size_t i = 0; i < iovcnt; ++i) {
+        int64_t n = iov[i].iov_len;
+        int64_t res = write(iov[i].iov_base, n);
         if (res == -1) {
             return -1;
         }
-        rassert(res == p->size);
+        rassert(res == n);
+        total += res;
+    }
+    return total;
+}
+
+int send_write_message(write_stream_t *s, const write_message_t *wm) {
+    intrusive_list_t<write_buffer_t> *list = const_cast<write_message_t *>(wm)->unsafe_expose_buffers();
+    // Hand all the buffers to the stream at once rather than one `write()` each,
+    // so that a socket can send them without copying them together first.
+    std::vector<iovec> iov;
+    for (write_buffer_t *p = list->head(); p; p = list->next(p)) {
+        iovec v;
+        v.iov_base = p->data;
+        v.iov_len = p->size;
+        iov.push_back(v);
+    }
+    int64_t res = s->writev(iov.data(), iov.size());
+    if (res == -1) {
+        return -1;
     }
+    rassert(static_cast<size_t>(res) == wm->size());
     return 0;
 }
 
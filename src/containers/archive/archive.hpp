@@ -3,6 +3,7 @@
 #define CONTAINERS_ARCHIVE_ARCHIVE_HPP_
 
 #include <stdint.h>
+#include <sys/uio.h>
 
 #include <string>
 #include <type_traits>
@@ -85,6 +86,10 @@ public:
     write_stream_t() { }
     // Returns n, or -1 upon error. Blocks until all bytes are written.
     virtual MUST_USE int64_t write(const void *p, int64_t n) = 0;
+    // Writes the `iovcnt` buffers in `iov`, in order. Returns the total number of
+    // bytes, or -1 upon error. The default calls `write()` for each buffer;
+    // streams that can pass several buffers to the kernel at once override it.
+    virtual MUST_USE int64_t writev(const iovec *iov, size_t iovcnt);
 protected:
     virtual ~write_stream_t() { }
 private:
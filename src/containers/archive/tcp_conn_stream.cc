@@ -1,7 +1,45 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "containers/archive/tcp_conn_stream.hpp"
 
+#include <limits.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <vector>
+
 #include "arch/io/network.hpp"
+#include "config/args.hpp"
+
+/* The deflate and inflate streams of a compressed connection. Every write is
+finished with a `Z_SYNC_FLUSH`, so the receiver can decode a message as soon as
+all of its bytes have arrived. */
+class tcp_conn_stream_t::compression_t {
+public:
+    compression_t()
+        : in_buffer(CLUSTER_COMPRESSION_BUFFER_SIZE),
+          out_buffer(CLUSTER_COMPRESSION_BUFFER_SIZE) {
+        memset(&deflater, 0, sizeof(deflater));
+        memset(&inflater, 0, sizeof(inflater));
+        // See http://www.zlib.net/manual.html for descriptions of these functions
+        int zres = deflateInit(&deflater, CLUSTER_COMPRESSION_LEVEL);
+        guarantee(zres == Z_OK, "deflateInit failed (%d)", zres);
+        zres = inflateInit(&inflater);
+        guarantee(zres == Z_OK, "inflateInit failed (%d)", zres);
+    }
+    ~compression_t() {
+        deflateEnd(&deflater);
+        inflateEnd(&inflater);
+    }
+
+    z_stream deflater;
+    z_stream inflater;
+    std::vector<char> in_buffer;
+    std::vector<char> out_buffer;
+
+private:
+    DISABLE_COPYING(compression_t);
+};
 
 tcp_conn_stream_t::tcp_conn_stream_t(const ip_address_t &host, int port, signal_t *interruptor, int local_port)
     : conn_(new tcp_conn_t(host, port, interruptor, local_port)) { }
@@ -16,9 +54,12 @@ tcp_conn_stream_t::~tcp_conn_stream_t() {
 
 int64_t tcp_conn_stream_t::read(void *p, int64_t n) {
     // Returns the number of bytes read, or 0 upon EOF, -1 upon error.
-    // Right now this function cannot "error".
+    // Only a corrupt compressed stream can "error".
     try {
         cond_t non_closer;
+        if (compression_.has()) {
+            return read_compressed(p, n, &non_closer);
+        }
         size_t result = conn_->read_some(p, n, &non_closer);
         rassert(result > 0);
         rassert(int64_t(result) <= n);
@@ -32,13 +73,103 @@ int64_t tcp_conn_stream_t::write(const void *p, int64_t n) {
     try {
         // write writes everything or throws an exception.
         cond_t non_closer;
-        conn_->write(p, n, &non_closer);
+        if (compression_.has()) {
+            iovec iov;
+            iov.iov_base = const_cast<void *>(p);
+            iov.iov_len = n;
+            write_compressed(&iov, 1, &non_closer);
+        } else {
+            conn_->write(p, n, &non_closer);
+        }
         return n;
     } catch (const tcp_conn_write_closed_exc_t &) {
         return -1;
     }
 }
 
+int64_t tcp_conn_stream_t::writev(const iovec *iov, size_t iovcnt) {
+    try {
+        cond_t non_closer;
+        if (compression_.has()) {
+            write_compressed(iov, iovcnt, &non_closer);
+        } else {
+            conn_->writev(iov, iovcnt, &non_closer);
+        }
+        int64_t total = 0;
+        for (size_t i = 0; i < iovcnt; ++i) {
+            total += iov[i].iov_len;
+        }
+        return total;
+    } catch (const tcp_conn_write_closed_exc_t &) {
+        return -1;
+    }
+}
+
+void tcp_conn_stream_t::enable_compression() {
+    guarantee(!compression_.has());
+    compression_.init(new compression_t);
+}
+
+int64_t tcp_conn_stream_t::read_compressed(void *p, int64_t n, signal_t *closer) {
+    z_stream *z = &compression_->inflater;
+    const uInt out_size = std::min<int64_t>(n, UINT_MAX);
+    for (;;) {
+        if (z->avail_in == 0) {
+            std::vector<char> *in = &compression_->in_buffer;
+            size_t got = conn_->read_some(in->data(), in->size(), closer);
+            rassert(got > 0);
+            z->next_in = reinterpret_cast<Bytef *>(in->data());
+            z->avail_in = got;
+        }
+        z->next_out = static_cast<Bytef *>(p);
+        z->avail_out = out_size;
+        int zres = inflate(z, Z_SYNC_FLUSH);
+        if (zres != Z_OK && zres != Z_BUF_ERROR) {
+            // Corrupt data, or the peer ended the deflate stream.
+            return -1;
+        }
+        if (z->avail_out != out_size) {
+            return out_size - z->avail_out;
+        }
+        if (z->avail_in != 0) {
+            // inflate made no progress even though it had input and room.
+            return -1;
+        }
+    }
+}
+
+void tcp_conn_stream_t::write_compressed(const iovec *iov, size_t iovcnt,
+                                         signal_t *closer) {
+    z_stream *z = &compression_->deflater;
+    std::vector<char> *out = &compression_->out_buffer;
+    // Feed all buffers with `Z_NO_FLUSH`, then finish with an empty
+    // `Z_SYNC_FLUSH` pass that pushes out everything still pending.
+    for (size_t i = 0; i <= iovcnt; ++i) {
+        const bool last = (i == iovcnt);
+        const char *data = last ? NULL : static_cast<const char *>(iov[i].iov_base);
+        size_t remaining = last ? 0 : iov[i].iov_len;
+        do {
+            const uInt chunk = std::min<size_t>(remaining, UINT_MAX);
+            z->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+            z->avail_in = chunk;
+            do {
+                z->next_out = reinterpret_cast<Bytef *>(out->data());
+                z->avail_out = out->size();
+                int zres = deflate(z, last ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+                guarantee(zres == Z_OK || zres == Z_BUF_ERROR,
+                          "deflate failed (%d)", zres);
+                size_t produced = out->size() - z->avail_out;
+                if (produced > 0) {
+                    conn_->write(out->data(), produced, closer);
+                }
+            } while (z->avail_out == 0);
+            rassert(z->avail_in == 0);
+            data += chunk;
+            remaining -= chunk;
+        } while (remaining > 0);
+    }
+}
+
 void tcp_conn_stream_t::rethread(threadnum_t new_thread) {
     conn_->rethread(new_thread);
 }
@@ -98,6 +229,14 @@ int64_t keepalive_tcp_conn_stream_t::write(const void *p, int64_t n) {
     return tcp_conn_stream_t::write(p, n);
 }
 
+int64_t keepalive_tcp_conn_stream_t::writev(const iovec *iov, size_t iovcnt) {
+    if (keepalive_callback != NULL) {
+        keepalive_callback->keepalive_write();
+    }
+
+    return tcp_conn_stream_t::writev(iov, iovcnt);
+}
+
 rethread_tcp_conn_stream_t::rethread_tcp_conn_stream_t(tcp_conn_stream_t *conn, threadnum_t thread)
     : conn_(conn), old_thread_(conn->home_thread()), new_thread_(thread) {
     conn->rethread(thread);
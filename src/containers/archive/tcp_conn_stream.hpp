@@ -5,6 +5,7 @@
 #include "arch/address.hpp"
 #include "arch/types.hpp"
 #include "containers/archive/archive.hpp"
+#include "containers/scoped.hpp"
 #include "threading.hpp"
 
 class signal_t;
@@ -19,6 +20,7 @@ public:
 
     virtual MUST_USE int64_t read(void *p, int64_t n);
     virtual MUST_USE int64_t write(const void *p, int64_t n);
+    virtual MUST_USE int64_t writev(const iovec *iov, size_t iovcnt);
 
     void rethread(threadnum_t new_thread);
 
@@ -29,12 +31,28 @@ public:
     bool is_read_open();
     bool is_write_open();
 
+    /* Switches the stream to zlib streaming compression in both directions.
+    Everything written after this call is compressed, and everything read after
+    it is expected to be compressed. Both ends of the connection must switch at
+    the same point in the byte stream. Compressed writes share one output
+    buffer, so callers must not write from two coroutines at once. */
+    void enable_compression();
+    bool is_compressed() const {
+        return compression_.has();
+    }
+
     tcp_conn_t *get_underlying_conn() {
         return conn_;
     }
 
 private:
+    class compression_t;
+
+    int64_t read_compressed(void *p, int64_t n, signal_t *closer);
+    void write_compressed(const iovec *iov, size_t iovcnt, signal_t *closer);
+
     tcp_conn_t *conn_;
+    scoped_ptr_t<compression_t> compression_;
 
     DISABLE_COPYING(tcp_conn_stream_t);
 };
@@ -58,6 +76,7 @@ public:
 
     virtual MUST_USE int64_t read(void *p, int64_t n);
     virtual MUST_USE int64_t write(const void *p, int64_t n);
+    virtual MUST_USE int64_t writev(const iovec *iov, size_t iovcnt);
 
 private:
     keepalive_callback_t *keepalive_callback;
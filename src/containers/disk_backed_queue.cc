@@ -170,6 +170,45 @@ void internal_disk_backed_queue_t::pop(buffer_group_viewer_t *viewer) {
     }
 }
 
+void internal_disk_backed_queue_t::view_all(buffer_group_viewer_t *viewer) {
+    mutex_t::acq_t mutex_acq(&mutex);
+
+    txn_t txn(cache_conn.get(), read_access_t::read);
+
+    block_id_t block_id = tail_block_id;
+    while (block_id != NULL_BLOCK_ID) {
+        buf_lock_t block(buf_parent_t(&txn), block_id, access_t::read);
+        std::vector<char> refs;
+        {
+            buf_read_t read(&block);
+            const queue_block_t *queue_block
+                = static_cast<const queue_block_t *>(read.get_data_read());
+            refs.assign(queue_block->data + queue_block->live_data_offset,
+                        queue_block->data + queue_block->data_size);
+            block_id = queue_block->next;
+        }
+
+        size_t offset = 0;
+        while (offset < refs.size()) {
+            char buffer[DBQ_MAX_REF_SIZE];
+            size_t ref_size = blob::ref_size(cache->max_block_size(),
+                                             refs.data() + offset,
+                                             DBQ_MAX_REF_SIZE);
+            guarantee(offset + ref_size <= refs.size());
+            memcpy(buffer, refs.data() + offset, ref_size);
+            blob_t blob(cache->max_block_size(), buffer, DBQ_MAX_REF_SIZE);
+            {
+                blob_acq_t acq_group;
+                buffer_group_t blob_group;
+                blob.expose_all(buf_parent_t(&block), access_t::read,
+                                &blob_group, &acq_group);
+                viewer->view_buffer_group(const_view(&blob_group));
+            }
+            offset += ref_size;
+        }
+    }
+}
+
 bool internal_disk_backed_queue_t::empty() {
     return queue_size == 0;
 }
@@ -50,6 +50,10 @@ public:
 
     void pop(buffer_group_viewer_t *viewer);
 
+    // Shows every value to `viewer`, from the oldest to the newest, without
+    // removing anything.
+    void view_all(buffer_group_viewer_t *viewer);
+
     bool empty();
 
     int64_t size();
@@ -126,6 +130,25 @@ public:
         internal_.pop(&viewer);
     }
 
+    // Calls `cb` with every element, from the oldest to the newest, without
+    // removing anything.
+    template <class callable_t>
+    void for_each(const callable_t &cb) {
+        class callback_viewer_t : public buffer_group_viewer_t {
+        public:
+            explicit callback_viewer_t(const callable_t *_cb) : cb_(_cb) { }
+            virtual void view_buffer_group(const const_buffer_group_t *group) {
+                T value;
+                deserialize_from_group<cluster_version_t::LATEST_OVERALL>(
+                    group, &value);
+                (*cb_)(std::move(value));
+            }
+        private:
+            const callable_t *cb_;
+        } viewer(&cb);
+        internal_.view_all(&viewer);
+    }
+
     bool empty() {
         return internal_.empty();
     }
@@ -5,7 +5,8 @@
 
 extproc_job_t::extproc_job_t(extproc_pool_t *_pool,
                              bool (*worker_fn) (read_stream_t *, write_stream_t *),
-                             signal_t *_user_interruptor) :
+                             signal_t *_user_interruptor,
+                             const std::string &affinity_key) :
     pool(_pool),
     user_error(false),
     user_interruptor(_user_interruptor),
@@ -15,7 +16,10 @@ extproc_job_t::extproc_job_t(extproc_pool_t *_pool,
         combined_interruptor.add(user_interruptor);
     }
 
-    worker_lock.create(pool->get_worker_semaphore(), &combined_interruptor);
+    extproc_worker_t *preferred_worker =
+        affinity_key.empty() ? NULL : pool->get_affinity(affinity_key);
+    worker_lock.create(pool->get_worker_semaphore(), &combined_interruptor,
+                       preferred_worker);
 
     try {
         worker_lock.get()->get_value()->acquired(&combined_interruptor);
@@ -44,6 +48,11 @@ write_stream_t *extproc_job_t::write_stream() {
     return worker_lock.get()->get_value()->get_write_stream();
 }
 
+void extproc_job_t::set_affinity(const std::string &key) {
+    assert_thread();
+    pool->set_affinity(key, worker_lock.get()->get_value());
+}
+
 void extproc_job_t::worker_error() {
     user_error = true;
 }
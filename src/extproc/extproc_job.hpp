@@ -27,11 +27,17 @@ private:
 
 class extproc_job_t : public home_thread_mixin_t {
 public:
+    // If `affinity_key` is not empty, the job prefers the worker that was last given
+    //  the same key with `set_affinity()`.
     extproc_job_t(extproc_pool_t *_pool,
                   bool (*worker_fn) (read_stream_t *, write_stream_t *),
-                  signal_t *_user_interruptor);
+                  signal_t *_user_interruptor,
+                  const std::string &affinity_key = "");
     ~extproc_job_t();
 
+    // Remembers this job's worker for `key`, see `extproc_pool_t::get_affinity()`
+    void set_affinity(const std::string &key);
+
     // All data written and read by the user must be accounted for, or the worker will
     //  has to be killed and restarted
     read_stream_t *read_stream();
@@ -1,4 +1,7 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <functional>
+
+#include "config/args.hpp"
 #include "containers/object_buffer.hpp"
 #include "extproc/extproc_pool.hpp"
 #include "extproc/extproc_spawner.hpp"
@@ -10,6 +13,7 @@ extproc_pool_t::extproc_pool_t(size_t worker_count) :
     dealloc_timer(DEALLOC_TIMER_FREQ_MS, this),
     worker_semaphore(worker_count,
                      extproc_spawner_t::get_instance()),
+    affinity_index(EXTPROC_AFFINITY_INDEX_SIZE),
     dealloc_pool(1, &pool_queue, this) { }
 
 extproc_pool_t::~extproc_pool_t() {
@@ -24,6 +28,19 @@ cross_thread_semaphore_t<extproc_worker_t> *extproc_pool_t::get_worker_semaphore
     return &worker_semaphore;
 }
 
+extproc_worker_t *extproc_pool_t::get_affinity(const std::string &key) {
+    const size_t hash = std::hash<std::string>()(key);
+    system_mutex_t::lock_t lock(&affinity_mutex);
+    auto it = affinity_index.find(hash);
+    return it == affinity_index.end() ? NULL : it->second;
+}
+
+void extproc_pool_t::set_affinity(const std::string &key, extproc_worker_t *worker) {
+    const size_t hash = std::hash<std::string>()(key);
+    system_mutex_t::lock_t lock(&affinity_mutex);
+    affinity_index[hash] = worker;
+}
+
 signal_t *extproc_pool_t::get_shutdown_signal() {
     return ct_interruptors.get();
 }
@@ -39,8 +56,11 @@ void extproc_pool_t::coro_pool_callback(extproc_pool_dummy_value_t,
     prev_worker_cnt = cur_worker_cnt;
 
     for (int i = 0; i < dealloc_cnt; ++i) {
+        // Kill the coldest workers, and keep the state of the ones that were used
+        //  recently for the next jobs.
         object_buffer_t<cross_thread_semaphore_t<extproc_worker_t>::lock_t> worker_lock;
-        worker_lock.create(get_worker_semaphore(), get_shutdown_signal());
+        worker_lock.create(get_worker_semaphore(), get_shutdown_signal(),
+            cross_thread_semaphore_t<extproc_worker_t>::pick_t::LEAST_RECENTLY_USED);
 
         if (worker_lock.get()->get_value()->is_process_alive()) {
             worker_lock.get()->get_value()->kill_process();
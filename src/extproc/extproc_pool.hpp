@@ -2,8 +2,12 @@
 #ifndef EXTPROC_EXTPROC_POOL_HPP_
 #define EXTPROC_EXTPROC_POOL_HPP_
 
+#include <string>
+
+#include "arch/io/concurrency.hpp"
 #include "arch/timing.hpp"
 #include "utils.hpp"
+#include "containers/lru_cache.hpp"
 #include "containers/scoped.hpp"
 #include "concurrency/cond_var.hpp"
 #include "concurrency/coro_pool.hpp"
@@ -30,6 +34,14 @@ public:
     // Get the semaphore of workers to obtain a lock (may be done from any thread)
     cross_thread_semaphore_t<extproc_worker_t> *get_worker_semaphore();
 
+    // Workers keep some state between jobs, like the JavaScript functions they have
+    //  compiled.  The pool remembers which worker last did the work for each key (by
+    //  hash, least recently used keys are forgotten), so that later jobs for the same
+    //  key can be sent to that worker.  This is only a hint: the worker may be busy,
+    //  or may have been restarted since.  May be called from any thread.
+    extproc_worker_t *get_affinity(const std::string &key);
+    void set_affinity(const std::string &key, extproc_worker_t *worker);
+
     class worker_acq_t {
     public:
         explicit worker_acq_t(extproc_pool_t *_pool) : pool(_pool) {
@@ -79,6 +91,10 @@ private:
     // Cross-threaded semaphore allowing workers to be acquired from any thread
     cross_thread_semaphore_t<extproc_worker_t> worker_semaphore;
 
+    // Maps hashes of affinity keys to workers, protected by the mutex
+    system_mutex_t affinity_mutex;
+    lru_cache_t<size_t, extproc_worker_t *> affinity_index;
+
     // Coroutine pool to make sure there is only one worker deallocation happening at a time
     // The single_value_producer_t makes sure we never build up a backlog.
     single_value_producer_t<extproc_pool_dummy_value_t> pool_queue;
@@ -7,12 +7,18 @@
 #include <re2/re2.h>
 
 #include <limits>
+#include <map>
 
+#include "config/args.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/stl_types.hpp"
+#include "containers/archive/string_stream.hpp"
+#include "containers/lru_cache.hpp"
+#include "containers/scoped.hpp"
 #include "extproc/extproc_job.hpp"
 #include "http/http_parser.hpp"
 #include "rdb_protocol/env.hpp"
+#include "time.hpp"
 
 #define RETHINKDB_USER_AGENT (SOFTWARE_NAME_STRING "/" RETHINKDB_VERSION)
 
@@ -35,8 +41,8 @@ void jsonp_to_datum(const std::string &jsonp,
                     attach_json_to_error_t attach_json,
                     http_result_t *res_out);
 
-void perform_http(http_opts_t *opts,
-                  http_result_t *res_out);
+void perform_http_batch(std::vector<http_opts_t> *opts_batch,
+                        std::vector<http_result_t> *results_out);
 
 class curl_exc_t : public std::exception {
 public:
@@ -175,13 +181,20 @@ size_t curl_data_t::read_internal(char *ptr, size_t size) {
 }
 
 // The job_t runs in the context of the main rethinkdb process
-http_job_t::http_job_t(extproc_pool_t *pool, signal_t *interruptor) :
-    extproc_job(pool, &worker_fn, interruptor) { }
-
-void http_job_t::http(const http_opts_t &opts,
-                      http_result_t *res_out) {
+http_job_t::http_job_t(extproc_pool_t *pool,
+                       signal_t *interruptor,
+                       const std::string &affinity_key) :
+    extproc_job(pool, &worker_fn, interruptor, affinity_key) { }
+
+void http_job_t::http(const std::vector<const http_opts_t *> &opts_batch,
+                      std::vector<http_result_t> *res_out) {
+    // This is the same format as serializing a `std::vector<http_opts_t>`, which is
+    //  what the worker reads
     write_message_t msg;
-    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts);
+    serialize_varint_uint64(&msg, opts_batch.size());
+    for (const http_opts_t *opts : opts_batch) {
+        serialize<cluster_version_t::LATEST_OVERALL>(&msg, *opts);
+    }
     {
         int res = send_write_message(extproc_job.write_stream(), &msg);
         if (res != 0) {
@@ -196,24 +209,59 @@ void http_job_t::http(const http_opts_t &opts,
         throw extproc_worker_exc_t(strprintf("failed to deserialize result from worker "
                                              "(%s)", archive_result_as_str(res)));
     }
+    if (res_out->size() != opts_batch.size()) {
+        throw extproc_worker_exc_t("wrong number of results from worker");
+    }
 }
 
 void http_job_t::worker_error() {
     extproc_job.worker_error();
 }
 
+void http_job_t::set_affinity(const std::string &key) {
+    extproc_job.set_affinity(key);
+}
+
+bool http_job_t::is_cacheable(const http_opts_t &opts) {
+    return opts.cache_ttl_ms > 0 &&
+        (opts.method == http_method_t::GET || opts.method == http_method_t::HEAD);
+}
+
+std::string http_job_t::cache_key(const http_opts_t &opts) {
+    write_message_t msg;
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts.auth);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts.method);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts.result_format);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts.proxy);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts.url);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts.url_params);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts.header);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts.cookies);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts.limits);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts.version);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts.max_redirects);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts.verify);
+
+    string_stream_t stream;
+    int res = send_write_message(&stream, &msg);
+    guarantee(res == 0);
+    return std::move(stream.str());
+}
+
 bool http_job_t::worker_fn(read_stream_t *stream_in, write_stream_t *stream_out) {
     static bool curl_initialized(false);
-    http_opts_t opts;
+    std::vector<http_opts_t> opts_batch;
     {
         archive_result_t res
-            = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &opts);
+            = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &opts_batch);
         if (bad(res)) { return false; }
     }
 
-    http_result_t result;
-    result.header = ql::datum_t::null();
-    result.body = ql::datum_t::null();
+    std::vector<http_result_t> results(opts_batch.size());
+    for (http_result_t &result : results) {
+        result.header = ql::datum_t::null();
+        result.body = ql::datum_t::null();
+    }
 
     CURLcode curl_res = CURLE_OK;
     if (!curl_initialized) {
@@ -222,20 +270,16 @@ bool http_job_t::worker_fn(read_stream_t *stream_in, write_stream_t *stream_out)
     }
 
     if (curl_res == CURLE_OK) {
-        try {
-            perform_http(&opts, &result);
-        } catch (const std::exception &ex) {
-            result.error.assign(ex.what());
-        } catch (...) {
-            result.error.assign("unknown error");
-        }
+        perform_http_batch(&opts_batch, &results);
     } else {
-        result.error.assign("global initialization");
+        for (http_result_t &result : results) {
+            result.error.assign("global initialization");
+        }
         curl_initialized = false;
     }
 
     write_message_t msg;
-    serialize<cluster_version_t::LATEST_OVERALL>(&msg, result);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, results);
     int res = send_write_message(stream_out, &msg);
     if (res != 0) { return false; }
 
@@ -532,49 +576,162 @@ void set_default_opts(CURL *curl_handle,
     }
 }
 
-// TODO: implement streaming API support
-void perform_http(http_opts_t *opts, http_result_t *res_out) {
-    scoped_curl_handle_t curl_handle;
-    curl_data_t curl_data;
+void exc_multi(CURLMcode curl_res, const char *info) {
+    if (curl_res != CURLM_OK) {
+        throw curl_exc_t(strprintf("%s, '%s'", info, curl_multi_strerror(curl_res)));
+    }
+}
 
-    if (curl_handle.get() == NULL) {
-        res_out->error.assign("initialization");
-        return;
+// The multi handle is kept between jobs, along with the connections it holds, so that
+//  later requests to the same servers don't have to connect again
+CURLM *get_multi_handle() {
+    static CURLM *multi_handle = NULL;
+    if (multi_handle == NULL) {
+        multi_handle = curl_multi_init();
     }
+    return multi_handle;
+}
 
-    set_default_opts(curl_handle.get(), opts->proxy, curl_data);
-    transfer_opts(opts, curl_handle.get(), &curl_data);
+// Successful responses to cacheable requests (see `http_job_t::is_cacheable()`) are
+//  kept for `cache_ttl_ms`, or until they are pushed out by newer ones.
+class http_response_cache_t {
+public:
+    http_response_cache_t() : entries(HTTP_RESPONSE_CACHE_SIZE) { }
 
-    CURLcode curl_res = CURLE_OK;
-    long response_code = 0; // NOLINT(runtime/int)
-    for (uint64_t attempts = 0; attempts < opts->attempts; ++attempts) {
-        // Do the HTTP operation, then check for errors
-        curl_res = curl_easy_perform(curl_handle.get());
-
-        if (curl_res == CURLE_SEND_ERROR ||
-            curl_res == CURLE_RECV_ERROR ||
-            curl_res == CURLE_COULDNT_CONNECT) {
+    bool get(const std::string &key, http_result_t *res_out) {
+        auto it = entries.find(key);
+        if (it == entries.end() || it->second.expiration <= get_ticks()) {
+            return false;
+        }
+        *res_out = it->second.result;
+        return true;
+    }
+
+    void put(const std::string &key, const http_result_t &res, uint64_t ttl_ms) {
+        entry_t *entry = &entries[key];
+        entry->result = res;
+        entry->expiration = get_ticks() + ttl_ms * MILLION;
+    }
+
+private:
+    struct entry_t {
+        entry_t() : expiration(0) { }
+        http_result_t result;
+        ticks_t expiration;
+    };
+
+    lru_cache_t<std::string, entry_t> entries;
+};
+
+// A request that the worker is working on.  The handle is run by the multi handle,
+//  once for each attempt.
+class http_transfer_t {
+public:
+    http_transfer_t(http_opts_t *_opts, http_result_t *_res_out) :
+        opts(_opts),
+        res_out(_res_out),
+        deadline(get_ticks() + opts->timeout_ms * MILLION),
+        attempts_made(0),
+        curl_res(CURLE_OK),
+        response_code(0),
+        failed(false),
+        timed_out(false) { }
+
+    CURL *handle() {
+        return curl_handle.get();
+    }
+
+    // Sets up the handle, returns false if the request should not be started
+    bool prepare() {
+        if (curl_handle.get() == NULL) {
+            res_out->error.assign("initialization");
+            return false;
+        }
+
+        set_default_opts(curl_handle.get(), opts->proxy, curl_data);
+        transfer_opts(opts, curl_handle.get(), &curl_data);
+        return true;
+    }
+
+    // Adds the handle to the multi handle for another attempt, returns false if no
+    //  attempts or no time are left
+    bool start_attempt(CURLM *multi_handle) {
+        if (attempts_made >= opts->attempts) {
+            return false;
+        }
+        ticks_t now = get_ticks();
+        if (now >= deadline) {
+            timed_out = true;
+            return false;
+        }
+        long timeout_ms = std::max<long>((deadline - now) / MILLION, 1); // NOLINT(runtime/int)
+        exc_setopt(curl_handle.get(), CURLOPT_TIMEOUT_MS, timeout_ms, "TIMEOUT");
+        exc_multi(curl_multi_add_handle(multi_handle, curl_handle.get()), "add handle");
+        return true;
+    }
+
+    // Called when an attempt is over, returns true if it should be tried again
+    bool attempt_done(CURLcode attempt_res) {
+        ++attempts_made;
+        curl_res = attempt_res;
+
+        if (curl_res == CURLE_OPERATION_TIMEDOUT) {
+            timed_out = true;
+            return false;
+        } else if (curl_res == CURLE_SEND_ERROR ||
+                   curl_res == CURLE_RECV_ERROR ||
+                   curl_res == CURLE_COULDNT_CONNECT) {
             // Could be a temporary error, try again
-            continue;
+            return true;
         } else if (curl_res != CURLE_OK) {
-            res_out->error.assign(curl_easy_strerror(curl_res));
-            return;
+            failed = true;
+            return false;
         }
 
         curl_res = curl_easy_getinfo(curl_handle.get(),
                                      CURLINFO_RESPONSE_CODE,
                                      &response_code);
 
-        // Break on success, retry on temporary error
-        if (curl_res != CURLE_OK ||
+        // Stop on success, retry on temporary error
+        return curl_res == CURLE_OK &&
             // Error codes that may be resolved by retrying
-            (response_code != 408 &&
-             response_code != 500 &&
-             response_code != 502 &&
-             response_code != 503 &&
-             response_code != 504)) {
-            break;
-        }
+            (response_code == 408 ||
+             response_code == 500 ||
+             response_code == 502 ||
+             response_code == 503 ||
+             response_code == 504);
+    }
+
+    // Fills in the result once there will be no more attempts
+    void finish();
+
+private:
+    http_opts_t *opts;
+    http_result_t *res_out;
+
+    scoped_curl_handle_t curl_handle;
+    curl_data_t curl_data;
+
+    ticks_t deadline;
+    uint64_t attempts_made;
+    CURLcode curl_res;
+    long response_code; // NOLINT(runtime/int)
+    bool failed;
+    bool timed_out;
+
+    DISABLE_COPYING(http_transfer_t);
+};
+
+// TODO: implement streaming API support
+void http_transfer_t::finish() {
+    if (timed_out) {
+        res_out->error =
+            strprintf("timed out after %" PRIu64 ".%03" PRIu64 " seconds",
+                      opts->timeout_ms / 1000, opts->timeout_ms % 1000);
+        return;
+    } else if (failed) {
+        res_out->error.assign(curl_easy_strerror(curl_res));
+        return;
     }
 
     std::string body_data(curl_data.steal_body_data());
@@ -682,6 +839,126 @@ void perform_http(http_opts_t *opts, http_result_t *res_out) {
     }
 }
 
+// Runs a step of a transfer, turning any exception into the request's error
+template <class callable_t>
+void run_transfer_step(http_result_t *res_out, const callable_t &step) {
+    try {
+        step();
+    } catch (const std::exception &ex) {
+        res_out->error.assign(ex.what());
+    } catch (...) {
+        res_out->error.assign("unknown error");
+    }
+}
+
+void perform_http_batch(std::vector<http_opts_t> *opts_batch,
+                        std::vector<http_result_t> *results_out) {
+    static http_response_cache_t response_cache;
+
+    CURLM *multi_handle = get_multi_handle();
+    if (multi_handle == NULL) {
+        for (http_result_t &result : *results_out) {
+            result.error.assign("initialization");
+        }
+        return;
+    }
+
+    const size_t count = opts_batch->size();
+    std::vector<scoped_ptr_t<http_transfer_t> > transfers(count);
+    std::vector<std::string> cache_keys(count);
+    std::map<CURL *, size_t> in_flight;
+
+    auto finish = [&](size_t i) {
+        http_result_t *res = &(*results_out)[i];
+        run_transfer_step(res, [&]() { transfers[i]->finish(); });
+        transfers[i].reset();
+        if (!cache_keys[i].empty() && res->error.empty()) {
+            response_cache.put(cache_keys[i], *res, (*opts_batch)[i].cache_ttl_ms);
+        }
+    };
+
+    size_t next = 0;
+    try {
+        while (next < count || !in_flight.empty()) {
+            while (next < count && in_flight.size() < HTTP_MAX_CONCURRENT_REQUESTS) {
+                size_t i = next++;
+                http_opts_t *opts = &(*opts_batch)[i];
+                http_result_t *res = &(*results_out)[i];
+                if (http_job_t::is_cacheable(*opts)) {
+                    cache_keys[i] = http_job_t::cache_key(*opts);
+                    if (response_cache.get(cache_keys[i], res)) {
+                        continue;
+                    }
+                }
+
+                transfers[i].init(new http_transfer_t(opts, res));
+                bool started = false;
+                run_transfer_step(res, [&]() {
+                    started = transfers[i]->prepare() &&
+                        transfers[i]->start_attempt(multi_handle);
+                });
+                if (started) {
+                    in_flight[transfers[i]->handle()] = i;
+                } else if (res->error.empty()) {
+                    finish(i);
+                } else {
+                    transfers[i].reset();
+                }
+            }
+
+            if (in_flight.empty()) {
+                continue;
+            }
+
+            int running;
+            exc_multi(curl_multi_perform(multi_handle, &running), "perform");
+
+            CURLMsg *msg;
+            int msgs_left;
+            while ((msg = curl_multi_info_read(multi_handle, &msgs_left)) != NULL) {
+                if (msg->msg != CURLMSG_DONE) {
+                    continue;
+                }
+                CURL *handle = msg->easy_handle;
+                CURLcode attempt_res = msg->data.result;
+                auto it = in_flight.find(handle);
+                guarantee(it != in_flight.end());
+                size_t i = it->second;
+                in_flight.erase(it);
+                exc_multi(curl_multi_remove_handle(multi_handle, handle),
+                          "remove handle");
+
+                http_result_t *res = &(*results_out)[i];
+                bool restarted = false;
+                run_transfer_step(res, [&]() {
+                    restarted = transfers[i]->attempt_done(attempt_res) &&
+                        transfers[i]->start_attempt(multi_handle);
+                });
+                if (restarted) {
+                    in_flight[handle] = i;
+                } else if (res->error.empty()) {
+                    finish(i);
+                } else {
+                    transfers[i].reset();
+                }
+            }
+
+            if (!in_flight.empty()) {
+                exc_multi(curl_multi_wait(multi_handle, NULL, 0, 1000, NULL), "wait");
+            }
+        }
+    } catch (const curl_exc_t &ex) {
+        // The multi handle failed, so give up on everything that isn't done
+        for (auto const &pair : in_flight) {
+            curl_multi_remove_handle(multi_handle, pair.first);
+            (*results_out)[pair.second].error.assign(ex.what());
+        }
+        for (size_t i = next; i < count; ++i) {
+            (*results_out)[i].error.assign(ex.what());
+        }
+    }
+}
+
 class header_parser_singleton_t {
 public:
     static ql::datum_t parse(const std::string &header);
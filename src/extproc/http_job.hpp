@@ -2,6 +2,9 @@
 #ifndef EXTPROC_HTTP_JOB_HPP_
 #define EXTPROC_HTTP_JOB_HPP_
 
+#include <string>
+#include <vector>
+
 #include "errors.hpp"
 
 #include "extproc/extproc_pool.hpp"
@@ -12,13 +15,26 @@
 
 class http_job_t {
 public:
-    http_job_t(extproc_pool_t *pool, signal_t *interruptor);
+    http_job_t(extproc_pool_t *pool,
+               signal_t *interruptor,
+               const std::string &affinity_key = "");
 
-    void http(const http_opts_t &opts, http_result_t *res_out);
+    // The worker runs the requests concurrently and sends back one result for each
+    void http(const std::vector<const http_opts_t *> &opts_batch,
+              std::vector<http_result_t> *res_out);
 
     // Marks the extproc worker as errored to simplify cleanup later
     void worker_error();
 
+    // Remembers that the worker has the response for `key` in its cache
+    void set_affinity(const std::string &key);
+
+    // Whether the worker caches the response to the request, and the key it is cached
+    //  under.  The key covers everything that can change the result, except for the
+    //  options that only control how hard to try, like `timeout_ms` and `attempts`.
+    static bool is_cacheable(const http_opts_t &opts);
+    static std::string cache_key(const http_opts_t &opts);
+
 private:
     static bool worker_fn(read_stream_t *stream_in, write_stream_t *stream_out);
 
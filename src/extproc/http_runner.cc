@@ -2,16 +2,17 @@
 #include "extproc/http_runner.hpp"
 
 #include "extproc/http_job.hpp"
+#include "config/args.hpp"
 #include "containers/archive/stl_types.hpp"
 #include "arch/timing.hpp"
 #include "protocol_api.hpp"
 
 RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(http_result_t, header, body, cookies, error);
 RDB_IMPL_SERIALIZABLE_3_SINCE_v1_13(http_opts_t::http_auth_t, type, username, password);
-RDB_IMPL_SERIALIZABLE_16(http_opts_t,
+RDB_IMPL_SERIALIZABLE_17(http_opts_t,
                          auth, method, result_format, url, proxy, url_params,
                          header, cookies, data, form_data, limits, version, timeout_ms,
-                         attempts, max_redirects, verify);
+                         attempts, max_redirects, verify, cache_ttl_ms);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(http_opts_t);
 
 std::string http_method_to_str(http_method_t method) {
@@ -42,7 +43,8 @@ http_opts_t::http_opts_t() :
     timeout_ms(30000),
     attempts(5),
     max_redirects(1),
-    verify(true) { }
+    verify(true),
+    cache_ttl_ms(0) { }
 
 http_opts_t::http_auth_t::http_auth_t() :
     type(http_auth_type_t::NONE),
@@ -74,26 +76,74 @@ http_runner_t::http_runner_t(extproc_pool_t *_pool) :
 void http_runner_t::http(const http_opts_t &opts,
                          http_result_t *res_out,
                          signal_t *interruptor) {
+    std::vector<http_result_t> results;
+    run(std::vector<const http_opts_t *>({ &opts }), &results, interruptor);
+    *res_out = std::move(results[0]);
+}
+
+void http_runner_t::http_batch(const std::vector<http_opts_t> &opts_batch,
+                               std::vector<http_result_t> *res_out,
+                               signal_t *interruptor) {
+    std::vector<const http_opts_t *> opts_ptrs;
+    opts_ptrs.reserve(opts_batch.size());
+    for (const http_opts_t &opts : opts_batch) {
+        opts_ptrs.push_back(&opts);
+    }
+    run(opts_ptrs, res_out, interruptor);
+}
+
+void http_runner_t::run(const std::vector<const http_opts_t *> &opts_batch,
+                        std::vector<http_result_t> *res_out,
+                        signal_t *interruptor) {
+    guarantee(!opts_batch.empty());
+
+    // Send the job to the worker that has the first cacheable response, if any
+    std::string affinity_key;
+    uint64_t max_timeout_ms = 0;
+    for (const http_opts_t *opts : opts_batch) {
+        if (affinity_key.empty() && http_job_t::is_cacheable(*opts)) {
+            affinity_key = http_job_t::cache_key(*opts);
+        }
+        max_timeout_ms = std::max(max_timeout_ms, opts->timeout_ms);
+    }
+
+    // The worker times out each request itself.  This only catches a worker that
+    // doesn't respond, so it allows for the requests that have to wait for a free
+    // slot, plus one more request's worth of time.
+    uint64_t rounds = (opts_batch.size() + HTTP_MAX_CONCURRENT_REQUESTS - 1)
+        / HTTP_MAX_CONCURRENT_REQUESTS + 1;
+
     signal_timer_t timeout;
     wait_any_t combined_interruptor(interruptor, &timeout);
-    http_job_t job(pool, &combined_interruptor);
+    http_job_t job(pool, &combined_interruptor, affinity_key);
 
     assert_thread();
-    timeout.start(opts.timeout_ms);
+    timeout.start(static_cast<int64_t>(max_timeout_ms * rounds));
 
     try {
-        job.http(opts, res_out);
+        job.http(opts_batch, res_out);
     } catch (const interrupted_exc_t &ex) {
         if (!timeout.is_pulsed()) {
             throw;
         }
-        res_out->error =
-            strprintf("timed out after %" PRIu64 ".%03" PRIu64 " seconds",
-                      opts.timeout_ms / 1000, opts.timeout_ms % 1000);
+        res_out->clear();
+        res_out->resize(opts_batch.size());
+        for (http_result_t &res : *res_out) {
+            res.error =
+                strprintf("timed out after %" PRIu64 ".%03" PRIu64 " seconds",
+                          max_timeout_ms / 1000, max_timeout_ms % 1000);
+        }
+        return;
     } catch (...) {
         // This will mark the worker as errored so we don't try to re-sync with it
         //  on the next line (since we're in a catch statement, we aren't allowed)
         job.worker_error();
         throw;
     }
+
+    for (const http_opts_t *opts : opts_batch) {
+        if (http_job_t::is_cacheable(*opts)) {
+            job.set_affinity(http_job_t::cache_key(*opts));
+        }
+    }
 }
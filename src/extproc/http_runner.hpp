@@ -117,6 +117,10 @@ struct http_opts_t {
     uint32_t max_redirects;
 
     bool verify;
+
+    // If nonzero, the worker process may answer a GET or HEAD request with a response
+    // it received for the same request less than this long ago.
+    uint64_t cache_ttl_ms;
 };
 
 RDB_DECLARE_SERIALIZABLE(http_opts_t);
@@ -132,7 +136,18 @@ public:
               http_result_t *res_out,
               signal_t *interruptor);
 
+    // Sends all of the requests to one worker process, which keeps up to
+    // `HTTP_MAX_CONCURRENT_REQUESTS` of them in flight at once, and fills `res_out`
+    // with their results in order.
+    void http_batch(const std::vector<http_opts_t> &opts_batch,
+                    std::vector<http_result_t> *res_out,
+                    signal_t *interruptor);
+
 private:
+    void run(const std::vector<const http_opts_t *> &opts_batch,
+             std::vector<http_result_t> *res_out,
+             signal_t *interruptor);
+
     extproc_pool_t *pool;
 
     DISABLE_COPYING(http_runner_t);
@@ -3,10 +3,14 @@
 
 #include <v8.h>
 
+#include <errno.h>
+#include <pthread.h>
 #include <stdint.h>
+#include <time.h>
 #include <libplatform/libplatform.h>
 #include <limits>
 
+#include "config/args.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/stl_types.hpp"
 #include "extproc/extproc_job.hpp"
@@ -32,12 +36,119 @@ ql::datum_t js_to_datum(const v8::Handle<v8::Value> &value,
 v8::Handle<v8::Value> js_from_datum(const ql::datum_t &datum,
                                     std::string *err_out);
 
+// Stops JavaScript that runs for too long. A thread of its own waits for the deadline
+// and then tells v8 to terminate whatever is running.
+class js_call_watchdog_t {
+public:
+    explicit js_call_watchdog_t(v8::Isolate *isolate);
+    ~js_call_watchdog_t();
+
+    // Terminates the JavaScript that runs `timeout_ms` from now, unless `disarm()` is
+    // called first.
+    void arm(uint64_t timeout_ms);
+
+    // Stops the countdown. If the watchdog fired since it was armed, the termination
+    // is cancelled, so that v8 is usable again afterwards. The watchdog can fire just
+    // after the call has returned, so whether the call timed out has to be taken from
+    // v8 (`v8::TryCatch::HasTerminated()`), not from whether the watchdog fired.
+    void disarm();
+
+private:
+    static void *run(void *self);
+
+    v8::Isolate *const isolate;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool stop;
+    bool armed;
+    bool fired;
+    struct timespec deadline;
+
+    DISABLE_COPYING(js_call_watchdog_t);
+};
+
+js_call_watchdog_t::js_call_watchdog_t(v8::Isolate *_isolate) :
+    isolate(_isolate), stop(false), armed(false), fired(false) {
+    int res = pthread_mutex_init(&mutex, NULL);
+    guarantee_xerr(res == 0, res, "Could not initialize pthread mutex.");
+    // The deadline is on the monotonic clock, so that changing the system time
+    // doesn't make calls time out early or never.
+    pthread_condattr_t attr;
+    res = pthread_condattr_init(&attr);
+    guarantee_xerr(res == 0, res, "Could not initialize pthread condattr.");
+    res = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    guarantee_xerr(res == 0, res, "Could not set the clock of pthread condattr.");
+    res = pthread_cond_init(&cond, &attr);
+    guarantee_xerr(res == 0, res, "Could not initialize pthread cond.");
+    pthread_condattr_destroy(&attr);
+    res = pthread_create(&thread, NULL, &js_call_watchdog_t::run, this);
+    guarantee_xerr(res == 0, res, "Could not create the JavaScript watchdog thread.");
+}
+
+js_call_watchdog_t::~js_call_watchdog_t() {
+    pthread_mutex_lock(&mutex);
+    stop = true;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+    int res = pthread_join(thread, NULL);
+    guarantee_xerr(res == 0, res, "Could not join the JavaScript watchdog thread.");
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+}
+
+void js_call_watchdog_t::arm(uint64_t timeout_ms) {
+    struct timespec now;
+    int res = clock_gettime(CLOCK_MONOTONIC, &now);
+    guarantee_err(res == 0, "clock_gettime failed");
+    pthread_mutex_lock(&mutex);
+    deadline.tv_sec = now.tv_sec + timeout_ms / 1000;
+    deadline.tv_nsec = now.tv_nsec + (timeout_ms % 1000) * MILLION;
+    if (deadline.tv_nsec >= BILLION) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= BILLION;
+    }
+    armed = true;
+    fired = false;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+}
+
+void js_call_watchdog_t::disarm() {
+    pthread_mutex_lock(&mutex);
+    armed = false;
+    const bool did_fire = fired;
+    fired = false;
+    pthread_mutex_unlock(&mutex);
+    if (did_fire) {
+        v8::V8::CancelTerminateExecution(isolate);
+    }
+}
+
+void *js_call_watchdog_t::run(void *_self) {
+    js_call_watchdog_t *self = static_cast<js_call_watchdog_t *>(_self);
+    pthread_mutex_lock(&self->mutex);
+    while (!self->stop) {
+        if (!self->armed) {
+            pthread_cond_wait(&self->cond, &self->mutex);
+        } else if (pthread_cond_timedwait(&self->cond, &self->mutex, &self->deadline)
+                   == ETIMEDOUT && self->armed) {
+            v8::V8::TerminateExecution(self->isolate);
+            self->armed = false;
+            self->fired = true;
+        }
+    }
+    pthread_mutex_unlock(&self->mutex);
+    return NULL;
+}
+
 // Each worker process should have a single instance of this class before using the v8 API
 class js_instance_t {
 public:
     static void run_other_tasks();
     static void maybe_initialize_v8();
     static v8::Isolate *isolate();
+    static js_call_watchdog_t *watchdog();
 
 private:
     js_instance_t();
@@ -48,6 +159,7 @@ private:
     v8::Isolate *isolate_;
 
     scoped_ptr_t<v8::Platform> platform;
+    scoped_ptr_t<js_call_watchdog_t> watchdog_;
 };
 
 js_instance_t *js_instance_t::instance = NULL;
@@ -59,9 +171,11 @@ js_instance_t::js_instance_t() {
     v8::V8::Initialize();
     isolate_ = v8::Isolate::New();
     isolate_->Enter();
+    watchdog_.init(new js_call_watchdog_t(isolate_));
 }
 
 js_instance_t::~js_instance_t() {
+    watchdog_.reset();
     isolate_->Exit();
     isolate_->Dispose();
     v8::V8::Dispose();
@@ -76,28 +190,75 @@ v8::Isolate *js_instance_t::isolate() {
     return instance->isolate_;
 }
 
+js_call_watchdog_t *js_instance_t::watchdog() {
+    return instance->watchdog_.get();
+}
+
 void js_instance_t::maybe_initialize_v8() {
     if (instance == NULL) {
         instance = new js_instance_t;
     }
 }
 
+// Compiled scripts that evaluated to functions, by source, so that later jobs in the
+// same worker process can skip the compilation. A compiled script isn't tied to a
+// context; every `eval()` binds it to a fresh one and runs it again, so the functions,
+// their closures and their globals are never shared between jobs.
+class js_script_cache_t {
+public:
+    js_script_cache_t() : use_counter(0) { }
+    ~js_script_cache_t();
+
+    // Returns an empty handle if the source isn't cached.
+    v8::Local<v8::UnboundScript> find(const std::string &source);
+    // Evicts the least recently used script if the cache is full.
+    void insert(const std::string &source, const v8::Local<v8::UnboundScript> &script);
+
+private:
+    struct entry_t {
+        boost::shared_ptr<v8::Persistent<v8::UnboundScript> > script;
+        uint64_t last_used;
+    };
+    typedef std::map<std::string, entry_t> script_map_t;
+
+    void touch(script_map_t::iterator it);
+
+    script_map_t scripts;
+    // The entries of `scripts` by `last_used`, least recently used first
+    std::map<uint64_t, script_map_t::iterator> by_last_use;
+    uint64_t use_counter;
+
+    DISABLE_COPYING(js_script_cache_t);
+};
+
 // Worker-side JS evaluation environment.
 class js_env_t {
 public:
-    js_env_t();
+    explicit js_env_t(js_script_cache_t *script_cache);
     ~js_env_t();
 
     js_result_t eval(const std::string &source, const ql::configured_limits_t &limits);
     js_result_t call(js_id_t id, const std::vector<ql::datum_t> &args,
                      const ql::configured_limits_t &limits);
+    // Each call may run for `timeout_ms`. If one runs for longer, it's terminated, and
+    // the batch ends with it; `*timed_out_out` is set and its result is meaningless.
+    std::vector<js_result_t> call_batch(
+        js_id_t id, const std::vector<std::vector<ql::datum_t> > &args_batch,
+        const ql::configured_limits_t &limits, uint64_t timeout_ms,
+        bool *timed_out_out);
     void release(js_id_t id);
     void run_other_tasks(uint64_t task_counter);
 
 private:
+    js_result_t call_function(const v8::Local<v8::Function> &fn,
+                              const std::vector<ql::datum_t> &args,
+                              const ql::configured_limits_t &limits,
+                              bool remember_functions,
+                              bool *terminated_out);
     js_id_t remember_value(const v8::Handle<v8::Value> &value);
     const boost::shared_ptr<v8::Persistent<v8::Value> > find_value(js_id_t id);
 
+    js_script_cache_t *script_cache;
     js_id_t next_id;
     std::map<js_id_t, boost::shared_ptr<v8::Persistent<v8::Value> > > values;
 };
@@ -119,13 +280,15 @@ enum js_task_t {
     TASK_EVAL,
     TASK_CALL,
     TASK_RELEASE,
-    TASK_EXIT
+    TASK_EXIT,
+    TASK_CALL_BATCH
 };
 
 // The job_t runs in the context of the main rethinkdb process
 js_job_t::js_job_t(extproc_pool_t *pool, signal_t *interruptor,
-                   const ql::configured_limits_t &_limits) :
-    extproc_job(pool, &worker_fn, interruptor), limits(_limits) { }
+                   const ql::configured_limits_t &_limits,
+                   const std::string &source) :
+    extproc_job(pool, &worker_fn, interruptor, source), limits(_limits) { }
 
 js_result_t js_job_t::eval(const std::string &source) {
     js_task_t task = js_task_t::TASK_EVAL;
@@ -148,6 +311,10 @@ js_result_t js_job_t::eval(const std::string &source) {
         throw extproc_worker_exc_t(strprintf("failed to deserialize eval result from worker "
                                              "(%s)", archive_result_as_str(res)));
     }
+    // The worker keeps the compiled code of functions around for later jobs
+    if (boost::get<js_id_t>(&result) != NULL) {
+        extproc_job.set_affinity(source);
+    }
     return result;
 }
 
@@ -176,6 +343,44 @@ js_result_t js_job_t::call(js_id_t id, const std::vector<ql::datum_t> &args) {
     return result;
 }
 
+std::vector<js_result_t> js_job_t::call_batch(
+        js_id_t id, const std::vector<std::vector<ql::datum_t> > &args_batch,
+        uint64_t timeout_ms, bool *timed_out_out) {
+    js_task_t task = js_task_t::TASK_CALL_BATCH;
+    write_message_t wm;
+    wm.append(&task, sizeof(task));
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, id);
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, args_batch);
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, limits);
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, timeout_ms);
+    {
+        int res = send_write_message(extproc_job.write_stream(), &wm);
+        if (res != 0) {
+            throw extproc_worker_exc_t("failed to send data to the worker");
+        }
+    }
+
+    std::vector<js_result_t> results;
+    archive_result_t res
+        = deserialize<cluster_version_t::LATEST_OVERALL>(extproc_job.read_stream(),
+                                                         &results);
+    if (!bad(res)) {
+        res = deserialize<cluster_version_t::LATEST_OVERALL>(extproc_job.read_stream(),
+                                                             timed_out_out);
+    }
+    if (bad(res)) {
+        throw extproc_worker_exc_t(strprintf("failed to deserialize call results from "
+                                             "worker (%s)", archive_result_as_str(res)));
+    }
+    // A call that timed out ends the batch early.
+    if (*timed_out_out
+            ? results.empty() || results.size() > args_batch.size()
+            : results.size() != args_batch.size()) {
+        throw extproc_worker_exc_t("worker returned the wrong number of call results");
+    }
+    return results;
+}
+
 void js_job_t::release(js_id_t id) {
     js_task_t task = js_task_t::TASK_RELEASE;
     write_message_t wm;
@@ -308,6 +513,46 @@ bool run_call(read_stream_t *stream_in,
     return send_js_result(stream_out, js_result);
 }
 
+bool run_call_batch(read_stream_t *stream_in,
+                    write_stream_t *stream_out,
+                    js_env_t *js_env,
+                    uint64_t task_counter) {
+    js_id_t id;
+    std::vector<std::vector<ql::datum_t> > args_batch;
+    ql::configured_limits_t limits;
+    uint64_t timeout_ms;
+    {
+        archive_result_t res
+            = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &id);
+        if (bad(res)) { return false; }
+        res = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &args_batch);
+        if (bad(res)) { return false; }
+        res = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &limits);
+        if (bad(res)) { return false; }
+        res = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &timeout_ms);
+        if (bad(res)) { return false; }
+    }
+
+    std::vector<js_result_t> js_results;
+    bool timed_out = false;
+    try {
+        js_results = js_env->call_batch(id, args_batch, limits, timeout_ms, &timed_out);
+    } catch (const std::exception &e) {
+        js_results.assign(args_batch.size(), js_result_t(std::string(e.what())));
+    } catch (...) {
+        js_results.assign(args_batch.size(),
+                          js_result_t(std::string("encountered an unknown exception")));
+    }
+
+    js_env->run_other_tasks(task_counter);
+
+    write_message_t wm;
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, js_results);
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, timed_out);
+    int res = send_write_message(stream_out, &wm);
+    return res == 0;
+}
+
 bool run_release(read_stream_t *stream_in,
                  write_stream_t *stream_out,
                  js_env_t *js_env,
@@ -330,7 +575,10 @@ bool js_job_t::worker_fn(read_stream_t *stream_in, write_stream_t *stream_out) {
     static uint64_t task_counter = 0;
     bool running = true;
     js_instance_t::maybe_initialize_v8();
-    js_env_t js_env;
+
+    // The compiled scripts outlive the job, but nothing else in its environment does.
+    static js_script_cache_t *script_cache = new js_script_cache_t;
+    js_env_t js_env(script_cache);
 
     while (running) {
         task_counter += 1;
@@ -357,6 +605,11 @@ bool js_job_t::worker_fn(read_stream_t *stream_in, write_stream_t *stream_out) {
                 return false;
             }
             break;
+        case TASK_CALL_BATCH:
+            if (!run_call_batch(stream_in, stream_out, &js_env, task_counter)) {
+                return false;
+            }
+            break;
         case TASK_EXIT:
             return run_exit(stream_out);
         default:
@@ -368,6 +621,11 @@ bool js_job_t::worker_fn(read_stream_t *stream_in, write_stream_t *stream_out) {
 
 static void append_caught_error(std::string *err_out, const v8::TryCatch &try_catch) {
     if (!try_catch.HasCaught()) return;
+    if (try_catch.HasTerminated()) {
+        // The watchdog stopped it; v8 can't turn that into a string.
+        err_out->append("JavaScript execution was terminated");
+        return;
+    }
 
     v8::String::Utf8Value exception(try_catch.Exception());
     const char *message = *exception;
@@ -375,8 +633,51 @@ static void append_caught_error(std::string *err_out, const v8::TryCatch &try_ca
     err_out->append(message, strlen(message));
 }
 
+js_script_cache_t::~js_script_cache_t() {
+    for (auto it = scripts.begin(); it != scripts.end(); ++it) {
+        it->second.script->Reset();
+    }
+}
+
+v8::Local<v8::UnboundScript> js_script_cache_t::find(const std::string &source) {
+    auto it = scripts.find(source);
+    if (it == scripts.end()) {
+        return v8::Local<v8::UnboundScript>();
+    }
+    touch(it);
+    return v8::Local<v8::UnboundScript>::New(js_instance_t::isolate(),
+                                             *it->second.script);
+}
+
+void js_script_cache_t::insert(const std::string &source,
+                               const v8::Local<v8::UnboundScript> &script) {
+    auto res = scripts.insert(std::make_pair(source, entry_t()));
+    if (res.second) {
+        res.first->second.script.reset(new v8::Persistent<v8::UnboundScript>(
+            js_instance_t::isolate(), script));
+    } else {
+        by_last_use.erase(res.first->second.last_used);
+    }
+    res.first->second.last_used = ++use_counter;
+    by_last_use.insert(std::make_pair(use_counter, res.first));
+
+    while (scripts.size() > JS_WORKER_SCRIPT_CACHE_SIZE) {
+        auto oldest = by_last_use.begin();
+        oldest->second->second.script->Reset();
+        scripts.erase(oldest->second);
+        by_last_use.erase(oldest);
+    }
+}
+
+void js_script_cache_t::touch(script_map_t::iterator it) {
+    by_last_use.erase(it->second.last_used);
+    it->second.last_used = ++use_counter;
+    by_last_use.insert(std::make_pair(use_counter, it));
+}
+
 // The env_t runs in the context of the worker process
-js_env_t::js_env_t() :
+js_env_t::js_env_t(js_script_cache_t *_script_cache) :
+    script_cache(_script_cache),
     next_id(MIN_ID) { }
 
 js_env_t::~js_env_t() {
@@ -396,24 +697,29 @@ js_result_t js_env_t::eval(const std::string &source,
 
     v8::HandleScope handle_scope(isolate);
 
-    // TODO: use an "external resource" to avoid copy?
-    v8::Handle<v8::String> src = v8::String::NewFromUtf8(isolate,
-                                                         source.data(),
-                                                         v8::String::NewStringType::kNormalString,
-                                                         source.size());
-
     // This constructor registers itself with v8 so that any errors generated
     // within v8 will be available within this object.
     v8::TryCatch try_catch;
 
     // Firstly, compilation may fail (because of say a syntax error)
-    v8::Handle<v8::Script> script = v8::Script::Compile(src);
-    if (script.IsEmpty()) {
+    v8::Local<v8::UnboundScript> unbound_script = script_cache->find(source);
+    const bool was_cached = !unbound_script.IsEmpty();
+    if (!was_cached) {
+        // TODO: use an "external resource" to avoid copy?
+        v8::Local<v8::String> src = v8::String::NewFromUtf8(isolate,
+                                                            source.data(),
+                                                            v8::String::NewStringType::kNormalString,
+                                                            source.size());
+        v8::ScriptCompiler::Source script_source(src);
+        unbound_script = v8::ScriptCompiler::CompileUnbound(isolate, &script_source);
+    }
+    if (unbound_script.IsEmpty()) {
         // Get the error out of the TryCatch object
         append_caught_error(err_out, try_catch);
     } else {
         // Secondly, evaluation may fail because of an exception generated
         // by the code
+        v8::Handle<v8::Script> script = unbound_script->BindToCurrentContext();
         v8::Handle<v8::Value> result_val = script->Run();
         if (result_val.IsEmpty()) {
             // Get the error from the TryCatch object
@@ -425,6 +731,9 @@ js_result_t js_env_t::eval(const std::string &source,
                 v8::Handle<v8::Function> func
                     = v8::Handle<v8::Function>::Cast(result_val);
                 result = remember_value(func);
+                if (!was_cached) {
+                    script_cache->insert(source, unbound_script);
+                }
             } else {
                 guarantee(!result_val.IsEmpty());
 
@@ -460,10 +769,13 @@ const boost::shared_ptr<v8::Persistent<v8::Value> > js_env_t::find_value(js_id_t
     return it->second;
 }
 
+// Sets `*terminated_out` if the call was stopped by `v8::V8::TerminateExecution()`.
 v8::Local<v8::Value> run_js_func(v8::Handle<v8::Function> fn,
                                  const std::vector<ql::datum_t> &args,
-                                 std::string *err_out) {
+                                 std::string *err_out,
+                                 bool *terminated_out) {
     v8::Isolate *isolate = js_instance_t::isolate();
+    *terminated_out = false;
 
     v8::TryCatch try_catch;
     v8::EscapableHandleScope scope(isolate);
@@ -484,6 +796,7 @@ v8::Local<v8::Value> run_js_func(v8::Handle<v8::Function> fn,
     // Call function with environment as its receiver.
     v8::Local<v8::Value> result = fn->Call(obj, args.size(), handles.data());
     if (result.IsEmpty()) {
+        *terminated_out = try_catch.HasTerminated();
         append_caught_error(err_out, try_catch);
     }
     return scope.Escape(result);
@@ -492,10 +805,6 @@ v8::Local<v8::Value> run_js_func(v8::Handle<v8::Function> fn,
 js_result_t js_env_t::call(js_id_t id,
                            const std::vector<ql::datum_t> &args,
                            const ql::configured_limits_t &limits) {
-    js_context_t clean_context;
-    js_result_t result("");
-    std::string *err_out = boost::get<std::string>(&result);
-
     const boost::shared_ptr<v8::Persistent<v8::Value> > found_value = find_value(id);
     guarantee(!found_value->IsEmpty());
 
@@ -506,12 +815,68 @@ js_result_t js_env_t::call(js_id_t id,
     // Construct local handle from persistent handle
     v8::Local<v8::Value> local_handle = v8::Local<v8::Value>::New(isolate, *found_value);
     v8::Local<v8::Function> fn = v8::Local<v8::Function>::Cast(local_handle);
-    v8::Handle<v8::Value> value = run_js_func(fn, args, err_out);
+    bool terminated;
+    return call_function(fn, args, limits, true, &terminated);
+}
+
+std::vector<js_result_t> js_env_t::call_batch(
+        js_id_t id,
+        const std::vector<std::vector<ql::datum_t> > &args_batch,
+        const ql::configured_limits_t &limits,
+        uint64_t timeout_ms,
+        bool *timed_out_out) {
+    const boost::shared_ptr<v8::Persistent<v8::Value> > found_value = find_value(id);
+    guarantee(!found_value->IsEmpty());
+
+    v8::Isolate *isolate = js_instance_t::isolate();
+
+    v8::HandleScope handle_scope(isolate);
+
+    v8::Local<v8::Value> local_handle = v8::Local<v8::Value>::New(isolate, *found_value);
+    v8::Local<v8::Function> fn = v8::Local<v8::Function>::Cast(local_handle);
+
+    *timed_out_out = false;
+    std::vector<js_result_t> results;
+    results.reserve(args_batch.size());
+    js_call_watchdog_t *watchdog = js_instance_t::watchdog();
+    for (const auto &args : args_batch) {
+        watchdog->arm(timeout_ms);
+        // The transforms that batch their calls can't do anything with a function
+        // except report it as the wrong type, so we don't keep it around.
+        bool terminated;
+        results.push_back(call_function(fn, args, limits, false, &terminated));
+        watchdog->disarm();
+        if (terminated) {
+            // The caller reports the timeout, which fails the whole query anyway.
+            *timed_out_out = true;
+            break;
+        }
+    }
+    return results;
+}
+
+// Each call gets a clean context, whether it's part of a batch or not, so that calls
+// can't see each other's globals.
+js_result_t js_env_t::call_function(const v8::Local<v8::Function> &fn,
+                                    const std::vector<ql::datum_t> &args,
+                                    const ql::configured_limits_t &limits,
+                                    bool remember_functions,
+                                    bool *terminated_out) {
+    js_context_t clean_context;
+    js_result_t result("");
+    std::string *err_out = boost::get<std::string>(&result);
+
+    v8::HandleScope handle_scope(js_instance_t::isolate());
+    v8::Handle<v8::Value> value = run_js_func(fn, args, err_out, terminated_out);
 
     if (!value.IsEmpty()) {
         if (value->IsFunction()) {
-            v8::Handle<v8::Function> sub_func = v8::Handle<v8::Function>::Cast(value);
-            result = remember_value(sub_func);
+            if (remember_functions) {
+                v8::Handle<v8::Function> sub_func = v8::Handle<v8::Function>::Cast(value);
+                result = remember_value(sub_func);
+            } else {
+                result = INVALID_ID;
+            }
         } else {
             // JSONify result.
             ql::datum_t datum = js_to_datum(value, limits, err_out);
@@ -525,8 +890,10 @@ js_result_t js_env_t::call(js_id_t id,
 
 void js_env_t::release(js_id_t id) {
     guarantee(id < next_id);
-    size_t num_erased = values.erase(id);
-    guarantee(1 == num_erased);
+    auto it = values.find(id);
+    guarantee(it != values.end());
+    it->second->Reset();
+    values.erase(it);
 }
 
 // TODO: Is there a better way of detecting circular references than a recursion limit?
@@ -19,11 +19,20 @@
 
 class js_job_t {
 public:
+    // `source` is the first thing the job will evaluate, if known. The job is sent to
+    //  the worker that compiled it most recently, which may still have it cached.
     js_job_t(extproc_pool_t *pool, signal_t *interruptor,
-             const ql::configured_limits_t &limits);
+             const ql::configured_limits_t &limits,
+             const std::string &source);
 
     js_result_t eval(const std::string &source);
     js_result_t call(js_id_t id, const std::vector<ql::datum_t> &args);
+    // Calls the function once for each element of `args_batch`, in a single round
+    // trip. The worker stops each call after `timeout_ms`; if one times out, the
+    // results end with it and `*timed_out_out` is set.
+    std::vector<js_result_t> call_batch(
+        js_id_t id, const std::vector<std::vector<ql::datum_t> > &args_batch,
+        uint64_t timeout_ms, bool *timed_out_out);
     void release(js_id_t id);
     void exit();
 
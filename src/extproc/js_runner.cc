@@ -3,6 +3,7 @@
 
 #include <inttypes.h>   // For PRIu64
 
+#include <limits>
 #include <map>
 
 #include "extproc/js_job.hpp"
@@ -47,13 +48,15 @@ private:
 class js_runner_t::job_data_t {
 public:
     job_data_t(extproc_pool_t *pool, signal_t *interruptor,
-               const ql::configured_limits_t &limits) :
+               const ql::configured_limits_t &limits,
+               const std::string &source) :
         combined_interruptor(interruptor, js_timeout.get_signal()),
-        js_job(pool, &combined_interruptor, limits) { }
+        js_job(pool, &combined_interruptor, limits, source) { }
 
-    explicit job_data_t(extproc_pool_t *pool,
-                        const ql::configured_limits_t &limits) :
-        js_job(pool, js_timeout.get_signal(), limits) { }
+    job_data_t(extproc_pool_t *pool,
+               const ql::configured_limits_t &limits,
+               const std::string &source) :
+        js_job(pool, js_timeout.get_signal(), limits, source) { }
 
     struct func_info_t {
         explicit func_info_t(js_id_t _id) :
@@ -69,7 +72,7 @@ public:
     js_job_t js_job;
 };
 
-js_runner_t::js_runner_t() { }
+js_runner_t::js_runner_t() : pool(NULL), interruptor(NULL) { }
 
 js_runner_t::~js_runner_t() {
     assert_thread();
@@ -80,6 +83,10 @@ js_runner_t::~js_runner_t() {
 
 void js_runner_t::end() {
     assert_thread();
+    pool = NULL;
+    if (!job_data.has()) {
+        return;
+    }
     // Have the worker job exit its loop - if anything fails,
     //  don't worry, the worker will be cleaned up
     try {
@@ -99,21 +106,32 @@ bool js_runner_t::connected() const {
     return job_data.has();
 }
 
-// Starts the javascript function in the worker process
-void js_runner_t::begin(extproc_pool_t *pool, signal_t *interruptor,
-                        const ql::configured_limits_t &limits) {
+void js_runner_t::begin(extproc_pool_t *_pool, signal_t *_interruptor,
+                        const ql::configured_limits_t &_limits) {
     assert_thread();
+    guarantee(!job_data.has());
+    pool = _pool;
+    interruptor = _interruptor;
+    limits = _limits;
+}
+
+// Starts the javascript job in a worker process
+void js_runner_t::maybe_connect(const std::string &source) {
+    guarantee(pool != NULL, "js_runner_t used without calling begin()");
+    if (job_data.has()) {
+        return;
+    }
     if (interruptor == NULL) {
-        job_data.init(new job_data_t(pool, limits));
+        job_data.init(new job_data_t(pool, limits, source));
     } else {
-        job_data.init(new job_data_t(pool, interruptor, limits));
+        job_data.init(new job_data_t(pool, interruptor, limits, source));
     }
 }
 
 js_result_t js_runner_t::eval(const std::string &source,
                               const req_config_t &config) {
     assert_thread();
-    guarantee(job_data.has());
+    maybe_connect(source);
 
     js_result_t result;
 
@@ -170,7 +188,6 @@ js_result_t js_runner_t::call(const std::string &source,
                               const std::vector<ql::datum_t> &args,
                               const req_config_t &config) {
     assert_thread();
-    guarantee(job_data.has());
 
     // This will retrieve the function from the cache if it's there, or re-eval it
     js_result_t result = eval(source, config);
@@ -219,6 +236,63 @@ js_result_t js_runner_t::call(const std::string &source,
     return result;
 }
 
+std::vector<js_result_t> js_runner_t::call_batch(
+        const std::string &source,
+        const std::vector<std::vector<ql::datum_t> > &args_batch,
+        const req_config_t &config) {
+    assert_thread();
+    guarantee(!args_batch.empty());
+
+    // This will retrieve the function from the cache if it's there, or re-eval it
+    js_result_t fn_result = eval(source, config);
+    js_id_t *fn_id = boost::get<js_id_t>(&fn_result);
+    guarantee(fn_id != NULL);
+
+    // The worker stops each call that runs for longer than `config.timeout_ms`. This
+    // timeout is only for a worker that stops responding altogether, which kills it.
+    const uint64_t batch_timeout_ms =
+        config.timeout_ms > std::numeric_limits<uint64_t>::max() / args_batch.size()
+            ? std::numeric_limits<uint64_t>::max()
+            : config.timeout_ms * args_batch.size();
+    object_buffer_t<js_timeout_t::sentry_t> sentry;
+    sentry.create(&job_data->js_timeout, batch_timeout_ms);
+
+    const std::string timeout_message = strprintf(
+        "JavaScript query `%s` timed out after %" PRIu64 ".%03" PRIu64 " seconds.",
+        source.c_str(), config.timeout_ms / 1000, config.timeout_ms % 1000);
+    std::vector<js_result_t> results;
+    bool is_timeout = false;
+    try {
+        try {
+            bool call_timed_out;
+            results = job_data->js_job.call_batch(
+                *fn_id, args_batch, config.timeout_ms, &call_timed_out);
+            if (call_timed_out) {
+                // The batch ended with the call that timed out.
+                results.back() = js_result_t(timeout_message);
+            }
+        } catch (...) {
+            // See `eval()` for why this is split into two try-catch blocks.
+            is_timeout = job_data->js_timeout.get_signal()->is_pulsed();
+
+            sentry.reset();
+            job_data->js_job.worker_error();
+            job_data.reset();
+
+            throw;
+        }
+    } catch (interrupted_exc_t const &e) {
+        if (is_timeout) {
+            // We can't tell which call took too long, so they all fail.
+            results.assign(args_batch.size(), js_result_t(timeout_message));
+        } else {
+            throw;
+        }
+    }
+
+    return results;
+}
+
 void js_runner_t::cache_id(js_id_t id, const std::string &source) {
     guarantee(job_data.has());
     guarantee(id != INVALID_ID);
@@ -37,6 +37,9 @@ public:
     js_runner_t();
     ~js_runner_t();
 
+    // Whether the runner has a worker. `begin()` doesn't acquire one right away, that
+    // happens when the first function is evaluated so that we can pick a worker that
+    // compiled it before.
     bool connected() const;
 
     // Used for worker configuration
@@ -59,9 +62,21 @@ public:
                      const std::vector<ql::datum_t> &args,
                      const req_config_t &config);
 
+    // Calls a previously compiled function once for each element of `args_batch`,
+    // in a single round trip to the worker. The timeout applies to each call. The
+    // first call that times out ends the batch, so there may be fewer results than
+    // calls; the last result is then the timeout error.
+    std::vector<js_result_t> call_batch(
+        const std::string &source,
+        const std::vector<std::vector<ql::datum_t> > &args_batch,
+        const req_config_t &config);
+
 private:
     static const size_t CACHE_SIZE;
 
+    // Acquires a worker if we don't have one, preferring one that compiled `source`
+    void maybe_connect(const std::string &source);
+
     void cache_id(js_id_t id, const std::string &source);
     void trim_cache();
 
@@ -70,6 +85,11 @@ private:
     void release_id(js_id_t id);
 
 
+    // Set by `begin()`
+    extproc_pool_t *pool;
+    signal_t *interruptor;
+    ql::configured_limits_t limits;
+
     class job_data_t;
     scoped_ptr_t<job_data_t> job_data;
 
@@ -0,0 +1,136 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "perfmon/latency_histogram.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+latency_histogram_t::latency_histogram_t() : total(0), max_usecs(0) {
+    memset(buckets, 0, sizeof(buckets));
+}
+
+int latency_histogram_t::bucket_index(uint64_t usecs) {
+    const uint64_t sub_buckets = 1 << sub_bucket_bits;
+    if (usecs < sub_buckets) {
+        return usecs;
+    }
+    int exponent = 63 - __builtin_clzll(usecs);
+    if (exponent >= max_exponent) {
+        return num_buckets - 1;
+    }
+    int sub_bucket = (usecs >> (exponent - sub_bucket_bits)) & (sub_buckets - 1);
+    return ((exponent - sub_bucket_bits + 1) << sub_bucket_bits) + sub_bucket;
+}
+
+double latency_histogram_t::bucket_value(int index) {
+    const int sub_buckets = 1 << sub_bucket_bits;
+    if (index < sub_buckets) {
+        return index;
+    }
+    int exponent = (index >> sub_bucket_bits) + sub_bucket_bits - 1;
+    uint64_t width = uint64_t(1) << (exponent - sub_bucket_bits);
+    uint64_t lower = (sub_buckets + (index & (sub_buckets - 1))) * width;
+    // The middle of the bucket
+    return lower + (width - 1) / 2.0;
+}
+
+void latency_histogram_t::record(uint64_t usecs) {
+    ++buckets[bucket_index(usecs)];
+    ++total;
+    max_usecs = std::max(max_usecs, usecs);
+}
+
+void latency_histogram_t::merge(const latency_histogram_t &other) {
+    for (int i = 0; i < num_buckets; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    total += other.total;
+    max_usecs = std::max(max_usecs, other.max_usecs);
+}
+
+double latency_histogram_t::percentile(double fraction) const {
+    guarantee(total > 0);
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(ceil(fraction * total)));
+    uint64_t seen = 0;
+    for (int i = 0; i < num_buckets; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(bucket_value(i), static_cast<double>(max_usecs));
+        }
+    }
+    return max_usecs;
+}
+
+static const double percentile_fractions[] = { 0.5, 0.9, 0.99, 0.999 };
+static const char *percentile_names[] = { "p50", "p90", "p99", "p999" };
+
+static void add_percentiles(const latency_histogram_t &histogram,
+                            double max_usecs,
+                            ql::datum_object_builder_t *builder) {
+    for (size_t i = 0; i < sizeof(percentile_fractions) / sizeof(double); ++i) {
+        builder->overwrite(percentile_names[i],
+            histogram.count() == 0
+                ? ql::datum_t::null()
+                : ql::datum_t(histogram.percentile(percentile_fractions[i]) / 1000));
+    }
+    builder->overwrite("max",
+        histogram.count() == 0 ? ql::datum_t::null() : ql::datum_t(max_usecs / 1000));
+}
+
+ql::datum_t latency_histogram_t::to_datum() const {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("count", ql::datum_t(static_cast<double>(total)));
+    add_percentiles(*this, max_usecs, &builder);
+
+    ql::datum_array_builder_t buckets_builder(ql::configured_limits_t::unlimited);
+    for (int i = 0; i < num_buckets; ++i) {
+        if (buckets[i] != 0) {
+            std::vector<ql::datum_t> pair;
+            pair.push_back(ql::datum_t(static_cast<double>(i)));
+            pair.push_back(ql::datum_t(static_cast<double>(buckets[i])));
+            buckets_builder.add(ql::datum_t(std::move(pair),
+                                            ql::configured_limits_t::unlimited));
+        }
+    }
+    builder.overwrite("buckets", std::move(buckets_builder).to_datum());
+    return std::move(builder).to_datum();
+}
+
+bool latency_histogram_t::merge_datum(const ql::datum_t &datum) {
+    if (datum.get_type() != ql::datum_t::R_OBJECT) {
+        return false;
+    }
+    ql::datum_t buckets_datum = datum.get_field("buckets", ql::throw_bool_t::NOTHROW);
+    ql::datum_t max_datum = datum.get_field("max", ql::throw_bool_t::NOTHROW);
+    if (!buckets_datum.has() || buckets_datum.get_type() != ql::datum_t::R_ARRAY) {
+        return false;
+    }
+    latency_histogram_t other;
+    for (size_t i = 0; i < buckets_datum.arr_size(); ++i) {
+        ql::datum_t pair = buckets_datum.get(i);
+        if (pair.get_type() != ql::datum_t::R_ARRAY || pair.arr_size() != 2 ||
+                pair.get(0).get_type() != ql::datum_t::R_NUM ||
+                pair.get(1).get_type() != ql::datum_t::R_NUM) {
+            return false;
+        }
+        double index = pair.get(0).as_num();
+        if (index < 0 || index >= num_buckets) {
+            return false;
+        }
+        uint64_t count = static_cast<uint64_t>(pair.get(1).as_num());
+        other.buckets[static_cast<int>(index)] += count;
+        other.total += count;
+    }
+    if (max_datum.has() && max_datum.get_type() == ql::datum_t::R_NUM) {
+        other.max_usecs = llround(max_datum.as_num() * 1000);
+    }
+    merge(other);
+    return true;
+}
+
+ql::datum_t latency_histogram_t::percentiles_to_datum() const {
+    ql::datum_object_builder_t builder;
+    add_percentiles(*this, max_usecs, &builder);
+    return std::move(builder).to_datum();
+}
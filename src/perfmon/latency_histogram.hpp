@@ -0,0 +1,54 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef PERFMON_LATENCY_HISTOGRAM_HPP_
+#define PERFMON_LATENCY_HISTOGRAM_HPP_
+
+#include <stdint.h>
+
+#include "rdb_protocol/datum.hpp"
+
+/* `latency_histogram_t` counts latencies in log-linear buckets, in the style of
+HdrHistogram. Values below 2^sub_bucket_bits microseconds get a bucket each. Above
+that, every power of two is split into 2^sub_bucket_bits buckets of equal width, so a
+percentile is never off by more than 1/2^sub_bucket_bits of its value. Latencies
+beyond `2^max_exponent` microseconds all go into the last bucket. */
+class latency_histogram_t {
+public:
+    static const int sub_bucket_bits = 3;
+    static const int max_exponent = 32;
+    static const int num_buckets = (max_exponent - sub_bucket_bits + 1)
+        << sub_bucket_bits;
+
+    latency_histogram_t();
+
+    void record(uint64_t usecs);
+    void merge(const latency_histogram_t &other);
+
+    uint64_t count() const { return total; }
+
+    // Returns the latency in microseconds that `fraction` of the recorded latencies
+    // are at or below. Must not be called on an empty histogram.
+    double percentile(double fraction) const;
+
+    // Returns the count, the maximum, the p50, p90, p99 and p999 (all in
+    // milliseconds) and the non-empty buckets. This is what
+    // `perfmon_latency_histogram_t` reports.
+    ql::datum_t to_datum() const;
+
+    // Adds the buckets of a datum returned by `to_datum()`, which may have come from
+    // another server. Returns `false` if the datum is malformed.
+    bool merge_datum(const ql::datum_t &datum);
+
+    // Returns only the percentiles and the maximum, in milliseconds, or nulls if the
+    // histogram is empty. This is what the `stats` table shows.
+    ql::datum_t percentiles_to_datum() const;
+
+private:
+    static int bucket_index(uint64_t usecs);
+    static double bucket_value(int index);
+
+    uint64_t buckets[num_buckets];
+    uint64_t total;
+    uint64_t max_usecs;
+};
+
+#endif  // PERFMON_LATENCY_HISTOGRAM_HPP_
@@ -301,6 +301,71 @@ ql::datum_t perfmon_rate_monitor_t::output_stat(const double &stat) {
     return ql::datum_t(stat / ticks_to_secs(length));
 }
 
+/* perfmon_latency_histogram_t */
+
+perfmon_latency_histogram_t::perfmon_latency_histogram_t(ticks_t _length)
+    : perfmon_perthread_t<latency_histogram_t>(), length(_length) {
+    for (int i = 0; i < MAX_THREADS; i++) {
+        thread_data[i] = NULL;
+    }
+}
+
+perfmon_latency_histogram_t::~perfmon_latency_histogram_t() {
+    for (int i = 0; i < MAX_THREADS; i++) {
+        delete thread_data[i];
+    }
+}
+
+perfmon_latency_histogram_t::thread_info_t *
+perfmon_latency_histogram_t::get_thread_info(ticks_t now) {
+    int interval = now / length;
+    rassert(get_thread_id().threadnum >= 0);
+    thread_info_t *&thread = thread_data[get_thread_id().threadnum];
+
+    if (thread == NULL) {
+        thread = new thread_info_t;
+        thread->current_interval = interval;
+    } else if (thread->current_interval == interval) {
+        /* We're up to date; nothing to do */
+    } else if (thread->current_interval + 1 == interval) {
+        /* We're one step behind */
+        thread->last = thread->current;
+        thread->current = latency_histogram_t();
+        thread->current_interval++;
+    } else {
+        /* We're more than one step behind */
+        thread->last = thread->current = latency_histogram_t();
+        thread->current_interval = interval;
+    }
+    return thread;
+}
+
+void perfmon_latency_histogram_t::record(ticks_t duration) {
+    thread_info_t *thread = get_thread_info(get_ticks());
+    thread->current.record(static_cast<uint64_t>(ticks_to_secs(duration) * 1000000));
+}
+
+void perfmon_latency_histogram_t::get_thread_stat(latency_histogram_t *stat) {
+    rassert(get_thread_id().threadnum >= 0);
+    if (thread_data[get_thread_id().threadnum] != NULL) {
+        /* Like `perfmon_sampler_t`, return the last complete interval. */
+        *stat = get_thread_info(get_ticks())->last;
+    }
+}
+
+latency_histogram_t perfmon_latency_histogram_t::combine_stats(
+        const latency_histogram_t *stats) {
+    latency_histogram_t combined;
+    for (int i = 0; i < get_num_threads(); i++) {
+        combined.merge(stats[i]);
+    }
+    return combined;
+}
+
+ql::datum_t perfmon_latency_histogram_t::output_stat(const latency_histogram_t &stat) {
+    return stat.to_datum();
+}
+
 perfmon_duration_sampler_t::perfmon_duration_sampler_t(ticks_t length, bool _ignore_global_full_perfmon)
     : stat(), active(), total(), recent(length, true),
       active_membership(&stat, &active, "active_count"),
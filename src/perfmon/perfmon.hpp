@@ -18,6 +18,7 @@
 #include "config/args.hpp"
 #include "perfmon/types.hpp"
 #include "perfmon/core.hpp"
+#include "perfmon/latency_histogram.hpp"
 #include "time.hpp"
 
 // Some arch/runtime declarations.
@@ -215,6 +216,33 @@ public:
     void record(double value = 1.0);
 };
 
+/* `perfmon_latency_histogram_t` reports percentiles of a latency, such as the p99,
+ * over the last complete interval of `length` ticks. Unlike `perfmon_sampler_t` it
+ * keeps a whole `latency_histogram_t` per thread, which is why the per-thread
+ * histograms are only allocated on threads that actually record something. Threads
+ * record without any synchronization; the histograms are merged when the stats are
+ * collected.
+ */
+class perfmon_latency_histogram_t : public perfmon_perthread_t<latency_histogram_t> {
+private:
+    struct thread_info_t {
+        latency_histogram_t current, last;
+        int current_interval;
+    };
+
+    thread_info_t *thread_data[MAX_THREADS];
+    thread_info_t *get_thread_info(ticks_t now);
+    ticks_t length;
+
+    void get_thread_stat(latency_histogram_t *);
+    latency_histogram_t combine_stats(const latency_histogram_t *);
+    ql::datum_t output_stat(const latency_histogram_t &);
+public:
+    explicit perfmon_latency_histogram_t(ticks_t length);
+    virtual ~perfmon_latency_histogram_t();
+    void record(ticks_t duration);
+};
+
 /* perfmon_duration_sampler_t is a perfmon_t that monitors events that have a
  * starting and ending time. When something starts, call begin(); when
  * something ends, call end() with the same value as begin. It will produce
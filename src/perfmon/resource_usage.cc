@@ -0,0 +1,64 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "perfmon/resource_usage.hpp"
+
+#include "arch/runtime/coroutines.hpp"
+#include "containers/archive/archive.hpp"
+
+resource_usage_t::resource_usage_t()
+    : rows_scanned(0),
+      blocks_from_cache(0),
+      blocks_from_disk(0),
+      bytes_sent(0),
+      cpu_time(0),
+      lock_wait_time(0) { }
+
+void resource_usage_t::add(const resource_usage_t &other) {
+    rows_scanned += other.rows_scanned;
+    blocks_from_cache += other.blocks_from_cache;
+    blocks_from_disk += other.blocks_from_disk;
+    bytes_sent += other.bytes_sent;
+    cpu_time += other.cpu_time;
+    lock_wait_time += other.lock_wait_time;
+}
+
+resource_usage_t *resource_usage_t::current() {
+    coro_t *self = coro_t::self();
+    return self == NULL ? NULL : self->get_resource_usage();
+}
+
+ql::datum_t resource_usage_t::to_datum() const {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("rows_scanned", ql::datum_t(static_cast<double>(rows_scanned)));
+    builder.overwrite("blocks_from_cache",
+                      ql::datum_t(static_cast<double>(blocks_from_cache)));
+    builder.overwrite("blocks_from_disk",
+                      ql::datum_t(static_cast<double>(blocks_from_disk)));
+    builder.overwrite("bytes_sent", ql::datum_t(static_cast<double>(bytes_sent)));
+    builder.overwrite("cpu_time_ms", ql::datum_t(ticks_to_secs(cpu_time) * 1000));
+    builder.overwrite("lock_wait_ms", ql::datum_t(ticks_to_secs(lock_wait_time) * 1000));
+    return std::move(builder).to_datum();
+}
+
+RDB_IMPL_SERIALIZABLE_6_FOR_CLUSTER(resource_usage_t,
+                                    rows_scanned,
+                                    blocks_from_cache,
+                                    blocks_from_disk,
+                                    bytes_sent,
+                                    cpu_time,
+                                    lock_wait_time);
+
+resource_usage_scope_t::resource_usage_scope_t(resource_usage_t *usage) {
+    coro_t *self = coro_t::self();
+    guarantee(self != NULL, "resource_usage_scope_t used outside of a coroutine");
+    self->charge_cpu_time();
+    previous = self->resource_usage;
+    self->resource_usage = usage;
+    self->resource_usage_since = get_ticks();
+}
+
+resource_usage_scope_t::~resource_usage_scope_t() {
+    coro_t *self = coro_t::self();
+    self->charge_cpu_time();
+    self->resource_usage = previous;
+    self->resource_usage_since = get_ticks();
+}
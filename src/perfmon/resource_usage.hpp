@@ -0,0 +1,92 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef PERFMON_RESOURCE_USAGE_HPP_
+#define PERFMON_RESOURCE_USAGE_HPP_
+
+#include <stdint.h>
+
+#include "rdb_protocol/datum.hpp"
+#include "rpc/serialize_macros.hpp"
+#include "time.hpp"
+
+/* `resource_usage_t` adds up what a query costs, so that the `jobs` table can show
+which queries are expensive without anybody having to turn on profiling.
+
+The counters are charged to whichever coroutine does the work. A
+`resource_usage_scope_t` attaches a `resource_usage_t` to the current coroutine, and
+code that does work on the query's behalf finds it with `current()`, which returns
+`NULL` outside of any scope. The coroutine also charges its CPU time to it every time
+it yields. A `resource_usage_t` is only touched by the coroutine it is attached to, so
+it needs no synchronization.
+
+The work that a query does on a shard happens in another coroutine, possibly on
+another server. `store_t` gives that coroutine a scope of its own and sends the
+counters back in the read or write response, and the query adds them to its own with
+`add_to_current()`. */
+class resource_usage_t {
+public:
+    resource_usage_t();
+
+    void add(const resource_usage_t &other);
+
+    // Returns the counters of the current coroutine, or `NULL`.
+    static resource_usage_t *current();
+
+    static void add_to_current(const resource_usage_t &other) {
+        resource_usage_t *usage = current();
+        if (usage != NULL) {
+            usage->add(other);
+        }
+    }
+
+    static void note_rows_scanned(uint64_t count) {
+        resource_usage_t *usage = current();
+        if (usage != NULL) {
+            usage->rows_scanned += count;
+        }
+    }
+
+    static void note_block_read(bool from_cache) {
+        resource_usage_t *usage = current();
+        if (usage != NULL) {
+            if (from_cache) {
+                ++usage->blocks_from_cache;
+            } else {
+                ++usage->blocks_from_disk;
+            }
+        }
+    }
+
+    static void note_lock_wait(ticks_t duration) {
+        resource_usage_t *usage = current();
+        if (usage != NULL) {
+            usage->lock_wait_time += duration;
+        }
+    }
+
+    // Times are in milliseconds.
+    ql::datum_t to_datum() const;
+
+    uint64_t rows_scanned;
+    uint64_t blocks_from_cache;
+    uint64_t blocks_from_disk;
+    uint64_t bytes_sent;
+    ticks_t cpu_time;
+    ticks_t lock_wait_time;
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(resource_usage_t);
+
+/* Charges the work of the current coroutine to `usage` for the lifetime of the
+`resource_usage_scope_t`. Scopes nest; the enclosing scope's counters are not charged
+for the work done in the inner one. */
+class resource_usage_scope_t {
+public:
+    explicit resource_usage_scope_t(resource_usage_t *usage);
+    ~resource_usage_scope_t();
+
+private:
+    resource_usage_t *previous;
+
+    DISABLE_COPYING(resource_usage_scope_t);
+};
+
+#endif  // PERFMON_RESOURCE_USAGE_HPP_
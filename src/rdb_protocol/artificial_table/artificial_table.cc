@@ -55,6 +55,23 @@ ql::datum_t artificial_table_t::read_row(ql::env_t *env,
     return row;
 }
 
+std::vector<ql::datum_t> artificial_table_t::read_rows(ql::env_t *env,
+        const std::vector<ql::datum_t> &pvals, UNUSED bool use_outdated) {
+    std::vector<ql::datum_t> rows;
+    for (const ql::datum_t &pval : pvals) {
+        ql::datum_t row;
+        std::string error;
+        if (!checked_read_row_from_backend(
+                backend, pval, env->interruptor, &row, &error)) {
+            throw ql::datum_exc_t(ql::base_exc_t::GENERIC, error);
+        }
+        if (row.has()) {
+            rows.push_back(row);
+        }
+    }
+    return rows;
+}
+
 counted_t<ql::datum_stream_t> artificial_table_t::read_all(
         ql::env_t *env,
         const std::string &get_all_sindex_id,
@@ -82,9 +99,12 @@ counted_t<ql::datum_stream_t> artificial_table_t::read_changes(
         ql::env_t *env,
         const ql::datum_t &,
         bool include_states,
+        const ql::changefeed::resume_t &resume,
         ql::changefeed::keyspec_t::spec_t &&spec,
         const ql::protob_t<const Backtrace> &bt,
         UNUSED const std::string &table_name) {
+    rcheck_datum(!resume.since && !resume.include_token, ql::base_exc_t::GENERIC,
+                 "System tables don't support resuming changefeeds.");
     counted_t<ql::datum_stream_t> stream;
     std::string error;
     if (!backend->read_changes(
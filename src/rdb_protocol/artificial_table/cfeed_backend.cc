@@ -16,6 +16,7 @@ void cfeed_artificial_table_backend_t::machinery_t::send_all_change(
     change.pkey = key;
     change.old_val = old_val;
     change.new_val = new_val;
+    change.log_seq = 0;
     send_all(ql::changefeed::msg_t(change));
 }
 
@@ -55,20 +56,24 @@ bool cfeed_artificial_table_backend_t::read_changes(
     std::string *error_out) {
 
     guarantee(!begin_destruction_was_called);
-    class visitor_t : public boost::static_visitor<bool> {
+    class visitor_t : public boost::static_visitor<const char *> {
     public:
-        bool operator()(const ql::changefeed::keyspec_t::limit_t &) const {
-            return false;
+        const char *operator()(const ql::changefeed::keyspec_t::limit_t &) const {
+            return "System tables don't support changefeeds on `.limit()`.";
         }
-        bool operator()(const ql::changefeed::keyspec_t::range_t &) const {
-            return true;
+        const char *operator()(const ql::changefeed::keyspec_t::range_t &) const {
+            return NULL;
         }
-        bool operator()(const ql::changefeed::keyspec_t::point_t &) const {
-            return true;
+        const char *operator()(const ql::changefeed::keyspec_t::point_t &) const {
+            return NULL;
+        }
+        const char *operator()(
+                const ql::changefeed::keyspec_t::aggregate_t &) const {
+            return "System tables don't support changefeeds on aggregates.";
         }
     };
-    if (!boost::apply_visitor(visitor_t(), spec)) {
-        *error_out = "System tables don't support changefeeds on `.limit()`.";
+    if (const char *error = boost::apply_visitor(visitor_t(), spec)) {
+        *error_out = error;
         return false;
     }
     threadnum_t request_thread = get_thread_id();
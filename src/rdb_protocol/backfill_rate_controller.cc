@@ -0,0 +1,82 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "rdb_protocol/backfill_rate_controller.hpp"
+
+#include <algorithm>
+
+#include "arch/io/disk.hpp"
+#include "arch/timing.hpp"
+#include "concurrency/wait_any.hpp"
+#include "config/args.hpp"
+
+backfill_rate_controller_t::backfill_rate_controller_t(io_backender_t *_io_backender)
+    : io_backender(_io_backender),
+      rate(BACKFILL_MIN_BANDWIDTH),
+      next_chunk_time(get_ticks()),
+      last_adjustment_time(get_ticks()),
+      foreground_duration_sum(0),
+      foreground_op_count(0) { }
+
+void backfill_rate_controller_t::note_foreground_op(ticks_t duration) {
+    assert_thread();
+    foreground_duration_sum += duration;
+    ++foreground_op_count;
+    maybe_adjust_rate(get_ticks());
+}
+
+void backfill_rate_controller_t::throttle(signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    assert_thread();
+    // Warning: No re-ordering is allowed during throttling! We only sleep while
+    // holding `throttle_mutex`, and wait for it lazily so that the previous chunk
+    // gets to continue before we do.
+    new_mutex_in_line_t mutex_acq(&throttle_mutex);
+    wait_any_t waiter(mutex_acq.acq_signal(), interruptor);
+    waiter.wait_lazily_ordered();
+    if (interruptor->is_pulsed()) {
+        throw interrupted_exc_t();
+    }
+
+    ticks_t now = get_ticks();
+    maybe_adjust_rate(now);
+    if (next_chunk_time > now) {
+        nap((next_chunk_time - now + MILLION - 1) / MILLION, interruptor);
+    }
+}
+
+void backfill_rate_controller_t::note_backfill_bytes(size_t bytes) {
+    assert_thread();
+    ticks_t now = get_ticks();
+    maybe_adjust_rate(now);
+    next_chunk_time = std::max(next_chunk_time, now)
+        + static_cast<ticks_t>(bytes * static_cast<double>(BILLION) / rate);
+}
+
+void backfill_rate_controller_t::maybe_adjust_rate(ticks_t now) {
+    if (now < last_adjustment_time + BACKFILL_RATE_ADJUST_INTERVAL_MS * MILLION) {
+        return;
+    }
+
+    bool overloaded = false;
+    if (foreground_op_count > 0
+        && foreground_duration_sum / foreground_op_count
+           > static_cast<ticks_t>(BACKFILL_TARGET_FOREGROUND_LATENCY_MS * MILLION)) {
+        overloaded = true;
+    }
+    if (io_backender != NULL
+        && io_backender->get_queue_depth() > BACKFILL_TARGET_DISK_QUEUE_DEPTH) {
+        overloaded = true;
+    }
+
+    if (overloaded) {
+        rate = std::max<double>(rate / 2, BACKFILL_MIN_BANDWIDTH);
+    } else {
+        rate = std::min<double>(
+            rate + (BACKFILL_MAX_BANDWIDTH - BACKFILL_MIN_BANDWIDTH)
+                / static_cast<double>(BACKFILL_RATE_INCREASE_STEPS),
+            BACKFILL_MAX_BANDWIDTH);
+    }
+
+    last_adjustment_time = now;
+    foreground_duration_sum = 0;
+    foreground_op_count = 0;
+}
@@ -0,0 +1,57 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_BACKFILL_RATE_CONTROLLER_HPP_
+#define RDB_PROTOCOL_BACKFILL_RATE_CONTROLLER_HPP_
+
+#include "concurrency/new_mutex.hpp"
+#include "threading.hpp"
+#include "time.hpp"
+
+class io_backender_t;
+class signal_t;
+
+/* `backfill_rate_controller_t` limits the rate at which a store applies the
+backfill chunks it receives. The rate lies between `BACKFILL_MIN_BANDWIDTH` and
+`BACKFILL_MAX_BANDWIDTH` bytes per second. Every `BACKFILL_RATE_ADJUST_INTERVAL_MS`
+it is halved if the store's foreground reads and writes got slow or the disk queue
+got long, and increased by a fixed step otherwise. So backfills run at full speed
+while the server is idle, and back off quickly when they start to hurt user
+traffic. */
+class backfill_rate_controller_t : public home_thread_mixin_debug_only_t {
+public:
+    /* `io_backender` may be `NULL`, in which case the disk queue is ignored. */
+    explicit backfill_rate_controller_t(io_backender_t *io_backender);
+
+    /* Records how long a foreground read or write took. */
+    void note_foreground_op(ticks_t duration);
+
+    /* Blocks until the next backfill chunk may be applied, according to the bytes
+    of the chunks before it. Callers are let through in the order in which they
+    called this. */
+    void throttle(signal_t *interruptor) THROWS_ONLY(interrupted_exc_t);
+
+    /* Records the size of a backfill chunk that has been applied. */
+    void note_backfill_bytes(size_t bytes);
+
+    /* The current rate in bytes per second */
+    double get_rate() const { return rate; }
+
+private:
+    void maybe_adjust_rate(ticks_t now);
+
+    io_backender_t *const io_backender;
+
+    double rate;
+
+    /* The time at which the next chunk may be applied */
+    ticks_t next_chunk_time;
+
+    ticks_t last_adjustment_time;
+    ticks_t foreground_duration_sum;
+    int64_t foreground_op_count;
+
+    new_mutex_t throttle_mutex;
+
+    DISABLE_COPYING(backfill_rate_controller_t);
+};
+
+#endif  // RDB_PROTOCOL_BACKFILL_RATE_CONTROLLER_HPP_
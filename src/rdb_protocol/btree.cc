@@ -1,6 +1,7 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/btree.hpp"
 
+#include <algorithm>
 #include <functional>
 #include <iterator>
 #include <set>
@@ -12,18 +13,25 @@
 
 #include "btree/backfill.hpp"
 #include "btree/concurrent_traversal.hpp"
+#include "btree/depth_first_traversal.hpp"
 #include "btree/get_distribution.hpp"
 #include "btree/operations.hpp"
 #include "btree/parallel_traversal.hpp"
 #include "btree/reql_specific.hpp"
 #include "btree/superblock.hpp"
 #include "buffer_cache/serialize_onto_blob.hpp"
+#include "config/args.hpp"
 #include "concurrency/coro_pool.hpp"
+#include "concurrency/wait_any.hpp"
 #include "concurrency/queue/unlimited_fifo.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/buffer_group_stream.hpp"
 #include "containers/archive/buffer_stream.hpp"
+#include "containers/archive/stl_types.hpp"
+#include "containers/disk_backed_queue.hpp"
 #include "containers/scoped.hpp"
+#include "containers/uuid.hpp"
+#include "perfmon/resource_usage.hpp"
 #include "rdb_protocol/geo/exceptions.hpp"
 #include "rdb_protocol/geo/indexing.hpp"
 #include "rdb_protocol/blob_wrapper.hpp"
@@ -34,6 +42,7 @@
 #include "rdb_protocol/serialize_datum_onto_blob.hpp"
 #include "rdb_protocol/shards.hpp"
 #include "rdb_protocol/table_common.hpp"
+#include "time.hpp"
 
 #include "debug.hpp"
 
@@ -106,6 +115,32 @@ void rdb_get(const store_key_t &store_key, btree_slice_t *slice,
     }
 }
 
+class rdb_get_multi_callback_t : public keyvalue_locations_read_callback_t {
+public:
+    explicit rdb_get_multi_callback_t(point_multi_read_response_t *_response)
+        : response(_response) { }
+    void on_value(UNUSED size_t key_index, const void *value, buf_parent_t leaf) {
+        response->data.push_back(
+            get_data(static_cast<const rdb_value_t *>(value), leaf));
+    }
+private:
+    point_multi_read_response_t *response;
+};
+
+void rdb_get_multi(const std::vector<store_key_t> &keys, btree_slice_t *slice,
+                   superblock_t *superblock, point_multi_read_response_t *response,
+                   profile::trace_t *trace) {
+    std::vector<const btree_key_t *> btree_keys;
+    btree_keys.reserve(keys.size());
+    for (const store_key_t &key : keys) {
+        btree_keys.push_back(key.btree_key());
+    }
+    rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
+    rdb_get_multi_callback_t callback(response);
+    find_keyvalue_locations_for_read(&sizer, superblock, btree_keys, &callback,
+                                     &slice->stats, trace);
+}
+
 void kv_location_delete(keyvalue_location_t *kv_location,
                         const store_key_t &key,
                         repli_timestamp_t timestamp,
@@ -419,6 +454,9 @@ batched_replace_response_t rdb_batched_replace(
                                             // we don't need to finish.
             }
         }
+        // The secondary index changes of the whole batch are written in one
+        // ordered pass per index.
+        sindex_cb->apply_sindex_updates();
         // This needs to happen after draining.
         if (update_pkey_cfeeds) {
             guarantee(current_superblock.has());
@@ -522,6 +560,7 @@ public:
                 // with the remaining values.
                 slice_->stats.pm_keys_read.record(chunk_atoms.size());
                 slice_->stats.pm_total_keys_read += chunk_atoms.size();
+                resource_usage_t::note_rows_scanned(chunk_atoms.size());
                 cb_->on_keyvalues(std::move(chunk_atoms), interruptor);
                 chunk_atoms = std::vector<backfill_atom_t>();
                 chunk_atoms.reserve(keys.size() - (i+1));
@@ -532,6 +571,7 @@ public:
             // Pass on the final chunk
             slice_->stats.pm_keys_read.record(chunk_atoms.size());
             slice_->stats.pm_total_keys_read += chunk_atoms.size();
+            resource_usage_t::note_rows_scanned(chunk_atoms.size());
             cb_->on_keyvalues(std::move(chunk_atoms), interruptor);
         }
     }
@@ -557,6 +597,132 @@ void rdb_backfill(btree_slice_t *slice, const key_range_t& key_range,
                                superblock, sindex_block, p, interruptor);
 }
 
+// FNV-1a, finished with the mixing step of splitmix64 so that the sum of many row
+// hashes doesn't cancel out in the low bits.
+uint64_t hash_bytes(uint64_t h, const void *data, size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+uint64_t finish_hash(uint64_t h) {
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+class range_hash_helper_t : public depth_first_traversal_callback_t {
+public:
+    range_hash_helper_t(max_block_size_t block_size,
+                        const region_t *region,
+                        size_t max_split_keys,
+                        range_hash_t *result,
+                        signal_t *interruptor)
+        : block_size_(block_size), region_(region), max_split_keys_(max_split_keys),
+          split_step_(1), result_(result), interruptor_(interruptor) { }
+
+    done_traversing_t handle_pair(scoped_key_value_t &&keyvalue) {
+        if (interruptor_->is_pulsed()) {
+            return done_traversing_t::YES;
+        }
+        store_key_t key(keyvalue.key());
+        if (!region_contains_key(*region_, key)) {
+            return done_traversing_t::NO;
+        }
+
+        // We hash the serialized document as it is stored in the row's blob, so
+        // we don't have to deserialize it. The key and the value are each preceded
+        // by their length, so that moving bytes across the boundary between them
+        // changes the hash.
+        const uint64_t key_size = key.size();
+        uint64_t h = hash_bytes(0xcbf29ce484222325ULL, &key_size, sizeof(key_size));
+        h = hash_bytes(h, key.contents(), key.size());
+        const rdb_value_t *value = static_cast<const rdb_value_t *>(keyvalue.value());
+        rdb_blob_wrapper_t blob(block_size_,
+                                const_cast<rdb_value_t *>(value)->value_ref(),
+                                blob::btree_maxreflen);
+        blob_acq_t acq_group;
+        buffer_group_t buffer_group;
+        blob.expose_all(keyvalue.expose_buf(), access_t::read,
+                        &buffer_group, &acq_group);
+        const uint64_t value_size = buffer_group.get_size();
+        h = hash_bytes(h, &value_size, sizeof(value_size));
+        for (size_t i = 0; i < buffer_group.num_buffers(); ++i) {
+            buffer_group_t::buffer_t buffer = buffer_group.get_buffer(i);
+            h = hash_bytes(h, buffer.data, buffer.size);
+        }
+        result_->hash += finish_hash(h);
+        ++result_->num_pairs;
+
+        // We don't know the number of pairs in advance, so we take every
+        // `split_step_`th key after the first one and double the step whenever we
+        // have collected twice as many keys as we need.
+        if (max_split_keys_ > 0 && result_->num_pairs > 1
+            && (result_->num_pairs - 1) % split_step_ == 0) {
+            result_->split_keys.push_back(key);
+            if (result_->split_keys.size() >= 2 * max_split_keys_) {
+                std::vector<store_key_t> thinned;
+                thinned.reserve(max_split_keys_);
+                for (size_t i = 1; i < result_->split_keys.size(); i += 2) {
+                    thinned.push_back(std::move(result_->split_keys[i]));
+                }
+                result_->split_keys = std::move(thinned);
+                split_step_ *= 2;
+            }
+        }
+        return done_traversing_t::NO;
+    }
+
+    void finish() {
+        std::vector<store_key_t> *keys = &result_->split_keys;
+        if (keys->size() > max_split_keys_) {
+            std::vector<store_key_t> evenly_spaced;
+            evenly_spaced.reserve(max_split_keys_);
+            for (size_t i = 0; i < max_split_keys_; ++i) {
+                evenly_spaced.push_back(
+                    (*keys)[(i + 1) * keys->size() / (max_split_keys_ + 1)]);
+            }
+            *keys = std::move(evenly_spaced);
+        }
+    }
+
+private:
+    max_block_size_t block_size_;
+    const region_t *region_;
+    size_t max_split_keys_;
+    uint64_t split_step_;
+    range_hash_t *result_;
+    signal_t *interruptor_;
+
+    DISABLE_COPYING(range_hash_helper_t);
+};
+
+void rdb_get_range_hashes(superblock_t *superblock,
+                          const std::vector<region_t> &regions,
+                          size_t max_split_keys,
+                          std::vector<range_hash_t> *hashes_out,
+                          signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t) {
+    hashes_out->clear();
+    hashes_out->resize(regions.size());
+    for (size_t i = 0; i < regions.size(); ++i) {
+        rassert(i == 0 || regions[i - 1].inner.right <=
+                key_range_t::right_bound_t(regions[i].inner.left));
+        range_hash_helper_t helper(superblock->cache()->max_block_size(),
+                                   &regions[i], max_split_keys,
+                                   &(*hashes_out)[i], interruptor);
+        btree_depth_first_traversal(superblock, regions[i].inner, &helper,
+                                    direction_t::FORWARD, release_superblock_t::KEEP);
+        if (interruptor->is_pulsed()) {
+            throw interrupted_exc_t();
+        }
+        helper.finish();
+    }
+}
+
 void rdb_delete(const store_key_t &key, btree_slice_t *slice,
                 repli_timestamp_t timestamp,
                 real_superblock_t *superblock,
@@ -647,12 +813,14 @@ private:
 
 class rget_io_data_t {
 public:
-    rget_io_data_t(rget_read_response_t *_response, btree_slice_t *_slice)
-        : response(_response), slice(_slice) { }
+    rget_io_data_t(rget_read_response_t *_response, btree_slice_t *_slice,
+                   key_access_histogram_t *_access_histogram = NULL)
+        : response(_response), slice(_slice), access_histogram(_access_histogram) { }
 private:
     friend class rget_cb_t;
     rget_read_response_t *const response;
     btree_slice_t *const slice;
+    key_access_histogram_t *const access_histogram;
 };
 
 class rget_cb_t : public concurrent_traversal_callback_t {
@@ -674,6 +842,8 @@ private:
 
     // State for internal bookkeeping.
     bool bad_init;
+    /* The rows scanned since the last one we recorded in `io.access_histogram`. */
+    int rows_since_access_recorded;
     scoped_ptr_t<profile::disabler_t> disabler;
     scoped_ptr_t<profile::sampler_t> sampler;
 };
@@ -685,7 +855,8 @@ rget_cb_t::rget_cb_t(rget_io_data_t &&_io,
     : io(std::move(_io)),
       job(std::move(_job)),
       sindex(std::move(_sindex)),
-      bad_init(false) {
+      bad_init(false),
+      rows_since_access_recorded(0) {
     io.response->last_key = !reversed(job.sorting)
         ? range.left
         : (!range.right.unbounded ? range.right.key : store_key_t::max());
@@ -695,6 +866,10 @@ rget_cb_t::rget_cb_t(rget_io_data_t &&_io,
 }
 
 void rget_cb_t::finish() THROWS_ONLY(interrupted_exc_t) {
+    if (io.access_histogram != NULL && rows_since_access_recorded > 0) {
+        io.access_histogram->record(io.response->last_key,
+                                    rows_since_access_recorded);
+    }
     job.accumulator->finish(&io.response->result);
     if (job.accumulator->should_send_batch()) {
         io.response->truncated = true;
@@ -726,6 +901,7 @@ done_traversing_t rget_cb_t::handle_pair(
         val = row.get();
         io.slice->stats.pm_keys_read.record();
         io.slice->stats.pm_total_keys_read += 1;
+        resource_usage_t::note_rows_scanned(1);
     } else {
         row.reset();
     }
@@ -740,6 +916,14 @@ done_traversing_t rget_cb_t::handle_pair(
             io.response->last_key = key;
         }
 
+        // Every `KEY_ACCESS_RANGE_SAMPLE_ROWS`th row stands for the rows before it,
+        // so a range read weighs on the histogram where its rows actually are.
+        if (io.access_histogram != NULL
+            && ++rows_since_access_recorded == KEY_ACCESS_RANGE_SAMPLE_ROWS) {
+            io.access_histogram->record(key, rows_since_access_recorded);
+            rows_since_access_recorded = 0;
+        }
+
         // Check whether we're out of sindex range.
         ql::datum_t sindex_val; // NULL if no sindex.
         if (sindex) {
@@ -799,12 +983,13 @@ void rdb_rget_slice(
         const boost::optional<terminal_variant_t> &terminal,
         sorting_t sorting,
         rget_read_response_t *response,
-        release_superblock_t release_superblock) {
+        release_superblock_t release_superblock,
+        key_access_histogram_t *access_histogram) {
 
     r_sanity_check(boost::get<ql::exc_t>(&response->result) == NULL);
     profile::starter_t starter("Do range scan on primary index.", ql_env->trace);
     rget_cb_t callback(
-        rget_io_data_t(response, slice),
+        rget_io_data_t(response, slice, access_histogram),
         job_data_t(ql_env, batchspec, transforms, terminal, sorting),
         boost::optional<rget_sindex_data_t>(),
         range);
@@ -1046,6 +1231,15 @@ void rdb_modification_report_cb_t::finish(
         });
 }
 
+void rdb_modification_report_cb_t::apply_sindex_updates() {
+    rdb_live_deletion_context_t deletion_context;
+    rdb_apply_sindex_update_batch(store_,
+                                  sindexes_,
+                                  &sindex_batch_,
+                                  sindex_block_->txn(),
+                                  &deletion_context);
+}
+
 scoped_ptr_t<new_mutex_in_line_t> rdb_modification_report_cb_t::get_in_line() {
     return store_->get_in_line_for_sindex_queue(sindex_block_);
 }
@@ -1056,7 +1250,10 @@ void rdb_modification_report_cb_t::on_mod_report(
     new_mutex_in_line_t *spot) {
     if (report.info.deleted.first.has() || report.info.added.first.has()) {
         // We spawn the sindex update in its own coroutine because we don't want to
-        // hold the sindex update for the changefeed update or vice-versa.
+        // hold the sindex update for the changefeed update or vice-versa. This
+        // happens for every row that's written. The coroutine only queues the
+        // change and waits for `rdb_update_sindexes`, which evaluates the index
+        // functions in coroutines of their own, so a medium-sized stack is enough.
         cond_t sindexes_updated_cond, keys_available_cond;
         std::map<std::string, std::vector<ql::datum_t> > old_keys, new_keys;
         spot->acq_signal()->wait_lazily_unordered();
@@ -1068,7 +1265,8 @@ void rdb_modification_report_cb_t::on_mod_report(
                       &keys_available_cond,
                       &sindexes_updated_cond,
                       &old_keys,
-                      &new_keys));
+                      &new_keys),
+            coro_stack_class_t::MEDIUM);
         guarantee(store_->changefeed_server.has());
         if (update_pkey_cfeeds) {
             store_->changefeed_server->foreach_limit(
@@ -1102,7 +1300,9 @@ void rdb_modification_report_cb_t::on_mod_report(
                     new_keys,
                     report.primary_key,
                     report.info.deleted.first,
-                    report.info.added.first}),
+                    report.info.added.first,
+                    // `send_all` sets the change log sequence number.
+                    0}),
             report.primary_key);
         sindexes_updated_cond.wait_lazily_unordered();
     }
@@ -1122,6 +1322,7 @@ void rdb_modification_report_cb_t::on_mod_report_sub(
                         &mod_report,
                         sindex_block_->txn(),
                         &deletion_context,
+                        &sindex_batch_,
                         keys_available_cond,
                         old_keys_out,
                         new_keys_out);
@@ -1271,7 +1472,8 @@ void deserialize_sindex_info(const std::vector<char> &data,
     case cluster_version_t::v1_14:
     case cluster_version_t::v1_15:
     case cluster_version_t::v1_16:
-    case cluster_version_t::v2_0_is_latest:
+    case cluster_version_t::v2_0:
+    case cluster_version_t::v2_1_is_latest:
         success = deserialize_for_version(
                 cluster_version,
                 &read_stream,
@@ -1310,12 +1512,79 @@ void deserialize_sindex_info(const std::vector<char> &data,
               "An sindex description was incompletely deserialized.");
 }
 
-/* Used below by rdb_update_sindexes. */
+void sindex_delete_key(const store_t::sindex_access_t *sindex,
+                       const store_key_t &key,
+                       const deletion_context_t *deletion_context,
+                       profile::trace_t *trace) {
+    sindex_superblock_t *superblock = sindex->superblock.get();
+    promise_t<superblock_t *> return_superblock_local;
+    {
+        keyvalue_location_t kv_location;
+        rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
+
+        find_keyvalue_location_for_write(
+            &sizer,
+            superblock,
+            key.btree_key(),
+            deletion_context->balancing_detacher(),
+            &kv_location,
+            &sindex->btree->stats,
+            trace,
+            &return_superblock_local);
+
+        if (kv_location.value.has()) {
+            kv_location_delete(
+                &kv_location,
+                key,
+                repli_timestamp_t::distant_past,
+                deletion_context,
+                NULL);
+        }
+        // The keyvalue location gets destroyed here.
+    }
+    return_superblock_local.wait();
+}
+
+void sindex_set_key(const store_t::sindex_access_t *sindex,
+                    const store_key_t &key,
+                    const std::vector<char> &value_ref,
+                    const deletion_context_t *deletion_context,
+                    profile::trace_t *trace) {
+    sindex_superblock_t *superblock = sindex->superblock.get();
+    promise_t<superblock_t *> return_superblock_local;
+    {
+        keyvalue_location_t kv_location;
+        rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
+
+        find_keyvalue_location_for_write(
+            &sizer,
+            superblock,
+            key.btree_key(),
+            deletion_context->balancing_detacher(),
+            &kv_location,
+            &sindex->btree->stats,
+            trace,
+            &return_superblock_local);
+
+        ql::serialization_result_t res =
+            kv_location_set(&kv_location, key, value_ref,
+                            repli_timestamp_t::distant_past,
+                            deletion_context);
+        // this particular context cannot fail AT THE MOMENT.
+        guarantee(!bad(res));
+        // The keyvalue location gets destroyed here.
+    }
+    return_superblock_local.wait();
+}
+
+/* Used below by rdb_update_sindexes. If `batch_ops` is not NULL, the changes to
+the sindex tree are appended to it instead of being written. */
 void rdb_update_single_sindex(
         store_t *store,
         const store_t::sindex_access_t *sindex,
         const deletion_context_t *deletion_context,
         const rdb_modification_report_t *modification,
+        std::vector<sindex_update_batch_t::op_t> *batch_ops,
         size_t *updates_left,
         auto_drainer_t::lock_t,
         cond_t *keys_available_cond,
@@ -1373,33 +1642,12 @@ void rdb_update_single_sindex(
                     });
             }
             for (auto it = keys.begin(); it != keys.end(); ++it) {
-                promise_t<superblock_t *> return_superblock_local;
-                {
-                    keyvalue_location_t kv_location;
-                    rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
-
-                    find_keyvalue_location_for_write(
-                        &sizer,
-                        superblock,
-                        it->first.btree_key(),
-                        deletion_context->balancing_detacher(),
-                        &kv_location,
-                        &sindex->btree->stats,
-                        trace,
-                        &return_superblock_local);
-
-                    if (kv_location.value.has()) {
-                        kv_location_delete(
-                            &kv_location,
-                            it->first,
-                            repli_timestamp_t::distant_past,
-                            deletion_context,
-                            NULL);
-                    }
-                    // The keyvalue location gets destroyed here.
+                if (batch_ops != NULL) {
+                    batch_ops->push_back(sindex_update_batch_t::op_t{
+                        it->first, std::vector<char>(), true});
+                } else {
+                    sindex_delete_key(sindex, it->first, deletion_context, trace);
                 }
-                superblock =
-                    static_cast<sindex_superblock_t *>(return_superblock_local.wait());
             }
         } catch (const ql::base_exc_t &) {
             // Do nothing (it wasn't actually in the index).
@@ -1450,32 +1698,13 @@ void rdb_update_single_sindex(
                     });
             }
             for (auto it = keys.begin(); it != keys.end(); ++it) {
-                promise_t<superblock_t *> return_superblock_local;
-                {
-                    keyvalue_location_t kv_location;
-
-                    rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
-                    find_keyvalue_location_for_write(
-                        &sizer,
-                        superblock,
-                        it->first.btree_key(),
-                        deletion_context->balancing_detacher(),
-                        &kv_location,
-                        &sindex->btree->stats,
-                        trace,
-                        &return_superblock_local);
-
-                    ql::serialization_result_t res =
-                        kv_location_set(&kv_location, it->first,
-                                        modification->info.added.second,
-                                        repli_timestamp_t::distant_past,
-                                        deletion_context);
-                    // this particular context cannot fail AT THE MOMENT.
-                    guarantee(!bad(res));
-                    // The keyvalue location gets destroyed here.
+                if (batch_ops != NULL) {
+                    batch_ops->push_back(sindex_update_batch_t::op_t{
+                        it->first, modification->info.added.second, false});
+                } else {
+                    sindex_set_key(sindex, it->first, modification->info.added.second,
+                                   deletion_context, trace);
                 }
-                superblock = static_cast<sindex_superblock_t *>(
-                    return_superblock_local.wait());
             }
         } catch (const ql::base_exc_t &) {
             // Do nothing (we just drop the row from the index).
@@ -1504,7 +1733,9 @@ void rdb_update_single_sindex(
         }
     }
 
-    if (server != NULL) {
+    // With a batch, the limit managers are committed once the batch has been
+    // written (see `rdb_apply_sindex_update_batch`).
+    if (server != NULL && batch_ops == NULL) {
         server->foreach_limit(
             sindex->name.name,
             &modification->primary_key,
@@ -1526,6 +1757,7 @@ void rdb_update_sindexes(
     const rdb_modification_report_t *modification,
     txn_t *txn,
     const deletion_context_t *deletion_context,
+    sindex_update_batch_t *batch,
     cond_t *keys_available_cond,
     std::map<std::string, std::vector<ql::datum_t> > *old_keys_out,
     std::map<std::string, std::vector<ql::datum_t> > *new_keys_out) {
@@ -1544,6 +1776,7 @@ void rdb_update_sindexes(
                     sindex.get(),
                     deletion_context,
                     modification,
+                    batch == NULL ? NULL : &batch->ops[sindex->sindex.id],
                     &counter,
                     auto_drainer_t::lock_t(&drainer),
                     keys_available_cond,
@@ -1559,128 +1792,407 @@ void rdb_update_sindexes(
     /* All of the sindex have been updated now it's time to actually clear the
      * deleted blob if it exists. */
     if (modification->info.deleted.first.has()) {
+        if (batch != NULL) {
+            batch->deleted_values.push_back(modification->info.deleted.second);
+        } else {
+            deletion_context->post_deleter()->delete_value(buf_parent_t(txn),
+                    modification->info.deleted.second.data());
+        }
+    }
+}
+
+void apply_single_sindex_batch(
+        store_t *store,
+        const store_t::sindex_access_t *sindex,
+        std::vector<sindex_update_batch_t::op_t> *ops,
+        const deletion_context_t *deletion_context,
+        auto_drainer_t::lock_t) THROWS_NOTHING {
+    // The stable sort keeps multiple changes to the same key in their original
+    // order.
+    std::stable_sort(ops->begin(), ops->end(),
+                     [](const sindex_update_batch_t::op_t &a,
+                        const sindex_update_batch_t::op_t &b) {
+                         return a.key < b.key;
+                     });
+    for (const auto &op : *ops) {
+        if (op.is_deletion) {
+            sindex_delete_key(sindex, op.key, deletion_context, NULL);
+        } else {
+            sindex_set_key(sindex, op.key, op.value_ref, deletion_context, NULL);
+        }
+    }
+
+    if (store->changefeed_server.has()) {
+        sindex_disk_info_t sindex_info;
+        try {
+            deserialize_sindex_info(sindex->sindex.opaque_definition, &sindex_info);
+        } catch (const archive_exc_t &e) {
+            crash("%s", e.what());
+        }
+        store->changefeed_server->foreach_limit(
+            sindex->name.name,
+            nullptr,
+            [&](rwlock_in_line_t *clients_spot,
+                rwlock_in_line_t *limit_clients_spot,
+                rwlock_in_line_t *lm_spot,
+                ql::changefeed::limit_manager_t *lm) {
+                guarantee(clients_spot->read_signal()->is_pulsed());
+                guarantee(limit_clients_spot->read_signal()->is_pulsed());
+                lm->commit(lm_spot, ql::changefeed::sindex_ref_t{
+                        sindex->btree, sindex->superblock.get(), &sindex_info});
+            });
+    }
+}
+
+void rdb_apply_sindex_update_batch(
+    store_t *store,
+    const store_t::sindex_access_vector_t &sindexes,
+    sindex_update_batch_t *batch,
+    txn_t *txn,
+    const deletion_context_t *deletion_context) {
+    {
+        auto_drainer_t drainer;
+        for (const auto &sindex : sindexes) {
+            auto it = batch->ops.find(sindex->sindex.id);
+            if (it == batch->ops.end()) {
+                continue;
+            }
+            coro_t::spawn_sometime(
+                std::bind(
+                    &apply_single_sindex_batch,
+                    store,
+                    sindex.get(),
+                    &it->second,
+                    deletion_context,
+                    auto_drainer_t::lock_t(&drainer)));
+        }
+    }
+    batch->ops.clear();
+
+    /* Now that the sindex entries are gone, we can delete the blobs they
+     * shared with the deleted rows. */
+    for (const auto &value : batch->deleted_values) {
         deletion_context->post_deleter()->delete_value(buf_parent_t(txn),
-                modification->info.deleted.second.data());
+                                                       value.data());
     }
+    batch->deleted_values.clear();
 }
 
-class post_construct_traversal_helper_t : public btree_traversal_helper_t {
+/* Secondary index post construction is sort-based:
+ 1. A parallel traversal of a snapshot of the primary btree hands the rows of
+    each leaf to another thread, which computes their secondary index keys.
+ 2. The resulting entries are buffered in memory. Whenever the buffer grows
+    past the sort buffer size (`SINDEX_POST_CONSTRUCTION_SORT_BUFFER_SIZE` in
+    production), it is sorted and spilled to disk as a sorted run.
+ 3. The runs are merged, and the entries are written into the sindex trees in
+    key order, so consecutive inserts hit the same leaf nodes instead of
+    scattering writes all over the tree.
+Writes that happen in the meantime are caught up with afterwards from the
+modification queue (see `post_construct_and_drain_queue()`). */
+
+/* A row of the primary btree, detached from its leaf node so that it can be
+handed to another thread. */
+struct post_construct_row_t {
+    store_key_t primary_key;
+    // The serialized document, as stored in the row's blob.
+    std::vector<char> data;
+    // The inline part of the `rdb_value_t`. The sindex entries share it (and
+    // therefore the blob) with the primary btree.
+    std::vector<char> value_ref;
+};
+
+struct post_construct_entry_t {
+    // The position of the index in `post_construct_sorter_t::sindex_ids()`.
+    uint64_t sindex;
+    store_key_t key;
+    std::vector<char> value_ref;
+
+    bool operator<(const post_construct_entry_t &other) const {
+        return sindex < other.sindex
+            || (sindex == other.sindex && key < other.key);
+    }
+};
+
+RDB_MAKE_SERIALIZABLE_3(post_construct_entry_t, sindex, key, value_ref);
+
+/* Runs on an arbitrary thread. `rows` and `definitions` are only read, and the
+entries are returned as plain data, so nothing reference-counted crosses
+threads. */
+void compute_post_construct_entries(
+        const std::vector<post_construct_row_t> &rows,
+        const std::vector<std::vector<char> > &definitions,
+        std::vector<post_construct_entry_t> *entries_out) {
+    std::vector<sindex_disk_info_t> sindex_infos(definitions.size());
+    for (size_t i = 0; i < definitions.size(); ++i) {
+        try {
+            deserialize_sindex_info(definitions[i], &sindex_infos[i]);
+        } catch (const archive_exc_t &e) {
+            crash("%s", e.what());
+        }
+    }
+
+    for (const auto &row : rows) {
+        ql::datum_t doc;
+        buffer_read_stream_t read_stream(row.data.data(), row.data.size());
+        archive_result_t res = datum_deserialize(&read_stream, &doc);
+        guarantee_deserialization(res, "rdb value");
+
+        for (size_t i = 0; i < sindex_infos.size(); ++i) {
+            std::vector<std::pair<store_key_t, ql::datum_t> > keys;
+            try {
+                compute_keys(row.primary_key, doc, sindex_infos[i], &keys);
+            } catch (const ql::base_exc_t &) {
+                // Do nothing (we just drop the row from the index).
+                continue;
+            }
+            for (const auto &pair : keys) {
+                post_construct_entry_t entry;
+                entry.sindex = i;
+                entry.key = pair.first;
+                entry.value_ref = row.value_ref;
+                entries_out->push_back(std::move(entry));
+            }
+        }
+    }
+}
+
+/* Collects the sindex entries computed during the traversal, spills them to
+sorted runs on disk when they don't fit in memory, and merges them back in
+sorted order afterwards. */
+class post_construct_sorter_t : public home_thread_mixin_t {
 public:
-    post_construct_traversal_helper_t(
-            store_t *store,
-            const std::set<uuid_u> &sindexes_to_post_construct,
-            cond_t *interrupt_myself,
-            signal_t *interruptor
-            )
+    post_construct_sorter_t(store_t *store,
+                            std::vector<uuid_u> &&sindex_ids,
+                            std::vector<std::vector<char> > &&definitions,
+                            size_t buffer_limit)
         : store_(store),
-          sindexes_to_post_construct_(sindexes_to_post_construct),
-          interrupt_myself_(interrupt_myself), interruptor_(interruptor)
-    { }
+          sindex_ids_(std::move(sindex_ids)),
+          definitions_(std::move(definitions)),
+          buffer_limit_(buffer_limit),
+          buffer_size_(0),
+          num_entries_(0),
+          next_thread_(0) { }
+
+    const std::vector<uuid_u> &sindex_ids() const { return sindex_ids_; }
+    const std::vector<std::vector<char> > &definitions() const {
+        return definitions_;
+    }
+    // The number of entries that have been added so far.
+    uint64_t num_entries() const { return num_entries_; }
+
+    /* Picks the threads that evaluate the index functions and sort the runs in
+    round-robin order. */
+    threadnum_t next_thread() {
+        assert_thread();
+        return threadnum_t(next_thread_++ % get_num_threads());
+    }
 
-    void process_a_leaf(buf_lock_t *leaf_node_buf,
-                        const btree_key_t *, const btree_key_t *,
-                        signal_t *, int *) THROWS_ONLY(interrupted_exc_t) {
+    void add(std::vector<post_construct_entry_t> &&entries) {
+        assert_thread();
+        num_entries_ += entries.size();
+        for (auto &&entry : entries) {
+            buffer_size_ += entry_size(entry);
+            buffer_.push_back(std::move(entry));
+        }
+        if (buffer_size_ >= buffer_limit_) {
+            // Other coroutines keep adding to a fresh buffer while we spill.
+            std::vector<post_construct_entry_t> full_buffer;
+            full_buffer.swap(buffer_);
+            buffer_size_ = 0;
+            spill(std::move(full_buffer));
+        }
+    }
 
-        scoped_ptr_t<txn_t> wtxn;
-        store_t::sindex_access_vector_t sindexes;
+    /* Must be called once after the last `add()` and before `next()`. */
+    void finish() {
+        assert_thread();
+        {
+            on_thread_t thread_switcher(next_thread());
+            std::sort(buffer_.begin(), buffer_.end());
+        }
+        sources_.resize(runs_.size() + 1);
+        for (size_t i = 0; i < runs_.size(); ++i) {
+            sources_[i].run = runs_[i].get();
+            refill(&sources_[i]);
+        }
+        sources_.back().run = NULL;
+        sources_.back().chunk.swap(buffer_);
+        for (size_t i = 0; i < sources_.size(); ++i) {
+            if (sources_[i].pos < sources_[i].chunk.size()) {
+                heap_.push_back(i);
+            }
+        }
+        std::make_heap(heap_.begin(), heap_.end(), source_greater_t(&sources_));
+    }
 
-        buf_read_t leaf_read(leaf_node_buf);
-        const leaf_node_t *leaf_node
-            = static_cast<const leaf_node_t *>(leaf_read.get_data_read());
-
-        // Number of key/value pairs we process before yielding
-        const int MAX_CHUNK_SIZE = 10;
-        int current_chunk_size = 0;
-        const rdb_post_construction_deletion_context_t deletion_context;
-        for (auto it = leaf::begin(*leaf_node); it != leaf::end(*leaf_node); ++it) {
-            if (current_chunk_size == 0) {
-                // Start a write transaction and acquire the secondary index
-                // at the beginning of each chunk. We reset the transaction
-                // after each chunk because large write transactions can cause
-                // the cache to go into throttling, and that would interfere
-                // with other transactions on this table.
-                try {
-                    write_token_t token;
-                    store_->new_write_token(&token);
-
-                    scoped_ptr_t<real_superblock_t> superblock;
-
-                    // We use HARD durability because we want post construction
-                    // to be throttled if we insert data faster than it can
-                    // be written to disk. Otherwise we might exhaust the cache's
-                    // dirty page limit and bring down the whole table.
-                    // Other than that, the hard durability guarantee is not actually
-                    // needed here.
-                    store_->acquire_superblock_for_write(
-                            repli_timestamp_t::distant_past,
-                            2 + MAX_CHUNK_SIZE,
-                            write_durability_t::HARD,
-                            &token,
-                            &wtxn,
-                            &superblock,
-                            interruptor_);
+    /* Returns the entries in sorted order, or `false` once there are none
+    left. */
+    bool next(post_construct_entry_t *entry_out) {
+        assert_thread();
+        if (heap_.empty()) {
+            return false;
+        }
+        source_greater_t greater(&sources_);
+        std::pop_heap(heap_.begin(), heap_.end(), greater);
+        source_t *source = &sources_[heap_.back()];
+        *entry_out = std::move(source->chunk[source->pos]);
+        ++source->pos;
+        if (source->pos == source->chunk.size()) {
+            refill(source);
+        }
+        if (source->pos < source->chunk.size()) {
+            std::push_heap(heap_.begin(), heap_.end(), greater);
+        } else {
+            heap_.pop_back();
+        }
+        return true;
+    }
 
-                    // Acquire the sindex block.
-                    const block_id_t sindex_block_id = superblock->get_sindex_block_id();
+private:
+    // The number of entries in each element of a run's disk backed queue.
+    static const size_t RUN_CHUNK_SIZE = 1000;
+
+    typedef disk_backed_queue_t<std::vector<post_construct_entry_t> > run_t;
+
+    struct source_t {
+        source_t() : run(NULL), pos(0) { }
+        run_t *run;
+        std::vector<post_construct_entry_t> chunk;
+        size_t pos;
+    };
+
+    class source_greater_t {
+    public:
+        explicit source_greater_t(const std::vector<source_t> *sources)
+            : sources_(sources) { }
+        bool operator()(size_t a, size_t b) const {
+            const source_t &sa = (*sources_)[a];
+            const source_t &sb = (*sources_)[b];
+            return sb.chunk[sb.pos] < sa.chunk[sa.pos];
+        }
+    private:
+        const std::vector<source_t> *sources_;
+    };
 
-                    buf_lock_t sindex_block(superblock->expose_buf(), sindex_block_id,
-                                            access_t::write);
+    static size_t entry_size(const post_construct_entry_t &entry) {
+        return sizeof(entry) + entry.key.size() + entry.value_ref.size();
+    }
 
-                    superblock.reset();
+    void spill(std::vector<post_construct_entry_t> &&entries) {
+        {
+            on_thread_t thread_switcher(next_thread());
+            std::sort(entries.begin(), entries.end());
+        }
+        run_t *run = new run_t(
+            store_->io_backender_,
+            serializer_filepath_t(
+                store_->base_path_,
+                "post_construction_sort_" + uuid_to_str(generate_uuid())),
+            &store_->perfmon_collection);
+        runs_.push_back(scoped_ptr_t<run_t>(run));
+        for (size_t i = 0; i < entries.size(); i += RUN_CHUNK_SIZE) {
+            const size_t end = std::min(entries.size(), i + RUN_CHUNK_SIZE);
+            run->push(std::vector<post_construct_entry_t>(
+                std::make_move_iterator(entries.begin() + i),
+                std::make_move_iterator(entries.begin() + end)));
+        }
+    }
 
-                    store_->acquire_sindex_superblocks_for_write(
-                            sindexes_to_post_construct_,
-                            &sindex_block,
-                            &sindexes);
+    void refill(source_t *source) {
+        source->chunk.clear();
+        source->pos = 0;
+        if (source->run != NULL && !source->run->empty()) {
+            source->run->pop(&source->chunk);
+        }
+    }
 
-                    if (sindexes.empty()) {
-                        interrupt_myself_->pulse_if_not_already_pulsed();
-                        return;
-                    }
-                } catch (const interrupted_exc_t &e) {
-                    return;
-                }
-            }
+    store_t *store_;
+    const std::vector<uuid_u> sindex_ids_;
+    const std::vector<std::vector<char> > definitions_;
+    const size_t buffer_limit_;
 
-            store_->btree->stats.pm_keys_read.record();
-            store_->btree->stats.pm_total_keys_read += 1;
-
-            /* Grab relevant values from the leaf node. */
-            const btree_key_t *key = (*it).first;
-            const void *value = (*it).second;
-            guarantee(key);
-
-            const store_key_t pk(key);
-            rdb_modification_report_t mod_report(pk);
-            const rdb_value_t *rdb_value = static_cast<const rdb_value_t *>(value);
-            const max_block_size_t block_size = leaf_node_buf->cache()->max_block_size();
-            mod_report.info.added
-                = std::make_pair(
-                    get_data(rdb_value, buf_parent_t(leaf_node_buf)),
-                    std::vector<char>(rdb_value->value_ref(),
-                        rdb_value->value_ref() + rdb_value->inline_size(block_size)));
-
-            rdb_update_sindexes(store_,
-                                sindexes,
-                                &mod_report,
-                                wtxn.get(),
-                                &deletion_context,
-                                NULL,
-                                NULL,
-                                NULL);
-            store_->btree->stats.pm_keys_set.record();
-            store_->btree->stats.pm_total_keys_set += 1;
-
-            ++current_chunk_size;
-            if (current_chunk_size >= MAX_CHUNK_SIZE) {
-                current_chunk_size = 0;
-                // Release the write transaction and yield.
-                // We continue later where we have left off.
-                sindexes.clear();
-                wtxn.reset();
-                coro_t::yield();
+    std::vector<post_construct_entry_t> buffer_;
+    size_t buffer_size_;
+    uint64_t num_entries_;
+    std::vector<scoped_ptr_t<run_t> > runs_;
+    uint64_t next_thread_;
+
+    std::vector<source_t> sources_;
+    // A min-heap of the indices of the non-exhausted `sources_`.
+    std::vector<size_t> heap_;
+
+    DISABLE_COPYING(post_construct_sorter_t);
+};
+
+class post_construct_traversal_helper_t : public btree_traversal_helper_t {
+public:
+    post_construct_traversal_helper_t(store_t *store,
+                                      post_construct_sorter_t *sorter,
+                                      cond_t *interrupt_myself)
+        : store_(store), sorter_(sorter), interrupt_myself_(interrupt_myself),
+          next_drop_check_(0) { }
+
+    void process_a_leaf(buf_lock_t *leaf_node_buf,
+                        const btree_key_t *, const btree_key_t *,
+                        signal_t *, int *) THROWS_ONLY(interrupted_exc_t) {
+        if (all_sindexes_dropped()) {
+            interrupt_myself_->pulse_if_not_already_pulsed();
+            return;
+        }
+
+        std::vector<post_construct_row_t> rows;
+        {
+            buf_read_t leaf_read(leaf_node_buf);
+            const leaf_node_t *leaf_node
+                = static_cast<const leaf_node_t *>(leaf_read.get_data_read());
+            const max_block_size_t block_size
+                = leaf_node_buf->cache()->max_block_size();
+
+            for (auto it = leaf::begin(*leaf_node); it != leaf::end(*leaf_node); ++it) {
+                store_->btree->stats.pm_keys_read.record();
+                store_->btree->stats.pm_total_keys_read += 1;
+                resource_usage_t::note_rows_scanned(1);
+
+                /* Grab relevant values from the leaf node. */
+                const btree_key_t *key = (*it).first;
+                const void *value = (*it).second;
+                guarantee(key);
+
+                const rdb_value_t *rdb_value = static_cast<const rdb_value_t *>(value);
+                post_construct_row_t row;
+                row.primary_key = store_key_t(key);
+                row.value_ref.assign(
+                    rdb_value->value_ref(),
+                    rdb_value->value_ref() + rdb_value->inline_size(block_size));
+
+                rdb_blob_wrapper_t blob(block_size,
+                                        const_cast<rdb_value_t *>(rdb_value)->value_ref(),
+                                        blob::btree_maxreflen);
+                blob_acq_t acq_group;
+                buffer_group_t buffer_group;
+                blob.expose_all(buf_parent_t(leaf_node_buf), access_t::read,
+                                &buffer_group, &acq_group);
+                row.data.resize(buffer_group.get_size());
+                buffer_group_t data_group;
+                data_group.add_buffer(row.data.size(), row.data.data());
+                buffer_group_copy_data(&data_group, const_view(&buffer_group));
+
+                rows.push_back(std::move(row));
             }
         }
+
+        if (rows.empty()) {
+            return;
+        }
+
+        // Evaluating the index functions is the expensive part, so we spread it
+        // over all threads.
+        std::vector<post_construct_entry_t> entries;
+        {
+            on_thread_t thread_switcher(sorter_->next_thread());
+            compute_post_construct_entries(rows, sorter_->definitions(), &entries);
+        }
+        sorter_->add(std::move(entries));
     }
 
     void postprocess_internal_node(buf_lock_t *) { }
@@ -1697,49 +2209,286 @@ public:
     access_t btree_superblock_mode() { return access_t::read; }
     access_t btree_node_mode() { return access_t::read; }
 
+private:
+    /* Nothing gets written until the traversal is done, so we have to look up
+    the indexes to notice that they have been dropped. We only do that every so
+    often, because it acquires the sindex block. */
+    bool all_sindexes_dropped() {
+        // How often we check whether the indexes still exist.
+        const ticks_t DROP_CHECK_INTERVAL = 500 * MILLION;
+
+        if (interrupt_myself_->is_pulsed()) {
+            return true;
+        }
+        const ticks_t now = get_ticks();
+        if (now < next_drop_check_) {
+            return false;
+        }
+        next_drop_check_ = now + DROP_CHECK_INTERVAL;
+
+        const std::vector<uuid_u> &sindex_ids = sorter_->sindex_ids();
+        for (const auto &pair : store_->get_sindexes()) {
+            if (!pair.second.being_deleted
+                && std::find(sindex_ids.begin(), sindex_ids.end(),
+                             pair.second.id) != sindex_ids.end()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     store_t *store_;
-    const std::set<uuid_u> &sindexes_to_post_construct_;
+    post_construct_sorter_t *sorter_;
     cond_t *interrupt_myself_;
-    signal_t *interruptor_;
+    ticks_t next_drop_check_;
 };
 
+/* Writes the sorted entries into the sindex trees. Stops early if all of the
+indexes have been dropped in the meantime. */
+void write_post_construct_entries(
+        store_t *store,
+        post_construct_sorter_t *sorter,
+        signal_t *interruptor,
+        sindex_post_construction_progress_t *progress_tracker)
+    THROWS_ONLY(interrupted_exc_t) {
+    const std::vector<uuid_u> &sindex_ids = sorter->sindex_ids();
+    const std::set<uuid_u> sindex_id_set(sindex_ids.begin(), sindex_ids.end());
+    const rdb_post_construction_deletion_context_t deletion_context;
+
+    std::vector<post_construct_entry_t> chunk;
+    for (;;) {
+        // Fetch the next chunk before we acquire the superblock, so we don't hold
+        // up other writes while reading the runs from disk.
+        chunk.clear();
+        post_construct_entry_t entry;
+        while (chunk.size() < SINDEX_POST_CONSTRUCTION_WRITE_CHUNK_SIZE
+               && sorter->next(&entry)) {
+            chunk.push_back(std::move(entry));
+        }
+        if (chunk.empty()) {
+            return;
+        }
+
+        write_token_t token;
+        store->new_write_token(&token);
+
+        scoped_ptr_t<txn_t> wtxn;
+        scoped_ptr_t<real_superblock_t> superblock;
+
+        // We use HARD durability because we want post construction
+        // to be throttled if we insert data faster than it can
+        // be written to disk. Otherwise we might exhaust the cache's
+        // dirty page limit and bring down the whole table.
+        // Other than that, the hard durability guarantee is not actually
+        // needed here.
+        store->acquire_superblock_for_write(
+                repli_timestamp_t::distant_past,
+                2 + chunk.size(),
+                write_durability_t::HARD,
+                &token,
+                &wtxn,
+                &superblock,
+                interruptor);
+
+        // Acquire the sindex block.
+        const block_id_t sindex_block_id = superblock->get_sindex_block_id();
+
+        buf_lock_t sindex_block(superblock->expose_buf(), sindex_block_id,
+                                access_t::write);
+
+        superblock.reset();
+
+        store_t::sindex_access_vector_t sindexes;
+        store->acquire_sindex_superblocks_for_write(
+                sindex_id_set,
+                &sindex_block,
+                &sindexes);
+
+        // Indexes that have been dropped since we started either don't show up
+        // in `sindexes` or are being deleted, and we skip their entries.
+        std::vector<const store_t::sindex_access_t *> sindex_by_position(
+            sindex_ids.size(), NULL);
+        bool any_left = false;
+        for (const auto &sindex : sindexes) {
+            if (sindex->sindex.being_deleted) {
+                continue;
+            }
+            auto it = std::find(sindex_ids.begin(), sindex_ids.end(),
+                                sindex->sindex.id);
+            guarantee(it != sindex_ids.end());
+            sindex_by_position[it - sindex_ids.begin()] = sindex.get();
+            any_left = true;
+        }
+        if (!any_left) {
+            return;
+        }
+
+        for (const auto &e : chunk) {
+            const store_t::sindex_access_t *sindex = sindex_by_position[e.sindex];
+            if (sindex == NULL) {
+                continue;
+            }
+
+            promise_t<superblock_t *> return_superblock_local;
+            {
+                keyvalue_location_t kv_location;
+
+                rdb_value_sizer_t sizer(sindex->superblock->cache()->max_block_size());
+                find_keyvalue_location_for_write(
+                    &sizer,
+                    sindex->superblock.get(),
+                    e.key.btree_key(),
+                    deletion_context.balancing_detacher(),
+                    &kv_location,
+                    &sindex->btree->stats,
+                    NULL,
+                    &return_superblock_local);
+
+                ql::serialization_result_t res =
+                    kv_location_set(&kv_location, e.key, e.value_ref,
+                                    repli_timestamp_t::distant_past,
+                                    &deletion_context);
+                // this particular context cannot fail AT THE MOMENT.
+                guarantee(!bad(res));
+                // The keyvalue location gets destroyed here.
+            }
+            return_superblock_local.wait();
+
+            store->btree->stats.pm_keys_set.record();
+            store->btree->stats.pm_total_keys_set += 1;
+        }
+        progress_tracker->note_entries_written(chunk.size());
+
+        // Release the write transaction and yield.
+        // We continue later where we have left off.
+        sindexes.clear();
+        sindex_block.reset_buf_lock();
+        wtxn.reset();
+        coro_t::yield();
+    }
+}
+
+sindex_post_construction_progress_t::sindex_post_construction_progress_t()
+    : phase(phase_t::TRAVERSE), total_entries(0), written_entries(0) { }
+
+void sindex_post_construction_progress_t::start_sort() {
+    assert_thread();
+    phase = phase_t::SORT;
+}
+
+void sindex_post_construction_progress_t::start_merge(uint64_t _total_entries) {
+    assert_thread();
+    phase = phase_t::MERGE;
+    total_entries = _total_entries;
+    written_entries = 0;
+}
+
+void sindex_post_construction_progress_t::note_entries_written(uint64_t count) {
+    assert_thread();
+    written_entries = std::min(total_entries, written_entries + count);
+}
+
+progress_completion_fraction_t
+sindex_post_construction_progress_t::guess_completion() const {
+    assert_thread();
+    // Each half of the work is worth `SCALE`.
+    const int SCALE = 1000;
+    switch (phase) {
+    case phase_t::TRAVERSE: {
+        progress_completion_fraction_t traversal = traversal_progress.guess_completion();
+        if (traversal.invalid()) {
+            return progress_completion_fraction_t(0, 2 * SCALE);
+        }
+        return progress_completion_fraction_t(
+            static_cast<int>(traversal.as_double() * SCALE), 2 * SCALE);
+    }
+    case phase_t::SORT:
+        return progress_completion_fraction_t(SCALE, 2 * SCALE);
+    case phase_t::MERGE: {
+        const double written = total_entries == 0
+            ? 1.0
+            : static_cast<double>(written_entries) / total_entries;
+        return progress_completion_fraction_t(
+            SCALE + static_cast<int>(written * SCALE), 2 * SCALE);
+    }
+    default:
+        unreachable();
+    }
+}
+
 void post_construct_secondary_indexes(
         store_t *store,
         const std::set<uuid_u> &sindexes_to_post_construct,
+        size_t sort_buffer_size,
         signal_t *interruptor,
-        parallel_traversal_progress_t *progress_tracker)
+        sindex_post_construction_progress_t *progress_tracker)
     THROWS_ONLY(interrupted_exc_t) {
-    cond_t local_interruptor;
+    scoped_ptr_t<post_construct_sorter_t> sorter;
 
-    wait_any_t wait_any(&local_interruptor, interruptor);
-
-    post_construct_traversal_helper_t helper(store,
-            sindexes_to_post_construct, &local_interruptor, interruptor);
-    helper.progress = progress_tracker;
+    {
+        read_token_t read_token;
+        store->new_read_token(&read_token);
+
+        // Mind the destructor ordering.
+        // The superblock must be released before txn (`btree_parallel_traversal`
+        // usually already takes care of that).
+        // The txn must be destructed before the cache_account.
+        cache_account_t cache_account;
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+
+        store->acquire_superblock_for_read(
+            &read_token,
+            &txn,
+            &superblock,
+            interruptor,
+            true /* USE_SNAPSHOT */);
+
+        cache_account
+            = txn->cache()->create_cache_account(SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY);
+        txn->set_account(&cache_account);
+
+        // Look up the definitions of the indexes in the same snapshot.
+        std::vector<uuid_u> sindex_ids;
+        std::vector<std::vector<char> > definitions;
+        {
+            buf_lock_t sindex_block(superblock->expose_buf(),
+                                    superblock->get_sindex_block_id(),
+                                    access_t::read);
+            std::map<sindex_name_t, secondary_index_t> sindexes;
+            get_secondary_indexes(&sindex_block, &sindexes);
+            for (const auto &pair : sindexes) {
+                if (!pair.second.being_deleted
+                    && sindexes_to_post_construct.count(pair.second.id) == 1) {
+                    sindex_ids.push_back(pair.second.id);
+                    definitions.push_back(pair.second.opaque_definition);
+                }
+            }
+        }
+        if (sindex_ids.empty()) {
+            return;
+        }
 
-    read_token_t read_token;
-    store->new_read_token(&read_token);
+        sorter.init(new post_construct_sorter_t(
+            store, std::move(sindex_ids), std::move(definitions),
+            sort_buffer_size));
 
-    // Mind the destructor ordering.
-    // The superblock must be released before txn (`btree_parallel_traversal`
-    // usually already takes care of that).
-    // The txn must be destructed before the cache_account.
-    cache_account_t cache_account;
-    scoped_ptr_t<txn_t> txn;
-    scoped_ptr_t<real_superblock_t> superblock;
+        // Pulsed if all of the indexes get dropped while we're traversing.
+        cond_t local_interruptor;
+        wait_any_t wait_any(&local_interruptor, interruptor);
 
-    store->acquire_superblock_for_read(
-        &read_token,
-        &txn,
-        &superblock,
-        interruptor,
-        true /* USE_SNAPSHOT */);
+        post_construct_traversal_helper_t helper(
+            store, sorter.get(), &local_interruptor);
+        helper.progress = progress_tracker->get_traversal_progress();
 
-    cache_account
-        = txn->cache()->create_cache_account(SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY);
-    txn->set_account(&cache_account);
+        btree_parallel_traversal(superblock.get(), &helper, &wait_any);
+    }
 
-    btree_parallel_traversal(superblock.get(), &helper, &wait_any);
+    progress_tracker->start_sort();
+    sorter->finish();
+    progress_tracker->start_merge(sorter->num_entries());
+    write_post_construct_entries(store, sorter.get(), interruptor,
+                                 progress_tracker);
 }
 
 void noop_value_deleter_t::delete_value(buf_parent_t, const void *) const { }
@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "backfill_progress.hpp"
+#include "btree/parallel_traversal.hpp"
 #include "btree/types.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "rdb_protocol/datum.hpp"
@@ -18,14 +19,11 @@
 class btree_slice_t;
 class deletion_context_t;
 class key_tester_t;
-class parallel_traversal_progress_t;
 template <class> class promise_t;
 struct rdb_value_t;
 class refcount_superblock_t;
 struct sindex_disk_info_t;
 
-class parallel_traversal_progress_t;
-
 bool btree_value_fits(max_block_size_t bs, int data_length, const rdb_value_t *value);
 
 class rdb_value_sizer_t : public value_sizer_t {
@@ -65,6 +63,14 @@ void rdb_get(
     point_read_response_t *response,
     profile::trace_t *trace);
 
+// `keys` must be sorted.
+void rdb_get_multi(
+    const std::vector<store_key_t> &keys,
+    btree_slice_t *slice,
+    superblock_t *superblock,
+    point_multi_read_response_t *response,
+    profile::trace_t *trace);
+
 struct btree_info_t {
     btree_info_t(btree_slice_t *_slice,
                  repli_timestamp_t _timestamp,
@@ -152,6 +158,15 @@ void rdb_backfill(btree_slice_t *slice, const key_range_t& key_range,
                   parallel_traversal_progress_t *p, signal_t *interruptor)
     THROWS_ONLY(interrupted_exc_t);
 
+/* Hashes the key/value pairs of each of `regions`, which must be sorted and
+disjoint, into `hashes_out`. See `range_hash_t`. */
+void rdb_get_range_hashes(superblock_t *superblock,
+                          const std::vector<region_t> &regions,
+                          size_t max_split_keys,
+                          std::vector<range_hash_t> *hashes_out,
+                          signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t);
+
 
 void rdb_delete(const store_key_t &key, btree_slice_t *slice, repli_timestamp_t
                 timestamp, real_superblock_t *superblock,
@@ -170,7 +185,9 @@ void rdb_rget_slice(
     const boost::optional<ql::terminal_variant_t> &terminal,
     sorting_t sorting,
     rget_read_response_t *response,
-    release_superblock_t release_superblock);
+    release_superblock_t release_superblock,
+    /* If not NULL, the rows that the read scans are recorded here. */
+    key_access_histogram_t *access_histogram = NULL);
 
 void rdb_rget_secondary_slice(
     btree_slice_t *slice,
@@ -294,6 +311,26 @@ void deserialize_sindex_info(const std::vector<char> &data,
                              sindex_disk_info_t *info_out)
     THROWS_ONLY(archive_exc_t);
 
+/* Collects the secondary index tree changes of a batch of modifications, so
+ * that they can be applied index by index in key order once the whole batch has
+ * been processed (see `rdb_apply_sindex_update_batch`). Neighbouring keys then
+ * hit the same, already cached leaf nodes instead of each document causing its
+ * own descent at a random position of every index. */
+struct sindex_update_batch_t {
+    struct op_t {
+        store_key_t key;
+        // Empty for deletions.
+        std::vector<char> value_ref;
+        bool is_deletion;
+    };
+
+    // The changes to each index, in the order they were made.
+    std::map<uuid_u, std::vector<op_t> > ops;
+    // The values of deleted rows. The sindex entries share their blobs, so
+    // they can only be deleted after the sindex entries are gone.
+    std::vector<std::vector<char> > deleted_values;
+};
+
 /* An rdb_modification_cb_t is passed to BTree operations and allows them to
  * modify the secondary while they perform an operation. */
 class superblock_queue_t;
@@ -311,6 +348,10 @@ public:
     bool has_pkey_cfeeds();
     void finish(btree_slice_t *btree, real_superblock_t *superblock);
 
+    /* Writes the secondary index changes collected by `on_mod_report` to the
+    sindex trees. Must be called once all mod reports have been handled. */
+    void apply_sindex_updates();
+
     ~rdb_modification_report_cb_t();
 
 private:
@@ -329,6 +370,7 @@ private:
 
     /* Fields initialized by calls to on_mod_report */
     store_t::sindex_access_vector_t sindexes_;
+    sindex_update_batch_t sindex_batch_;
 };
 
 void rdb_update_sindexes(
@@ -337,15 +379,54 @@ void rdb_update_sindexes(
     const rdb_modification_report_t *modification,
     txn_t *txn,
     const deletion_context_t *deletion_context,
+    sindex_update_batch_t *batch,  // NULL to write the changes right away
     cond_t *keys_available_cond,
     std::map<std::string, std::vector<ql::datum_t> > *old_keys_out,
     std::map<std::string, std::vector<ql::datum_t> > *new_keys_out);
 
+void rdb_apply_sindex_update_batch(
+    store_t *store,
+    const store_t::sindex_access_vector_t &sindexes,
+    sindex_update_batch_t *batch,
+    txn_t *txn,
+    const deletion_context_t *deletion_context);
+
+/* Tracks `post_construct_secondary_indexes()` through all of its phases. The
+traversal of the primary btree, which also sorts full buffers and spills them to
+disk, counts for the first half of the work. Merging the sorted runs and writing
+them into the index trees counts for the second half, in proportion to the entries
+written. In between, the last buffer is sorted. */
+class sindex_post_construction_progress_t : public traversal_progress_t {
+public:
+    sindex_post_construction_progress_t();
+
+    parallel_traversal_progress_t *get_traversal_progress() {
+        return &traversal_progress;
+    }
+    void start_sort();
+    void start_merge(uint64_t total_entries);
+    void note_entries_written(uint64_t count);
+
+    progress_completion_fraction_t guess_completion() const;
+
+private:
+    enum class phase_t { TRAVERSE, SORT, MERGE };
+    phase_t phase;
+    parallel_traversal_progress_t traversal_progress;
+    uint64_t total_entries;
+    uint64_t written_entries;
+};
+
+/* Builds the given secondary indexes from the primary btree. Full buffers of
+`sort_buffer_size` bytes are spilled to disk as sorted runs. Returns early, or throws
+`interrupted_exc_t` if it's in the middle of the traversal, once all of the indexes
+have been dropped. */
 void post_construct_secondary_indexes(
         store_t *store,
         const std::set<uuid_u> &sindexes_to_post_construct,
+        size_t sort_buffer_size,
         signal_t *interruptor,
-        parallel_traversal_progress_t *progress_tracker)
+        sindex_post_construction_progress_t *progress_tracker)
     THROWS_ONLY(interrupted_exc_t);
 
 /* This deleter actually deletes the value and all associated blocks. */
@@ -18,6 +18,7 @@
 #include "containers/disk_backed_queue.hpp"
 #include "containers/scoped.hpp"
 #include "logger.hpp"
+#include "perfmon/resource_usage.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/erase_range.hpp"
 #include "rdb_protocol/protocol.hpp"
@@ -93,10 +94,19 @@ store_t::store_t(serializer_t *serializer,
       ctx(_ctx),
       changefeed_server((ctx == NULL || ctx->manager == NULL)
                         ? NULL
-                        : new ql::changefeed::server_t(ctx->manager)),
+                        : new ql::changefeed::server_t(ctx->manager,
+                                                       io_backender,
+                                                       base_path,
+                                                       &perfmon_collection)),
       index_report(std::move(_index_report)),
       table_id(_table_id),
-      write_superblock_acq_semaphore(WRITE_SUPERBLOCK_ACQ_WAITERS_LIMIT)
+      write_superblock_acq_semaphore(WRITE_SUPERBLOCK_ACQ_WAITERS_LIMIT),
+      backfill_rate_controller(io_backender),
+      read_latency(secs_to_ticks(LATENCY_HISTOGRAM_INTERVAL_SECS)),
+      write_latency(secs_to_ticks(LATENCY_HISTOGRAM_INTERVAL_SECS)),
+      latency_membership(&perfmon_collection,
+                         &read_latency, "read_latency_ms",
+                         &write_latency, "write_latency_ms")
 {
     cache.init(new cache_t(serializer, balancer, &perfmon_collection));
     general_cache_conn.init(new cache_conn_t(cache.get()));
@@ -184,16 +194,28 @@ void store_t::read(
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
     assert_thread();
-    scoped_ptr_t<txn_t> txn;
-    scoped_ptr_t<real_superblock_t> superblock;
+    ticks_t start_time = get_ticks();
+    // The scope is closed before we copy `usage` into the response, so that the CPU
+    // time of the read has been charged to it by then.
+    resource_usage_t usage;
+    {
+        resource_usage_scope_t usage_scope(&usage);
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
 
-    acquire_superblock_for_read(token, &txn, &superblock,
-                                interruptor,
-                                read.use_snapshot());
+        acquire_superblock_for_read(token, &txn, &superblock,
+                                    interruptor,
+                                    read.use_snapshot());
+        resource_usage_t::note_lock_wait(get_ticks() - start_time);
 
-    DEBUG_ONLY(check_metainfo(DEBUG_ONLY(metainfo_checker, ) superblock.get());)
+        DEBUG_ONLY(check_metainfo(DEBUG_ONLY(metainfo_checker, ) superblock.get());)
 
-    protocol_read(read, response, superblock.get(), interruptor);
+        protocol_read(read, response, superblock.get(), interruptor);
+        ticks_t duration = get_ticks() - start_time;
+        read_latency.record(duration);
+        backfill_rate_controller.note_foreground_op(duration);
+    }
+    response->resource_usage = usage;
 }
 
 void store_t::write(
@@ -208,18 +230,29 @@ void store_t::write(
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
     assert_thread();
+    ticks_t start_time = get_ticks();
 
-    scoped_ptr_t<txn_t> txn;
-    scoped_ptr_t<real_superblock_t> real_superblock;
-    const int expected_change_count = 2; // FIXME: this is incorrect, but will do for now
-    acquire_superblock_for_write(timestamp.to_repli_timestamp(),
-                                 expected_change_count, durability, token,
-                                 &txn, &real_superblock, interruptor);
-
-    check_and_update_metainfo(DEBUG_ONLY(metainfo_checker, ) new_metainfo,
-                              real_superblock.get());
-    scoped_ptr_t<real_superblock_t> superblock(real_superblock.release());
-    protocol_write(write, response, timestamp, &superblock, interruptor);
+    // See the comment in `store_t::read()`.
+    resource_usage_t usage;
+    {
+        resource_usage_scope_t usage_scope(&usage);
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> real_superblock;
+        const int expected_change_count = 2; // FIXME: this is incorrect, but will do for now
+        acquire_superblock_for_write(timestamp.to_repli_timestamp(),
+                                     expected_change_count, durability, token,
+                                     &txn, &real_superblock, interruptor);
+        resource_usage_t::note_lock_wait(get_ticks() - start_time);
+
+        check_and_update_metainfo(DEBUG_ONLY(metainfo_checker, ) new_metainfo,
+                                  real_superblock.get());
+        scoped_ptr_t<real_superblock_t> superblock(real_superblock.release());
+        protocol_write(write, response, timestamp, &superblock, interruptor);
+        ticks_t duration = get_ticks() - start_time;
+        write_latency.record(duration);
+        backfill_rate_controller.note_foreground_op(duration);
+    }
+    response->resource_usage = usage;
 }
 
 // TODO: Figure out wtf does the backfill filtering, figure out wtf constricts delete range operations to hit only a certain hash-interval, figure out what filters keys.
@@ -249,6 +282,31 @@ bool store_t::send_backfill(
     return false;
 }
 
+void store_t::get_range_hashes(
+        const std::vector<region_t> &regions,
+        size_t max_split_keys,
+        std::vector<range_hash_t> *hashes_out,
+        region_map_t<binary_blob_t> *metainfo_out,
+        read_token_t *token,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    assert_thread();
+
+    // Hashing reads the whole range, so it goes through the backfill account
+    // like `send_backfill()` does.
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    acquire_superblock_for_backfill(token, &txn, &superblock, interruptor);
+
+    region_map_t<binary_blob_t> unmasked_metainfo;
+    get_metainfo_internal(superblock.get(), &unmasked_metainfo);
+    *metainfo_out = unmasked_metainfo.mask(get_region());
+
+    with_priority_t p(CORO_PRIORITY_BACKFILL_SENDER);
+    rdb_get_range_hashes(superblock.get(), regions, max_split_keys, hashes_out,
+                         interruptor);
+}
+
 void store_t::throttle_backfill_chunk(signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
     // Warning: No re-ordering is allowed during throttling!
@@ -264,6 +322,9 @@ void store_t::throttle_backfill_chunk(signal_t *interruptor)
     if (interruptor->is_pulsed()) {
         throw interrupted_exc_t();
     }
+
+    // Don't let the backfill take more disk bandwidth than user queries can spare.
+    backfill_rate_controller.throttle(interruptor);
 }
 
 struct backfill_chunk_timestamp_t : public boost::static_visitor<repli_timestamp_t> {
@@ -289,6 +350,31 @@ struct backfill_chunk_timestamp_t : public boost::static_visitor<repli_timestamp
     }
 };
 
+/* The number of bytes a backfill chunk writes, as far as `backfill_rate_controller_t`
+is concerned */
+struct backfill_chunk_size_t : public boost::static_visitor<size_t> {
+    size_t operator()(const backfill_chunk_t::delete_key_t &del) const {
+        return del.key.size();
+    }
+
+    size_t operator()(const backfill_chunk_t::delete_range_t &) const {
+        return 0;
+    }
+
+    size_t operator()(const backfill_chunk_t::key_value_pairs_t &kv) const {
+        size_t size = 0;
+        for (const backfill_atom_t &atom : kv.backfill_atoms) {
+            size += static_cast<size_t>(atom.key.size())
+                + ql::serialized_size<cluster_version_t::CLUSTER>(atom.value);
+        }
+        return size;
+    }
+
+    size_t operator()(const backfill_chunk_t::sindexes_t &) const {
+        return 0;
+    }
+};
+
 void store_t::receive_backfill(
         const backfill_chunk_t &chunk,
         write_token_t *token,
@@ -296,6 +382,8 @@ void store_t::receive_backfill(
         THROWS_ONLY(interrupted_exc_t) {
     assert_thread();
     with_priority_t p(CORO_PRIORITY_BACKFILL_RECEIVER);
+    backfill_rate_controller.note_backfill_bytes(
+        boost::apply_visitor(backfill_chunk_size_t(), chunk.val));
 
     scoped_ptr_t<txn_t> txn;
     scoped_ptr_t<real_superblock_t> real_superblock;
@@ -510,16 +598,20 @@ void store_t::update_sindexes(
         }
 
         rdb_live_deletion_context_t deletion_context;
+        sindex_update_batch_t batch;
         for (size_t i = 0; i < mod_reports.size(); ++i) {
             rdb_update_sindexes(this,
                                 sindexes,
                                 &mod_reports[i],
                                 txn,
                                 &deletion_context,
+                                &batch,
                                 NULL,
                                 NULL,
                                 NULL);
         }
+        rdb_apply_sindex_update_batch(this, sindexes, &batch, txn,
+                                      &deletion_context);
     }
 
     // Write mod reports onto the sindex queue. We are in line for the
@@ -2,11 +2,13 @@
 
 #include <queue>
 
+#include "arch/timing.hpp"
 #include "boost_utils.hpp"
 #include "btree/reql_specific.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/interruptor.hpp"
 #include "containers/archive/boost_types.hpp"
+#include "containers/disk_backed_queue.hpp"
 #include "rdb_protocol/artificial_table/backend.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/env.hpp"
@@ -52,7 +54,10 @@ enum class pop_type_t { RANGE, POINT };
 class maybe_squashing_queue_t {
 public:
     virtual ~maybe_squashing_queue_t() { }
-    virtual void add(store_key_t key, datum_t old_val, datum_t new_val) = 0;
+    // `resume_token` is empty unless the subscription includes resume tokens,
+    // which it can't if it squashes.
+    virtual void add(store_key_t key, datum_t old_val, datum_t new_val,
+                     datum_t resume_token) = 0;
     virtual size_t size() const = 0;
     virtual void clear() = 0;
     virtual datum_t pop() {
@@ -67,7 +72,9 @@ private:
 };
 
 class squashing_queue_t : public maybe_squashing_queue_t {
-    virtual void add(store_key_t key, datum_t old_val, datum_t new_val) {
+    virtual void add(store_key_t key, datum_t old_val, datum_t new_val,
+                     datum_t resume_token) {
+        guarantee(!resume_token.has());
         guarantee(old_val.has() || new_val.has());
         if (old_val.has() && new_val.has()) {
             rassert(old_val != new_val);
@@ -105,18 +112,32 @@ class squashing_queue_t : public maybe_squashing_queue_t {
 };
 
 class nonsquashing_queue_t : public maybe_squashing_queue_t {
-    virtual void add(store_key_t, datum_t old_val, datum_t new_val) {
+    virtual void add(store_key_t, datum_t old_val, datum_t new_val,
+                     datum_t resume_token) {
         guarantee(old_val.has() || new_val.has());
         if (old_val.has() && new_val.has()) {
             rassert(old_val != new_val);
         }
         queue.emplace_back(std::move(old_val), std::move(new_val));
+        resume_tokens.push_back(std::move(resume_token));
+    }
+    virtual datum_t pop() {
+        datum_t resume_token = std::move(resume_tokens.front());
+        resume_tokens.pop_front();
+        datum_t ret = maybe_squashing_queue_t::pop();
+        if (resume_token.has()) {
+            datum_object_builder_t builder(ret);
+            builder.overwrite("resume_token", std::move(resume_token));
+            ret = std::move(builder).to_datum();
+        }
+        return ret;
     }
     virtual size_t size() const {
         return queue.size();
     }
     virtual void clear() {
         queue.clear();
+        resume_tokens.clear();
     }
     virtual std::pair<datum_t, datum_t> pop_impl() {
         guarantee(size() != 0);
@@ -125,6 +146,8 @@ class nonsquashing_queue_t : public maybe_squashing_queue_t {
         return ret;
     }
     std::deque<std::pair<datum_t, datum_t> > queue;
+    // Parallel to `queue`.
+    std::deque<datum_t> resume_tokens;
 };
 
 scoped_ptr_t<maybe_squashing_queue_t> make_maybe_squashing_queue(bool squash) {
@@ -165,13 +188,123 @@ boost::optional<datum_t> apply_ops(
     }
 }
 
+datum_t resume_token_to_datum(const resume_token_t &token) {
+    std::map<datum_string_t, datum_t> obj;
+    for (const auto &pair : token) {
+        obj[datum_string_t(uuid_to_str(pair.first))]
+            = datum_t(static_cast<double>(pair.second));
+    }
+    return datum_t(std::move(obj));
+}
+
+resume_token_t datum_to_resume_token(const datum_t &d) {
+    const char *const error =
+        "`since` must be a `resume_token` from an earlier changefeed.";
+    rcheck_datum(d.get_type() == datum_t::R_OBJECT, base_exc_t::GENERIC, error);
+    resume_token_t token;
+    for (size_t i = 0; i < d.obj_size(); ++i) {
+        std::pair<datum_string_t, datum_t> pair = d.get_pair(i);
+        uuid_u server_uuid;
+        int64_t seq;
+        rcheck_datum(str_to_uuid(pair.first.to_std(), &server_uuid)
+                     && pair.second.get_type() == datum_t::R_NUM
+                     && number_as_integer(pair.second.as_num(), &seq)
+                     && seq > 0,
+                     base_exc_t::GENERIC, error);
+        token[server_uuid] = seq;
+    }
+    return token;
+}
+
+change_log_t::change_log_t(io_backender_t *io_backender,
+                           const serializer_filepath_t &filename,
+                           perfmon_collection_t *stats_parent,
+                           size_t _max_changes)
+    : queue(new disk_backed_queue_t<msg_t::change_t>(
+                io_backender, filename, stats_parent)),
+      max_changes(_max_changes),
+      // 0 means a change wasn't logged.
+      first_seq(1),
+      next_seq(1),
+      flush_scheduled(false) {
+    guarantee(max_changes > 0);
+}
+
+change_log_t::~change_log_t() { }
+
+void change_log_t::push(msg_t::change_t *change) {
+    ASSERT_NO_CORO_WAITING;
+    change->log_seq = next_seq++;
+    pending.push_back(*change);
+    if (pending.size() > max_changes) {
+        first_seq = pending.front().log_seq + 1;
+        pending.pop_front();
+    }
+    if (!flush_scheduled) {
+        flush_scheduled = true;
+        coro_t::spawn_sometime(
+            std::bind(&change_log_t::flush, this, drainer.lock()));
+    }
+}
+
+void change_log_t::flush(auto_drainer_t::lock_t lock) {
+    new_mutex_in_line_t spot(&queue_mutex);
+    spot.acq_signal()->wait_lazily_unordered();
+    while (!pending.empty() && !lock.get_drain_signal()->is_pulsed()) {
+        // `push` may add to (and drop from) `pending` while we're writing.
+        msg_t::change_t change = std::move(pending.front());
+        pending.pop_front();
+        queue->push(change);
+        while (static_cast<size_t>(queue->size()) > max_changes) {
+            msg_t::change_t dropped;
+            queue->pop(&dropped);
+            first_seq = std::max(first_seq, dropped.log_seq + 1);
+        }
+    }
+    flush_scheduled = false;
+}
+
+bool change_log_t::read_range(uint64_t from_seq,
+                              uint64_t to_seq,
+                              const region_t &region,
+                              std::vector<msg_t::change_t> *changes_out) {
+    if (from_seq < first_seq || from_seq > to_seq) {
+        return false;
+    }
+    auto visit = [&](const msg_t::change_t &change) {
+        if (change.log_seq >= from_seq && change.log_seq < to_seq
+            && region_contains_key(region, change.pkey)) {
+            changes_out->push_back(change);
+        }
+    };
+    new_mutex_in_line_t spot(&queue_mutex);
+    spot.acq_signal()->wait_lazily_unordered();
+    queue->for_each(visit);
+    // Everything in `pending` is newer than everything in `queue`.
+    for (const auto &change : pending) {
+        visit(change);
+    }
+    // Changes may have been dropped while we were reading.
+    return from_seq >= first_seq;
+}
+
 server_t::client_info_t::client_info_t()
-    : limit_clients(&opt_lt<std::string>),
+    : stamp(0),
+      squash(false),
+      batch_start_stamp(0),
+      flush_scheduled(false),
+      limit_clients(&opt_lt<std::string>),
       limit_clients_lock(new rwlock_t()) { }
 
-server_t::server_t(mailbox_manager_t *_manager)
+server_t::server_t(mailbox_manager_t *_manager,
+                   io_backender_t *_io_backender,
+                   const base_path_t &_base_path,
+                   perfmon_collection_t *_perfmon_collection)
     : uuid(generate_uuid()),
       manager(_manager),
+      io_backender(_io_backender),
+      base_path(_base_path),
+      perfmon_collection(_perfmon_collection),
       stop_mailbox(manager,
                    std::bind(&server_t::stop_mailbox_cb, this, ph::_1, ph::_2)),
       limit_stop_mailbox(manager, std::bind(&server_t::limit_stop_mailbox_cb,
@@ -240,10 +373,19 @@ void server_t::limit_stop_mailbox_cb(signal_t *,
     }
 }
 
-void server_t::add_client(const client_t::addr_t &addr, region_t region) {
+void server_t::add_client(
+    const client_t::addr_t &addr, region_t region, bool squash) {
     auto_drainer_t::lock_t lock(&drainer);
     rwlock_in_line_t spot(&clients_lock, access_t::write);
     spot.write_signal()->wait_lazily_unordered();
+    if (!log.has() && CHANGEFEED_LOG_MAX_CHANGES > 0) {
+        log.init(new change_log_t(
+            io_backender,
+            serializer_filepath_t(
+                base_path, "changefeed_log_" + uuid_to_str(uuid)),
+            perfmon_collection,
+            CHANGEFEED_LOG_MAX_CHANGES));
+    }
     client_info_t *info = &clients[addr];
 
     // We do this regardless of whether there's already an entry for this
@@ -256,6 +398,8 @@ void server_t::add_client(const client_t::addr_t &addr, region_t region) {
     // that's fine.
     if (!info->cond.has()) {
         info->stamp = 0;
+        info->batch_start_stamp = 0;
+        info->squash = squash;
         cond_t *stopped = new cond_t();
         info->cond.init(stopped);
         // We spawn now so the auto drainer lock is acquired immediately.
@@ -325,47 +469,190 @@ void server_t::add_client_cb(signal_t *stopped, client_t::addr_t addr) {
     guarantee(erased == 1);
 }
 
-struct stamped_msg_t {
-    stamped_msg_t() { }
-    stamped_msg_t(uuid_u _server_uuid, uint64_t _stamp, msg_t _submsg)
+// A batch of messages from one `server_t`.  The batch covers every stamp in
+// `[min_stamp, max_stamp)`, but some of those stamps may have no message in
+// `msgs` because the server coalesced changes to the same primary key.
+struct stamped_msgs_t {
+    stamped_msgs_t() { }
+    stamped_msgs_t(uuid_u _server_uuid,
+                   uint64_t _min_stamp,
+                   uint64_t _max_stamp,
+                   std::vector<std::pair<uint64_t, msg_t> > _msgs)
         : server_uuid(std::move(_server_uuid)),
-          stamp(_stamp),
-          submsg(std::move(_submsg)) { }
+          min_stamp(_min_stamp),
+          max_stamp(_max_stamp),
+          msgs(std::move(_msgs)) { }
     uuid_u server_uuid;
-    uint64_t stamp;
-    msg_t submsg;
+    uint64_t min_stamp, max_stamp;
+    std::vector<std::pair<uint64_t, msg_t> > msgs;
 };
 
-RDB_MAKE_SERIALIZABLE_3(stamped_msg_t, server_uuid, stamp, submsg);
+RDB_MAKE_SERIALIZABLE_4(stamped_msgs_t, server_uuid, min_stamp, max_stamp, msgs);
+
+// Folds `later` into `earlier`, which must be a change to the same row.  Returns
+// `false` if the two changes cancel out.
+bool coalesce_change(msg_t::change_t *earlier, msg_t::change_t &&later) {
+    guarantee(earlier->pkey == later.pkey);
+    earlier->new_indexes = std::move(later.new_indexes);
+    earlier->new_val = std::move(later.new_val);
+    earlier->log_seq = later.log_seq;
+    if (!earlier->old_val.has() && !earlier->new_val.has()) {
+        return false;
+    }
+    return !(earlier->old_val.has() && earlier->new_val.has()
+             && earlier->old_val == earlier->new_val);
+}
+
+void add_msg_to_squashing_batch(std::map<uint64_t, msg_t> *batch,
+                                std::map<store_key_t, uint64_t> *batch_changes,
+                                uint64_t stamp,
+                                msg_t &&msg) {
+    msg_t::change_t *change = boost::get<msg_t::change_t>(&msg.op);
+    if (change == NULL) {
+        batch->insert(std::make_pair(stamp, std::move(msg)));
+        return;
+    }
+    auto it = batch_changes->find(change->pkey);
+    if (it == batch_changes->end()) {
+        batch_changes->insert(std::make_pair(change->pkey, stamp));
+        batch->insert(std::make_pair(stamp, std::move(msg)));
+        return;
+    }
+    auto batch_it = batch->find(it->second);
+    guarantee(batch_it != batch->end());
+    msg_t::change_t *earlier = boost::get<msg_t::change_t>(&batch_it->second.op);
+    guarantee(earlier != NULL);
+    // See the comment in `changefeed.hpp` for why the coalesced change keeps the
+    // earlier `old_val` but takes the later stamp.
+    if (coalesce_change(earlier, std::move(*change))) {
+        batch->insert(std::make_pair(stamp, std::move(batch_it->second)));
+        it->second = stamp;
+    } else {
+        batch_changes->erase(it);
+    }
+    batch->erase(batch_it);
+}
 
 // This function takes a `lock_t` to make sure you have one.  (We can't just
 // always ackquire a drainer lock before sending because we sometimes send a
 // `stop_t` during destruction, and you can't acquire a drain lock on a draining
 // `auto_drainer_t`.)
 void server_t::send_one_with_lock(
-    const auto_drainer_t::lock_t &,
+    const auto_drainer_t::lock_t &lock,
     std::pair<const client_t::addr_t, client_info_t> *client,
     msg_t msg) {
-    uint64_t stamp;
+    if (add_to_batch_with_lock(lock, client, std::move(msg))) {
+        flush_batch(client);
+    }
+}
+
+bool server_t::add_to_batch_with_lock(
+    const auto_drainer_t::lock_t &lock,
+    std::pair<const client_t::addr_t, client_info_t> *client,
+    msg_t msg) {
+    ASSERT_NO_CORO_WAITING;
+    client_info_t *info = &client->second;
+    bool is_stop = boost::get<msg_t::stop_t>(&msg.op) != NULL;
     {
         // We don't need a write lock as long as we make sure the coroutine
-        // doesn't block between reading and updating the stamp.
+        // doesn't block between reading and updating the stamp and the batch.
+        uint64_t stamp = info->stamp++;
+        if (info->squash) {
+            add_msg_to_squashing_batch(
+                &info->batch, &info->batch_changes, stamp, std::move(msg));
+        } else {
+            info->batch.insert(std::make_pair(stamp, std::move(msg)));
+        }
+    }
+    // We always send `stop_t` right away because the client entry is removed
+    // right after it's sent.
+    if (is_stop
+        || CHANGEFEED_BATCH_WINDOW_MS == 0
+        || info->batch.size() >= CHANGEFEED_BATCH_MAX_MSGS) {
+        return true;
+    } else if (!info->flush_scheduled && !lock.get_drain_signal()->is_pulsed()) {
+        info->flush_scheduled = true;
+        // Every client with changes gets one of these per batch window.  It only
+        // sends the batch, so a medium-sized stack is enough.
+        coro_t::spawn_sometime(
+            std::bind(&server_t::flush_batch_cb, this, lock, client->first),
+            coro_stack_class_t::MEDIUM);
+    }
+    return false;
+}
+
+void server_t::flush_batch(std::pair<const client_t::addr_t, client_info_t> *client) {
+    client_info_t *info = &client->second;
+    std::vector<std::pair<uint64_t, msg_t> > msgs;
+    uint64_t min_stamp, max_stamp;
+    {
         ASSERT_NO_CORO_WAITING;
-        stamp = client->second.stamp++;
+        // Coalescing may have removed every message, but we still have to tell
+        // the client that the stamps were used.
+        if (info->batch_start_stamp == info->stamp) {
+            guarantee(info->batch.size() == 0);
+            return;
+        }
+        msgs.reserve(info->batch.size());
+        for (auto &&pair : info->batch) {
+            msgs.push_back(std::make_pair(pair.first, std::move(pair.second)));
+        }
+        info->batch.clear();
+        info->batch_changes.clear();
+        min_stamp = info->batch_start_stamp;
+        max_stamp = info->stamp;
+        info->batch_start_stamp = info->stamp;
     }
-    send(manager, client->first, stamped_msg_t(uuid, stamp, std::move(msg)));
+    send(manager, client->first,
+         stamped_msgs_t(uuid, min_stamp, max_stamp, std::move(msgs)));
 }
 
-void server_t::send_all(const msg_t &msg, const store_key_t &key) {
+void server_t::flush_batch_cb(auto_drainer_t::lock_t lock, client_t::addr_t addr) {
+    try {
+        nap(CHANGEFEED_BATCH_WINDOW_MS, lock.get_drain_signal());
+    } catch (const interrupted_exc_t &) {
+        // If we're draining, `add_client_cb` sends whatever is left together
+        // with the `stop_t`.
+        return;
+    }
+    rwlock_in_line_t spot(&clients_lock, access_t::read);
+    spot.read_signal()->wait_lazily_unordered();
+    auto it = clients.find(addr);
+    // The client might have been removed while we were napping, in which case
+    // the batch was sent along with its `stop_t`.
+    if (it != clients.end()) {
+        it->second.flush_scheduled = false;
+        flush_batch(&*it);
+    }
+}
+
+void server_t::send_all(msg_t msg, const store_key_t &key) {
     auto_drainer_t::lock_t lock(&drainer);
     rwlock_in_line_t spot(&clients_lock, access_t::read);
     spot.read_signal()->wait_lazily_unordered();
-    for (auto it = clients.begin(); it != clients.end(); ++it) {
-        if (std::any_of(it->second.regions.begin(),
-                        it->second.regions.end(),
-                        std::bind(&region_contains_key, ph::_1, std::cref(key)))) {
-            send_one_with_lock(lock, &*it, msg);
+    std::vector<std::pair<const client_t::addr_t, client_info_t> *> to_flush;
+    {
+        // We log the change and stamp it for every client without blocking, so
+        // `get_stamp_and_replay` sees it either in the log or not yet stamped.
+        ASSERT_NO_CORO_WAITING;
+        if (log.has()) {
+            if (msg_t::change_t *change = boost::get<msg_t::change_t>(&msg.op)) {
+                log->push(change);
+            }
         }
+        for (auto it = clients.begin(); it != clients.end(); ++it) {
+            if (std::any_of(it->second.regions.begin(),
+                            it->second.regions.end(),
+                            std::bind(&region_contains_key,
+                                      ph::_1, std::cref(key)))) {
+                if (add_to_batch_with_lock(lock, &*it, msg)) {
+                    to_flush.push_back(&*it);
+                }
+            }
+        }
+    }
+    for (auto client : to_flush) {
+        flush_batch(client);
     }
 }
 
@@ -386,10 +673,11 @@ server_t::limit_addr_t server_t::get_limit_stop_addr() {
     return limit_stop_mailbox.get_address();
 }
 
-uint64_t server_t::get_stamp(const client_t::addr_t &addr) {
+uint64_t server_t::get_stamp(const client_t::addr_t &addr, uint64_t *log_end_out) {
     auto_drainer_t::lock_t lock(&drainer);
     rwlock_in_line_t spot(&clients_lock, access_t::read);
     spot.read_signal()->wait_lazily_unordered();
+    *log_end_out = log.has() ? log->end_seq() : 0;
     auto it = clients.find(addr);
     if (it == clients.end()) {
         // The client was removed, so no future messages are coming.
@@ -399,6 +687,22 @@ uint64_t server_t::get_stamp(const client_t::addr_t &addr) {
     }
 }
 
+uint64_t server_t::get_stamp_and_replay(
+    const client_t::addr_t &addr,
+    uint64_t since,
+    const region_t &region,
+    uint64_t *log_end_out,
+    std::vector<msg_t::change_t> *changes_out,
+    bool *complete_out) {
+    auto_drainer_t::lock_t lock(&drainer);
+    uint64_t stamp = get_stamp(addr, log_end_out);
+    // `log` is never reset once it's created, so we can read it without
+    // holding `clients_lock` and without holding up writes.
+    *complete_out = *log_end_out != 0
+        && log->read_range(since, *log_end_out, region, changes_out);
+    return stamp;
+}
+
 uuid_u server_t::get_uuid() {
     return uuid;
 }
@@ -986,9 +1290,9 @@ RDB_IMPL_SERIALIZABLE_3(msg_t::limit_change_t, sub, old_key, new_val);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(msg_t::limit_change_t);
 RDB_IMPL_SERIALIZABLE_2(msg_t::limit_stop_t, sub, exc);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(msg_t::limit_stop_t);
-RDB_IMPL_SERIALIZABLE_5(
+RDB_IMPL_SERIALIZABLE_6(
     msg_t::change_t,
-    old_indexes, new_indexes, pkey, old_val, new_val);
+    old_indexes, new_indexes, pkey, old_val, new_val, log_seq);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(msg_t::change_t);
 RDB_IMPL_SERIALIZABLE_0_SINCE_v1_13(msg_t::stop_t);
 
@@ -1082,9 +1386,11 @@ public:
         const store_key_t &key,
         datum_t old_val,
         datum_t new_val,
+        datum_t resume_token,
         const configured_limits_t &limits) {
         if (update_stamp(uuid, stamp)) {
-            queue->add(key, std::move(old_val), std::move(new_val));
+            queue->add(key, std::move(old_val), std::move(new_val),
+                       std::move(resume_token));
             if (queue->size() > limits.array_size_limit()) {
                 skipped += queue->size();
                 queue->clear();
@@ -1180,24 +1486,24 @@ public:
                 client_t *client,
                 mailbox_manager_t *manager,
                 namespace_interface_t *ns_if,
-                uuid_u uuid,
+                client_t::feed_key_t key,
                 signal_t *interruptor);
     ~real_feed_t();
 
     client_t::addr_t get_addr() const;
 private:
     virtual auto_drainer_t::lock_t get_drainer_lock() { return drainer.lock(); }
-    virtual void maybe_remove_feed() { client->maybe_remove_feed(client_lock, uuid); }
+    virtual void maybe_remove_feed() { client->maybe_remove_feed(client_lock, key); }
     virtual void stop_limit_sub(limit_sub_t *sub);
 
-    void mailbox_cb(signal_t *interruptor, stamped_msg_t msg);
+    void mailbox_cb(signal_t *interruptor, stamped_msgs_t msgs);
     void constructor_cb();
 
     auto_drainer_t::lock_t client_lock;
     client_t *client;
-    uuid_u uuid;
+    client_t::feed_key_t key;
     mailbox_manager_t *manager;
-    mailbox_t<void(stamped_msg_t)> mailbox;
+    mailbox_t<void(stamped_msgs_t)> mailbox;
     std::vector<server_t::addr_t> stop_addrs;
     std::vector<scoped_ptr_t<disconnect_watcher_t> > disconnect_watchers;
 
@@ -1205,11 +1511,12 @@ private:
         rwlock_t lock;
         uint64_t next;
         struct lt_t {
-            bool operator()(const stamped_msg_t &left, const stamped_msg_t &right) {
-                return left.stamp > right.stamp; // We want the min val to be on top.
+            bool operator()(const stamped_msgs_t &left, const stamped_msgs_t &right) {
+                // We want the min val to be on top.
+                return left.min_stamp > right.min_stamp;
             }
         };
-        std::priority_queue<stamped_msg_t, std::vector<stamped_msg_t>, lt_t> map;
+        std::priority_queue<stamped_msgs_t, std::vector<stamped_msgs_t>, lt_t> map;
     };
     // Maps from a `server_t`'s uuid_u.  We don't need a lock for this because
     // the set of `uuid_u`s never changes after it's initialized.
@@ -1224,15 +1531,15 @@ real_feed_t::real_feed_t(auto_drainer_t::lock_t _client_lock,
                          client_t *_client,
                          mailbox_manager_t *_manager,
                          namespace_interface_t *ns_if,
-                         uuid_u _uuid,
+                         client_t::feed_key_t _key,
                          signal_t *interruptor)
     : client_lock(std::move(_client_lock)),
       client(_client),
-      uuid(_uuid),
+      key(std::move(_key)),
       manager(_manager),
       mailbox(manager, std::bind(&real_feed_t::mailbox_cb, this, ph::_1, ph::_2)) {
     try {
-        read_t read(changefeed_subscribe_t(mailbox.get_address()),
+        read_t read(changefeed_subscribe_t(mailbox.get_address(), key.second),
                     profile_bool_t::DONT_PROFILE);
         read_response_t read_resp;
         ns_if->read(read, &read_resp, order_token_t::ignore, interruptor);
@@ -1265,10 +1572,13 @@ real_feed_t::real_feed_t(auto_drainer_t::lock_t _client_lock,
 #ifndef NDEBUG
             for (size_t i = 0; i < queues.size()-1; ++i) {
                 res.first->second->map.push(
-                    stamped_msg_t(
+                    stamped_msgs_t(
                         server_uuid,
                         std::numeric_limits<uint64_t>::max() - i,
-                        msg_t()));
+                        std::numeric_limits<uint64_t>::max() - i,
+                        std::vector<std::pair<uint64_t, msg_t> >{
+                            std::make_pair(std::numeric_limits<uint64_t>::max() - i,
+                                           msg_t())}));
             }
 #endif
         }
@@ -1308,7 +1618,7 @@ void real_feed_t::constructor_cb() {
     // longer than necessary.
     disconnect_watchers.clear();
     if (!detached) {
-        scoped_ptr_t<feed_t> self = client->detach_feed(client_lock, uuid);
+        scoped_ptr_t<feed_t> self = client->detach_feed(client_lock, key);
         detached = true;
         if (self.has()) {
             const char *msg = "Disconnected from peer.";
@@ -1357,7 +1667,7 @@ public:
                 break;
             }
         }
-        queue->add(store_key_t(pkey.print_primary()), datum_t(), initial);
+        queue->add(store_key_t(pkey.print_primary()), datum_t(), initial, datum_t());
         started = true;
     }
     virtual void start_real(env_t *env,
@@ -1382,7 +1692,8 @@ public:
         if (queue->size() == 0 || start_stamp > stamp) {
             stamp = start_stamp;
             queue->clear(); // Remove the premature values.
-            queue->add(store_key_t(pkey.print_primary()), datum_t(), resp->initial_val);
+            queue->add(store_key_t(pkey.print_primary()), datum_t(),
+                       resp->initial_val, datum_t());
         }
         started = true;
     }
@@ -1418,9 +1729,11 @@ class range_sub_t : public flat_sub_t {
 public:
     // Throws QL exceptions.
     range_sub_t(feed_t *feed, const datum_t &squash,
-                bool include_states, keyspec_t::range_t _spec)
+                bool include_states, keyspec_t::range_t _spec,
+                resume_t _resume)
         : flat_sub_t(feed, squash, include_states), spec(std::move(_spec)),
-          state(state_t::READY), sent_state(state_t::NONE) {
+          resume(std::move(_resume)), state(state_t::READY),
+          sent_state(state_t::NONE) {
         for (const auto &transform : spec.transforms) {
             ops.push_back(make_op(transform));
         }
@@ -1447,12 +1760,38 @@ public:
         read_response_t read_resp;
         // Note that we use the `outer_env`'s interruptor for the read.
         nif->read(
-            read_t(changefeed_stamp_t(*addr), profile_bool_t::DONT_PROFILE),
+            read_t(changefeed_stamp_t(*addr, resume.since),
+                   profile_bool_t::DONT_PROFILE),
             &read_resp, order_token_t::ignore, outer_env->interruptor);
         auto resp = boost::get<changefeed_stamp_response_t>(&read_resp.response);
         guarantee(resp != NULL);
+        rcheck_datum(resp->replay_complete, base_exc_t::GENERIC,
+                     "Cannot resume changefeed: the changes after the `since` "
+                     "token are no longer available.  Re-read the table instead.");
         start_stamps = std::move(resp->stamps);
         guarantee(start_stamps.size() != 0);
+        if (resume.include_token) {
+            for (const auto &pair : resp->log_ends) {
+                rcheck_datum(pair.second != 0, base_exc_t::GENERIC,
+                             "Cannot include resume tokens: the change log is "
+                             "disabled.");
+                // A complete replay means every server was in the token.
+                resume_seqs[pair.first] = resume.since
+                    ? resume.since->at(pair.first)
+                    : pair.second;
+            }
+        }
+        // We don't block between setting `start_stamps` and replaying the
+        // logged changes (`apply_ops` doesn't block), so they come before any
+        // change we receive from the servers, which all have a stamp at or
+        // after the start stamp.
+        for (const auto &pair : resp->replay) {
+            auto it = start_stamps.find(pair.first);
+            guarantee(it != start_stamps.end());
+            for (const auto &change : pair.second) {
+                add_change(pair.first, it->second, change);
+            }
+        }
     }
     boost::optional<std::string> sindex() const { return spec.sindex; }
     bool contains(const datum_t &sindex_key) const {
@@ -1499,6 +1838,71 @@ public:
         return new_stamp >= it->second;
     }
 
+    virtual void add_change(const uuid_u &server_uuid,
+                            uint64_t stamp,
+                            const msg_t::change_t &change) {
+        configured_limits_t default_limits;
+        datum_t null = datum_t::null();
+        datum_t new_val = null, old_val = null;
+        if (has_ops()) {
+            if (change.new_val.has()) {
+                if (boost::optional<datum_t> d = apply_ops(change.new_val)) {
+                    new_val = *d;
+                }
+            }
+            if (change.old_val.has()) {
+                if (boost::optional<datum_t> d = apply_ops(change.old_val)) {
+                    old_val = *d;
+                }
+            }
+            // Duplicate values are caught before being written to disk and
+            // don't generate a `mod_report`, but if we have transforms the
+            // values might have changed.
+            if (new_val == old_val) {
+                return;
+            }
+        } else {
+            guarantee(change.old_val.has() || change.new_val.has());
+            if (change.new_val.has()) {
+                new_val = change.new_val;
+            }
+            if (change.old_val.has()) {
+                old_val = change.old_val;
+            }
+        }
+        size_t old_vals, new_vals;
+        count_in_range(change, &old_vals, &new_vals);
+        if (old_vals == 0 && new_vals == 0) {
+            return;
+        }
+        datum_t resume_token;
+        if (resume.include_token) {
+            // Changes from before we subscribed are discarded by `add_el`, and
+            // must not move the token back.
+            uint64_t *seq = &resume_seqs[server_uuid];
+            *seq = std::max(*seq, change.log_seq + 1);
+            resume_token = resume_token_to_datum(resume_seqs);
+        }
+        while (new_vals > 0 && old_vals > 0) {
+            add_el(server_uuid, stamp, change.pkey,
+                   old_val, new_val, resume_token, default_limits);
+            --new_vals;
+            --old_vals;
+        }
+        while (old_vals > 0) {
+            guarantee(new_vals == 0);
+            add_el(server_uuid, stamp, change.pkey,
+                   old_val, null, resume_token, default_limits);
+            --old_vals;
+        }
+        while (new_vals > 0) {
+            guarantee(old_vals == 0);
+            add_el(server_uuid, stamp, change.pkey,
+                   null, new_val, resume_token, default_limits);
+            --new_vals;
+        }
+    }
+
     virtual datum_t pop_el() {
         if (state != sent_state && include_states) {
             sent_state = state;
@@ -1509,7 +1913,40 @@ public:
     virtual bool has_el() {
         return (include_states && state != sent_state) || queue->size() != 0;
     }
-private:
+protected:
+    // Sets `*old_vals_out` and `*new_vals_out` to how many times the old and
+    // new values of `change` fall in our range.  For primary key ranges both
+    // are 0 or 1 (even if the row didn't exist); for multi indexes they can be
+    // larger.
+    void count_in_range(const msg_t::change_t &change,
+                        size_t *old_vals_out,
+                        size_t *new_vals_out) const {
+        *old_vals_out = 0;
+        *new_vals_out = 0;
+        boost::optional<std::string> sindex_name = sindex();
+        if (sindex_name) {
+            auto old_it = change.old_indexes.find(*sindex_name);
+            if (old_it != change.old_indexes.end()) {
+                for (const auto &idx : old_it->second) {
+                    if (contains(idx)) {
+                        *old_vals_out += 1;
+                    }
+                }
+            }
+            auto new_it = change.new_indexes.find(*sindex_name);
+            if (new_it != change.new_indexes.end()) {
+                for (const auto &idx : new_it->second) {
+                    if (contains(idx)) {
+                        *new_vals_out += 1;
+                    }
+                }
+            }
+        } else if (contains(change.pkey)) {
+            *old_vals_out = 1;
+            *new_vals_out = 1;
+        }
+    }
+
     scoped_ptr_t<env_t> make_env(env_t *outer_env) {
         // This is to support fake environments from the unit tests that don't
         // actually have a context.
@@ -1528,15 +1965,281 @@ private:
     scoped_ptr_t<env_t> env;
     std::vector<scoped_ptr_t<op_t> > ops;
 
-    // The stamp (see `stamped_msg_t`) associated with our `changefeed_stamp_t`
+    // The stamp (see `stamped_msgs_t`) associated with our `changefeed_stamp_t`
     // read.  We use these to make sure we don't see changes from writes before
     // our subscription.
     std::map<uuid_u, uint64_t> start_stamps;
     keyspec_t::range_t spec;
+    resume_t resume;
+    // If `resume.include_token` is set, the resume token for the changes we've
+    // queued so far.
+    resume_token_t resume_seqs;
     state_t state, sent_state;
     auto_drainer_t drainer;
 };
 
+// Maintains `count` or `sum`, optionally grouped, over a range.  The starting
+// totals are read along with the stamps, and after that each row change is
+// turned into per-group deltas with the same terminal accumulators the read
+// used, so keeping the aggregate up to date never rereads the table.
+//
+// The deltas are computed here rather than on the shards.  `server_t::send_all`
+// runs on the write path and sends each change once per client feed, which all of
+// that feed's subscriptions share.  Computing deltas there would mean evaluating
+// every aggregate subscription's transforms on the write path, and keeping
+// per-subscription state on every shard (as `limit_manager_t` does), to send
+// messages that are only smaller than the row changes they replace if a single
+// aggregate is subscribed to the range.
+class aggregate_sub_t : public range_sub_t {
+public:
+    // Throws QL exceptions.
+    aggregate_sub_t(feed_t *feed, const datum_t &squash,
+                    bool include_states, keyspec_t::aggregate_t _spec)
+        : range_sub_t(feed, squash, include_states, _spec.range, resume_t()),
+          terminal(std::move(_spec.terminal)),
+          grouped(false),
+          totals(optional_datum_less_t(reql_version_t::LATEST)),
+          squashed(optional_datum_less_t(reql_version_t::LATEST)) {
+        for (const auto &transform : spec.transforms) {
+            if (boost::get<group_wire_func_t>(&transform) != NULL) {
+                grouped = true;
+            }
+        }
+        state = state_t::INITIALIZING;
+    }
+    virtual void start_artificial(env_t *, const uuid_u &,
+                                  const std::string &,
+                                  const std::vector<datum_t> &) {
+        // System tables reject aggregate changefeeds before we get here.
+        unreachable();
+    }
+    virtual void start_real(env_t *outer_env,
+                            std::string table,
+                            namespace_interface_t *nif,
+                            client_t::addr_t *addr) {
+        assert_thread();
+        env = make_env(outer_env);
+
+        boost::optional<terminal_variant_t> initial_terminal(terminal);
+        boost::optional<sindex_rangespec_t> sindex_range;
+        if (spec.sindex) {
+            sindex_range = sindex_rangespec_t(*spec.sindex, boost::none, spec.range);
+        }
+        rget_read_t initial(
+            spec.sindex
+                ? region_t::universe()
+                : region_t(spec.range.to_primary_keyrange()),
+            outer_env->get_all_optargs(),
+            std::move(table),
+            batchspec_t::all(), // Terminal takes care of stopping.
+            spec.transforms,
+            std::move(initial_terminal),
+            std::move(sindex_range),
+            sorting_t::UNORDERED);
+
+        read_response_t read_resp;
+        // Note that we use the `outer_env`'s interruptor for the read.
+        nif->read(
+            read_t(changefeed_stamp_t(*addr, std::move(initial)),
+                   profile_bool_t::DONT_PROFILE),
+            &read_resp, order_token_t::ignore, outer_env->interruptor);
+        auto resp = boost::get<changefeed_stamp_response_t>(&read_resp.response);
+        guarantee(resp != NULL);
+        guarantee(static_cast<bool>(resp->initial));
+        // This throws if the read failed.
+        counted_t<grouped_data_t> initial_totals =
+            to_totals(&resp->initial->result);
+        for (auto &&pair : *initial_totals->get_underlying_map(
+                 grouped::order_doesnt_matter_t())) {
+            totals.insert(std::move(pair));
+        }
+        if (!grouped && totals.size() == 0) {
+            totals[datum_t()] = datum_t(0.0);
+        }
+        for (const auto &pair : totals) {
+            initial_vals.push_back(change_datum(pair.first, datum_t(), pair.second));
+        }
+        if (initial_vals.size() == 0) {
+            state = state_t::READY;
+        }
+        // We don't block between reading `totals` and setting `start_stamps`,
+        // so the first change we apply is the first one after the read.
+        start_stamps = std::move(resp->stamps);
+        guarantee(start_stamps.size() != 0);
+    }
+
+    virtual void add_change(const uuid_u &server_uuid,
+                            uint64_t stamp,
+                            const msg_t::change_t &change) {
+        if (!update_stamp(server_uuid, stamp)) {
+            return;
+        }
+        size_t old_vals, new_vals;
+        count_in_range(change, &old_vals, &new_vals);
+        if (!change.old_val.has()) {
+            old_vals = 0;
+        }
+        if (!change.new_val.has()) {
+            new_vals = 0;
+        }
+        if (old_vals == 0 && new_vals == 0) {
+            return;
+        }
+        // The old value's contribution is subtracted and the new value's
+        // added, once for each time the row falls in our range.
+        std::map<datum_t, double, optional_datum_less_t> deltas(
+            optional_datum_less_t(reql_version_t::LATEST));
+        for (const auto &pair : contribution(change.old_val)) {
+            deltas[pair.first] -= pair.second.as_num() * old_vals;
+        }
+        for (const auto &pair : contribution(change.new_val)) {
+            deltas[pair.first] += pair.second.as_num() * new_vals;
+        }
+        for (const auto &pair : deltas) {
+            apply_delta(pair.first, pair.second);
+        }
+        maybe_signal_cond();
+    }
+
+    virtual datum_t pop_el() {
+        if (state != sent_state && include_states) {
+            sent_state = state;
+            return state_datum(state);
+        }
+        datum_t ret;
+        if (initial_vals.size() != 0) {
+            ret = std::move(initial_vals.front());
+            initial_vals.pop_front();
+            if (initial_vals.size() == 0) {
+                state = state_t::READY;
+            }
+        } else if (els.size() != 0) {
+            ret = std::move(els.front());
+            els.pop_front();
+        } else {
+            guarantee(squashed.size() != 0);
+            auto it = squashed.begin();
+            ret = change_datum(it->first, it->second.first, it->second.second);
+            squashed.erase(it);
+        }
+        return ret;
+    }
+    virtual bool has_el() {
+        return (include_states && state != sent_state)
+            || initial_vals.size() != 0
+            || els.size() != 0
+            || squashed.size() != 0;
+    }
+private:
+    typedef std::map<datum_t, datum_t, optional_datum_less_t> totals_t;
+
+    // Finishes a terminal result into one total per group.  Throws QL
+    // exceptions if `res` is an error.
+    counted_t<grouped_data_t> to_totals(result_t *res) {
+        scoped_ptr_t<eager_acc_t> acc = make_eager_terminal(terminal);
+        acc->add_res(env.get(), res);
+        return acc->finish_eager(
+            make_counted_backtrace(), true, env->limits())->as_grouped_data();
+    }
+
+    // What `row` adds to the total of each group it falls in.
+    totals_t contribution(const datum_t &row) {
+        totals_t ret(optional_datum_less_t(reql_version_t::LATEST));
+        if (!row.has()) {
+            return ret;
+        }
+        // See `range_sub_t::apply_ops` for why we take a lock here.
+        auto_drainer_t::lock_t lock(&drainer);
+        try {
+            groups_t groups{optional_datum_less_t(env->reql_version())};
+            groups[datum_t()] = std::vector<datum_t>{row};
+            for (const auto &op : ops) {
+                (*op)(env.get(), &groups, datum_t());
+            }
+            scoped_ptr_t<eager_acc_t> acc = make_eager_terminal(terminal);
+            (*acc)(env.get(), &groups);
+            counted_t<grouped_data_t> gd = acc->finish_eager(
+                make_counted_backtrace(), true, env->limits())->as_grouped_data();
+            for (auto &&pair : *gd->get_underlying_map(
+                     grouped::order_doesnt_matter_t())) {
+                ret.insert(std::move(pair));
+            }
+        } catch (const base_exc_t &) {
+            // Like `apply_ops`, we drop rows we can't aggregate (e.g. a `sum`
+            // over a field that isn't a number).
+            ret.clear();
+        }
+        return ret;
+    }
+
+    void apply_delta(const datum_t &group, double delta) {
+        datum_t old_total, new_total;
+        auto it = totals.find(group);
+        if (it == totals.end()) {
+            new_total = datum_t(delta);
+            totals.insert(std::make_pair(group, new_total));
+        } else {
+            if (delta == 0.0) {
+                return;
+            }
+            old_total = it->second;
+            new_total = datum_t(old_total.as_num() + delta);
+            // We only know that a group is empty for `count`.  A grouped `sum`
+            // keeps reporting a group whose rows have all been removed.
+            if (grouped
+                && boost::get<count_wire_func_t>(&terminal) != NULL
+                && new_total.as_num() == 0.0) {
+                totals.erase(it);
+                new_total = datum_t();
+            } else {
+                it->second = new_total;
+            }
+        }
+        if (squash) {
+            auto sq = squashed.find(group);
+            if (sq == squashed.end()) {
+                squashed.insert(
+                    std::make_pair(group, std::make_pair(old_total, new_total)));
+            } else {
+                sq->second.second = new_total;
+                const datum_t &first = sq->second.first;
+                if (first.has() == new_total.has()
+                    && (!first.has() || first == new_total)) {
+                    squashed.erase(sq);
+                }
+            }
+        } else {
+            els.push_back(change_datum(group, old_total, new_total));
+            configured_limits_t default_limits;
+            if (els.size() > default_limits.array_size_limit()) {
+                skipped += els.size();
+                els.clear();
+            }
+        }
+    }
+
+    datum_t change_datum(const datum_t &group,
+                         const datum_t &old_total,
+                         const datum_t &new_total) const {
+        std::map<datum_string_t, datum_t> ret;
+        if (grouped) {
+            ret[datum_string_t("group")] = group;
+        }
+        if (old_total.has()) ret[datum_string_t("old_val")] = old_total;
+        if (new_total.has()) ret[datum_string_t("new_val")] = new_total;
+        return datum_t(std::move(ret));
+    }
+
+    const terminal_variant_t terminal;
+    bool grouped;
+    // The current total of each group, keyed by `datum_t()` if not grouped.
+    totals_t totals;
+    std::deque<datum_t> initial_vals, els;
+    // If we're squashing, the first and latest total of each group that
+    // changed since the user last read from us.
+    std::map<datum_t, std::pair<datum_t, datum_t>, optional_datum_less_t> squashed;
+};
+
 class limit_sub_t : public subscription_t {
 public:
     // Throws QL exceptions.
@@ -1870,76 +2573,7 @@ public:
         datum_t null = datum_t::null();
 
         feed->each_active_range_sub(*lock, [&](range_sub_t *sub) {
-            datum_t new_val = null, old_val = null;
-            if (sub->has_ops()) {
-                if (change.new_val.has()) {
-                    if (boost::optional<datum_t> d = sub->apply_ops(change.new_val)) {
-                        new_val = *d;
-                    }
-                }
-                if (change.old_val.has()) {
-                    if (boost::optional<datum_t> d = sub->apply_ops(change.old_val)) {
-                        old_val = *d;
-                    }
-                }
-                // Duplicate values are caught before being written to disk and
-                // don't generate a `mod_report`, but if we have transforms the
-                // values might have changed.
-                if (new_val == old_val) {
-                    return;
-                }
-            } else {
-                guarantee(change.old_val.has() || change.new_val.has());
-                if (change.new_val.has()) {
-                    new_val = change.new_val;
-                }
-                if (change.old_val.has()) {
-                    old_val = change.old_val;
-                }
-            }
-            boost::optional<std::string> sindex = sub->sindex();
-            if (sindex) {
-                size_t old_vals = 0, new_vals = 0;
-                auto old_it = change.old_indexes.find(*sindex);
-                if (old_it != change.old_indexes.end()) {
-                    for (const auto &idx : old_it->second) {
-                        if (sub->contains(idx)) {
-                            old_vals += 1;
-                        }
-                    }
-                }
-                auto new_it = change.new_indexes.find(*sindex);
-                if (new_it != change.new_indexes.end()) {
-                    for (const auto &idx : new_it->second) {
-                        if (sub->contains(idx)) {
-                            new_vals += 1;
-                        }
-                    }
-                }
-                while (new_vals > 0 && old_vals > 0) {
-                    sub->add_el(server_uuid, stamp, change.pkey,
-                                old_val, new_val, default_limits);
-                    --new_vals;
-                    --old_vals;
-                }
-                while (old_vals > 0) {
-                    guarantee(new_vals == 0);
-                    sub->add_el(server_uuid, stamp, change.pkey,
-                                old_val, null, default_limits);
-                    --old_vals;
-                }
-                while (new_vals > 0) {
-                    guarantee(old_vals == 0);
-                    sub->add_el(server_uuid, stamp, change.pkey,
-                                null, new_val, default_limits);
-                    --new_vals;
-                }
-            } else {
-                if (sub->contains(change.pkey)) {
-                    sub->add_el(server_uuid, stamp, change.pkey,
-                                old_val, new_val, default_limits);
-                }
-            }
+            sub->add_change(server_uuid, stamp, change);
         });
         feed->on_point_sub(
             change.pkey,
@@ -1951,6 +2585,7 @@ public:
                       change.pkey,
                       change.old_val.has() ? change.old_val : null,
                       change.new_val.has() ? change.new_val : null,
+                      datum_t(),
                       default_limits));
     }
     void operator()(const msg_t::stop_t &) const {
@@ -1969,7 +2604,7 @@ private:
     uint64_t stamp;
 };
 
-void real_feed_t::mailbox_cb(signal_t *, stamped_msg_t msg) {
+void real_feed_t::mailbox_cb(signal_t *, stamped_msgs_t msgs) {
     // We stop receiving messages when detached (we're only receiving
     // messages because we haven't managed to get a message to the
     // stop mailboxes for some of the primary replicas yet).  This also stops
@@ -1985,7 +2620,7 @@ void real_feed_t::mailbox_cb(signal_t *, stamped_msg_t msg) {
         if (!lock.get_drain_signal()->is_pulsed()) {
             // We don't need a lock for this because the set of `uuid_u`s never
             // changes after it's initialized.
-            auto it = queues.find(msg.server_uuid);
+            auto it = queues.find(msgs.server_uuid);
             guarantee(it != queues.end());
             queue_t *queue = it->second.get();
             guarantee(queue != NULL);
@@ -1994,16 +2629,19 @@ void real_feed_t::mailbox_cb(signal_t *, stamped_msg_t msg) {
             spot.write_signal()->wait_lazily_unordered();
 
             // Add us to the queue.
-            guarantee(msg.stamp >= queue->next);
-            queue->map.push(std::move(msg));
+            guarantee(msgs.min_stamp >= queue->next);
+            queue->map.push(std::move(msgs));
 
             // Read as much as we can from the queue (this enforces ordering.)
-            while (queue->map.size() != 0 && queue->map.top().stamp == queue->next) {
-                const stamped_msg_t &curmsg = queue->map.top();
-                msg_visitor_t visitor(this, &lock, curmsg.server_uuid, curmsg.stamp);
-                boost::apply_visitor(visitor, curmsg.submsg.op);
+            while (queue->map.size() != 0
+                   && queue->map.top().min_stamp == queue->next) {
+                const stamped_msgs_t &curmsgs = queue->map.top();
+                for (const auto &pair : curmsgs.msgs) {
+                    msg_visitor_t visitor(this, &lock, curmsgs.server_uuid, pair.first);
+                    boost::apply_visitor(visitor, pair.second.op);
+                }
+                queue->next = curmsgs.max_stamp;
                 queue->map.pop();
-                queue->next += 1;
             }
         }
     }
@@ -2180,6 +2818,7 @@ RDB_MAKE_SERIALIZABLE_4_FOR_CLUSTER(
     keyspec_t::range_t, transforms, sindex, sorting, range);
 RDB_MAKE_SERIALIZABLE_2_FOR_CLUSTER(keyspec_t::limit_t, range, limit);
 RDB_MAKE_SERIALIZABLE_1_FOR_CLUSTER(keyspec_t::point_t, key);
+RDB_MAKE_SERIALIZABLE_2_FOR_CLUSTER(keyspec_t::aggregate_t, range, terminal);
 
 void feed_t::add_sub_with_lock(
     rwlock_t *rwlock, const std::function<void()> &f) THROWS_NOTHING {
@@ -2442,13 +3081,15 @@ client_t::~client_t() { }
 
 scoped_ptr_t<subscription_t> new_sub(
     feed_t *feed, const datum_t &squash, bool include_states,
-    const keyspec_t::spec_t &spec) {
+    const resume_t &resume, const keyspec_t::spec_t &spec) {
     struct spec_visitor_t : public boost::static_visitor<subscription_t *> {
         explicit spec_visitor_t(
-            feed_t *_feed, const datum_t *_squash, bool _include_states)
-            : feed(_feed), squash(_squash), include_states(_include_states) { }
+            feed_t *_feed, const datum_t *_squash, bool _include_states,
+            const resume_t *_resume)
+            : feed(_feed), squash(_squash), include_states(_include_states),
+              resume(_resume) { }
         subscription_t *operator()(const keyspec_t::range_t &range) const {
-            return new range_sub_t(feed, *squash, include_states, range);
+            return new range_sub_t(feed, *squash, include_states, range, *resume);
         }
         subscription_t *operator()(const keyspec_t::limit_t &limit) const {
             return new limit_sub_t(feed, *squash, include_states, limit);
@@ -2456,18 +3097,24 @@ scoped_ptr_t<subscription_t> new_sub(
         subscription_t *operator()(const keyspec_t::point_t &point) const {
             return new point_sub_t(feed, *squash, include_states, point.key);
         }
+        subscription_t *operator()(const keyspec_t::aggregate_t &aggregate) const {
+            return new aggregate_sub_t(feed, *squash, include_states, aggregate);
+        }
         feed_t *feed;
         const datum_t *squash;
         bool include_states;
+        const resume_t *resume;
     };
     return scoped_ptr_t<subscription_t>(
-        boost::apply_visitor(spec_visitor_t(feed, &squash, include_states), spec));
+        boost::apply_visitor(
+            spec_visitor_t(feed, &squash, include_states, &resume), spec));
 }
 
 counted_t<datum_stream_t> client_t::new_stream(
     env_t *env,
     const datum_t &squash,
     bool include_states,
+    const resume_t &resume,
     const namespace_id_t &uuid,
     const protob_t<const Backtrace> &bt,
     const std::string &table_name,
@@ -2485,7 +3132,8 @@ counted_t<datum_stream_t> client_t::new_stream(
             auto_drainer_t::lock_t lock(&drainer, throw_if_draining_t::YES);
             rwlock_in_line_t spot(&feeds_lock, access_t::write);
             spot.read_signal()->wait_lazily_unordered();
-            auto feed_it = feeds.find(uuid);
+            feed_key_t key(uuid, squash.as_bool());
+            auto feed_it = feeds.find(key);
             if (feed_it == feeds.end()) {
                 spot.write_signal()->wait_lazily_unordered();
                 namespace_interface_access_t access =
@@ -2495,8 +3143,8 @@ counted_t<datum_stream_t> client_t::new_stream(
                 // only be run for the first one.  Rather than mess
                 // about, just use the defaults.
                 auto val = make_scoped<real_feed_t>(
-                    lock, this, manager, access.get(), uuid, &interruptor);
-                feed_it = feeds.insert(std::make_pair(uuid, std::move(val))).first;
+                    lock, this, manager, access.get(), key, &interruptor);
+                feed_it = feeds.insert(std::make_pair(key, std::move(val))).first;
             }
 
             // We need to do this while holding `feeds_lock` to make sure the
@@ -2504,7 +3152,7 @@ counted_t<datum_stream_t> client_t::new_stream(
             on_thread_t th2(old_thread);
             real_feed_t *feed = feed_it->second.get();
             addr = feed->get_addr();
-            sub = new_sub(feed, squash, include_states, spec);
+            sub = new_sub(feed, squash, include_states, resume, spec);
         }
         namespace_interface_access_t access = namespace_source(uuid, env->interruptor);
         sub->start_real(env, table_name, access.get(), &addr);
@@ -2517,13 +3165,13 @@ counted_t<datum_stream_t> client_t::new_stream(
 }
 
 void client_t::maybe_remove_feed(
-    const auto_drainer_t::lock_t &lock, const uuid_u &uuid) {
+    const auto_drainer_t::lock_t &lock, const feed_key_t &key) {
     assert_thread();
     lock.assert_is_holding(&drainer);
     scoped_ptr_t<real_feed_t> destroy;
     rwlock_in_line_t spot(&feeds_lock, access_t::write);
     spot.write_signal()->wait_lazily_unordered();
-    auto feed_it = feeds.find(uuid);
+    auto feed_it = feeds.find(key);
     // The feed might have disappeared because it may have been detached while
     // we held the lock, in which case we don't need to do anything.  The feed
     // might also have gotten a new subscriber, in which case we don't want to
@@ -2537,7 +3185,7 @@ void client_t::maybe_remove_feed(
 }
 
 scoped_ptr_t<real_feed_t> client_t::detach_feed(
-    const auto_drainer_t::lock_t &lock, const uuid_u &uuid) {
+    const auto_drainer_t::lock_t &lock, const feed_key_t &key) {
     assert_thread();
     lock.assert_is_holding(&drainer);
     scoped_ptr_t<real_feed_t> ret;
@@ -2545,7 +3193,7 @@ scoped_ptr_t<real_feed_t> client_t::detach_feed(
     spot.write_signal()->wait_lazily_unordered();
     // The feed might have been removed in `maybe_remove_feed`, in which case
     // there's nothing to detach.
-    auto feed_it = feeds.find(uuid);
+    auto feed_it = feeds.find(key);
     if (feed_it != feeds.end()) {
         ret.swap(feed_it->second);
         feeds.erase(feed_it);
@@ -2585,7 +3233,7 @@ counted_t<datum_stream_t> artificial_t::subscribe(
     // on the thread you want to use them on.
     guarantee(feed.has());
     scoped_ptr_t<subscription_t> sub = new_sub(
-        feed.get(), datum_t::boolean(false), include_states, spec);
+        feed.get(), datum_t::boolean(false), include_states, resume_t(), spec);
     sub->start_artificial(env, uuid, primary_key_name, initial_values);
     return make_counted<stream_t>(std::move(sub), bt);
 }
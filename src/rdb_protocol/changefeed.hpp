@@ -14,6 +14,7 @@
 #include <boost/variant.hpp>
 
 #include "btree/keys.hpp"
+#include "concurrency/new_mutex.hpp"
 #include "concurrency/promise.hpp"
 #include "concurrency/rwlock.hpp"
 #include "containers/counted.hpp"
@@ -27,17 +28,22 @@
 #include "rpc/connectivity/peer_id.hpp"
 #include "rpc/mailbox/typed.hpp"
 #include "rpc/serialize_macros.hpp"
+#include "time.hpp"
+#include "utils.hpp"
 
 class artificial_table_backend_t;
 class auto_drainer_t;
 class base_table_t;
 class btree_slice_t;
+class io_backender_t;
 class mailbox_manager_t;
 class namespace_interface_access_t;
+class perfmon_collection_t;
 class real_superblock_t;
 class sindex_superblock_t;
 struct rdb_modification_report_t;
 struct sindex_disk_info_t;
+template <class T> class disk_backed_queue_t;
 
 namespace ql {
 
@@ -90,6 +96,9 @@ struct msg_t {
         /* For a newly-created row, `old_val` is an empty `datum_t`. For a deleted row,
         `new_val` is an empty `datum_t`. */
         datum_t old_val, new_val;
+        // The change's sequence number in the `server_t`'s change log, or 0 if
+        // it wasn't logged.
+        uint64_t log_seq;
         RDB_DECLARE_ME_SERIALIZABLE(change_t);
     };
     struct stop_t {
@@ -118,9 +127,9 @@ struct msg_t {
 RDB_DECLARE_SERIALIZABLE(msg_t);
 
 class real_feed_t;
-struct stamped_msg_t;
+struct stamped_msgs_t;
 
-typedef mailbox_addr_t<void(stamped_msg_t)> client_addr_t;
+typedef mailbox_addr_t<void(stamped_msgs_t)> client_addr_t;
 
 struct keyspec_t {
     struct range_t {
@@ -136,6 +145,13 @@ struct keyspec_t {
     struct point_t {
         datum_t key;
     };
+    // `count` or `sum` (optionally after `group`) over a range.  The initial
+    // value is read along with the stamps, and after that the subscription
+    // applies each change to its per-group totals.
+    struct aggregate_t {
+        range_t range;
+        terminal_variant_t terminal;
+    };
 
     keyspec_t(keyspec_t &&other)
         : spec(std::move(other.spec)),
@@ -157,7 +173,7 @@ struct keyspec_t {
     keyspec_t(const keyspec_t &) = default;
     keyspec_t &operator=(const keyspec_t &) = default;
 
-    typedef boost::variant<range_t, limit_t, point_t> spec_t;
+    typedef boost::variant<range_t, limit_t, point_t, aggregate_t> spec_t;
     spec_t spec;
     counted_t<base_table_t> table;
     std::string table_name;
@@ -167,6 +183,24 @@ region_t keyspec_to_region(const keyspec_t &keyspec);
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(keyspec_t::range_t);
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(keyspec_t::limit_t);
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(keyspec_t::point_t);
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(keyspec_t::aggregate_t);
+
+// A resume token maps the uuid of each changefeed `server_t` of a table to the
+// sequence number of the first change in its change log that the user hasn't
+// seen yet.  Range changefeeds can hand one out with every change and be
+// reopened with it as `since`.
+typedef std::map<uuid_u, uint64_t> resume_token_t;
+datum_t resume_token_to_datum(const resume_token_t &token);
+// Throws QL exceptions.
+resume_token_t datum_to_resume_token(const datum_t &d);
+
+struct resume_t {
+    resume_t() : include_token(false) { }
+    // If set, the changefeed starts by replaying the logged changes from here.
+    boost::optional<resume_token_t> since;
+    // Whether every change carries a `resume_token` field.
+    bool include_token;
+};
 
 // The `client_t` exists on the server handling the changefeed query, in the
 // `rdb_context_t`.  When a query subscribes to the changes on a table, it
@@ -188,19 +222,25 @@ public:
             > &_namespace_source
         );
     ~client_t();
+    // Feeds are keyed by table and by whether the servers are allowed to
+    // coalesce multiple changes to the same primary key into one (which is only
+    // OK if every subscription on the feed squashes).
+    typedef std::pair<namespace_id_t, bool> feed_key_t;
     // Throws QL exceptions.
     counted_t<datum_stream_t> new_stream(
         env_t *env,
         const datum_t &squash,
         bool include_states,
+        // Only allowed for range changefeeds.
+        const resume_t &resume,
         const namespace_id_t &table,
         const protob_t<const Backtrace> &bt,
         const std::string &table_name,
         const keyspec_t::spec_t &spec);
     void maybe_remove_feed(
-        const auto_drainer_t::lock_t &lock, const namespace_id_t &uuid);
+        const auto_drainer_t::lock_t &lock, const feed_key_t &key);
     scoped_ptr_t<real_feed_t> detach_feed(
-        const auto_drainer_t::lock_t &lock, const namespace_id_t &uuid);
+        const auto_drainer_t::lock_t &lock, const feed_key_t &key);
 private:
     friend class subscription_t;
     mailbox_manager_t *const manager;
@@ -209,7 +249,7 @@ private:
             const namespace_id_t &,
             signal_t *)
         > const namespace_source;
-    std::map<namespace_id_t, scoped_ptr_t<real_feed_t> > feeds;
+    std::map<feed_key_t, scoped_ptr_t<real_feed_t> > feeds;
     // This lock manages access to the `feeds` map.  The `feeds` map needs to be
     // read whenever `new_stream` is called, and needs to be written to whenever
     // `new_stream` is called with a table not already in the `feeds` map, or
@@ -414,6 +454,67 @@ public:
     auto_drainer_t drainer;
 };
 
+// A bounded log of the most recent changes on one `store_t`, so that a range
+// changefeed which lost its connection can be reopened from a resume token
+// instead of re-reading the table.  Every change gets the next sequence number
+// of the log.  `push` only appends to an in-memory buffer, which a background
+// coroutine moves to a temporary disk-backed queue, so writes never wait for
+// the disk.  The log doesn't survive restarts.
+class change_log_t {
+public:
+    change_log_t(io_backender_t *io_backender,
+                 const serializer_filepath_t &filename,
+                 perfmon_collection_t *stats_parent,
+                 size_t max_changes);
+    ~change_log_t();
+
+    // Sets `change->log_seq` and logs a copy of the change.  Never blocks.
+    void push(msg_t::change_t *change);
+    // The sequence number the next change will get.
+    uint64_t end_seq() const { return next_seq; }
+    // Appends every logged change in `region` with a sequence number in
+    // `[from_seq, to_seq)` to `changes_out`, oldest first.  Returns `false` if
+    // some of those changes have already been dropped from the log.
+    MUST_USE bool read_range(uint64_t from_seq,
+                             uint64_t to_seq,
+                             const region_t &region,
+                             std::vector<msg_t::change_t> *changes_out);
+private:
+    void flush(auto_drainer_t::lock_t lock);
+
+    const scoped_ptr_t<disk_backed_queue_t<msg_t::change_t> > queue;
+    const size_t max_changes;
+    // Changes that haven't been moved to `queue` yet, oldest first.  If the disk
+    // falls behind by more than `max_changes` the oldest ones are dropped.
+    std::deque<msg_t::change_t> pending;
+    // Every change with a sequence number in `[first_seq, next_seq)` is in
+    // `queue` or `pending`.  `queue` may also hold older, stale changes.
+    uint64_t first_seq, next_seq;
+    bool flush_scheduled;
+    // Held while moving changes to `queue` and while reading it.
+    new_mutex_t queue_mutex;
+    auto_drainer_t drainer;
+
+    DISABLE_COPYING(change_log_t);
+};
+
+// Adds `msg` to a batch of a client that squashes, under `stamp`.  `batch_changes`
+// holds the stamp of the change in `batch` for each primary key.  If `msg` is a
+// change to a primary key that already has one, the two are coalesced: the result
+// keeps the earlier change's `old_val` and takes the later change's `new_val` and
+// stamp, and it's dropped altogether if the two cancel out.
+//
+// This is intended.  The older `old_val` makes the coalesced change describe the
+// row's net change over the batch, which is what squashing subscriptions report
+// anyway.  The newer stamp is needed because a subscription ignores changes with
+// stamps from before it started: one that started between the two changes would
+// lose the later change if the coalesced one kept the earlier stamp.  It sees an
+// `old_val` from before it started instead, as it could with client-side squashing.
+void add_msg_to_squashing_batch(std::map<uint64_t, msg_t> *batch,
+                                std::map<store_key_t, uint64_t> *batch_changes,
+                                uint64_t stamp,
+                                msg_t &&msg);
+
 // There is one `server_t` per `store_t`, and it is used to send changes that
 // occur on that `store_t` to any subscribed `real_feed_t`s contained in a
 // `client_t`.
@@ -422,9 +523,16 @@ public:
     typedef server_addr_t addr_t;
     typedef mailbox_addr_t<void(client_t::addr_t, boost::optional<std::string>, uuid_u)>
         limit_addr_t;
-    explicit server_t(mailbox_manager_t *_manager);
+    // The change log is stored under `base_path`; it's only created once the
+    // first client subscribes, and never if `CHANGEFEED_LOG_MAX_CHANGES` is 0.
+    server_t(mailbox_manager_t *_manager,
+             io_backender_t *_io_backender,
+             const base_path_t &_base_path,
+             perfmon_collection_t *_perfmon_collection);
     ~server_t();
-    void add_client(const client_t::addr_t &addr, region_t region);
+    // If `squash` is true, changes to the same primary key that are waiting in
+    // the same batch are coalesced into one.
+    void add_client(const client_t::addr_t &addr, region_t region, bool squash);
     void add_limit_client(
         const client_t::addr_t &addr,
         const region_t &region,
@@ -436,11 +544,25 @@ public:
         limit_order_t lt,
         std::vector<item_t> &&start_data);
     // `key` should be non-NULL if there is a key associated with the message.
-    void send_all(const msg_t &msg, const store_key_t &key);
+    void send_all(msg_t msg, const store_key_t &key);
     void stop_all();
     addr_t get_stop_addr();
     limit_addr_t get_limit_stop_addr();
-    uint64_t get_stamp(const client_t::addr_t &addr);
+    // Also sets `*log_end_out` to the change log sequence number of the first
+    // change that will be sent with a stamp at or after the returned one (0 if
+    // there is no log).
+    uint64_t get_stamp(const client_t::addr_t &addr, uint64_t *log_end_out);
+    // Like `get_stamp`, but also reads the changes in `region` from the change
+    // log, starting with sequence number `since`.  Every change is either in
+    // `changes_out` or will be sent with a stamp at or after the returned one,
+    // never both.  `*complete_out` is set to `false` if the log doesn't cover
+    // `since`.  The log is read without holding `clients_lock`.
+    uint64_t get_stamp_and_replay(const client_t::addr_t &addr,
+                                  uint64_t since,
+                                  const region_t &region,
+                                  uint64_t *log_end_out,
+                                  std::vector<msg_t::change_t> *changes_out,
+                                  bool *complete_out);
     uuid_u get_uuid();
     // `f` will be called with a read lock on `clients` and a write lock on the
     // limit manager.
@@ -466,11 +588,27 @@ private:
     const uuid_u uuid;
     mailbox_manager_t *const manager;
 
+    io_backender_t *const io_backender;
+    const base_path_t base_path;
+    perfmon_collection_t *const perfmon_collection;
+    // Only accessed while holding `clients_lock`; written with a write lock.
+    scoped_ptr_t<change_log_t> log;
+
     struct client_info_t {
         client_info_t();
         scoped_ptr_t<cond_t> cond;
         uint64_t stamp;
         std::vector<region_t> regions;
+        bool squash;
+        // Messages that haven't been sent to the client yet, keyed by stamp.
+        // They are sent as one `stamped_msgs_t` covering the stamps in
+        // `[batch_start_stamp, stamp)`.
+        std::map<uint64_t, msg_t> batch;
+        uint64_t batch_start_stamp;
+        // The stamp of the `change_t` in `batch` for each primary key, used to
+        // coalesce changes when `squash` is true.
+        std::map<store_key_t, uint64_t> batch_changes;
+        bool flush_scheduled;
         std::map<boost::optional<std::string>,
                  std::vector<scoped_ptr_t<limit_manager_t> >,
                  // Be careful not to remove this, since optionals are
@@ -489,9 +627,19 @@ private:
         boost::optional<std::string> sindex,
         size_t offset);
 
+    // Adds `msg` to the client's current batch, which is sent after
+    // `CHANGEFEED_BATCH_WINDOW_MS` or as soon as it gets too big.
     void send_one_with_lock(const auto_drainer_t::lock_t &lock,
                             std::pair<const client_t::addr_t, client_info_t> *client,
                             msg_t msg);
+    // Like `send_one_with_lock`, but never blocks; returns `true` if the caller
+    // has to call `flush_batch` right away.
+    MUST_USE bool add_to_batch_with_lock(
+        const auto_drainer_t::lock_t &lock,
+        std::pair<const client_t::addr_t, client_info_t> *client,
+        msg_t msg);
+    void flush_batch(std::pair<const client_t::addr_t, client_info_t> *client);
+    void flush_batch_cb(auto_drainer_t::lock_t lock, client_t::addr_t addr);
 
     // Controls access to `clients`.  A `server_t` needs to read `clients` when:
     // * `send_all` is called
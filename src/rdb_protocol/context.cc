@@ -1,6 +1,7 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/context.hpp"
 
+#include "config/args.hpp"
 #include "rdb_protocol/query_cache.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "time.hpp"
@@ -17,13 +18,18 @@ rdb_context_t::stats_t::stats_t(perfmon_collection_t *global_stats)
       queries_per_sec_membership(&qe_stats_collection,
                                  &queries_per_sec, "queries_per_sec"),
       queries_total_membership(&qe_stats_collection,
-                               &queries_total, "queries_total") { }
+                               &queries_total, "queries_total"),
+      shard_round_trip_latency(secs_to_ticks(LATENCY_HISTOGRAM_INTERVAL_SECS)),
+      shard_round_trip_latency_membership(&qe_stats_collection,
+                                          &shard_round_trip_latency,
+                                          "shard_round_trip_latency_ms") { }
 
 rdb_context_t::rdb_context_t()
     : extproc_pool(nullptr),
       cluster_interface(nullptr),
       manager(nullptr),
       reql_http_proxy(),
+      slow_query_log(nullptr),
       stats(&get_global_perfmon_collection()) { }
 
 rdb_context_t::rdb_context_t(
@@ -33,6 +39,7 @@ rdb_context_t::rdb_context_t(
       cluster_interface(_cluster_interface),
       manager(nullptr),
       reql_http_proxy(),
+      slow_query_log(nullptr),
       stats(&get_global_perfmon_collection()) { }
 
 rdb_context_t::rdb_context_t(
@@ -42,12 +49,14 @@ rdb_context_t::rdb_context_t(
         boost::shared_ptr< semilattice_readwrite_view_t<auth_semilattice_metadata_t> >
             _auth_metadata,
         perfmon_collection_t *global_stats,
-        const std::string &_reql_http_proxy)
+        const std::string &_reql_http_proxy,
+        slow_query_log_t *_slow_query_log)
     : extproc_pool(_extproc_pool),
       cluster_interface(_cluster_interface),
       auth_metadata(_auth_metadata),
       manager(_mailbox_manager),
       reql_http_proxy(_reql_http_proxy),
+      slow_query_log(_slow_query_log),
       stats(global_stats)
 { }
 
@@ -85,6 +85,10 @@ public:
 
     virtual ql::datum_t read_row(ql::env_t *env,
         ql::datum_t pval, bool use_outdated) = 0;
+    /* Returns the rows with the given primary keys that exist, in the order of
+    `pvals`. A key that appears more than once in `pvals` yields its row each time. */
+    virtual std::vector<ql::datum_t> read_rows(ql::env_t *env,
+        const std::vector<ql::datum_t> &pvals, bool use_outdated) = 0;
     virtual counted_t<ql::datum_stream_t> read_all(
         ql::env_t *env,
         const std::string &sindex,
@@ -97,6 +101,7 @@ public:
         ql::env_t *env,
         const ql::datum_t &squash,
         bool include_states,
+        const ql::changefeed::resume_t &resume,
         ql::changefeed::keyspec_t::spec_t &&spec,
         const ql::protob_t<const Backtrace> &bt,
         const std::string &table_name) = 0;
@@ -259,6 +264,7 @@ protected:
 };
 
 class mailbox_manager_t;
+class slow_query_log_t;
 
 class rdb_context_t {
 public:
@@ -276,7 +282,8 @@ public:
                     semilattice_readwrite_view_t<
                         auth_semilattice_metadata_t> > _auth_metadata,
                   perfmon_collection_t *global_stats,
-                  const std::string &_reql_http_proxy);
+                  const std::string &_reql_http_proxy,
+                  slow_query_log_t *_slow_query_log);
 
     ~rdb_context_t();
 
@@ -290,6 +297,9 @@ public:
 
     const std::string reql_http_proxy;
 
+    // Finished queries are reported here; `NULL` in unit tests.
+    slow_query_log_t *const slow_query_log;
+
     class stats_t {
     public:
         explicit stats_t(perfmon_collection_t *global_stats);
@@ -304,6 +314,9 @@ public:
         perfmon_membership_t queries_per_sec_membership;
         perfmon_counter_t queries_total;
         perfmon_membership_t queries_total_membership;
+        // Time from sending a read or write to a shard until its reply arrives
+        perfmon_latency_histogram_t shard_round_trip_latency;
+        perfmon_membership_t shard_round_trip_latency_membership;
     private:
         DISABLE_COPYING(stats_t);
     } stats;
@@ -1450,8 +1450,20 @@ vector_datum_stream_t::vector_datum_stream_t(
         boost::optional<ql::changefeed::keyspec_t> &&_changespec) :
     eager_datum_stream_t(bt_source),
     rows(std::move(_rows)),
+    index(0) {
+    if (_changespec) {
+        changespecs.push_back(std::move(*_changespec));
+    }
+}
+
+vector_datum_stream_t::vector_datum_stream_t(
+        const protob_t<const Backtrace> &bt_source,
+        std::vector<datum_t> &&_rows,
+        std::vector<ql::changefeed::keyspec_t> &&_changespecs) :
+    eager_datum_stream_t(bt_source),
+    rows(std::move(_rows)),
     index(0),
-    changespec(std::move(_changespec)) { }
+    changespecs(std::move(_changespecs)) { }
 
 datum_t vector_datum_stream_t::next(
         env_t *env, const batchspec_t &bs) {
@@ -1486,8 +1498,8 @@ std::vector<datum_t> vector_datum_stream_t::next_raw_batch(
 
 void vector_datum_stream_t::add_transformation(
     transform_variant_t &&tv, const protob_t<const Backtrace> &bt) {
-    if (changespec) {
-        if (auto *rng = boost::get<changefeed::keyspec_t::range_t>(&changespec->spec)) {
+    for (auto &&changespec : changespecs) {
+        if (auto *rng = boost::get<changefeed::keyspec_t::range_t>(&changespec.spec)) {
             rng->transforms.push_back(tv);
         }
     }
@@ -1511,8 +1523,8 @@ bool vector_datum_stream_t::is_infinite() const {
 }
 
 std::vector<changefeed::keyspec_t> vector_datum_stream_t::get_change_specs() {
-    if (changespec) {
-        return std::vector<changefeed::keyspec_t>{*changespec};
+    if (!changespecs.empty()) {
+        return changespecs;
     } else {
         rfail(base_exc_t::GENERIC, "%s", "Cannot call `changes` on this stream.");
     }
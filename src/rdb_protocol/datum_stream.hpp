@@ -686,6 +686,10 @@ public:
             const protob_t<const Backtrace> &bt_source,
             std::vector<datum_t> &&_rows,
             boost::optional<ql::changefeed::keyspec_t> &&_changespec);
+    vector_datum_stream_t(
+            const protob_t<const Backtrace> &bt_source,
+            std::vector<datum_t> &&_rows,
+            std::vector<ql::changefeed::keyspec_t> &&_changespecs);
 private:
     datum_t next(env_t *env, const batchspec_t &bs);
     datum_t next_impl(env_t *);
@@ -703,7 +707,7 @@ private:
 
     std::vector<datum_t> rows;
     size_t index;
-    boost::optional<ql::changefeed::keyspec_t> changespec;
+    std::vector<ql::changefeed::keyspec_t> changespecs;
 };
 
 } // namespace ql
@@ -1,5 +1,8 @@
 #include "rdb_protocol/func.hpp"
 
+#include <algorithm>
+
+#include "config/args.hpp"
 #include "rdb_protocol/counted_term.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/minidriver.hpp"
@@ -32,6 +35,24 @@ scoped_ptr_t<val_t> func_t::call(env_t *env,
     return call(env, make_vector(arg1, arg2), eval_flags);
 }
 
+void func_t::map_batch(env_t *env, std::vector<datum_t> *args) const {
+    for (auto it = args->begin(); it != args->end(); ++it) {
+        *it = call(env, *it)->as_datum();
+    }
+}
+
+std::vector<bool> func_t::filter_batch(
+        env_t *env,
+        const std::vector<datum_t> &args,
+        counted_t<const func_t> default_filter_val) const {
+    std::vector<bool> keep;
+    keep.reserve(args.size());
+    for (auto it = args.begin(); it != args.end(); ++it) {
+        keep.push_back(filter_call(env, *it, default_filter_val));
+    }
+    return keep;
+}
+
 void func_t::assert_deterministic(const char *extra_msg) const {
     rcheck(is_deterministic(),
            base_exc_t::GENERIC,
@@ -74,6 +95,27 @@ scoped_ptr_t<val_t> reql_func_t::call(env_t *env,
     }
 }
 
+void reql_func_t::map_batch(env_t *env, std::vector<datum_t> *args) const {
+    if (arg_names.size() > 1) {
+        // `call()` reports the wrong number of arguments.
+        func_t::map_batch(env, args);
+        return;
+    }
+    try {
+        std::vector<var_scope_t> scopes;
+        scopes.reserve(args->size());
+        for (const datum_t &arg : *args) {
+            scopes.push_back(arg_names.size() == 0
+                             ? captured_scope
+                             : captured_scope.with_func_arg_list(arg_names,
+                                                                 make_vector(arg)));
+        }
+        *args = body->eval_batch(env, scopes);
+    } catch (const datum_exc_t &e) {
+        rfail(e.get_type(), "%s", e.what());
+    }
+}
+
 boost::optional<size_t> reql_func_t::arity() const {
     return arg_names.size();
 }
@@ -115,15 +157,100 @@ scoped_ptr_t<val_t> js_func_t::call(
                   js_source.c_str(), js_timeout_ms / 1000, js_timeout_ms % 1000);
         }
 
-        return scoped_ptr_t<val_t>(
-                boost::apply_visitor(
-                        js_result_visitor_t(js_source, js_timeout_ms, this), result));
+        return result_to_val(result);
     } catch (const datum_exc_t &e) {
         rfail(e.get_type(), "%s", e.what());
         unreachable();
     }
 }
 
+void js_func_t::map_batch(env_t *env, std::vector<datum_t> *args) const {
+    if (args->empty()) {
+        return;
+    }
+    try {
+        std::vector<js_result_t> results = call_batch(env, *args);
+        for (size_t i = 0; i < results.size(); ++i) {
+            (*args)[i] = result_to_val(results[i])->as_datum();
+        }
+        r_sanity_check(results.size() == args->size());
+    } catch (const datum_exc_t &e) {
+        rfail(e.get_type(), "%s", e.what());
+        unreachable();
+    }
+}
+
+std::vector<bool> js_func_t::filter_batch(
+        env_t *env,
+        const std::vector<datum_t> &args,
+        counted_t<const func_t> default_filter_val) const {
+    std::vector<bool> keep;
+    if (args.empty()) {
+        return keep;
+    }
+    std::vector<js_result_t> results = call_batch(env, args);
+    keep.reserve(results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        keep.push_back(apply_filter_default(
+            env,
+            [&]() { return result_to_val(results[i])->as_datum().as_bool(); },
+            default_filter_val));
+    }
+    r_sanity_check(keep.size() == args.size());
+    return keep;
+}
+
+std::vector<js_result_t> js_func_t::call_batch(env_t *env,
+                                               const std::vector<datum_t> &args) const {
+    js_runner_t::req_config_t config;
+    config.timeout_ms = js_timeout_ms;
+
+    r_sanity_check(!js_source.empty());
+    std::vector<js_result_t> results;
+    results.reserve(args.size());
+    std::vector<std::vector<datum_t> > args_batch;
+    for (size_t start = 0; start < args.size(); start += JS_CALL_BATCH_SIZE) {
+        const size_t end = std::min<size_t>(args.size(), start + JS_CALL_BATCH_SIZE);
+        args_batch.clear();
+        for (size_t i = start; i < end; ++i) {
+            args_batch.push_back(make_vector(args[i]));
+        }
+
+        std::vector<js_result_t> batch_results;
+        try {
+            batch_results =
+                env->get_js_runner()->call_batch(js_source, args_batch, config);
+        } catch (const extproc_worker_exc_t &e) {
+            rfail(base_exc_t::GENERIC,
+                  "Javascript query `%s` caused a crash in a worker process.",
+                  js_source.c_str());
+        } catch (const interrupted_exc_t &e) {
+            rfail(base_exc_t::GENERIC,
+                  "JavaScript query `%s` timed out after "
+                  "%" PRIu64 ".%03" PRIu64 " seconds.",
+                  js_source.c_str(), js_timeout_ms / 1000, js_timeout_ms % 1000);
+        }
+
+        bool failed = false;
+        for (auto it = batch_results.begin(); it != batch_results.end(); ++it) {
+            failed |= boost::get<std::string>(&*it) != NULL;
+            results.push_back(std::move(*it));
+        }
+        // An error ends the `map` or `filter`, so there's no point in making the calls
+        // for the rest of the rows.
+        if (failed) {
+            break;
+        }
+    }
+    return results;
+}
+
+scoped_ptr_t<val_t> js_func_t::result_to_val(const js_result_t &result) const {
+    return scoped_ptr_t<val_t>(
+            boost::apply_visitor(
+                    js_result_visitor_t(js_source, js_timeout_ms, this), result));
+}
+
 boost::optional<size_t> js_func_t::arity() const {
     return boost::none;
 }
@@ -288,13 +415,21 @@ bool js_func_t::filter_helper(env_t *env, datum_t arg) const {
 }
 
 bool func_t::filter_call(env_t *env, datum_t arg, counted_t<const func_t> default_filter_val) const {
+    return apply_filter_default(env,
+                                [&]() { return filter_helper(env, arg); },
+                                default_filter_val);
+}
+
+bool func_t::apply_filter_default(env_t *env,
+                                  const std::function<bool()> &filter_helper,
+                                  counted_t<const func_t> default_filter_val) {
     // We have to catch every exception type and save it so we can rethrow it later
     // So we don't trigger a coroutine wait in a catch statement
     std::exception_ptr saved_exception;
     base_exc_t::type_t exception_type;
 
     try {
-        return filter_helper(env, arg);
+        return filter_helper();
     } catch (const base_exc_t &e) {
         saved_exception = std::current_exception();
         exception_type = e.get_type();
@@ -2,6 +2,7 @@
 #ifndef RDB_PROTOCOL_FUNC_HPP_
 #define RDB_PROTOCOL_FUNC_HPP_
 
+#include <functional>
 #include <map>
 #include <string>
 #include <utility>
@@ -49,6 +50,19 @@ public:
                      datum_t arg,
                      counted_t<const func_t> default_filter_val) const;
 
+    // Batched versions of `call()` with one argument and of `filter_call()`, for the
+    // `map` and `filter` transforms. `map_batch()` replaces each element of `args` by
+    // the function's result for it, and `filter_batch()` returns whether to keep each
+    // element. They behave like the unbatched versions called on each element in
+    // order, except that `js_func_t` makes all the calls with one round trip to the
+    // JavaScript worker and throws the first error only after they have all run.
+    // `reql_func_t::map_batch()` leaves it to the body (see `term_t::eval_batch()`).
+    virtual void map_batch(env_t *env, std::vector<datum_t> *args) const;
+    virtual std::vector<bool> filter_batch(
+        env_t *env,
+        const std::vector<datum_t> &args,
+        counted_t<const func_t> default_filter_val) const;
+
     // These are simple, they call the vector version of call.
     scoped_ptr_t<val_t> call(env_t *env, eval_flags_t eval_flags = NO_FLAGS) const;
     scoped_ptr_t<val_t> call(env_t *env,
@@ -62,6 +76,12 @@ public:
 protected:
     explicit func_t(const protob_t<const Backtrace> &bt_source);
 
+    // Returns the result of `filter_helper`, or applies `default_filter_val` if it
+    // throws a non-existence error. `filter_call()` and `filter_batch()` share this.
+    static bool apply_filter_default(env_t *env,
+                                     const std::function<bool()> &filter_helper,
+                                     counted_t<const func_t> default_filter_val);
+
 private:
     virtual bool filter_helper(env_t *env, datum_t arg) const = 0;
 
@@ -89,6 +109,8 @@ public:
 
     void visit(func_visitor_t *visitor) const;
 
+    void map_batch(env_t *env, std::vector<datum_t> *args) const;
+
 private:
     template <cluster_version_t> friend class wire_func_serialization_visitor_t;
     bool filter_helper(env_t *env, datum_t arg) const;
@@ -126,10 +148,22 @@ public:
 
     void visit(func_visitor_t *visitor) const;
 
+    void map_batch(env_t *env, std::vector<datum_t> *args) const;
+    std::vector<bool> filter_batch(
+        env_t *env,
+        const std::vector<datum_t> &args,
+        counted_t<const func_t> default_filter_val) const;
+
 private:
     template <cluster_version_t> friend class wire_func_serialization_visitor_t;
     bool filter_helper(env_t *env, datum_t arg) const;
 
+    // Calls the function on each of `args` with `js_runner_t::call_batch()`, in
+    // batches of `JS_CALL_BATCH_SIZE`.
+    std::vector<js_result_t> call_batch(env_t *env,
+                                        const std::vector<datum_t> &args) const;
+    scoped_ptr_t<val_t> result_to_val(const js_result_t &result) const;
+
     std::string js_source;
     uint64_t js_timeout_ms;
 
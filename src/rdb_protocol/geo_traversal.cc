@@ -6,6 +6,7 @@
 #include "errors.hpp"
 #include <boost/variant/get.hpp>
 
+#include "perfmon/resource_usage.hpp"
 #include "rdb_protocol/batching.hpp"
 #include "rdb_protocol/configured_limits.hpp"
 #include "rdb_protocol/datum.hpp"
@@ -115,6 +116,7 @@ done_traversing_t geo_intersecting_cb_t::on_candidate(scoped_key_value_t &&keyva
     ql::datum_t val = row.get();
     slice->stats.pm_keys_read.record();
     slice->stats.pm_total_keys_read += 1;
+    resource_usage_t::note_rows_scanned(1);
     guarantee(!row.references_parent());
     keyvalue.reset();
 
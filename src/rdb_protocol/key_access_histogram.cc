@@ -0,0 +1,74 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "rdb_protocol/key_access_histogram.hpp"
+
+#include <math.h>
+
+#include "config/args.hpp"
+
+key_access_histogram_t::key_access_histogram_t()
+    : total_weight(0), last_decay_time(get_ticks()) { }
+
+void key_access_histogram_t::record(const store_key_t &key, double weight) {
+    assert_thread();
+    decay(get_ticks());
+    buckets[key] += weight;
+    total_weight += weight;
+    if (buckets.size() > 2 * KEY_ACCESS_HISTOGRAM_BUCKETS) {
+        rebin();
+    }
+}
+
+void key_access_histogram_t::get_loads(const key_range_t &range,
+                                       std::map<store_key_t, int64_t> *loads_out) {
+    assert_thread();
+    decay(get_ticks());
+    for (auto it = buckets.lower_bound(range.left); it != buckets.end(); ++it) {
+        if (!range.contains_key(it->first)) {
+            break;
+        }
+        int64_t load = llround(it->second);
+        if (load > 0) {
+            (*loads_out)[it->first] += load;
+        }
+    }
+}
+
+void key_access_histogram_t::decay(ticks_t now) {
+    /* Decaying touches every bucket, so we don't do it more often than once a
+    second. */
+    if (now < last_decay_time + secs_to_ticks(1)) {
+        return;
+    }
+    double factor = pow(0.5, ticks_to_secs(now - last_decay_time)
+                             / KEY_ACCESS_HALF_LIFE_SECS);
+    total_weight = 0;
+    for (auto it = buckets.begin(); it != buckets.end();) {
+        it->second *= factor;
+        if (it->second < 0.01) {
+            buckets.erase(it++);
+        } else {
+            total_weight += it->second;
+            ++it;
+        }
+    }
+    last_decay_time = now;
+}
+
+void key_access_histogram_t::rebin() {
+    /* Merges neighbouring buckets as long as they weigh at most `target_weight`
+    together. Each merged bucket keeps the left boundary of its first part. Any two
+    neighbouring buckets weigh more than `target_weight` afterwards, so at most about
+    `KEY_ACCESS_HISTOGRAM_BUCKETS` remain. */
+    double target_weight = 2 * total_weight / KEY_ACCESS_HISTOGRAM_BUCKETS;
+    auto current = buckets.begin();
+    auto it = current;
+    for (++it; it != buckets.end();) {
+        if (current->second + it->second <= target_weight) {
+            current->second += it->second;
+            buckets.erase(it++);
+        } else {
+            current = it;
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,42 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_KEY_ACCESS_HISTOGRAM_HPP_
+#define RDB_PROTOCOL_KEY_ACCESS_HISTOGRAM_HPP_
+
+#include <map>
+
+#include "btree/keys.hpp"
+#include "threading.hpp"
+#include "time.hpp"
+
+/* `key_access_histogram_t` keeps track of how the recent reads and writes of a store
+are distributed over its keys, so that the split points can be chosen to balance the
+load between the shards (see `calculate_split_points_with_load()`). It's a histogram
+of at most about `KEY_ACCESS_HISTOGRAM_BUCKETS` buckets whose boundaries follow the
+accessed keys, so that busy key ranges get finer buckets. Old accesses fade out with
+a half-life of `KEY_ACCESS_HALF_LIFE_SECS`. */
+class key_access_histogram_t : public home_thread_mixin_debug_only_t {
+public:
+    key_access_histogram_t();
+
+    /* Records `weight` accesses to `key`. Range reads record one key for every
+    `KEY_ACCESS_RANGE_SAMPLE_ROWS` rows they scan, with that many accesses. */
+    void record(const store_key_t &key, double weight = 1.0);
+
+    /* Fills `loads_out` like `distribution_read_response_t::key_counts`: each key
+    maps to the (decayed) number of accesses between it and the next key. Only keys
+    in `range` are included. */
+    void get_loads(const key_range_t &range, std::map<store_key_t, int64_t> *loads_out);
+
+private:
+    void decay(ticks_t now);
+    void rebin();
+
+    /* Maps the left boundary of every bucket to its weight */
+    std::map<store_key_t, double> buckets;
+    double total_weight;
+    ticks_t last_decay_time;
+
+    DISABLE_COPYING(key_access_histogram_t);
+};
+
+#endif  // RDB_PROTOCOL_KEY_ACCESS_HISTOGRAM_HPP_
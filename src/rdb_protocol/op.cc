@@ -191,8 +191,23 @@ op_term_t::op_term_t(compile_env_t *env, protob_t<const Term> term,
 }
 op_term_t::~op_term_t() { }
 
+const std::vector<counted_t<const term_t> > &op_term_t::get_original_args() const {
+    return arg_terms->get_original_args();
+}
+
 scoped_ptr_t<val_t> op_term_t::term_eval(scope_env_t *env,
                                          eval_flags_t eval_flags) const {
+    scoped_ptr_t<val_t> grouped_val;
+    scoped_ptr_t<args_t> args = eval_args(env, eval_flags, &grouped_val);
+    if (!args.has()) {
+        return grouped_val;
+    }
+    return eval_impl(env, args.get(), eval_flags);
+}
+
+scoped_ptr_t<args_t> op_term_t::eval_args(scope_env_t *env,
+                                          eval_flags_t eval_flags,
+                                          scoped_ptr_t<val_t> *grouped_val_out) const {
     argvec_t argv = arg_terms->start_eval(env, eval_flags);
     if (can_be_grouped()) {
         counted_t<grouped_data_t> gd;
@@ -211,14 +226,13 @@ scoped_ptr_t<val_t> op_term_t::term_eval(scope_env_t *env,
                 args_t args(this, argv, make_scoped<val_t>(kv->second, backtrace()));
                 (*out)[kv->first] = eval_impl(env, &args, eval_flags)->as_datum();
             }
-            return make_scoped<val_t>(out, backtrace());
+            *grouped_val_out = make_scoped<val_t>(out, backtrace());
+            return scoped_ptr_t<args_t>();
         } else {
-            args_t args(this, std::move(argv), std::move(arg0));
-            return eval_impl(env, &args, eval_flags);
+            return make_scoped<args_t>(this, std::move(argv), std::move(arg0));
         }
     } else {
-        args_t args(this, std::move(argv));
-        return eval_impl(env, &args, eval_flags);
+        return make_scoped<args_t>(this, std::move(argv));
     }
 }
 
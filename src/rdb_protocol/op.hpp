@@ -109,6 +109,11 @@ void accumulate_all_captures(
 // Almost all terms will inherit from this and use its member functions to
 // access their arguments.
 class op_term_t : public term_t {
+public:
+    // The compiled arguments as they were written, before any `r.args` in them are
+    // expanded.
+    const std::vector<counted_t<const term_t> > &get_original_args() const;
+
 protected:
     op_term_t(compile_env_t *env, protob_t<const Term> term,
               argspec_t argspec, optargspec_t optargspec = optargspec_t({}));
@@ -128,6 +133,14 @@ protected:
     // a subclass).
     virtual void accumulate_captures(var_captures_t *captures) const;
 
+    // The first half of `term_eval()`, for overrides of `eval_batch()` that need the
+    // arguments of each evaluation before making them all at once.  If the first
+    // argument is grouped data, `eval_impl()` is called for each group right away, and
+    // this sets `*grouped_val_out` to the result and returns an empty pointer.
+    scoped_ptr_t<args_t> eval_args(scope_env_t *env,
+                                   eval_flags_t eval_flags,
+                                   scoped_ptr_t<val_t> *grouped_val_out) const;
+
 private:
     friend class args_t;
     // Tries to get an optional argument, returns `scoped_ptr_t<val_t>()` if not found.
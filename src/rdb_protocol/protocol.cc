@@ -138,7 +138,7 @@ void post_construct_and_drain_queue(
     THROWS_NOTHING
 {
     std::set<uuid_u> sindexes_to_bring_up_to_date;
-    parallel_traversal_progress_t progress_tracker;
+    sindex_post_construction_progress_t progress_tracker;
     std::vector<map_insertion_sentry_t<
         store_t::sindex_context_map_t::key_type,
         store_t::sindex_context_map_t::mapped_type> > sindex_context_sentries;
@@ -164,6 +164,7 @@ void post_construct_and_drain_queue(
         post_construct_secondary_indexes(
             store,
             sindexes_to_bring_up_to_date,
+            SINDEX_POST_CONSTRUCTION_SORT_BUFFER_SIZE,
             lock.get_drain_signal(),
             &progress_tracker);
 
@@ -234,6 +235,7 @@ void post_construct_and_drain_queue(
                                     &deletion_context,
                                     NULL,
                                     NULL,
+                                    NULL,
                                     NULL);
                 ++current_chunk_size;
             }
@@ -359,12 +361,26 @@ store_key_t sindex_list_region_key() {
     return store_key_t();
 }
 
+point_multi_read_t::point_multi_read_t(std::vector<store_key_t> &&_keys)
+    : keys(std::move(_keys)) {
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    if (!keys.empty()) {
+        region = region_t(key_range_t(key_range_t::closed, keys.front(),
+                                      key_range_t::closed, keys.back()));
+    }
+}
+
 /* read_t::get_region implementation */
 struct rdb_r_get_region_visitor : public boost::static_visitor<region_t> {
     region_t operator()(const point_read_t &pr) const {
         return rdb_protocol::monokey_region(pr.key);
     }
 
+    region_t operator()(const point_multi_read_t &pmr) const {
+        return pmr.region;
+    }
+
     region_t operator()(const rget_read_t &rg) const {
         return rg.region;
     }
@@ -434,6 +450,21 @@ struct rdb_r_shard_visitor_t : public boost::static_visitor<bool> {
         return keyed_read(pr, pr.key);
     }
 
+    bool operator()(const point_multi_read_t &pmr) const {
+        point_multi_read_t tmp;
+        for (const store_key_t &key : pmr.keys) {
+            if (region_contains_key(*region, key)) {
+                tmp.keys.push_back(key);
+            }
+        }
+        if (tmp.keys.empty()) {
+            return false;
+        }
+        tmp.region = region_intersection(*region, pmr.region);
+        *payload_out = std::move(tmp);
+        return true;
+    }
+
     template <class T>
     bool rangey_read(const T &arg) const {
         const hash_region_t<key_range_t> intersection
@@ -457,7 +488,13 @@ struct rdb_r_shard_visitor_t : public boost::static_visitor<bool> {
     }
 
     bool operator()(const changefeed_stamp_t &t) const {
-        return rangey_read(t);
+        bool do_read = rangey_read(t);
+        if (do_read && t.initial) {
+            auto t_out = boost::get<changefeed_stamp_t>(payload_out);
+            t_out->initial->region
+                = region_intersection(t_out->region, t.initial->region);
+        }
+        return do_read;
     }
 
     bool operator()(const changefeed_point_stamp_t &t) const {
@@ -506,6 +543,7 @@ bool read_t::shard(const hash_region_t<key_range_t> &region,
     read_t::variant_t payload;
     bool result = boost::apply_visitor(rdb_r_shard_visitor_t(&region, &payload), read);
     *read_out = read_t(payload, profile);
+    read_out->max_staleness_ms = max_staleness_ms;
     return result;
 }
 
@@ -553,6 +591,7 @@ public:
           ctx(_ctx), interruptor(_interruptor) { }
 
     void operator()(const point_read_t &);
+    void operator()(const point_multi_read_t &);
 
     void operator()(const rget_read_t &rg);
     void operator()(const intersecting_geo_read_t &gr);
@@ -615,9 +654,10 @@ void rdb_r_unshard_visitor_t::operator()(const changefeed_limit_subscribe_t &) {
         changefeed_limit_subscribe_response_t(shards, std::move(limit_addrs));
 }
 
-void rdb_r_unshard_visitor_t::operator()(const changefeed_stamp_t &) {
+void rdb_r_unshard_visitor_t::operator()(const changefeed_stamp_t &q) {
     response_out->response = changefeed_stamp_response_t();
     auto out = boost::get<changefeed_stamp_response_t>(&response_out->response);
+    std::vector<ql::result_t *> results;
     for (size_t i = 0; i < count; ++i) {
         auto res = boost::get<changefeed_stamp_response_t>(&responses[i].response);
         for (auto it = res->stamps.begin(); it != res->stamps.end(); ++it) {
@@ -628,6 +668,37 @@ void rdb_r_unshard_visitor_t::operator()(const changefeed_stamp_t &) {
                 it_out->second = std::max(it->second, it_out->second);
             }
         }
+        for (const auto &pair : res->log_ends) {
+            uint64_t *log_end = &out->log_ends[pair.first];
+            *log_end = std::max(*log_end, pair.second);
+        }
+        // A `server_t` can answer for several disjoint regions, so we
+        // concatenate rather than replace.
+        for (auto &&pair : res->replay) {
+            auto *vec = &out->replay[pair.first];
+            std::move(pair.second.begin(), pair.second.end(),
+                      std::back_inserter(*vec));
+        }
+        out->replay_complete = out->replay_complete && res->replay_complete;
+        if (res->initial) {
+            results.push_back(&res->initial->result);
+        }
+    }
+    if (q.initial) {
+        guarantee(q.initial->terminal);
+        guarantee(results.size() == count);
+        out->initial = rget_read_response_t();
+        scoped_ptr_t<profile::trace_t> trace = ql::maybe_make_profile_trace(profile);
+        ql::env_t env(ctx, ql::return_empty_normal_batches_t::NO,
+                      interruptor, q.initial->optargs, trace.get_or_null());
+        try {
+            scoped_ptr_t<ql::accumulator_t> acc(
+                ql::make_terminal(*q.initial->terminal));
+            acc->unshard(&env, store_key_t::max(), results);
+            acc->finish(&out->initial->result);
+        } catch (const ql::exc_t &ex) {
+            out->initial = rget_read_response_t(ex);
+        }
     }
 }
 
@@ -643,6 +714,16 @@ void rdb_r_unshard_visitor_t::operator()(const point_read_t &) {
     *response_out = responses[0];
 }
 
+void rdb_r_unshard_visitor_t::operator()(const point_multi_read_t &) {
+    response_out->response = point_multi_read_response_t();
+    auto out = boost::get<point_multi_read_response_t>(&response_out->response);
+    for (size_t i = 0; i < count; ++i) {
+        auto res = boost::get<point_multi_read_response_t>(&responses[i].response);
+        guarantee(res != NULL);
+        std::move(res->data.begin(), res->data.end(), std::back_inserter(out->data));
+    }
+}
+
 void rdb_r_unshard_visitor_t::operator()(const intersecting_geo_read_t &query) {
     unshard_range_batch<rget_read_response_t>(query, sorting_t::UNORDERED);
 }
@@ -839,10 +920,20 @@ void rdb_r_unshard_visitor_t::operator()(const distribution_read_t &dg) {
         }
     }
 
+    // Every shard and hash shard counts its own accesses, so they just add up.
+    for (size_t j = 0; j < results.size(); ++j) {
+        for (const auto &pair : results[j].key_loads) {
+            res.key_loads[pair.first] += pair.second;
+        }
+    }
+
     // If the result is larger than the requested limit, scale it down
     if (dg.result_limit > 0 && res.key_counts.size() > dg.result_limit) {
         scale_down_distribution(dg.result_limit, &res.key_counts);
     }
+    if (dg.result_limit > 0 && res.key_loads.size() > dg.result_limit) {
+        scale_down_distribution(dg.result_limit, &res.key_loads);
+    }
 
     response_out->response = res;
 }
@@ -884,6 +975,10 @@ void read_t::unshard(read_response_t *responses, size_t count,
      * we set them here. */
     response_out->n_shards = 0;
     response_out->event_log.clear();
+    response_out->resource_usage = resource_usage_t();
+    for (size_t i = 0; i < count; ++i) {
+        response_out->resource_usage.add(responses[i].resource_usage);
+    }
     if (profile == profile_bool_t::PROFILE) {
         for (size_t i = 0; i < count; ++i) {
             response_out->event_log.insert(
@@ -897,6 +992,7 @@ void read_t::unshard(read_response_t *responses, size_t count,
 
 struct use_snapshot_visitor_t : public boost::static_visitor<bool> {
     bool operator()(const point_read_t &) const {                 return false; }
+    bool operator()(const point_multi_read_t &) const {           return false; }
     bool operator()(const dummy_read_t &) const {                 return false; }
     bool operator()(const rget_read_t &) const {                  return true;  }
     bool operator()(const intersecting_geo_read_t &) const {      return true;  }
@@ -918,6 +1014,7 @@ bool read_t::use_snapshot() const THROWS_NOTHING {
 
 struct route_to_primary_visitor_t : public boost::static_visitor<bool> {
     bool operator()(const point_read_t &) const {                 return false; }
+    bool operator()(const point_multi_read_t &) const {           return false; }
     bool operator()(const dummy_read_t &) const {                 return false; }
     bool operator()(const rget_read_t &) const {                  return false; }
     bool operator()(const intersecting_geo_read_t &) const {      return false; }
@@ -1234,6 +1331,10 @@ void write_t::unshard(write_response_t *responses, size_t count,
      * we set them here. */
     response_out->n_shards = 0;
     response_out->event_log.clear();
+    response_out->resource_usage = resource_usage_t();
+    for (size_t i = 0; i < count; ++i) {
+        response_out->resource_usage.add(responses[i].resource_usage);
+    }
     if (profile == profile_bool_t::PROFILE) {
         for (size_t i = 0; i < count; ++i) {
             response_out->event_log.insert(
@@ -1257,26 +1358,59 @@ RDB_IMPL_SERIALIZABLE_7_FOR_CLUSTER(
         outdated);
 
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(point_read_response_t, data);
+RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(point_multi_read_response_t, data);
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(
     ql::skey_version_t, int8_t,
     ql::skey_version_t::pre_1_16, ql::skey_version_t::post_1_16);
 RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(rget_read_response_t,
                                     result, skey_version, truncated, last_key);
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(nearest_geo_read_response_t, results_or_error);
-RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(distribution_read_response_t, region, key_counts);
+RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(distribution_read_response_t, region, key_counts,
+                                    key_loads);
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(sindex_list_response_t, sindexes);
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(sindex_status_response_t, statuses);
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
     changefeed_subscribe_response_t, server_uuids, addrs);
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
     changefeed_limit_subscribe_response_t, shards, limit_addrs);
-RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(changefeed_stamp_response_t, stamps);
+RDB_IMPL_SERIALIZABLE_5_FOR_CLUSTER(
+    changefeed_stamp_response_t,
+    stamps, log_ends, replay, replay_complete, initial);
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
     changefeed_point_stamp_response_t, stamp, initial_val);
-RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(read_response_t, response, event_log, n_shards);
+// `resource_usage` was added in v2_1.
+template <cluster_version_t W>
+void serialize(write_message_t *wm, const read_response_t &r) {
+    serialize<W>(wm, r.response);
+    serialize<W>(wm, r.event_log);
+    serialize<W>(wm, r.n_shards);
+    if (W >= cluster_version_t::v2_1) {
+        serialize<W>(wm, r.resource_usage);
+    }
+}
+
+template <cluster_version_t W>
+archive_result_t deserialize(read_stream_t *s, read_response_t *r) {
+    archive_result_t res = deserialize<W>(s, &r->response);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &r->event_log);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &r->n_shards);
+    if (bad(res)) { return res; }
+    if (W >= cluster_version_t::v2_1) {
+        res = deserialize<W>(s, &r->resource_usage);
+        if (bad(res)) { return res; }
+    } else {
+        r->resource_usage = resource_usage_t();
+    }
+    return archive_result_t::SUCCESS;
+}
+
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(read_response_t);
 RDB_IMPL_SERIALIZABLE_0_FOR_CLUSTER(dummy_read_response_t);
 
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(point_read_t, key);
+RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(point_multi_read_t, region, keys);
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(dummy_read_t, region);
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(sindex_rangespec_t, id, region, original_range);
 
@@ -1298,13 +1432,13 @@ RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
 RDB_IMPL_SERIALIZABLE_0_FOR_CLUSTER(sindex_list_t);
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(sindex_status_t, sindexes, region);
 
-RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(changefeed_subscribe_t, addr, region);
+RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(changefeed_subscribe_t, addr, region, squash);
 RDB_IMPL_SERIALIZABLE_5_FOR_CLUSTER(
     changefeed_limit_subscribe_t, addr, uuid, spec, table, region);
-RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(changefeed_stamp_t, addr, region);
+RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(changefeed_stamp_t, addr, region, since, initial);
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(changefeed_point_stamp_t, addr, key);
 
-RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(read_t, read, profile);
+RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(read_t, read, profile, max_staleness_ms);
 
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(point_write_response_t, result);
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(point_delete_response_t, result);
@@ -1315,7 +1449,35 @@ RDB_IMPL_SERIALIZABLE_0_FOR_CLUSTER(dummy_write_response_t);
 
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(sindex_rename_response_t, result);
 
-RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(write_response_t, response, event_log, n_shards);
+// `resource_usage` was added in v2_1.
+template <cluster_version_t W>
+void serialize(write_message_t *wm, const write_response_t &r) {
+    serialize<W>(wm, r.response);
+    serialize<W>(wm, r.event_log);
+    serialize<W>(wm, r.n_shards);
+    if (W >= cluster_version_t::v2_1) {
+        serialize<W>(wm, r.resource_usage);
+    }
+}
+
+template <cluster_version_t W>
+archive_result_t deserialize(read_stream_t *s, write_response_t *r) {
+    archive_result_t res = deserialize<W>(s, &r->response);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &r->event_log);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &r->n_shards);
+    if (bad(res)) { return res; }
+    if (W >= cluster_version_t::v2_1) {
+        res = deserialize<W>(s, &r->resource_usage);
+        if (bad(res)) { return res; }
+    } else {
+        r->resource_usage = resource_usage_t();
+    }
+    return archive_result_t::SUCCESS;
+}
+
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(write_response_t);
 
 // Serialization format for these changed in 1.14.  We only support the
 // latest version, since these are cluster-only types.
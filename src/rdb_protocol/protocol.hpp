@@ -18,6 +18,7 @@
 #include "btree/secondary_operations.hpp"
 #include "concurrency/cond_var.hpp"
 #include "perfmon/perfmon.hpp"
+#include "perfmon/resource_usage.hpp"
 #include "protocol_api.hpp"
 #include "rdb_protocol/changefeed.hpp"
 #include "rdb_protocol/configured_limits.hpp"
@@ -166,6 +167,13 @@ struct point_read_response_t {
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(point_read_response_t);
 
+struct point_multi_read_response_t {
+    // The rows that exist, in no particular order.
+    std::vector<ql::datum_t> data;
+    point_multi_read_response_t() { }
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(point_multi_read_response_t);
+
 struct rget_read_response_t {
     ql::result_t result;
     ql::skey_version_t skey_version;
@@ -220,6 +228,9 @@ struct distribution_read_response_t {
     // key_counts[kn] = the number of keys in [kn, right_key)
     region_t region;
     std::map<store_key_t, int64_t> key_counts;
+    // The recent reads and writes in the same format, see `key_access_histogram_t`.
+    // The keys don't match those of `key_counts`.
+    std::map<store_key_t, int64_t> key_loads;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(distribution_read_response_t);
 
@@ -244,11 +255,21 @@ struct changefeed_subscribe_response_t {
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(changefeed_subscribe_response_t);
 
 struct changefeed_stamp_response_t {
-    changefeed_stamp_response_t() { }
+    changefeed_stamp_response_t() : replay_complete(true) { }
     // The `uuid_u` below is the uuid of the changefeed `server_t`.  (We have
     // different timestamps for each `server_t` because they're on different
     // servers and don't synchronize with each other.)
     std::map<uuid_u, uint64_t> stamps;
+    // The sequence number the change log of each `server_t` will give the first
+    // change sent with a stamp at or after the one in `stamps`, or 0 if the
+    // server has no change log.
+    std::map<uuid_u, uint64_t> log_ends;
+    // Only filled in if the read asked for `since`.  `replay_complete` is false
+    // if some change log didn't cover `since`.
+    std::map<uuid_u, std::vector<ql::changefeed::msg_t::change_t> > replay;
+    bool replay_complete;
+    // Only filled in if the read asked for an initial aggregate.
+    boost::optional<rget_read_response_t> initial;
 };
 
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(changefeed_stamp_response_t);
@@ -283,6 +304,7 @@ RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(dummy_read_response_t);
 
 struct read_response_t {
     typedef boost::variant<point_read_response_t,
+                           point_multi_read_response_t,
                            rget_read_response_t,
                            nearest_geo_read_response_t,
                            changefeed_subscribe_response_t,
@@ -296,12 +318,14 @@ struct read_response_t {
     variant_t response;
     profile::event_log_t event_log;
     size_t n_shards;
+    // What the shards spent on this request; see `resource_usage_t`.
+    resource_usage_t resource_usage;
 
     read_response_t() { }
     explicit read_response_t(const variant_t &r)
         : response(r) { }
 };
-RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(read_response_t);
+RDB_DECLARE_SERIALIZABLE(read_response_t);
 
 class point_read_t {
 public:
@@ -312,6 +336,22 @@ public:
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(point_read_t);
 
+// Reads many primary keys at once. Each shard gets the keys that fall into it, and
+// looks them all up in one ordered walk of its B-tree.
+class point_multi_read_t {
+public:
+    point_multi_read_t() { }
+    // Sorts `_keys` and removes duplicates.
+    explicit point_multi_read_t(std::vector<store_key_t> &&_keys);
+
+    // The smallest region containing all of `keys`, narrowed down to the shard's
+    // region after sharding.
+    region_t region;
+    // Sorted and without duplicates
+    std::vector<store_key_t> keys;
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(point_multi_read_t);
+
 // `dummy_read_t` can be used to poll for table readiness - it will go through all
 // the clustering and reactor layers, but is a no-op in the protocol layer.
 class dummy_read_t {
@@ -476,11 +516,13 @@ struct sindex_status_t {
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(sindex_status_t);
 
 struct changefeed_subscribe_t {
-    changefeed_subscribe_t() { }
-    explicit changefeed_subscribe_t(ql::changefeed::client_t::addr_t _addr)
-        : addr(_addr), region(region_t::universe()) { }
+    changefeed_subscribe_t() : squash(false) { }
+    changefeed_subscribe_t(ql::changefeed::client_t::addr_t _addr, bool _squash)
+        : addr(_addr), region(region_t::universe()), squash(_squash) { }
     ql::changefeed::client_t::addr_t addr;
     region_t region;
+    // Whether the server may coalesce changes to the same primary key.
+    bool squash;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(changefeed_subscribe_t);
 
@@ -510,12 +552,27 @@ RDB_DECLARE_SERIALIZABLE(changefeed_limit_subscribe_t);
 
 struct changefeed_stamp_t {
     changefeed_stamp_t() : region(region_t::universe()) { }
-    explicit changefeed_stamp_t(
-        ql::changefeed::client_t::addr_t _addr)
+    changefeed_stamp_t(
+        ql::changefeed::client_t::addr_t _addr,
+        boost::optional<ql::changefeed::resume_token_t> _since)
+        : addr(std::move(_addr)),
+          region(region_t::universe()),
+          since(std::move(_since)) { }
+    changefeed_stamp_t(
+        ql::changefeed::client_t::addr_t _addr,
+        rget_read_t _initial)
         : addr(std::move(_addr)),
-          region(region_t::universe()) { }
+          region(region_t::universe()),
+          initial(std::move(_initial)) { }
     ql::changefeed::client_t::addr_t addr;
     region_t region;
+    // If set, the response also carries the logged changes from each server's
+    // position in the token.
+    boost::optional<ql::changefeed::resume_token_t> since;
+    // If set, this read is run on each shard while it holds the superblock, so
+    // that its result reflects exactly the writes before the stamp.  Used to
+    // get the starting value of aggregate changefeeds.
+    boost::optional<rget_read_t> initial;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(changefeed_stamp_t);
 
@@ -528,6 +585,7 @@ RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(changefeed_point_stamp_t);
 
 struct read_t {
     typedef boost::variant<point_read_t,
+                           point_multi_read_t,
                            rget_read_t,
                            intersecting_geo_read_t,
                            nearest_geo_read_t,
@@ -541,6 +599,10 @@ struct read_t {
                            dummy_read_t> variant_t;
     variant_t read;
     profile_bool_t profile;
+    // If set, outdated reads may only be answered by a replica that has applied
+    // every write it received more than this many milliseconds ago.  See
+    // `listener_t::wait_until_fresh()`.
+    boost::optional<int64_t> max_staleness_ms;
 
     region_t get_region() const THROWS_NOTHING;
     // Returns true if the read has any operation for this region.  Returns
@@ -633,12 +695,14 @@ struct write_response_t {
 
     profile::event_log_t event_log;
     size_t n_shards;
+    // What the shards spent on this request; see `resource_usage_t`.
+    resource_usage_t resource_usage;
 
     write_response_t() { }
     template<class T>
     explicit write_response_t(const T &t) : response(t) { }
 };
-RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(write_response_t);
+RDB_DECLARE_SERIALIZABLE(write_response_t);
 
 struct batched_replace_t {
     batched_replace_t() { }
@@ -894,6 +958,22 @@ RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(backfill_chunk_t::key_value_pairs_t);
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(backfill_chunk_t::sindexes_t);
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(backfill_chunk_t);
 
+/* The hash of the key/value pairs in one key range of a store, as computed by
+`store_view_t::get_range_hashes()`. Before a backfill, the backfillee compares
+these with the backfiller's to find key ranges that it already has. */
+struct range_hash_t {
+    range_hash_t() : hash(0), num_pairs(0) { }
+
+    /* The sum of the hashes of the individual pairs, so it doesn't depend on how
+    the range was traversed. */
+    uint64_t hash;
+    uint64_t num_pairs;
+
+    /* Keys that split the range into pieces with about the same number of pairs,
+    in ascending order. */
+    std::vector<store_key_t> split_keys;
+};
+
 
 class store_t;
 
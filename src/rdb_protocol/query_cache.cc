@@ -1,6 +1,9 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/query_cache.hpp"
 
+#include "clustering/administration/logs/slow_query_log.hpp"
+#include "config/args.hpp"
+#include "pprint/js_pprint.hpp"
 #include "rdb_protocol/env.hpp"
 
 #include "debug.hpp"
@@ -118,9 +121,12 @@ scoped_ptr_t<query_cache_t::ref_t> query_cache_t::create(
         throw query_cache_exc_t(Response::COMPILE_ERROR, e.what(), backtrace_t());
     }
 
+    const bool sample_profile = rdb_ctx->slow_query_log != NULL
+        && rdb_ctx->slow_query_log->sample_profile();
     scoped_ptr_t<entry_t> entry(new entry_t(original_query,
                                             std::move(global_optargs),
-                                            std::move(root_term)));
+                                            std::move(root_term),
+                                            sample_profile));
     scoped_ptr_t<ref_t> ref(new ref_t(this,
                                       token,
                                       entry.get(),
@@ -186,13 +192,16 @@ query_cache_t::ref_t::ref_t(query_cache_t *_query_cache,
                             signal_t *interruptor) :
         entry(_entry),
         token(_token),
-        trace(maybe_make_profile_trace(entry->profile)),
+        trace(maybe_make_profile_trace(entry->sample_profile
+                                           ? profile_bool_t::PROFILE
+                                           : entry->profile)),
         use_json(_use_json),
         query_cache(_query_cache),
         drainer_lock(&entry->drainer),
         combined_interruptor(interruptor, &entry->persistent_interruptor),
         mutex_lock(&entry->mutex) {
     wait_interruptible(mutex_lock.acq_signal(), interruptor);
+    start_ticks = get_ticks();
 }
 
 void query_cache_t::async_destroy_entry(query_cache_t::entry_t *entry) {
@@ -202,8 +211,11 @@ void query_cache_t::async_destroy_entry(query_cache_t::entry_t *entry) {
 query_cache_t::ref_t::~ref_t() {
     query_cache->assert_thread();
     guarantee(entry->state != entry_t::state_t::START);
+    entry->execution_time += get_ticks() - start_ticks;
 
     if (entry->state == entry_t::state_t::DONE) {
+        maybe_log_slow_query();
+
         // We do not delete the entry in this context for reasons:
         //  1. If there is an active exception, we aren't allowed to switch coroutines
         //  2. This will block until all auto-drainer locks on the entry have been
@@ -231,6 +243,7 @@ void query_cache_t::ref_t::fill_response(Response *res) {
                                 backtrace_t());
     }
 
+    resource_usage_scope_t usage_scope(&entry->resource_usage);
     try {
         env_t env(query_cache->rdb_ctx,
                   query_cache->return_empty_normal_batches,
@@ -248,8 +261,17 @@ void query_cache_t::ref_t::fill_response(Response *res) {
         }
 
         if (trace.has()) {
-            trace->as_datum().write_to_protobuf(res->mutable_profile(), use_json);
+            datum_t profile = trace->as_datum();
+            if (entry->profile == profile_bool_t::PROFILE) {
+                profile.write_to_protobuf(res->mutable_profile(), use_json);
+            }
+            if (!entry->first_batch_profile.has()) {
+                entry->first_batch_profile = profile;
+            }
         }
+
+        // The size of the protobuf is close enough to what goes over the wire.
+        entry->resource_usage.bytes_sent += res->ByteSize();
     } catch (const interrupted_exc_t &ex) {
         if (entry->persistent_interruptor.is_pulsed()) {
             if (entry->state != entry_t::state_t::DONE) {
@@ -269,6 +291,44 @@ void query_cache_t::ref_t::fill_response(Response *res) {
     }
 }
 
+void query_cache_t::ref_t::maybe_log_slow_query() {
+    slow_query_log_t *slow_query_log = query_cache->rdb_ctx->slow_query_log;
+    if (slow_query_log == NULL || !slow_query_log->is_slow(entry->execution_time)) {
+        return;
+    }
+    // Changefeeds are supposed to run for a long time.
+    if (entry->stream.has() && entry->stream->cfeed_type() != feed_type_t::not_feed) {
+        return;
+    }
+
+    std::string query = pprint::pretty_print(
+        SLOW_QUERY_LOG_MAX_QUERY_LENGTH,
+        pprint::render_as_javascript(entry->original_query->query()));
+    if (query.size() > SLOW_QUERY_LOG_MAX_QUERY_LENGTH) {
+        size_t length = SLOW_QUERY_LOG_MAX_QUERY_LENGTH;
+        // Don't cut a UTF-8 character in half.
+        while (length > 0 && (query[length] & 0xc0) == 0x80) {
+            --length;
+        }
+        query = query.substr(0, length) + "...";
+    }
+
+    const ip_and_port_t &client_addr_port = query_cache->get_client_addr_port();
+    datum_object_builder_t builder;
+    builder.overwrite("duration_ms",
+                      datum_t(ticks_to_secs(entry->execution_time) * 1000));
+    builder.overwrite("client_address",
+                      datum_t(datum_string_t(client_addr_port.ip().to_string())));
+    builder.overwrite("client_port",
+                      datum_t(static_cast<double>(client_addr_port.port().value())));
+    builder.overwrite("query", datum_t(datum_string_t(query)));
+    builder.overwrite("resources", entry->resource_usage.to_datum());
+    if (entry->first_batch_profile.has()) {
+        builder.overwrite("profile", entry->first_batch_profile);
+    }
+    slow_query_log->record(std::move(builder).to_datum());
+}
+
 void query_cache_t::ref_t::run(env_t *env, Response *res) {
     // The state will be overwritten if we end up with a stream
     entry->state = entry_t::state_t::DONE;
@@ -356,15 +416,18 @@ void query_cache_t::ref_t::serve(env_t *env, Response *res) {
 
 query_cache_t::entry_t::entry_t(protob_t<Query> _original_query,
                                 std::map<std::string, wire_func_t> &&_global_optargs,
-                                counted_t<const term_t> _root_term) :
+                                counted_t<const term_t> _root_term,
+                                bool _sample_profile) :
         state(state_t::START),
         job_id(generate_uuid()),
         original_query(_original_query),
         global_optargs(std::move(_global_optargs)),
         profile(profile_bool_optarg(original_query)),
+        sample_profile(_sample_profile),
         start_time(current_microtime()),
         root_term(_root_term),
-        has_sent_batch(false) { }
+        has_sent_batch(false),
+        execution_time(0) { }
 
 query_cache_t::entry_t::~entry_t() { }
 
@@ -19,6 +19,7 @@
 #include "containers/counted.hpp"
 #include "containers/intrusive_list.hpp"
 #include "containers/object_buffer.hpp"
+#include "perfmon/resource_usage.hpp"
 #include "rdb_protocol/term.hpp"
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/ql2.pb.h"
@@ -85,6 +86,9 @@ public:
         void run(env_t *env, Response *res); // Run a new query
         void serve(env_t *env, Response *res); // Serve a batch from a stream
 
+        // Called when the query is done, to write it to the slow query log if needed
+        void maybe_log_slow_query();
+
         query_cache_t::entry_t *const entry;
         const int64_t token;
         const scoped_ptr_t<profile::trace_t> trace;
@@ -95,6 +99,9 @@ public:
         wait_any_t combined_interruptor;
         new_mutex_in_line_t mutex_lock;
 
+        // When we got the mutex, for `entry->execution_time`
+        ticks_t start_ticks;
+
         DISABLE_COPYING(ref_t);
     };
 
@@ -127,7 +134,8 @@ private:
     struct entry_t {
         entry_t(protob_t<Query> original_query,
                 std::map<std::string, wire_func_t> &&global_optargs,
-                counted_t<const term_t> root_term);
+                counted_t<const term_t> root_term,
+                bool sample_profile);
         ~entry_t();
 
         enum class state_t { START, STREAM, DONE, DELETING } state;
@@ -136,6 +144,9 @@ private:
         const protob_t<Query> original_query;
         const std::map<std::string, wire_func_t> global_optargs;
         const profile_bool_t profile;
+        // Whether we profile the query for the slow query log, even if the client
+        // didn't ask for a profile
+        const bool sample_profile;
         const microtime_t start_time;
 
         cond_t persistent_interruptor;
@@ -149,6 +160,15 @@ private:
         counted_t<datum_stream_t> stream;
         bool has_sent_batch;
 
+        // What the query has cost so far, over all of its batches
+        resource_usage_t resource_usage;
+
+        // The time spent executing the query, which excludes the time between batches
+        ticks_t execution_time;
+
+        // The profile of the first batch, if we profiled it
+        datum_t first_batch_profile;
+
         // The order of these is very important, do not move them around
         new_mutex_t mutex; // Only one coroutine may be using this query at a time
         auto_drainer_t drainer; // Keep this entry alive until all refs are destroyed
@@ -1,7 +1,9 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved
 #include "rdb_protocol/real_table.hpp"
 
+#include "config/args.hpp"
 #include "math.hpp"
+#include "perfmon/resource_usage.hpp"
 #include "rdb_protocol/geo/ellipsoid.hpp"
 #include "rdb_protocol/geo/distances.hpp"
 #include "rdb_protocol/context.hpp"
@@ -82,6 +84,45 @@ ql::datum_t real_table_t::read_row(ql::env_t *env,
     return p_res->data;
 }
 
+std::vector<ql::datum_t> real_table_t::read_rows(ql::env_t *env,
+        const std::vector<ql::datum_t> &pvals, bool use_outdated) {
+    std::vector<std::string> keys;
+    keys.reserve(pvals.size());
+    for (const ql::datum_t &pval : pvals) {
+        keys.push_back(pval.print_primary());
+    }
+
+    /* Every shard answers all of its keys in one read, but we don't want a huge
+    `get_all` to turn into a huge message, so we split it up. */
+    std::map<std::string, ql::datum_t> found;
+    for (size_t i = 0; i < keys.size(); i += MULTI_POINT_READ_MAX_KEYS) {
+        std::vector<store_key_t> chunk;
+        for (size_t j = i; j < std::min(keys.size(), i + MULTI_POINT_READ_MAX_KEYS); ++j) {
+            chunk.push_back(store_key_t(keys[j]));
+        }
+        read_t read(point_multi_read_t(std::move(chunk)), env->profile());
+        read_response_t res;
+        read_with_profile(env, read, &res, use_outdated);
+        point_multi_read_response_t *p_res =
+            boost::get<point_multi_read_response_t>(&res.response);
+        r_sanity_check(p_res);
+        for (ql::datum_t &row : p_res->data) {
+            ql::datum_t pval = row.get_field(datum_string_t(pkey));
+            found[pval.print_primary()] = std::move(row);
+        }
+    }
+
+    std::vector<ql::datum_t> rows;
+    rows.reserve(found.size());
+    for (const std::string &key : keys) {
+        auto it = found.find(key);
+        if (it != found.end()) {
+            rows.push_back(it->second);
+        }
+    }
+    return rows;
+}
+
 counted_t<ql::datum_stream_t> real_table_t::read_all(
         ql::env_t *env,
         const std::string &sindex,
@@ -112,11 +153,12 @@ counted_t<ql::datum_stream_t> real_table_t::read_changes(
     ql::env_t *env,
     const ql::datum_t &squash,
     bool include_states,
+    const ql::changefeed::resume_t &resume,
     ql::changefeed::keyspec_t::spec_t &&spec,
     const ql::protob_t<const Backtrace> &bt,
     const std::string &table_name) {
     return changefeed_client->new_stream(
-        env, squash, include_states, uuid, bt, table_name, std::move(spec));
+        env, squash, include_states, resume, uuid, bt, table_name, std::move(spec));
 }
 
 counted_t<ql::datum_stream_t> real_table_t::read_intersecting(
@@ -136,6 +178,48 @@ counted_t<ql::datum_stream_t> real_table_t::read_intersecting(
         bt);
 }
 
+/* Returns the `max_staleness` global optarg in milliseconds. If it's set, reads that
+would go to the primary replica can be answered by any replica that is at most that
+far behind. */
+static boost::optional<int64_t> get_max_staleness_ms(ql::env_t *env) {
+    scoped_ptr_t<ql::val_t> v = env->get_optarg(env, "max_staleness");
+    if (!v.has()) {
+        return boost::optional<int64_t>();
+    }
+    // Cap it at a day, so that converting it to milliseconds can't overflow.
+    const double MAX_STALENESS_SECONDS = 60 * 60 * 24;
+    double secs = v->as_num();
+    rcheck_target(v.get(),
+                  secs >= 0 && secs <= MAX_STALENESS_SECONDS,
+                  ql::base_exc_t::GENERIC,
+                  strprintf("`max_staleness` must be between 0 and %g seconds, "
+                            "got %g.", MAX_STALENESS_SECONDS, secs));
+    return static_cast<int64_t>(secs * 1000);
+}
+
+/* Performs `read` on the primary replicas, or on any replicas if `use_outdated` is
+set or the user allowed stale reads with `max_staleness`. */
+static void dispatch_read(ql::env_t *env, namespace_interface_t *namespace_interface,
+                          const read_t &read, read_response_t *response,
+                          bool use_outdated) {
+    if (use_outdated) {
+        namespace_interface->read_outdated(read, response, env->interruptor);
+        return;
+    }
+    boost::optional<int64_t> max_staleness_ms;
+    if (!read.route_to_primary()) {
+        max_staleness_ms = get_max_staleness_ms(env);
+    }
+    if (static_cast<bool>(max_staleness_ms)) {
+        read_t bounded_read = read;
+        bounded_read.max_staleness_ms = max_staleness_ms;
+        namespace_interface->read_outdated(bounded_read, response, env->interruptor);
+    } else {
+        namespace_interface->read(read, response, order_token_t::ignore,
+                                  env->interruptor);
+    }
+}
+
 ql::datum_t real_table_t::read_nearest(
         ql::env_t *env,
         const std::string &sindex,
@@ -155,12 +239,7 @@ ql::datum_t real_table_t::read_nearest(
     read_t read(geo_read, env->profile());
     read_response_t res;
     try {
-        if (use_outdated) {
-            namespace_access.get()->read_outdated(read, &res, env->interruptor);
-        } else {
-            namespace_access.get()->read(
-                read, &res, order_token_t::ignore, env->interruptor);
-        }
+        dispatch_read(env, namespace_access.get(), read, &res, use_outdated);
     } catch (const cannot_perform_query_exc_t &ex) {
         rfail_datum(ql::base_exc_t::GENERIC, "Cannot perform read: %s", ex.what());
     }
@@ -389,15 +468,12 @@ void real_table_t::read_with_profile(ql::env_t *env, const read_t &read,
     r_sanity_check(read.profile == env->profile());
     /* Do the actual read. */
     try {
-        if (!outdated) {
-            namespace_access.get()->read(read, response, order_token_t::ignore,
-                env->interruptor);
-        } else {
-            namespace_access.get()->read_outdated(read, response, env->interruptor);
-        }
+        dispatch_read(env, namespace_access.get(), read, response, outdated);
     } catch (const cannot_perform_query_exc_t &e) {
         rfail_datum(ql::base_exc_t::GENERIC, "Cannot perform read: %s", e.what());
     }
+    /* Charge the work the shards did to the query */
+    resource_usage_t::add_to_current(response->resource_usage);
     /* Append the results of the profile to the current task */
     splitter.give_splits(response->n_shards, response->event_log);
 }
@@ -415,6 +491,8 @@ void real_table_t::write_with_profile(ql::env_t *env, write_t *write,
     } catch (const cannot_perform_query_exc_t &e) {
         rfail_datum(ql::base_exc_t::GENERIC, "Cannot perform write: %s", e.what());
     }
+    /* Charge the work the shards did to the query */
+    resource_usage_t::add_to_current(response->resource_usage);
     /* Append the results of the profile to the current task */
     splitter.give_splits(response->n_shards, response->event_log);
 }
@@ -68,6 +68,8 @@ public:
 
     ql::datum_t read_row(ql::env_t *env,
         ql::datum_t pval, bool use_outdated);
+    std::vector<ql::datum_t> read_rows(ql::env_t *env,
+        const std::vector<ql::datum_t> &pvals, bool use_outdated);
     counted_t<ql::datum_stream_t> read_all(
         ql::env_t *env,
         const std::string &sindex,
@@ -80,6 +82,7 @@ public:
         ql::env_t *env,
         const ql::datum_t &squash,
         bool include_states,
+        const ql::changefeed::resume_t &resume,
         ql::changefeed::keyspec_t::spec_t &&spec,
         const ql::protob_t<const Backtrace> &bt,
         const std::string &table_name);
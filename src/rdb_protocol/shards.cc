@@ -890,9 +890,7 @@ private:
     virtual void lst_transform(
         env_t *env, datums_t *lst, const datum_t &) {
         try {
-            for (auto it = lst->begin(); it != lst->end(); ++it) {
-                *it = f->call(env, *it)->as_datum();
-            }
+            f->map_batch(env, lst);
         } catch (const datum_exc_t &e) {
             throw exc_t(e, f->backtrace().get(), 1);
         }
@@ -941,18 +939,19 @@ public:
 private:
     virtual void lst_transform(
         env_t *env, datums_t *lst, const datum_t &) {
-        auto it = lst->begin();
-        auto loc = it;
+        std::vector<bool> keep;
         try {
-            for (it = lst->begin(); it != lst->end(); ++it) {
-                if (f->filter_call(env, *it, default_val)) {
-                    std::swap(*loc, *it);
-                    ++loc;
-                }
-            }
+            keep = f->filter_batch(env, *lst, default_val);
         } catch (const datum_exc_t &e) {
             throw exc_t(e, f->backtrace().get(), 1);
         }
+        auto loc = lst->begin();
+        for (size_t i = 0; i < lst->size(); ++i) {
+            if (keep[i]) {
+                std::swap(*loc, (*lst)[i]);
+                ++loc;
+            }
+        }
         lst->erase(loc, lst->end());
     }
     counted_t<const func_t> f, default_val;
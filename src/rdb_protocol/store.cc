@@ -213,7 +213,8 @@ void do_read(ql::env_t *env,
         // Normal rget
         rdb_rget_slice(btree, rget.region.inner, superblock,
                        env, rget.batchspec, rget.transforms, rget.terminal,
-                       rget.sorting, res, release_superblock);
+                       rget.sorting, res, release_superblock,
+                       &store->key_access_histogram);
     } else {
         sindex_disk_info_t sindex_info;
         uuid_u sindex_uuid;
@@ -269,7 +270,7 @@ void do_read(ql::env_t *env,
 struct rdb_read_visitor_t : public boost::static_visitor<void> {
     void operator()(const changefeed_subscribe_t &s) {
         guarantee(store->changefeed_server.has());
-        store->changefeed_server->add_client(s.addr, s.region);
+        store->changefeed_server->add_client(s.addr, s.region, s.squash);
         response->response = changefeed_subscribe_response_t();
         auto res = boost::get<changefeed_subscribe_response_t>(&response->response);
         guarantee(res != NULL);
@@ -349,17 +350,49 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         guarantee(store->changefeed_server.has());
         response->response = changefeed_stamp_response_t();
         auto res = boost::get<changefeed_stamp_response_t>(&response->response);
-        res->stamps[store->changefeed_server->get_uuid()]
-            = store->changefeed_server->get_stamp(s.addr);
+        uuid_u server_uuid = store->changefeed_server->get_uuid();
+        auto since_it = s.since
+            ? s.since->find(server_uuid)
+            : ql::changefeed::resume_token_t::const_iterator();
+        if (s.since && since_it != s.since->end()) {
+            guarantee(!s.initial);
+            // Reading the change log doesn't need the superblock, so we don't
+            // hold up writes while we wait for the disk.
+            superblock->release();
+            res->stamps[server_uuid]
+                = store->changefeed_server->get_stamp_and_replay(
+                    s.addr, since_it->second, s.region,
+                    &res->log_ends[server_uuid],
+                    &res->replay[server_uuid], &res->replay_complete);
+        } else {
+            res->stamps[server_uuid] = store->changefeed_server->get_stamp(
+                s.addr, &res->log_ends[server_uuid]);
+            if (s.since) {
+                // The token is from before this server restarted or before the
+                // table was resharded.
+                res->replay_complete = false;
+            }
+        }
+        if (s.initial) {
+            // We still hold the superblock, so the read sees exactly the
+            // writes whose changes were stamped before the stamp above.
+            ql::env_t env(ctx, ql::return_empty_normal_batches_t::NO,
+                          interruptor, s.initial->optargs, trace);
+            res->initial = rget_read_response_t();
+            do_read(&env, store, btree, superblock, *s.initial, &*res->initial,
+                    release_superblock_t::KEEP);
+        }
     }
 
     void operator()(const changefeed_point_stamp_t &s) {
         guarantee(store->changefeed_server.has());
         response->response = changefeed_point_stamp_response_t();
         auto res = boost::get<changefeed_point_stamp_response_t>(&response->response);
+        // Point changefeeds don't resume, so they don't need the log position.
+        uint64_t log_end;
         res->stamp = std::make_pair(
             store->changefeed_server->get_uuid(),
-            store->changefeed_server->get_stamp(s.addr));
+            store->changefeed_server->get_stamp(s.addr, &log_end));
         point_read_response_t val;
         rdb_get(s.key, btree, superblock, &val, trace);
         res->initial_val = val.data;
@@ -370,6 +403,17 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         point_read_response_t *res =
             boost::get<point_read_response_t>(&response->response);
         rdb_get(get.key, btree, superblock, res, trace);
+        store->key_access_histogram.record(get.key);
+    }
+
+    void operator()(const point_multi_read_t &get) {
+        response->response = point_multi_read_response_t();
+        point_multi_read_response_t *res =
+            boost::get<point_multi_read_response_t>(&response->response);
+        rdb_get_multi(get.keys, btree, superblock, res, trace);
+        for (const store_key_t &key : get.keys) {
+            store->key_access_histogram.record(key);
+        }
     }
 
     void operator()(const intersecting_geo_read_t &geo_read) {
@@ -508,6 +552,8 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             scale_down_distribution(dg.result_limit, &res->key_counts);
         }
 
+        store->key_access_histogram.get_loads(dg.region.inner, &res->key_loads);
+
         res->region = dg.region;
     }
 
@@ -684,6 +730,9 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
             store, &sindex_block,
             auto_drainer_t::lock_t(&store->drainer));
         func_replacer_t replacer(&ql_env, br.f, br.return_changes);
+        for (const store_key_t &key : br.keys) {
+            store->key_access_histogram.record(key);
+        }
 
         response->response =
             rdb_batched_replace(
@@ -706,6 +755,7 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
         keys.reserve(bi.inserts.size());
         for (auto it = bi.inserts.begin(); it != bi.inserts.end(); ++it) {
             keys.emplace_back(it->get_field(datum_string_t(bi.pkey)).print_primary());
+            store->key_access_histogram.record(keys.back());
         }
         response->response =
             rdb_batched_replace(
@@ -729,6 +779,7 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
         rdb_modification_report_t mod_report(w.key);
         rdb_set(w.key, w.data, w.overwrite, btree, timestamp, superblock->get(),
                 &deletion_context, res, &mod_report.info, trace);
+        store->key_access_histogram.record(w.key);
 
         update_sindexes(mod_report);
     }
@@ -743,6 +794,7 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
         rdb_modification_report_t mod_report(d.key);
         rdb_delete(d.key, btree, timestamp, superblock->get(), &deletion_context,
                 res, &mod_report.info, trace);
+        store->key_access_histogram.record(d.key);
 
         update_sindexes(mod_report);
     }
@@ -22,7 +22,9 @@
 #include "containers/scoped.hpp"
 #include "perfmon/perfmon.hpp"
 #include "protocol_api.hpp"
+#include "rdb_protocol/backfill_rate_controller.hpp"
 #include "rdb_protocol/changefeed.hpp"
+#include "rdb_protocol/key_access_histogram.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "rpc/mailbox/typed.hpp"
 #include "store_view.hpp"
@@ -146,6 +148,15 @@ public:
             signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t);
 
+    void get_range_hashes(
+            const std::vector<region_t> &regions,
+            size_t max_split_keys,
+            std::vector<range_hash_t> *hashes_out,
+            region_map_t<binary_blob_t> *metainfo_out,
+            read_token_t *token,
+            signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
     void receive_backfill(
             const backfill_chunk_t &chunk,
             write_token_t *token,
@@ -389,7 +400,7 @@ public:
     namespace_id_t const &get_table_id() const;
 
     typedef std::map<
-        uuid_u, std::pair<microtime_t, parallel_traversal_progress_t const *>
+        uuid_u, std::pair<microtime_t, traversal_progress_t const *>
     > sindex_context_map_t;
     sindex_context_map_t *get_sindex_context_map();
 
@@ -433,6 +444,9 @@ private:
     // the superblock, if any).
     new_semaphore_t write_superblock_acq_semaphore;
 
+    // Paces the backfill chunks that we receive, see `throttle_backfill_chunk()`.
+    backfill_rate_controller_t backfill_rate_controller;
+
 public:
     // This lock is used to pause backfills while secondary indexes are being
     // post constructed. Secondary index post construction gets in line for a write
@@ -442,6 +456,14 @@ public:
     // A read lock is acquired before a backfill chunk is being processed.
     rwlock_t backfill_postcon_lock;
 
+    // The keys of our recent reads and writes, for load-based rebalancing. Updated
+    // by the read and write visitors in `store.cc`.
+    key_access_histogram_t key_access_histogram;
+
+    // How long our reads and writes take, from acquiring the superblock to being done
+    perfmon_latency_histogram_t read_latency, write_latency;
+    perfmon_multi_membership_t latency_membership;
+
     // Mind the constructor ordering. We must destruct drainer before destructing
     // many of the other structures.
     auto_drainer_t drainer;
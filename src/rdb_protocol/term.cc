@@ -310,6 +310,17 @@ void term_t::prop_bt(Term *t) const {
     propagate_backtrace(t, &get_src()->GetExtension(ql2::extension::backtrace));
 }
 
+std::vector<datum_t> term_t::eval_batch(
+        env_t *env, const std::vector<var_scope_t> &scopes) const {
+    std::vector<datum_t> results;
+    results.reserve(scopes.size());
+    for (const var_scope_t &scope : scopes) {
+        scope_env_t scope_env(env, var_scope_t(scope));
+        results.push_back(eval(&scope_env)->as_datum());
+    }
+    return results;
+}
+
 scoped_ptr_t<val_t> runtime_term_t::eval(scope_env_t *env, eval_flags_t eval_flags) const {
     // This is basically a hook for unit tests to change things mid-query
     profile::starter_t starter(strprintf("Evaluating %s.", name()), env->env->trace);
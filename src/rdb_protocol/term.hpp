@@ -2,6 +2,8 @@
 #ifndef RDB_PROTOCOL_TERM_HPP_
 #define RDB_PROTOCOL_TERM_HPP_
 
+#include <vector>
+
 #include "containers/counted.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/error.hpp"
@@ -19,6 +21,7 @@ class scope_env_t;
 class table_t;
 class table_slice_t;
 class var_captures_t;
+class var_scope_t;
 class compile_env_t;
 
 enum eval_flags_t {
@@ -59,6 +62,14 @@ public:
 
     virtual bool is_deterministic() const = 0;
 
+    // Evaluates the term once in each of `scopes` and returns the results, in order.
+    // `map` uses this to run a function on a batch of rows.  Terms that can do many
+    // evaluations together faster than one at a time override it, like `r.http`,
+    // which makes its requests concurrently.  If more than one evaluation fails, the
+    // overrides may make them all before throwing the first error.
+    virtual std::vector<datum_t> eval_batch(
+        env_t *env, const std::vector<var_scope_t> &scopes) const;
+
     protob_t<const Term> get_src() const;
     void prop_bt(Term *t) const;
 
@@ -642,6 +642,15 @@ private:
         counted_t<table_t> table = args->arg(env, 0)->as_table();
         scoped_ptr_t<val_t> index = args->optarg(env, "index");
         std::string index_str = index ? index->as_str().to_std() : table->get_pkey();
+        if (index_str == table->get_pkey()) {
+            std::vector<datum_t> keys;
+            for (size_t i = 1; i < args->num_args(); ++i) {
+                keys.push_back(get_key_arg(args->arg(env, i)));
+            }
+            counted_t<datum_stream_t> stream =
+                table->get_all_by_pkey(env->env, keys, backtrace());
+            return new_val(make_counted<selection_t>(table, stream));
+        }
         std::vector<counted_t<datum_stream_t> > streams;
         for (size_t i = 1; i < args->num_args(); ++i) {
             datum_t key = get_key_arg(args->arg(env, i));
@@ -2,6 +2,8 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
+
 #include "debug.hpp"
 
 #include "math.hpp"
@@ -28,7 +30,8 @@ public:
                                 "page",
                                 "page_limit",
                                 "auth",
-                                "result_format" }))
+                                "result_format",
+                                "cache_ttl" }))
     { }
 private:
     virtual const char *name() const { return "http"; }
@@ -40,6 +43,22 @@ private:
 
     virtual scoped_ptr_t<val_t> eval_impl(scope_env_t *env, args_t *args, eval_flags_t) const;
 
+    // Makes the requests for all of the rows concurrently
+    virtual std::vector<datum_t> eval_batch(
+        env_t *env, const std::vector<var_scope_t> &scopes) const;
+
+    // Reads the arguments, sets `*depaginate_fn_out` if the result is a stream
+    void get_request(scope_env_t *env,
+                     args_t *args,
+                     http_opts_t *opts_out,
+                     counted_t<const func_t> *depaginate_fn_out,
+                     int64_t *depaginate_limit_out) const;
+
+    scoped_ptr_t<val_t> new_depaginate_val(env_t *env,
+                                           http_opts_t &&opts,
+                                           counted_t<const func_t> &&depaginate_fn,
+                                           int64_t depaginate_limit) const;
+
     // Functions to get optargs into the http_opts_t
     void get_optargs(scope_env_t *env, args_t *args, http_opts_t *opts_out) const;
 
@@ -71,9 +90,10 @@ private:
                   std::vector<std::string> *header_out,
                   http_method_t method) const;
 
-    static void get_timeout_ms(scope_env_t *env,
-                               args_t *args,
-                               uint64_t *timeout_ms_out);
+    static void get_duration_ms(const std::string &optarg_name,
+                                scope_env_t *env,
+                                args_t *args,
+                                uint64_t *duration_ms_out);
 
     static void get_header(scope_env_t *env,
                            args_t *args,
@@ -105,7 +125,7 @@ private:
                                      const std::string &name,
                                      const pb_rcheckable_t *auth);
 
-    // Have a maximum timeout of 30 days
+    // Have a maximum timeout (and cache TTL) of 30 days
     static const uint64_t MAX_TIMEOUT_MS = 2592000000ull;
 };
 
@@ -200,47 +220,98 @@ void check_error_result(const http_result_t &res,
     }
 }
 
+// Runs `fn`, and returns the error for the requests if it throws
+template <class callable_t>
+std::string run_http_runner(const callable_t &fn) {
+    try {
+        fn();
+    } catch (const extproc_worker_exc_t &ex) {
+        return "crash in a worker process";
+    } catch (const interrupted_exc_t &ex) {
+        return "interrupted";
+    } catch (const std::exception &ex) {
+        return std::string("encounted an exception - ") + ex.what();
+    } catch (...) {
+        return "encountered an unknown exception";
+    }
+    return std::string();
+}
+
 void dispatch_http(env_t *env,
                    const http_opts_t &opts,
                    http_runner_t *runner,
                    http_result_t *res_out,
                    const pb_rcheckable_t *parent) {
-    try {
+    std::string error = run_http_runner([&]() {
         runner->http(opts, res_out, env->interruptor);
-    } catch (const extproc_worker_exc_t &ex) {
-        res_out->error.assign("crash in a worker process");
-    } catch (const interrupted_exc_t &ex) {
-        res_out->error.assign("interrupted");
-    } catch (const std::exception &ex) {
-        res_out->error = std::string("encounted an exception - ") + ex.what();
-    } catch (...) {
-        res_out->error.assign("encountered an unknown exception");
+    });
+    if (!error.empty()) {
+        res_out->error = std::move(error);
     }
 
     check_error_result(*res_out, opts, parent);
 }
 
+// Like `dispatch_http`, but the requests are made concurrently, and the first error
+//  is only thrown after all of them are done.
+void dispatch_http_batch(env_t *env,
+                         const std::vector<http_opts_t> &opts_batch,
+                         http_runner_t *runner,
+                         std::vector<http_result_t> *res_out,
+                         const pb_rcheckable_t *parent) {
+    std::string error = run_http_runner([&]() {
+        runner->http_batch(opts_batch, res_out, env->interruptor);
+    });
+    if (!error.empty()) {
+        res_out->clear();
+        res_out->resize(opts_batch.size());
+        for (http_result_t &res : *res_out) {
+            res.error = error;
+        }
+    }
+
+    for (size_t i = 0; i < opts_batch.size(); ++i) {
+        check_error_result((*res_out)[i], opts_batch[i], parent);
+    }
+}
+
+void http_term_t::get_request(scope_env_t *env,
+                              args_t *args,
+                              http_opts_t *opts_out,
+                              counted_t<const func_t> *depaginate_fn_out,
+                              int64_t *depaginate_limit_out) const {
+    opts_out->limits = env->env->limits();
+    opts_out->version = env->env->reql_version();
+    opts_out->url.assign(args->arg(env, 0)->as_str().to_std());
+    opts_out->proxy.assign(env->env->get_reql_http_proxy());
+    get_optargs(env, args, opts_out);
+    get_page_and_limit(env, args, depaginate_fn_out, depaginate_limit_out);
+}
+
+// If we're depaginating, return a stream that will be evaluated automatically
+scoped_ptr_t<val_t> http_term_t::new_depaginate_val(
+        env_t *env,
+        http_opts_t &&opts,
+        counted_t<const func_t> &&depaginate_fn,
+        int64_t depaginate_limit) const {
+    counted_t<datum_stream_t> http_stream = counted_t<datum_stream_t>(
+        new http_datum_stream_t(std::move(opts),
+                                std::move(depaginate_fn),
+                                depaginate_limit,
+                                backtrace()));
+    return new_val(env, http_stream);
+}
+
 scoped_ptr_t<val_t> http_term_t::eval_impl(scope_env_t *env, args_t *args,
                                            eval_flags_t) const {
     http_opts_t opts;
-    opts.limits = env->env->limits();
-    opts.version = env->env->reql_version();
-    opts.url.assign(args->arg(env, 0)->as_str().to_std());
-    opts.proxy.assign(env->env->get_reql_http_proxy());
-    get_optargs(env, args, &opts);
-
     counted_t<const func_t> depaginate_fn;
     int64_t depaginate_limit(0);
-    get_page_and_limit(env, args, &depaginate_fn, &depaginate_limit);
+    get_request(env, args, &opts, &depaginate_fn, &depaginate_limit);
 
-    // If we're depaginating, return a stream that will be evaluated automatically
     if (depaginate_fn.has()) {
-        counted_t<datum_stream_t> http_stream = counted_t<datum_stream_t>(
-            new http_datum_stream_t(std::move(opts),
-                                    std::move(depaginate_fn),
-                                    depaginate_limit,
-                                    backtrace()));
-        return new_val(env->env, http_stream);
+        return new_depaginate_val(env->env, std::move(opts),
+                                  std::move(depaginate_fn), depaginate_limit);
     }
 
     // Otherwise, just run the http operation and return the datum
@@ -251,6 +322,54 @@ scoped_ptr_t<val_t> http_term_t::eval_impl(scope_env_t *env, args_t *args,
     return new_val(res.body);
 }
 
+std::vector<datum_t> http_term_t::eval_batch(
+        env_t *env, const std::vector<var_scope_t> &scopes) const {
+    profile::starter_t starter(strprintf("Evaluating %s for %zu rows.",
+                                         name(), scopes.size()),
+                               env->trace);
+    if (env->interruptor->is_pulsed()) {
+        throw interrupted_exc_t();
+    }
+
+    // Read the arguments for every row first, so that the requests can be made
+    // together.  Rows that don't make a single request are evaluated on the spot.
+    std::vector<datum_t> results(scopes.size());
+    std::vector<http_opts_t> opts_batch;
+    std::vector<size_t> batch_rows;
+    for (size_t i = 0; i < scopes.size(); ++i) {
+        scope_env_t scope_env(env, var_scope_t(scopes[i]));
+        scoped_ptr_t<val_t> grouped_val;
+        scoped_ptr_t<args_t> args = eval_args(&scope_env, NO_FLAGS, &grouped_val);
+        if (!args.has()) {
+            results[i] = grouped_val->as_datum();
+            continue;
+        }
+
+        http_opts_t opts;
+        counted_t<const func_t> depaginate_fn;
+        int64_t depaginate_limit(0);
+        get_request(&scope_env, args.get(), &opts, &depaginate_fn, &depaginate_limit);
+        if (depaginate_fn.has()) {
+            results[i] = new_depaginate_val(env, std::move(opts),
+                                            std::move(depaginate_fn),
+                                            depaginate_limit)->as_datum();
+            continue;
+        }
+        opts_batch.push_back(std::move(opts));
+        batch_rows.push_back(i);
+    }
+
+    if (!opts_batch.empty()) {
+        std::vector<http_result_t> res;
+        http_runner_t runner(env->get_extproc_pool());
+        dispatch_http_batch(env, opts_batch, &runner, &res, this);
+        for (size_t j = 0; j < batch_rows.size(); ++j) {
+            results[batch_rows[j]] = std::move(res[j].body);
+        }
+    }
+    return results;
+}
+
 std::vector<datum_t>
 http_datum_stream_t::next_page(env_t *env) {
     profile::sampler_t sampler(strprintf("Performing HTTP %s of `%s`",
@@ -437,27 +556,31 @@ void http_term_t::get_optargs(scope_env_t *env,
     get_result_format(env, args, &opts_out->result_format);
     get_params(env, args, &opts_out->url_params);
     get_header(env, args, &opts_out->header);
-    get_timeout_ms(env, args, &opts_out->timeout_ms);
+    get_duration_ms("timeout", env, args, &opts_out->timeout_ms);
+    get_duration_ms("cache_ttl", env, args, &opts_out->cache_ttl_ms);
     get_attempts(env, args, &opts_out->attempts);
     get_redirects(env, args, &opts_out->max_redirects);
     get_bool_optarg("verify", env, args, &opts_out->verify);
 }
 
 // The `timeout` optarg specifies the number of seconds to wait before erroring
-// out of the HTTP request.  This must be a NUMBER, but may be fractional.
-void http_term_t::get_timeout_ms(scope_env_t *env,
-                                 args_t *args,
-                                 uint64_t *timeout_ms_out) {
-    scoped_ptr_t<val_t> timeout = args->optarg(env, "timeout");
-    if (timeout.has()) {
-        double tmp = timeout->as_num();
+// out of the HTTP request, and the `cache_ttl` optarg the number of seconds that the
+// response to a GET or HEAD request may be reused for.  These must be NUMBERs, but may
+// be fractional.
+void http_term_t::get_duration_ms(const std::string &optarg_name,
+                                  scope_env_t *env,
+                                  args_t *args,
+                                  uint64_t *duration_ms_out) {
+    scoped_ptr_t<val_t> duration = args->optarg(env, optarg_name);
+    if (duration.has()) {
+        double tmp = duration->as_num();
         tmp *= 1000;
 
         if (tmp < 0) {
-            rfail_target(timeout.get(), base_exc_t::GENERIC,
-                         "`timeout` may not be negative.");
+            rfail_target(duration.get(), base_exc_t::GENERIC,
+                         "`%s` may not be negative.", optarg_name.c_str());
         } else {
-            *timeout_ms_out = clamp<double>(tmp, 0, MAX_TIMEOUT_MS);
+            *duration_ms_out = clamp<double>(tmp, 0, MAX_TIMEOUT_MS);
         }
     }
 }
@@ -370,6 +370,22 @@ struct rcheck_spec_visitor_t : public pb_rcheckable_t,
                    env->limits().array_size_limit()));
     }
     void operator()(const changefeed::keyspec_t::point_t &) const { }
+    void operator()(const changefeed::keyspec_t::aggregate_t &spec) const {
+        // Unlike other changefeeds, aggregates may be grouped.
+        for (const auto &t : spec.range.transforms) {
+            if (const group_wire_func_t *g = boost::get<group_wire_func_t>(&t)) {
+                rcheck(!g->should_append_index(), base_exc_t::GENERIC,
+                       "Cannot call `changes` after `group` with an `index`.");
+                for (const auto &f : g->compile_funcs()) {
+                    rcheck(f->is_deterministic(), base_exc_t::GENERIC,
+                           "Cannot call `changes` after a non-deterministic "
+                           "function.");
+                }
+            } else {
+                boost::apply_visitor(rcheck_transform_visitor_t(backtrace()), t);
+            }
+        }
+    }
     env_t *env;
 };
 
@@ -377,8 +393,79 @@ class changes_term_t : public op_term_t {
 public:
     changes_term_t(compile_env_t *env, const protob_t<const Term> &term)
         : op_term_t(env, term, argspec_t(1),
-                    optargspec_t({"squash", "include_states"})) { }
+                    optargspec_t({"squash", "include_states", "since",
+                                  "include_resume_token"})),
+          aggregate(aggregate_kind_t::NONE) {
+        // `count` and `sum` run their terminal right away, so to support
+        // `seq.count().changes()` we take the arguments `op_term_t` already
+        // compiled for them and build the stream they would have consumed.
+        const std::vector<counted_t<const term_t> > &args = get_original_args();
+        if (args.size() != 1) {
+            return;
+        }
+        const op_term_t *agg = dynamic_cast<const op_term_t *>(args[0].get());
+        if (agg == NULL) {
+            return;
+        }
+        const std::vector<counted_t<const term_t> > &agg_args
+            = agg->get_original_args();
+        if (agg_args.size() < 1 || agg_args.size() > 2) {
+            return;
+        }
+        for (const auto &arg : agg_args) {
+            if (arg->get_src()->type() == Term::ARGS) {
+                return;
+            }
+        }
+        if (agg->get_src()->type() == Term::COUNT) {
+            aggregate = aggregate_kind_t::COUNT;
+        } else if (agg->get_src()->type() == Term::SUM) {
+            aggregate = aggregate_kind_t::SUM;
+        } else {
+            return;
+        }
+        aggregate_args = agg_args;
+    }
 private:
+    // When we're aggregating, `eval_impl` never looks at its first argument.
+    virtual bool can_be_grouped() const {
+        return aggregate == aggregate_kind_t::NONE;
+    }
+
+    // Returns the aggregate's input sequence with the same transformations and
+    // terminal that `count` or `sum` would have used.
+    counted_t<datum_stream_t> eval_aggregate(scope_env_t *env,
+                                             terminal_variant_t *terminal_out) const {
+        counted_t<datum_stream_t> seq
+            = aggregate_args[0]->eval(env)->as_seq(env->env);
+        switch (aggregate) {
+        case aggregate_kind_t::COUNT:
+            if (aggregate_args.size() == 2) {
+                scoped_ptr_t<val_t> v1 = aggregate_args[1]->eval(env);
+                counted_t<const func_t> f =
+                    v1->get_type().is_convertible(val_t::type_t::FUNC)
+                    ? v1->as_func()
+                    : new_eq_comparison_func(v1->as_datum(), backtrace());
+                seq->add_transformation(filter_wire_func_t(f, boost::none),
+                                        backtrace());
+            }
+            *terminal_out = count_wire_func_t();
+            break;
+        case aggregate_kind_t::SUM:
+            if (aggregate_args.size() == 2) {
+                *terminal_out = sum_wire_func_t(
+                    backtrace(),
+                    aggregate_args[1]->eval(env)->as_func(GET_FIELD_SHORTCUT));
+            } else {
+                *terminal_out = sum_wire_func_t(backtrace());
+            }
+            break;
+        case aggregate_kind_t::NONE: // fallthru
+        default: unreachable();
+        }
+        return seq;
+    }
+
     virtual scoped_ptr_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
 
@@ -399,20 +486,72 @@ private:
             include_states = v->as_bool();
         }
 
+        // `since` is the `resume_token` of the last change seen by an earlier
+        // changefeed on the same range.
+        changefeed::resume_t resume;
+        if (scoped_ptr_t<val_t> v = args->optarg(env, "since")) {
+            resume.since = changefeed::datum_to_resume_token(v->as_datum());
+        }
+        if (scoped_ptr_t<val_t> v = args->optarg(env, "include_resume_token")) {
+            resume.include_token = v->as_bool();
+            // Squashing reorders changes, so there's no position to resume from.
+            rcheck_target(v, !resume.include_token || !squash.as_bool(),
+                          base_exc_t::GENERIC,
+                          "Cannot include resume tokens when squashing changes.");
+        }
+        const bool resuming = resume.since || resume.include_token;
+        const char *const resume_error =
+            "`since` and `include_resume_token` are only supported on changefeeds "
+            "on tables and ranges (other changefeeds already start with the "
+            "current value).";
+
+        if (aggregate != aggregate_kind_t::NONE) {
+            rcheck(!resuming, base_exc_t::GENERIC, resume_error);
+            terminal_variant_t terminal;
+            counted_t<datum_stream_t> seq = eval_aggregate(env, &terminal);
+            std::vector<changefeed::keyspec_t> keyspecs = seq->get_change_specs();
+            rcheck(keyspecs.size() == 1, base_exc_t::GENERIC,
+                   "Cannot call `changes` on an aggregate of a union.");
+            changefeed::keyspec_t::range_t *range =
+                boost::get<changefeed::keyspec_t::range_t>(&keyspecs[0].spec);
+            rcheck(range != NULL, base_exc_t::GENERIC,
+                   "Aggregate changefeeds are only supported on tables and ranges.");
+            changefeed::keyspec_t::aggregate_t spec{std::move(*range), terminal};
+            rcheck_spec_visitor_t(env->env, backtrace())(spec);
+            return new_val(
+                env->env,
+                keyspecs[0].table->read_changes(
+                    env->env,
+                    squash,
+                    include_states,
+                    resume,
+                    changefeed::keyspec_t::spec_t(std::move(spec)),
+                    backtrace(),
+                    keyspecs[0].table_name));
+        }
+
         scoped_ptr_t<val_t> v = args->arg(env, 0);
         if (v->get_type().is_convertible(val_t::type_t::SEQUENCE)) {
             counted_t<datum_stream_t> seq = v->as_seq(env->env);
             std::vector<counted_t<datum_stream_t> > streams;
             std::vector<changefeed::keyspec_t> keyspecs = seq->get_change_specs();
             r_sanity_check(keyspecs.size() >= 1);
+            // Each stream of a union would need its own token.
+            rcheck(!resuming || keyspecs.size() == 1, base_exc_t::GENERIC,
+                   "`since` and `include_resume_token` are not supported on "
+                   "unions of changefeeds.");
             for (auto &&keyspec : keyspecs) {
                 boost::apply_visitor(rcheck_spec_visitor_t(env->env, backtrace()),
                                      keyspec.spec);
+                rcheck(!resuming || boost::get<changefeed::keyspec_t::range_t>(
+                           &keyspec.spec) != NULL,
+                       base_exc_t::GENERIC, resume_error);
                 streams.push_back(
                     keyspec.table->read_changes(
                         env->env,
                         squash,
                         include_states,
+                        resume,
                         std::move(keyspec.spec),
                         backtrace(),
                         keyspec.table_name));
@@ -426,6 +565,7 @@ private:
                         env->env, std::move(streams), backtrace()));
             }
         } else if (v->get_type().is_convertible(val_t::type_t::SINGLE_SELECTION)) {
+            rcheck(!resuming, base_exc_t::GENERIC, resume_error);
             return new_val(
                 env->env,
                 v->as_single_selection()->read_changes(squash, include_states));
@@ -435,6 +575,10 @@ private:
               ".changes() not yet supported on range selections");
     }
     virtual const char *name() const { return "changes"; }
+
+    enum class aggregate_kind_t { NONE, COUNT, SUM };
+    aggregate_kind_t aggregate;
+    std::vector<counted_t<const term_t> > aggregate_args;
 };
 
 class minval_term_t final : public op_term_t {
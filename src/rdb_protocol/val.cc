@@ -36,6 +36,7 @@ public:
             env,
             squash,
             include_states,
+            changefeed::resume_t(),
             changefeed::keyspec_t::point_t{key},
             bt,
             tbl->display_name());
@@ -86,6 +87,7 @@ public:
             env,
             squash,
             include_states,
+            changefeed::resume_t(),
             std::move(spec),
             bt,
             slice->get_tbl()->display_name());
@@ -390,6 +392,26 @@ counted_t<datum_stream_t> table_t::get_all(
         use_outdated);
 }
 
+counted_t<datum_stream_t> table_t::get_all_by_pkey(
+        env_t *env,
+        const std::vector<datum_t> &values,
+        const protob_t<const Backtrace> &bt) {
+    std::vector<datum_t> rows = tbl->read_rows(env, values, use_outdated);
+    std::vector<changefeed::keyspec_t> changespecs;
+    for (const datum_t &value : values) {
+        changespecs.push_back(changefeed::keyspec_t(
+            changefeed::keyspec_t::range_t{
+                std::vector<transform_variant_t>(),
+                boost::optional<std::string>(),
+                sorting_t::UNORDERED,
+                datum_range_t(value)},
+            counted_t<base_table_t>(tbl),
+            display_name()));
+    }
+    return make_counted<vector_datum_stream_t>(
+        bt, std::move(rows), std::move(changespecs));
+}
+
 counted_t<datum_stream_t> table_t::get_intersecting(
         env_t *env,
         const datum_t &query_geometry,
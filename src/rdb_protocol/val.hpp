@@ -42,6 +42,12 @@ public:
             datum_t value,
             const std::string &sindex_id,
             const protob_t<const Backtrace> &bt);
+    // Like calling `get_all()` for each of `values` on the primary key, but reads
+    // them all at once.
+    counted_t<datum_stream_t> get_all_by_pkey(
+            env_t *env,
+            const std::vector<datum_t> &values,
+            const protob_t<const Backtrace> &bt);
     counted_t<datum_stream_t> get_intersecting(
             env_t *env,
             const datum_t &query_geometry,
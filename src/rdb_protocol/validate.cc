@@ -191,6 +191,7 @@ static std::set<std::string> acceptable_keys = {
     "auth",
     "base",
     "binary_format",
+    "cache_ttl",
     "conflict",
     "data",
     "db",
@@ -206,6 +207,7 @@ static std::set<std::string> acceptable_keys = {
     "group_format",
     "header",
     "identifier_format",
+    "include_resume_token",
     "include_states",
     "index",
     "left_bound",
@@ -214,6 +216,7 @@ static std::set<std::string> acceptable_keys = {
     "max_batch_seconds",
     "max_dist",
     "max_results",
+    "max_staleness",
     "method",
     "min_batch_rows",
     "multi",
@@ -234,6 +237,7 @@ static std::set<std::string> acceptable_keys = {
     "return_vals",
     "right_bound",
     "shards",
+    "since",
     "squash",
     "time_format",
     "timeout",
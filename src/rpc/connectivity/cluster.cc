@@ -27,10 +27,10 @@
 #define MESSAGE_HANDLER_MAX_BATCH_SIZE           8
 
 // The cluster communication protocol version.
-static_assert(cluster_version_t::CLUSTER == cluster_version_t::v2_0_is_latest,
+static_assert(cluster_version_t::CLUSTER == cluster_version_t::v2_1_is_latest,
               "We need to update CLUSTER_VERSION_STRING when we add a new cluster "
               "version.");
-#define CLUSTER_VERSION_STRING "2.0"
+#define CLUSTER_VERSION_STRING "2.1"
 
 const std::string connectivity_cluster_t::cluster_proto_header("RethinkDB cluster\n");
 const std::string connectivity_cluster_t::cluster_version_string(CLUSTER_VERSION_STRING);
@@ -39,7 +39,9 @@ const std::string connectivity_cluster_t::cluster_version_string(CLUSTER_VERSION
 // version_string is a recognized version and the same or earlier than our version.
 static bool version_number_recognized_compatible(const std::string &version_string,
                                                  cluster_version_t *out) {
-    // Right now, we only support one cluster version -- ours.
+    // Right now, we only support one cluster version -- ours.  2.0 peers are refused:
+    // they don't send `resource_usage` in read and write responses, and they don't
+    // take part in the compression exchange.
     if (version_string == CLUSTER_VERSION_STRING) {
         *out = cluster_version_t::CLUSTER;
         return true;
@@ -193,7 +195,8 @@ static peer_address_t our_peer_address(std::set<ip_address_t> local_addresses,
 connectivity_cluster_t::run_t::run_t(connectivity_cluster_t *p,
                                      const std::set<ip_address_t> &local_addresses,
                                      const peer_address_t &canonical_addresses,
-                                     int port, int client_port)
+                                     int port, int client_port,
+                                     bool use_compression)
         THROWS_ONLY(address_in_use_exc_t, tcp_socket_exc_t) :
     parent(p),
 
@@ -204,6 +207,8 @@ connectivity_cluster_t::run_t::run_t(connectivity_cluster_t *p,
     /* The local port to use when connecting to the cluster port of peers */
     cluster_client_port(client_port),
 
+    cluster_use_compression(use_compression),
+
     /* This sets `parent->current_run` to `this`. It's necessary to do it in the
     constructor of a subfield rather than in the body of the `run_t` constructor
     because `parent->current_run` needs to be set before `connection_to_ourself`
@@ -897,6 +902,25 @@ void connectivity_cluster_t::run_t::handle(
         }
     }
 
+    // Negotiate wire compression. Everything after this point is compressed if
+    // either side asked for it. Nodes older than 2.1 don't take part in this
+    // exchange, so it only happens on connections that negotiated v2_1 or later.
+    if (resolved_version >= cluster_version_t::v2_1) {
+        write_message_t wm;
+        serialize_universal(&wm, cluster_use_compression);
+        if (send_write_message(conn, &wm)) {
+            return; // network error.
+        }
+
+        bool other_use_compression;
+        if (deserialize_universal_and_check(conn, &other_use_compression, peername)) {
+            return;
+        }
+        if (cluster_use_compression || other_use_compression) {
+            conn->enable_compression();
+        }
+    }
+
     // Look up the ip addresses for the other host
     object_buffer_t<peer_address_t> other_peer_addr;
 
@@ -1235,29 +1259,22 @@ void connectivity_cluster_t::send_message(connection_t *connection,
         to send on the same connection. */
         mutex_t::acq_t acq(&connection->send_mutex);
 
-        /* Write the tag to the network */
+        /* Write the tag and the message itself to the network. We hand both to
+        a single `writev()`, which also lets a compressed connection flush them
+        as one block. */
         {
             // All cluster versions use a uint8_t tag here.
-            write_message_t wm;
             static_assert(std::is_same<message_tag_t, uint8_t>::value,
                           "We expect to be serializing a uint8_t -- if this has "
                           "changed, the cluster communication format has changed and "
                           "you need to ask yourself whether live cluster upgrades work."
                           );
-            serialize_universal(&wm, tag);
-            int res = send_write_message(connection->conn, &wm);
-            if (res == -1) {
-                if (connection->conn->is_read_open()) {
-                    connection->conn->shutdown_read();
-                }
-                return;
-            }
-        }
-
-        /* Write the message itself to the network */
-        {
-            int64_t res = connection->conn->write(buffer.vector().data(),
-                                                  buffer.vector().size());
+            iovec iov[2];
+            iov[0].iov_base = &tag;
+            iov[0].iov_len = sizeof(tag);
+            iov[1].iov_base = const_cast<char *>(buffer.vector().data());
+            iov[1].iov_len = buffer.vector().size();
+            int64_t res = connection->conn->writev(iov, 2);
             if (res == -1) {
                 /* Close the other half of the connection to make sure that
                    `connectivity_cluster_t::run_t::handle()` notices that something is
@@ -1267,7 +1284,8 @@ void connectivity_cluster_t::send_message(connection_t *connection,
                 }
                 return;
             } else {
-                guarantee(res == static_cast<int64_t>(buffer.vector().size()));
+                guarantee(res == static_cast<int64_t>(
+                    sizeof(tag) + buffer.vector().size()));
             }
         }
     }
@@ -143,13 +143,18 @@ public:
     message handlers. The `run_t`'s constructor is what actually starts listening for
     connections from other nodes, and the destructor is what stops listening. This way,
     we use RAII to ensure that we stop sending messages to the message handlers before we
-    destroy the message handlers. */
+    destroy the message handlers.
+
+    If `use_compression` is true, we ask every peer to compress the connection to
+    it. A connection is compressed if either end asks for it, so it's enough to
+    turn it on for the servers on the far side of a slow link. */
     class run_t {
     public:
         run_t(connectivity_cluster_t *parent,
               const std::set<ip_address_t> &local_addresses,
               const peer_address_t &canonical_addresses,
-              int port, int client_port)
+              int port, int client_port,
+              bool use_compression = false)
             THROWS_ONLY(address_in_use_exc_t, tcp_socket_exc_t);
 
         ~run_t();
@@ -247,6 +252,7 @@ public:
         scoped_ptr_t<tcp_bound_socket_t> cluster_listener_socket;
         int cluster_listener_port;
         int cluster_client_port;
+        bool cluster_use_compression;
 
         variable_setter_t register_us_with_parent;
 
@@ -129,6 +129,26 @@ public:
         return store_view->send_backfill(start_point, send_backfill_cb, p, token, interruptor);
     }
 
+    void get_range_hashes(
+            const std::vector<region_t> &regions,
+            size_t max_split_keys,
+            std::vector<range_hash_t> *hashes_out,
+            region_map_t<binary_blob_t> *metainfo_out,
+            read_token_t *token,
+            signal_t *interruptor)
+            THROWS_ONLY(interrupted_exc_t) {
+        home_thread_mixin_t::assert_thread();
+#ifndef NDEBUG
+        for (const region_t &r : regions) {
+            rassert(region_is_superset(get_region(), r));
+        }
+#endif
+
+        store_view->get_range_hashes(regions, max_split_keys, hashes_out,
+                                     metainfo_out, token, interruptor);
+        *metainfo_out = metainfo_out->mask(get_region());
+    }
+
     void receive_backfill(
             const backfill_chunk_t &chunk,
             write_token_t *token,
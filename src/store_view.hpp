@@ -90,6 +90,22 @@ public:
             THROWS_ONLY(interrupted_exc_t) = 0;
 
 
+    /* Hashes the key/value pairs in each of `regions` and also returns the
+    metainfo of the snapshot that the hashes were computed from. The ranges are
+    split into at most `max_split_keys` + 1 pieces of about equal size, see
+    `range_hash_t`.
+    [Precondition] `regions` are sorted, disjoint and inside view->get_region()
+    [May block]
+    */
+    virtual void get_range_hashes(
+            const std::vector<region_t> &regions,
+            size_t max_split_keys,
+            std::vector<range_hash_t> *hashes_out,
+            region_map_t<binary_blob_t> *metainfo_out,
+            read_token_t *token,
+            signal_t *interruptor)
+            THROWS_ONLY(interrupted_exc_t) = 0;
+
     /* Applies a backfill data chunk sent by `send_backfill()`. If
     `interrupted_exc_t` is thrown, the state of the database is undefined
     except that doing a second backfill must put it into a valid state.
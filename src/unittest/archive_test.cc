@@ -5,6 +5,7 @@
 
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/stl_types.hpp"
+#include "containers/archive/string_stream.hpp"
 
 namespace unittest {
 
@@ -34,6 +35,24 @@ TEST(WriteMessageTest, Variant) {
     ASSERT_EQ(15u, s.size());
 }
 
+TEST(WriteMessageTest, SendManyBuffers) {
+    // Big enough to span several `write_buffer_t`s.
+    std::string big(3 * write_buffer_t::DATA_SIZE + 17, 'x');
+    for (size_t i = 0; i < big.size(); ++i) {
+        big[i] = 'a' + (i % 26);
+    }
+
+    write_message_t wm;
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, big);
+    ASSERT_LT(1u, wm.unsafe_expose_buffers()->size());
+
+    std::string expected;
+    dump_to_string(&wm, &expected);
+
+    string_stream_t stream;
+    ASSERT_EQ(0, send_write_message(&stream, &wm));
+    ASSERT_EQ(expected, stream.str());
+}
 
 
 }  // namespace unittest
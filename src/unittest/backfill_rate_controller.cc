@@ -0,0 +1,47 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <algorithm>
+
+#include "arch/timing.hpp"
+#include "concurrency/cond_var.hpp"
+#include "config/args.hpp"
+#include "rdb_protocol/backfill_rate_controller.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(BackfillRateController, AdjustsToForegroundLatency) {
+    backfill_rate_controller_t controller(NULL);
+    EXPECT_DOUBLE_EQ(BACKFILL_MIN_BANDWIDTH, controller.get_rate());
+
+    /* Without any slow foreground operations, the rate goes up. */
+    nap(BACKFILL_RATE_ADJUST_INTERVAL_MS + 10);
+    controller.note_backfill_bytes(0);
+    double rate = controller.get_rate();
+    EXPECT_GT(rate, BACKFILL_MIN_BANDWIDTH);
+
+    /* A slow foreground operation makes it back off. */
+    nap(BACKFILL_RATE_ADJUST_INTERVAL_MS + 10);
+    controller.note_foreground_op(secs_to_ticks(1));
+    EXPECT_DOUBLE_EQ(std::max<double>(rate / 2, BACKFILL_MIN_BANDWIDTH),
+                     controller.get_rate());
+}
+
+TPTEST(BackfillRateController, Throttles) {
+    backfill_rate_controller_t controller(NULL);
+    cond_t non_interruptor;
+
+    /* At the minimum rate, this much data takes about 100ms. */
+    controller.note_backfill_bytes(BACKFILL_MIN_BANDWIDTH / 10);
+    ticks_t start_time = get_ticks();
+    controller.throttle(&non_interruptor);
+    EXPECT_GE(get_ticks() - start_time, static_cast<ticks_t>(90 * MILLION));
+
+    /* Interrupting the wait throws. */
+    controller.note_backfill_bytes(BACKFILL_MIN_BANDWIDTH);
+    cond_t interruptor;
+    interruptor.pulse();
+    EXPECT_THROW(controller.throttle(&interruptor), interrupted_exc_t);
+}
+
+}  // namespace unittest
@@ -0,0 +1,80 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+
+#include "rdb_protocol/protocol.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+using ql::changefeed::msg_t;
+
+void add_change(std::map<uint64_t, msg_t> *batch,
+                std::map<store_key_t, uint64_t> *batch_changes,
+                uint64_t stamp,
+                const std::string &pkey,
+                ql::datum_t old_val,
+                ql::datum_t new_val) {
+    msg_t::change_t change;
+    change.pkey = store_key_t(pkey);
+    change.old_val = std::move(old_val);
+    change.new_val = std::move(new_val);
+    change.log_seq = stamp;
+    ql::changefeed::add_msg_to_squashing_batch(
+        batch, batch_changes, stamp, msg_t(std::move(change)));
+}
+
+const msg_t::change_t *get_change(const std::map<uint64_t, msg_t> &batch,
+                                  uint64_t stamp) {
+    auto it = batch.find(stamp);
+    if (it == batch.end()) {
+        return NULL;
+    }
+    return boost::get<msg_t::change_t>(&it->second.op);
+}
+
+TEST(ChangefeedSquashing, CoalescedChangeKeepsOldValAndTakesNewStamp) {
+    std::map<uint64_t, msg_t> batch;
+    std::map<store_key_t, uint64_t> batch_changes;
+    add_change(&batch, &batch_changes, 5, "a", ql::datum_t(1.0), ql::datum_t(2.0));
+    add_change(&batch, &batch_changes, 6, "b", ql::datum_t(), ql::datum_t(10.0));
+    add_change(&batch, &batch_changes, 7, "a", ql::datum_t(2.0), ql::datum_t(3.0));
+
+    ASSERT_EQ(2u, batch.size());
+    EXPECT_TRUE(get_change(batch, 5) == NULL);
+
+    const msg_t::change_t *a = get_change(batch, 7);
+    ASSERT_TRUE(a != NULL);
+    EXPECT_EQ(store_key_t("a"), a->pkey);
+    EXPECT_EQ(ql::datum_t(1.0), a->old_val);
+    EXPECT_EQ(ql::datum_t(3.0), a->new_val);
+    EXPECT_EQ(7u, a->log_seq);
+    EXPECT_EQ(7u, batch_changes[store_key_t("a")]);
+
+    const msg_t::change_t *b = get_change(batch, 6);
+    ASSERT_TRUE(b != NULL);
+    EXPECT_FALSE(b->old_val.has());
+    EXPECT_EQ(ql::datum_t(10.0), b->new_val);
+}
+
+TEST(ChangefeedSquashing, CancellingChangesAreDropped) {
+    std::map<uint64_t, msg_t> batch;
+    std::map<store_key_t, uint64_t> batch_changes;
+    // Inserted and then deleted.
+    add_change(&batch, &batch_changes, 1, "a", ql::datum_t(), ql::datum_t(1.0));
+    add_change(&batch, &batch_changes, 2, "a", ql::datum_t(1.0), ql::datum_t());
+    // Changed and then changed back.
+    add_change(&batch, &batch_changes, 3, "b", ql::datum_t(1.0), ql::datum_t(2.0));
+    add_change(&batch, &batch_changes, 4, "b", ql::datum_t(2.0), ql::datum_t(1.0));
+    EXPECT_TRUE(batch.empty());
+    EXPECT_TRUE(batch_changes.empty());
+
+    // A later change to the same key starts over.
+    add_change(&batch, &batch_changes, 5, "a", ql::datum_t(), ql::datum_t(4.0));
+    const msg_t::change_t *a = get_change(batch, 5);
+    ASSERT_TRUE(a != NULL);
+    EXPECT_FALSE(a->old_val.has());
+    EXPECT_EQ(ql::datum_t(4.0), a->new_val);
+}
+
+}  // namespace unittest
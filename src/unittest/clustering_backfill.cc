@@ -18,6 +18,25 @@ boost::optional<boost::optional<backfiller_business_card_t> > wrap_in_optional(
     return boost::optional<boost::optional<backfiller_business_card_t> >(inner);
 }
 
+/* Counts the key/value pairs that a backfill transfers. */
+class counting_mock_store_t : public mock_store_t {
+public:
+    counting_mock_store_t() : pairs_received(0) { }
+
+    void receive_backfill(
+            const backfill_chunk_t &chunk,
+            write_token_t *token,
+            signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        if (const backfill_chunk_t::key_value_pairs_t *pairs =
+                boost::get<backfill_chunk_t::key_value_pairs_t>(&chunk.val)) {
+            pairs_received += pairs->backfill_atoms.size();
+        }
+        mock_store_t::receive_backfill(chunk, token, interruptor);
+    }
+
+    size_t pairs_received;
+};
+
 }   /* anonymous namespace */
 
 TPTEST(ClusteringBackfill, BackfillTest) {
@@ -155,4 +174,112 @@ TPTEST(ClusteringBackfill, BackfillTest) {
     //EXPECT_EQ(timestamp, backfillee_metadata[0].second.earliest.timestamp);
 }
 
+/* A backfillee that has the same data as the backfiller, but doesn't know which
+writes it has, should not receive any of it again. */
+TPTEST(ClusteringBackfill, InSyncRangesAreSkipped) {
+    order_source_t order_source;
+    region_t region = region_t::universe();
+
+    mock_store_t backfiller_store;
+    counting_mock_store_t backfillee_store;
+
+    in_memory_branch_history_manager_t branch_history_manager;
+    branch_id_t dummy_branch_id = generate_uuid();
+    {
+        branch_birth_certificate_t dummy_branch;
+        dummy_branch.region = region;
+        dummy_branch.initial_timestamp = state_timestamp_t::zero();
+        dummy_branch.origin = region_map_t<version_range_t>(
+            region, version_range_t(version_t(nil_uuid(), state_timestamp_t::zero())));
+        cond_t non_interruptor;
+        branch_history_manager.create_branch(dummy_branch_id, dummy_branch, &non_interruptor);
+    }
+
+    store_view_t *stores[] = { &backfiller_store, &backfillee_store };
+    for (size_t i = 0; i < sizeof(stores) / sizeof(stores[0]); i++) {
+        cond_t non_interruptor;
+        write_token_t token;
+        stores[i]->new_write_token(&token);
+        stores[i]->set_metainfo(
+            region_map_t<binary_blob_t>(region,
+                binary_blob_t(version_range_t(version_t(dummy_branch_id, state_timestamp_t::zero())))),
+            order_source.check_in(strprintf("set_metainfo(i=%zu)", i)),
+            &token,
+            &non_interruptor);
+    }
+
+    // Apply the same writes to both stores
+    state_timestamp_t timestamp = state_timestamp_t::zero();
+    for (int i = 0; i < 26; i++) {
+        timestamp = timestamp.next();
+        write_t w = mock_overwrite(std::string(1, 'a' + i), strprintf("%d", i));
+        for (size_t j = 0; j < sizeof(stores) / sizeof(stores[0]); j++) {
+            cond_t non_interruptor;
+            write_token_t token;
+            stores[j]->new_write_token(&token);
+            write_response_t response;
+#ifndef NDEBUG
+            trivial_metainfo_checker_callback_t metainfo_checker_callback;
+            metainfo_checker_t metainfo_checker(&metainfo_checker_callback, region);
+#endif
+            stores[j]->write(
+                DEBUG_ONLY(metainfo_checker, )
+                region_map_t<binary_blob_t>(
+                    region,
+                    binary_blob_t(version_range_t(version_t(dummy_branch_id, timestamp)))),
+                w,
+                &response, write_durability_t::SOFT,
+                timestamp,
+                order_source.check_in(strprintf("write(i=%d, j=%zu)", i, j)),
+                &token,
+                &non_interruptor);
+        }
+    }
+
+    // Make the backfillee forget how far it got
+    {
+        cond_t non_interruptor;
+        write_token_t token;
+        backfillee_store.new_write_token(&token);
+        backfillee_store.set_metainfo(
+            region_map_t<binary_blob_t>(region,
+                binary_blob_t(version_range_t(version_t(dummy_branch_id, state_timestamp_t::zero())))),
+            order_source.check_in("set_metainfo(forget)"),
+            &token,
+            &non_interruptor);
+    }
+
+    simple_mailbox_cluster_t cluster;
+    backfiller_t backfiller(
+        cluster.get_mailbox_manager(),
+        &branch_history_manager,
+        &backfiller_store);
+    watchable_variable_t<boost::optional<backfiller_business_card_t> > pseudo_directory(
+        boost::optional<backfiller_business_card_t>(backfiller.get_business_card()));
+
+    cond_t interruptor;
+    backfillee(
+        cluster.get_mailbox_manager(),
+        &branch_history_manager,
+        &backfillee_store,
+        backfillee_store.get_region(),
+        pseudo_directory.get_watchable()->subview(&wrap_in_optional),
+        &interruptor,
+        nullptr);
+
+    EXPECT_EQ(0u, backfillee_store.pairs_received);
+    for (char c = 'a'; c <= 'z'; c++) {
+        std::string key(1, c);
+        EXPECT_EQ(backfiller_store.values(key), backfillee_store.values(key));
+    }
+
+    read_token_t token;
+    backfillee_store.new_read_token(&token);
+    region_map_t<binary_blob_t> backfillee_metadata;
+    backfillee_store.do_get_metainfo(order_source.check_in("do_get_metainfo").with_read_mode(),
+                                     &token, &interruptor, &backfillee_metadata);
+    EXPECT_TRUE(backfillee_metadata == region_map_t<binary_blob_t>(region,
+        binary_blob_t(version_range_t(version_t(dummy_branch_id, timestamp)))));
+}
+
 }   /* namespace unittest */
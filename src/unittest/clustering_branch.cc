@@ -253,6 +253,124 @@ TEST(ClusteringBranch, Backfill) {
     run_in_thread_pool_with_broadcaster(&run_backfill_test);
 }
 
+/* The `BatchedWriteReads` test sends many concurrent writes that must be acked by
+two mirrors. The second mirror is remote, so it gets its writes in batches and
+replies to each of them separately. */
+
+void run_batched_writereads_test(
+        io_backender_t *io_backender,
+        simple_mailbox_cluster_t *cluster,
+        branch_history_manager_t *branch_history_manager,
+        clone_ptr_t<watchable_t<boost::optional<broadcaster_business_card_t> > > broadcaster_metadata_view,
+        scoped_ptr_t<broadcaster_t> *broadcaster,
+        mock_store_t *store1,
+        scoped_ptr_t<listener_t> *initial_listener,
+        order_source_t *order_source) {
+    replier_t replier(initial_listener->get(), cluster->get_mailbox_manager(), branch_history_manager);
+
+    watchable_variable_t<boost::optional<replier_business_card_t> > replier_directory_controller(
+        boost::optional<replier_business_card_t>(replier.get_business_card()));
+
+    backfill_throttler_t backfill_throttler;
+
+    /* Set up a second mirror, and make it readable so it gets write-reads. */
+    mock_store_t store2((binary_blob_t(version_range_t(version_t::zero()))));
+    cond_t interruptor;
+    listener_t listener2(
+        base_path_t("."),
+        io_backender,
+        cluster->get_mailbox_manager(),
+        generate_uuid(),
+        &backfill_throttler,
+        broadcaster_metadata_view->subview(&wrap_broadcaster_in_optional),
+        branch_history_manager,
+        &store2,
+        replier_directory_controller.get_watchable()->subview(&wrap_replier_in_optional),
+        &get_global_perfmon_collection(),
+        &interruptor,
+        order_source,
+        nullptr);
+    replier_t replier2(&listener2, cluster->get_mailbox_manager(), branch_history_manager);
+
+    /* Give time for the broadcaster to see the upgrade. */
+    let_stuff_happen();
+
+    class counting_write_callback_t : public broadcaster_t::write_callback_t {
+    public:
+        counting_write_callback_t(int *_successes, cond_t *_done)
+            : successes(_successes), done(_done) { }
+        void on_success(const write_response_t &) {
+            ++*successes;
+            done->pulse();
+        }
+        void on_failure(UNUSED bool might_have_been_run) {
+            EXPECT_TRUE(false);
+            done->pulse();
+        }
+        int *successes;
+        cond_t *done;
+    };
+
+    /* All of the writes are in flight at the same time, so they get batched. */
+    const int num_writes = 200;
+    int successes = 0;
+    std::vector<scoped_ptr_t<cond_t> > dones;
+    std::vector<scoped_ptr_t<counting_write_callback_t> > callbacks;
+    std::map<std::string, std::string> values_inserted;
+    unittest::fake_fifo_enforcement_t enforce;
+    fake_ack_checker_t ack_checker(2);
+    cond_t non_interruptor;
+    for (int i = 0; i < num_writes; ++i) {
+        std::string key = strprintf("key%d", i);
+        values_inserted[key] = strprintf("%d", i);
+        dones.push_back(make_scoped<cond_t>());
+        callbacks.push_back(make_scoped<counting_write_callback_t>(
+            &successes, dones.back().get()));
+        fifo_enforcer_sink_t::exit_write_t exiter(&enforce.sink, enforce.source.enter_write());
+        (*broadcaster)->spawn_write(
+            mock_overwrite(key, values_inserted[key]), &exiter,
+            order_source->check_in("unittest::run_batched_writereads_test(write)"),
+            callbacks.back().get(), &non_interruptor, &ack_checker);
+    }
+    for (const auto &done : dones) {
+        done->wait_lazily_unordered();
+    }
+    EXPECT_EQ(num_writes, successes);
+
+    for (const auto &pair : values_inserted) {
+        EXPECT_EQ(pair.second, mock_lookup(store1, pair.first));
+        EXPECT_EQ(pair.second, mock_lookup(&store2, pair.first));
+    }
+}
+TEST(ClusteringBranch, BatchedWriteReads) {
+    run_in_thread_pool_with_broadcaster(&run_batched_writereads_test);
+}
+
+/* The `BoundedStaleness` test checks that a mirror that has never been asked for a
+read with a `max_staleness` asks the broadcaster for heartbeats when it is, and can
+then serve the read. */
+
+void run_bounded_staleness_test(UNUSED io_backender_t *io_backender,
+                                UNUSED simple_mailbox_cluster_t *cluster,
+                                UNUSED branch_history_manager_t *branch_history_manager,
+                                UNUSED clone_ptr_t<watchable_t<boost::optional<broadcaster_business_card_t> > > broadcaster_metadata_view,
+                                UNUSED scoped_ptr_t<broadcaster_t> *broadcaster,
+                                UNUSED mock_store_t *store,
+                                scoped_ptr_t<listener_t> *initial_listener,
+                                UNUSED order_source_t *order_source) {
+    /* No heartbeats are sent before the first bounded read, so this one has to wait
+    for the heartbeat it requests. */
+    let_stuff_happen();
+    cond_t non_interruptor;
+    EXPECT_TRUE((*initial_listener)->wait_until_fresh(1000, &non_interruptor));
+
+    /* The heartbeat that the first read waited for is recent enough for this one. */
+    EXPECT_TRUE((*initial_listener)->wait_until_fresh(1000, &non_interruptor));
+}
+TEST(ClusteringBranch, BoundedStaleness) {
+    run_in_thread_pool_with_broadcaster(&run_bounded_staleness_test);
+}
+
 /* `PartialBackfill` backfills only in a specific sub-region. */
 
 void run_partial_backfill_test(io_backender_t *io_backender,
@@ -89,6 +89,31 @@ TEST(ContextSwitchingTest, SwitchBetweenContexts) {
     original_context = NULL;
 }
 
+#ifndef THREADED_COROUTINES
+static void touch_stack(void) {
+    volatile char buffer[40 * 1024];
+    for (size_t i = 0; i < sizeof(buffer); ++i) {
+        buffer[i] = 1;
+    }
+    context_switch(artificial_stack_1_context, original_context);
+}
+
+TEST(ContextSwitchingTest, StackHighWaterUsage) {
+    scoped_ptr_t<coro_context_ref_t> orig_context_local(new coro_context_ref_t);
+    original_context = orig_context_local.get();
+    {
+        coro_stack_t a(&touch_stack, 1024*1024);
+        artificial_stack_1_context = &a.context;
+        EXPECT_LT(a.get_high_water_usage(), 40u * 1024);
+
+        context_switch(original_context, artificial_stack_1_context);
+        EXPECT_GE(a.get_high_water_usage(), 40u * 1024);
+        EXPECT_LT(a.get_high_water_usage(), a.get_stack_size());
+    }
+    original_context = NULL;
+}
+#endif  // THREADED_COROUTINES
+
 __attribute__((noreturn)) static void throw_an_exception() {
     throw std::runtime_error("This is a test exception");
 }
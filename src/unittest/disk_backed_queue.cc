@@ -74,6 +74,42 @@ TEST(DiskBackedQueue, BigVals) {
     unittest::run_in_thread_pool(&run_big_values_test, 2);
 }
 
+void run_for_each_test() {
+    static const int NUM_ELTS_IN_QUEUE = 1000;
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+
+    const serializer_filepath_t serializer_path = dbq_serializer_path();
+
+    disk_backed_queue_t<int> queue(&io_backender, serializer_path, &get_global_perfmon_collection());
+
+    for (int i = 0; i < NUM_ELTS_IN_QUEUE; ++i) {
+        queue.push(i);
+    }
+    // Pop some so that the tail block is partially consumed.
+    for (int i = 0; i < NUM_ELTS_IN_QUEUE / 3; ++i) {
+        int x;
+        queue.pop(&x);
+    }
+
+    std::vector<int> seen;
+    queue.for_each([&](int &&x) { seen.push_back(x); });
+    ASSERT_EQ(static_cast<size_t>(NUM_ELTS_IN_QUEUE - NUM_ELTS_IN_QUEUE / 3),
+              seen.size());
+    for (size_t i = 0; i < seen.size(); ++i) {
+        EXPECT_EQ(static_cast<int>(i) + NUM_ELTS_IN_QUEUE / 3, seen[i]);
+    }
+
+    // Nothing was removed.
+    EXPECT_EQ(static_cast<int64_t>(seen.size()), queue.size());
+    int x;
+    queue.pop(&x);
+    EXPECT_EQ(NUM_ELTS_IN_QUEUE / 3, x);
+}
+
+TEST(DiskBackedQueue, ForEach) {
+    unittest::run_in_thread_pool(&run_for_each_test, 2);
+}
+
 static void randomly_delay(int, signal_t *) {
     nap(randint(100));
 }
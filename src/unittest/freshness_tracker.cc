@@ -0,0 +1,67 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "clustering/immediate_consistency/branch/freshness_tracker.hpp"
+
+#include "config/args.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+static const ticks_t ms = MILLION;
+
+static state_timestamp_t ts(int n) {
+    state_timestamp_t t = state_timestamp_t::zero();
+    for (int i = 0; i < n; ++i) {
+        t = t.next();
+    }
+    return t;
+}
+
+TEST(FreshnessTrackerTest, NothingHeard) {
+    freshness_tracker_t tracker;
+    EXPECT_FALSE(static_cast<bool>(tracker.get_required_timestamp(1000 * ms, 100 * ms)));
+}
+
+TEST(FreshnessTrackerTest, RequiredTimestamp) {
+    freshness_tracker_t tracker;
+    tracker.note_primary_timestamp(1000 * ms, ts(3));
+    tracker.note_primary_timestamp(1050 * ms, ts(7));
+    tracker.note_primary_timestamp(1100 * ms, ts(7));
+    tracker.note_primary_timestamp(1150 * ms, ts(12));
+
+    // The read must see what the primary had done by the first heartbeat that
+    // arrived within the bound.
+    EXPECT_EQ(ts(12), *tracker.get_required_timestamp(1160 * ms, 10 * ms));
+    EXPECT_EQ(ts(12), *tracker.get_required_timestamp(1160 * ms, 50 * ms));
+    EXPECT_EQ(ts(7), *tracker.get_required_timestamp(1160 * ms, 60 * ms));
+    EXPECT_EQ(ts(7), *tracker.get_required_timestamp(1160 * ms, 110 * ms));
+    EXPECT_EQ(ts(3), *tracker.get_required_timestamp(1160 * ms, 160 * ms));
+
+    // Bounds that reach back before the first heartbeat use the oldest one.
+    EXPECT_EQ(ts(3), *tracker.get_required_timestamp(1160 * ms, 5000 * ms));
+
+    // If we haven't heard from the primary within the bound, we can't vouch for it.
+    EXPECT_FALSE(static_cast<bool>(tracker.get_required_timestamp(1200 * ms, 40 * ms)));
+}
+
+TEST(FreshnessTrackerTest, ReorderedHeartbeats) {
+    freshness_tracker_t tracker;
+    tracker.note_primary_timestamp(1000 * ms, ts(5));
+    // An older heartbeat that arrives late doesn't lower the requirement.
+    tracker.note_primary_timestamp(1050 * ms, ts(4));
+    EXPECT_EQ(ts(5), *tracker.get_required_timestamp(1060 * ms, 20 * ms));
+}
+
+TEST(FreshnessTrackerTest, ForgetsOldHeartbeats) {
+    freshness_tracker_t tracker;
+    const ticks_t history = static_cast<ticks_t>(LISTENER_FRESHNESS_HISTORY_MS) * ms;
+    tracker.note_primary_timestamp(1000 * ms, ts(1));
+    tracker.note_primary_timestamp(1000 * ms + history / 2, ts(2));
+    tracker.note_primary_timestamp(1000 * ms + history * 2, ts(3));
+
+    // Only the last heartbeat is left; a bound that reaches back further is
+    // enforced as if it were shorter.
+    EXPECT_EQ(ts(3), *tracker.get_required_timestamp(
+        1000 * ms + history * 2, history * 2));
+}
+
+}  // namespace unittest
@@ -0,0 +1,131 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "arch/io/network.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "extproc/extproc_pool.hpp"
+#include "extproc/extproc_spawner.hpp"
+#include "extproc/http_runner.hpp"
+#include "unittest/extproc_test.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+// A stand-in for the servers that `r.http` talks to.  Unlike `http_server_t`, it keeps
+// connections open between requests.  It answers every request with the number of
+// requests it has received so far.
+class keepalive_http_server_t {
+public:
+    keepalive_http_server_t() : connections(0), requests(0) {
+        std::set<ip_address_t> ip_addresses;
+        ip_addresses.insert(ip_address_t("127.0.0.1"));
+        listener.init(new tcp_listener_t(
+            ip_addresses, 0,
+            std::bind(&keepalive_http_server_t::handle_conn, this,
+                      std::placeholders::_1, auto_drainer_t::lock_t(&drainer))));
+    }
+
+    std::string url(const std::string &path) const {
+        return strprintf("http://127.0.0.1:%d/%s", listener->get_port(), path.c_str());
+    }
+
+    int connections;
+    int requests;
+
+private:
+    void handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
+                     auto_drainer_t::lock_t keepalive) {
+        scoped_ptr_t<tcp_conn_t> conn;
+        nconn->make_overcomplicated(&conn);
+        ++connections;
+
+        try {
+            std::string buffer;
+            for (;;) {
+                // The requests have no body, so they end with the header
+                size_t end;
+                while ((end = buffer.find("\r\n\r\n")) == std::string::npos) {
+                    char chunk[1024];
+                    size_t size = conn->read_some(chunk, sizeof(chunk),
+                                                  keepalive.get_drain_signal());
+                    buffer.append(chunk, size);
+                }
+                buffer.erase(0, end + 4);
+
+                ++requests;
+                std::string body = strprintf("%d", requests);
+                std::string response = strprintf("HTTP/1.1 200 OK\r\n"
+                                                 "Content-Type: text/plain\r\n"
+                                                 "Content-Length: %zu\r\n\r\n%s",
+                                                 body.size(), body.c_str());
+                conn->write(response.data(), response.size(),
+                            keepalive.get_drain_signal());
+            }
+        } catch (const tcp_conn_read_closed_exc_t &) {
+        } catch (const tcp_conn_write_closed_exc_t &) {
+        }
+    }
+
+    auto_drainer_t drainer;
+    scoped_ptr_t<tcp_listener_t> listener;
+};
+
+SPAWNER_TEST(HttpProc, BatchKeepAliveAndCache) {
+    keepalive_http_server_t server;
+    extproc_pool_t extproc_pool(1);
+    http_runner_t runner(&extproc_pool);
+    cond_t non_interruptor;
+
+    // All of the requests in a batch are made, and the results come back in order
+    std::vector<http_opts_t> opts_batch(5);
+    for (size_t i = 0; i < opts_batch.size(); ++i) {
+        opts_batch[i].url = server.url(strprintf("%zu", i));
+    }
+    std::vector<http_result_t> results;
+    runner.http_batch(opts_batch, &results, &non_interruptor);
+    ASSERT_EQ(opts_batch.size(), results.size());
+    std::set<std::string> bodies;
+    for (const http_result_t &res : results) {
+        ASSERT_EQ("", res.error);
+        ASSERT_EQ(ql::datum_t::R_STR, res.body.get_type());
+        bodies.insert(res.body.as_str().to_std());
+    }
+    EXPECT_EQ(opts_batch.size(), bodies.size());
+    EXPECT_EQ(5, server.requests);
+
+    // Later requests reuse the connections the worker already has
+    int connections = server.connections;
+    for (int i = 0; i < 3; ++i) {
+        http_opts_t opts;
+        opts.url = server.url("again");
+        http_result_t res;
+        runner.http(opts, &res, &non_interruptor);
+        ASSERT_EQ("", res.error);
+    }
+    EXPECT_EQ(8, server.requests);
+    EXPECT_EQ(connections, server.connections);
+
+    // A request with `cache_ttl_ms` is answered from the worker's cache the second
+    // time, but a request with different options isn't
+    http_opts_t cached_opts;
+    cached_opts.url = server.url("cached");
+    cached_opts.cache_ttl_ms = 60000;
+    http_result_t first, second;
+    runner.http(cached_opts, &first, &non_interruptor);
+    runner.http(cached_opts, &second, &non_interruptor);
+    ASSERT_EQ("", first.error);
+    ASSERT_EQ("", second.error);
+    EXPECT_EQ(first.body, second.body);
+    EXPECT_EQ(9, server.requests);
+
+    cached_opts.header.push_back("X-Test: 1");
+    http_result_t third;
+    runner.http(cached_opts, &third, &non_interruptor);
+    ASSERT_EQ("", third.error);
+    EXPECT_EQ(10, server.requests);
+}
+
+}  // namespace unittest
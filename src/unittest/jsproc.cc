@@ -117,6 +117,123 @@ SPAWNER_TEST(JSProc, EvalAndCall) {
     ASSERT_EQ(res_datum->as_int(), 10337);
 }
 
+SPAWNER_TEST(JSProc, CallBatch) {
+    extproc_pool_t extproc_pool(1);
+    js_runner_t js_runner;
+    ql::configured_limits_t limits;
+
+    js_runner.begin(&extproc_pool, NULL, limits);
+
+    const std::string source_code =
+        "(function (x) { if (x == 3) { throw 'three'; } return x * 2; })";
+
+    js_runner_t::req_config_t config;
+    config.timeout_ms = 10000;
+
+    std::vector<std::vector<ql::datum_t> > args_batch;
+    for (int i = 0; i < 5; ++i) {
+        args_batch.push_back(std::vector<ql::datum_t>(1, ql::datum_t(static_cast<double>(i))));
+    }
+    std::vector<js_result_t> results =
+        js_runner.call_batch(source_code, args_batch, config);
+    ASSERT_TRUE(js_runner.connected());
+    ASSERT_EQ(args_batch.size(), results.size());
+
+    // An error in one call doesn't affect the others
+    for (int i = 0; i < 5; ++i) {
+        if (i == 3) {
+            std::string *error = boost::get<std::string>(&results[i]);
+            ASSERT_TRUE(error != NULL);
+            ASSERT_EQ("three", *error);
+        } else {
+            ql::datum_t *res_datum = boost::get<ql::datum_t>(&results[i]);
+            ASSERT_TRUE(res_datum != NULL);
+            ASSERT_EQ(i * 2, res_datum->as_int());
+        }
+    }
+}
+
+SPAWNER_TEST(JSProc, CallBatchTimeout) {
+    extproc_pool_t extproc_pool(1);
+    js_runner_t js_runner;
+    ql::configured_limits_t limits;
+
+    js_runner.begin(&extproc_pool, NULL, limits);
+
+    const std::string source_code =
+        "(function (x) { if (x == 2) { while (true) { } } return x; })";
+
+    js_runner_t::req_config_t config;
+    config.timeout_ms = 200;
+
+    std::vector<std::vector<ql::datum_t> > args_batch;
+    for (int i = 0; i < 5; ++i) {
+        args_batch.push_back(std::vector<ql::datum_t>(1, ql::datum_t(static_cast<double>(i))));
+    }
+    std::vector<js_result_t> results =
+        js_runner.call_batch(source_code, args_batch, config);
+
+    // The worker stopped the call that looped, and the rest of the batch with it. It
+    // didn't have to be killed.
+    ASSERT_TRUE(js_runner.connected());
+    ASSERT_EQ(3u, results.size());
+    for (int i = 0; i < 2; ++i) {
+        ql::datum_t *res_datum = boost::get<ql::datum_t>(&results[i]);
+        ASSERT_TRUE(res_datum != NULL);
+        ASSERT_EQ(i, res_datum->as_int());
+    }
+    std::string *error = boost::get<std::string>(&results[2]);
+    ASSERT_TRUE(error != NULL);
+    ASSERT_NE(std::string::npos, error->find("timed out"));
+
+    // The worker can still run JavaScript.
+    args_batch.resize(2);
+    results = js_runner.call_batch(source_code, args_batch, config);
+    ASSERT_EQ(2u, results.size());
+    ASSERT_TRUE(boost::get<ql::datum_t>(&results[1]) != NULL);
+}
+
+SPAWNER_TEST(JSProc, CompiledFunctionIsolation) {
+    extproc_pool_t extproc_pool(1);
+    ql::configured_limits_t limits;
+
+    // The function counts its calls, both in its closure and in a global.
+    const std::string counter_source =
+        "(function () {"
+        "    var n = 0;"
+        "    return function () {"
+        "        if (typeof calls === 'undefined') { calls = 0; }"
+        "        return 100 * (++n) + (++calls);"
+        "    };"
+        "})()";
+
+    js_runner_t::req_config_t config;
+    config.timeout_ms = 10000;
+
+    auto call_counter = [&](js_runner_t *js_runner) -> int64_t {
+        js_result_t result =
+            js_runner->call(counter_source, std::vector<ql::datum_t>(), config);
+        ql::datum_t *res_datum = boost::get<ql::datum_t>(&result);
+        guarantee(res_datum != NULL);
+        return res_datum->as_int();
+    };
+
+    // Within one query, the function keeps its state between calls.
+    scoped_ptr_t<js_runner_t> first_runner(new js_runner_t);
+    first_runner->begin(&extproc_pool, NULL, limits);
+    ASSERT_EQ(101, call_counter(first_runner.get()));
+    ASSERT_EQ(202, call_counter(first_runner.get()));
+    first_runner.reset();
+
+    // The next query runs on the same worker, which has the function's code cached,
+    // but it gets a new function and a new global object.
+    for (int i = 0; i < 2; ++i) {
+        js_runner_t runner;
+        runner.begin(&extproc_pool, NULL, limits);
+        ASSERT_EQ(101, call_counter(&runner));
+    }
+}
+
 SPAWNER_TEST(JSProc, BrokenFunction) {
     extproc_pool_t extproc_pool(1);
     js_runner_t js_runner;
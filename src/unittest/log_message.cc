@@ -1,5 +1,9 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
+#include <limits>
+
 #include "clustering/administration/logs/log_writer.hpp"
+#include "clustering/administration/logs/slow_query_log.hpp"
+#include "concurrency/cond_var.hpp"
 #include "unittest/gtest.hpp"
 #include "unittest/unittest_utils.hpp"
 
@@ -55,4 +59,50 @@ TPTEST(LogMessageTest, FileReverseReader) {
     }
 }
 
+TPTEST(LogMessageTest, SlowQueryLog) {
+    char filename[] = "/tmp/rethinkdb-unittest-slow-query-log-XXXXXX";
+    scoped_fd_t fd(mkstemp(filename));
+    guarantee(fd.get() != INVALID_FD);
+    fd.reset();
+
+    slow_query_log_options_t options;
+    options.filename = filename;
+    options.threshold_ms = 10;
+
+    /* Non-ASCII characters and escapes must survive the trip through the log file
+    format. */
+    ql::datum_object_builder_t builder;
+    builder.overwrite("query", ql::datum_t(datum_string_t(
+        "r.expr(\"caf\xc3\xa9 \xf0\x9f\x90\xa2\\n\\\\\t\")")));
+    builder.overwrite("duration_ms", ql::datum_t(12.5));
+    ql::datum_t entry = std::move(builder).to_datum();
+
+    std::vector<log_message_t> messages;
+    {
+        slow_query_log_t slow_query_log(options);
+        EXPECT_FALSE(slow_query_log.is_slow(9 * MILLION));
+        EXPECT_TRUE(slow_query_log.is_slow(10 * MILLION));
+        slow_query_log.record(entry);
+        slow_query_log.record(entry);
+    }
+    {
+        /* The entries are written in the background, but destroying the
+        `slow_query_log_t` waits for them. */
+        slow_query_log_t slow_query_log(options);
+        cond_t non_interruptor;
+        struct timespec max_timestamp = { std::numeric_limits<time_t>::max(), 0 };
+        messages = slow_query_log.tail(
+            10, { 0, 0 }, max_timestamp, &non_interruptor);
+    }
+    int unlink_res = unlink(filename);
+    guarantee(unlink_res == 0);
+
+    ASSERT_EQ(2u, messages.size());
+    EXPECT_TRUE(messages[1].timestamp < messages[0].timestamp);
+    for (const log_message_t &message : messages) {
+        EXPECT_EQ(entry, parse_slow_query_message(message.message));
+    }
+    EXPECT_FALSE(parse_slow_query_message("not json").has());
+}
+
 }  // namespace unittest
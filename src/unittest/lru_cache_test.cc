@@ -1,3 +1,5 @@
+#include <string>
+
 #include "unittest/gtest.hpp"
 
 #include "containers/lru_cache.hpp"
@@ -65,4 +67,17 @@ TEST(LRUCacheTest, Find) {
     EXPECT_EQ(10, cache.rbegin()->first);
 }
 
+TEST(LRUCacheTest, StringKeys) {
+    lru_cache_t<std::string, int> cache(2);
+    cache["a"] = 1;
+    cache[std::string("b")] = 2;
+    EXPECT_NE(cache.end(), cache.find("a"));
+    EXPECT_NE(cache.end(), cache.find("b"));
+    cache["c"] = 3;
+    EXPECT_EQ(2, cache.size());
+    EXPECT_EQ(cache.end(), cache.find("a"));
+    EXPECT_EQ(2, cache["b"]);
+    EXPECT_EQ(3, cache["c"]);
+}
+
 } // namespace unittest
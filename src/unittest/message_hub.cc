@@ -0,0 +1,83 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "arch/runtime/runtime.hpp"
+#include "arch/runtime/thread_pool.hpp"
+#include "concurrency/pmap.hpp"
+#include "concurrency/cond_var.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+/* Each hop wakes up an idle thread, so this checks that no wakeup is lost when the
+other thread has just finished processing its messages. */
+
+const int PING_PONG_ROUND_TRIPS = 1000;
+
+TPTEST_MULTITHREAD(MessageHubTest, PingPong, 2) {
+    for (int i = 0; i < PING_PONG_ROUND_TRIPS; ++i) {
+        on_thread_t thread_switcher((threadnum_t(1)));
+        EXPECT_EQ(threadnum_t(1), get_thread_id());
+    }
+    EXPECT_EQ(threadnum_t(0), get_thread_id());
+}
+
+const int FAN_IN_THREADS = 8;
+const int FAN_IN_MESSAGES_PER_PRODUCER = 2000;
+// The producers yield this often, so that the messages are pushed in batches.
+const int FAN_IN_BATCH_SIZE = 64;
+
+struct fan_in_state_t {
+    fan_in_state_t() : received(0) {
+        for (int i = 0; i < FAN_IN_THREADS; ++i) {
+            next_seq[i] = 0;
+        }
+    }
+    int next_seq[FAN_IN_THREADS];
+    int received;
+    cond_t done;
+};
+
+class fan_in_message_t : public linux_thread_message_t {
+public:
+    fan_in_message_t(int _producer, int _seq, fan_in_state_t *_state)
+        : producer(_producer), seq(_seq), state(_state) { }
+
+    void on_thread_switch() {
+        EXPECT_EQ(threadnum_t(0), get_thread_id());
+        // Ordered messages from one thread have to arrive in the order they were sent.
+        EXPECT_EQ(state->next_seq[producer], seq);
+        state->next_seq[producer] = seq + 1;
+        ++state->received;
+        if (state->received == (FAN_IN_THREADS - 1) * FAN_IN_MESSAGES_PER_PRODUCER) {
+            state->done.pulse();
+        }
+        delete this;
+    }
+
+private:
+    int producer;
+    int seq;
+    fan_in_state_t *state;
+};
+
+TPTEST_MULTITHREAD(MessageHubTest, FanIn, FAN_IN_THREADS) {
+    fan_in_state_t state;
+    pmap(static_cast<int64_t>(1), static_cast<int64_t>(FAN_IN_THREADS),
+         [&](int64_t producer) {
+        on_thread_t thread_switcher((threadnum_t(static_cast<int32_t>(producer))));
+        for (int seq = 0; seq < FAN_IN_MESSAGES_PER_PRODUCER; ++seq) {
+            linux_thread_pool_t::get_thread()->message_hub.store_message_ordered(
+                threadnum_t(0),
+                new fan_in_message_t(producer, seq, &state));
+            if ((seq + 1) % FAN_IN_BATCH_SIZE == 0) {
+                coro_t::yield();
+            }
+        }
+    });
+    state.done.wait();
+    for (int producer = 1; producer < FAN_IN_THREADS; ++producer) {
+        EXPECT_EQ(FAN_IN_MESSAGES_PER_PRODUCER, state.next_seq[producer]);
+    }
+}
+
+}  // namespace unittest
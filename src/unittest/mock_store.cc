@@ -135,18 +135,33 @@ void mock_store_t::read(
             nap(rng_.randint(10), interruptor);
         }
 
-        const point_read_t *point_read = boost::get<point_read_t>(&read.read);
-        guarantee(point_read != NULL);
-
         response->n_shards = 1;
-        response->response = point_read_response_t();
-        point_read_response_t *res = boost::get<point_read_response_t>(&response->response);
-
-        auto it = table_.find(point_read->key);
-        if (it == table_.end()) {
-            res->data = ql::datum_t::null();
+        if (const distribution_read_t *distribution_read =
+                boost::get<distribution_read_t>(&read.read)) {
+            /* Every key is its own bucket. */
+            response->response = distribution_read_response_t();
+            distribution_read_response_t *res =
+                boost::get<distribution_read_response_t>(&response->response);
+            res->region = distribution_read->region;
+            for (auto it = table_.begin(); it != table_.end(); ++it) {
+                if (distribution_read->region.inner.contains_key(it->first)) {
+                    res->key_counts[it->first] = 1;
+                }
+            }
         } else {
-            res->data = it->second.second;
+            const point_read_t *point_read = boost::get<point_read_t>(&read.read);
+            guarantee(point_read != NULL);
+
+            response->response = point_read_response_t();
+            point_read_response_t *res =
+                boost::get<point_read_response_t>(&response->response);
+
+            auto it = table_.find(point_read->key);
+            if (it == table_.end()) {
+                res->data = ql::datum_t::null();
+            } else {
+                res->data = it->second.second;
+            }
         }
     }
     if (rng_.randint(2) == 0) {
@@ -275,6 +290,46 @@ bool mock_store_t::send_backfill(
     }
 }
 
+void mock_store_t::get_range_hashes(
+        const std::vector<region_t> &regions,
+        size_t max_split_keys,
+        std::vector<range_hash_t> *hashes_out,
+        region_map_t<binary_blob_t> *metainfo_out,
+        read_token_t *token,
+        signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+    object_buffer_t<fifo_enforcer_sink_t::exit_read_t>::destruction_sentinel_t destroyer(&token->main_read_token);
+
+    wait_interruptible(token->main_read_token.get(), interruptor);
+
+    *metainfo_out = metainfo_;
+    hashes_out->clear();
+    hashes_out->resize(regions.size());
+    for (size_t i = 0; i < regions.size(); ++i) {
+        rassert(region_is_superset(get_region(), regions[i]));
+        std::vector<store_key_t> keys;
+        range_hash_t *res = &(*hashes_out)[i];
+        for (auto it = table_.lower_bound(regions[i].inner.left);
+             it != table_.end() && regions[i].inner.contains_key(it->first);
+             ++it) {
+            if (region_contains_key(regions[i], it->first)) {
+                const std::string key = key_to_unescaped_str(it->first);
+                res->hash += std::hash<std::string>()(
+                    strprintf("%zu:", key.size()) + key + it->second.second.print());
+                ++res->num_pairs;
+                keys.push_back(it->first);
+            }
+        }
+        size_t num_splits = std::min(max_split_keys, keys.size() / 2);
+        for (size_t j = 0; j < num_splits; ++j) {
+            res->split_keys.push_back(keys[(j + 1) * keys.size() / (num_splits + 1)]);
+        }
+    }
+
+    if (rng_.randint(2) == 0) {
+        nap(rng_.randint(10), interruptor);
+    }
+}
+
 void mock_store_t::receive_backfill(
         const backfill_chunk_t &chunk,
         write_token_t *token,
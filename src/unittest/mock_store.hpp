@@ -4,6 +4,7 @@
 #include <map>
 #include <utility>
 #include <string>
+#include <vector>
 
 #include "rdb_protocol/protocol.hpp"
 #include "store_view.hpp"
@@ -66,6 +67,15 @@ public:
             signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t);
 
+    void get_range_hashes(
+            const std::vector<region_t> &regions,
+            size_t max_split_keys,
+            std::vector<range_hash_t> *hashes_out,
+            region_map_t<binary_blob_t> *metainfo_out,
+            read_token_t *token,
+            signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
     void receive_backfill(
             const backfill_chunk_t &chunk,
             write_token_t *token,
@@ -0,0 +1,52 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "arch/runtime/numa.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(NumaTest, ParseCpuList) {
+    std::vector<int> cpus;
+    ASSERT_TRUE(parse_cpu_list("0-3,8,10-11\n", &cpus));
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 8, 10, 11}), cpus);
+
+    ASSERT_TRUE(parse_cpu_list("5", &cpus));
+    EXPECT_EQ(std::vector<int>{5}, cpus);
+
+    // Nodes without CPUs have an empty list
+    ASSERT_TRUE(parse_cpu_list("\n", &cpus));
+    EXPECT_TRUE(cpus.empty());
+
+    EXPECT_FALSE(parse_cpu_list("3-1", &cpus));
+    EXPECT_FALSE(parse_cpu_list("0-", &cpus));
+    EXPECT_FALSE(parse_cpu_list("0,,1", &cpus));
+    EXPECT_FALSE(parse_cpu_list("a", &cpus));
+}
+
+TEST(NumaTest, AssignThreads) {
+    std::map<int, std::vector<int> > cpus_by_node_id;
+    cpus_by_node_id[0] = {0, 1, 2, 3};
+    cpus_by_node_id[1] = {};
+    cpus_by_node_id[2] = {4, 5, 6, 7};
+    numa_topology_t topology(cpus_by_node_id);
+
+    // The node without CPUs is left out.
+    ASSERT_EQ(2u, topology.num_nodes());
+    EXPECT_EQ(2, topology.node_id(1));
+
+    EXPECT_EQ((std::vector<size_t>{0, 0, 0, 0, 1, 1, 1, 1}), topology.assign_threads(8));
+    EXPECT_EQ((std::vector<size_t>{0, 0, 1, 1}), topology.assign_threads(4));
+    EXPECT_EQ((std::vector<size_t>{0, 0, 0, 1, 1}), topology.assign_threads(5));
+    EXPECT_EQ((std::vector<size_t>{0}), topology.assign_threads(1));
+    EXPECT_EQ(17u, topology.assign_threads(17).size());
+    EXPECT_EQ(1u, topology.assign_threads(17).back());
+}
+
+TEST(NumaTest, DiscoverTopology) {
+    numa_topology_t topology = numa_topology_t::discover();
+    ASSERT_GE(topology.num_nodes(), 1u);
+    for (size_t i = 0; i < topology.num_nodes(); ++i) {
+        EXPECT_FALSE(topology.node_cpus(i).empty());
+    }
+}
+
+}  // namespace unittest
@@ -5,8 +5,11 @@
 
 #include <cmath>  // for std::isnan -- read the comment below.
 
+#include "perfmon/latency_histogram.hpp"
 #include "perfmon/perfmon.hpp"
+#include "perfmon/resource_usage.hpp"
 #include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
 
 namespace unittest {
 
@@ -57,4 +60,88 @@ TEST(PerfmonTest, StddevComputation) {
     }
 }
 
+TEST(PerfmonTest, LatencyHistogramPercentiles) {
+    latency_histogram_t hist;
+    EXPECT_EQ(0u, hist.count());
+    EXPECT_EQ(ql::datum_t::R_NULL,
+              hist.percentiles_to_datum().get_field("p99").get_type());
+
+    // 1..100000 microseconds, so the exact p-th percentile is p * 100000.
+    for (uint64_t i = 1; i <= 100000; ++i) {
+        hist.record(i);
+    }
+    EXPECT_EQ(100000u, hist.count());
+
+    // Each bucket is at most 1/8 of its value wide.
+    static const double fractions[] = { 0.5, 0.9, 0.99, 0.999 };
+    for (double fraction : fractions) {
+        double exact = fraction * 100000;
+        EXPECT_NEAR(exact, hist.percentile(fraction), exact / 8);
+    }
+    EXPECT_EQ(100000, hist.percentile(1.0));
+
+    // Small latencies are exact.
+    latency_histogram_t small;
+    small.record(3);
+    small.record(5);
+    EXPECT_EQ(3, small.percentile(0.5));
+    EXPECT_EQ(5, small.percentile(1.0));
+}
+
+TEST(PerfmonTest, LatencyHistogramMerge) {
+    latency_histogram_t fast, slow;
+    for (int i = 0; i < 90; ++i) {
+        fast.record(100);
+    }
+    for (int i = 0; i < 10; ++i) {
+        slow.record(50000);
+    }
+
+    // Merging through the datum the perfmon reports must give the same result as
+    // merging the histograms directly.
+    latency_histogram_t direct;
+    direct.merge(fast);
+    direct.merge(slow);
+
+    latency_histogram_t via_datum;
+    ASSERT_TRUE(via_datum.merge_datum(fast.to_datum()));
+    ASSERT_TRUE(via_datum.merge_datum(slow.to_datum()));
+
+    EXPECT_EQ(100u, via_datum.count());
+    EXPECT_EQ(direct.percentile(0.5), via_datum.percentile(0.5));
+    EXPECT_EQ(direct.percentile(0.95), via_datum.percentile(0.95));
+    EXPECT_EQ(50, via_datum.percentiles_to_datum().get_field("max").as_num());
+    EXPECT_GT(via_datum.percentile(0.95), 40000);
+    EXPECT_LT(via_datum.percentile(0.5), 200);
+
+    EXPECT_FALSE(via_datum.merge_datum(ql::datum_t(1.0)));
+}
+
+TPTEST(PerfmonTest, ResourceUsageScopes) {
+    EXPECT_TRUE(resource_usage_t::current() == NULL);
+    resource_usage_t::note_rows_scanned(1);
+
+    resource_usage_t outer, inner;
+    {
+        resource_usage_scope_t outer_scope(&outer);
+        resource_usage_t::note_rows_scanned(2);
+        {
+            resource_usage_scope_t inner_scope(&inner);
+            EXPECT_EQ(&inner, resource_usage_t::current());
+            resource_usage_t::note_rows_scanned(5);
+            resource_usage_t::note_block_read(true);
+            resource_usage_t::note_block_read(false);
+        }
+        EXPECT_EQ(&outer, resource_usage_t::current());
+        resource_usage_t::add_to_current(inner);
+    }
+    EXPECT_TRUE(resource_usage_t::current() == NULL);
+
+    EXPECT_EQ(5u, inner.rows_scanned);
+    EXPECT_EQ(7u, outer.rows_scanned);
+    EXPECT_EQ(1u, outer.blocks_from_cache);
+    EXPECT_EQ(1u, outer.blocks_from_disk);
+    EXPECT_GE(outer.cpu_time, inner.cpu_time);
+}
+
 }  // namespace unittest
@@ -4,9 +4,12 @@
 #include "arch/io/disk.hpp"
 #include "arch/runtime/coroutines.hpp"
 #include "arch/timing.hpp"
+#include "btree/depth_first_traversal.hpp"
 #include "btree/operations.hpp"
 #include "btree/reql_specific.hpp"
+#include "btree/secondary_operations.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "config/args.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/vector_stream.hpp"
 #include "containers/uuid.hpp"
@@ -28,58 +31,129 @@
 
 namespace unittest {
 
-void insert_rows(int start, int finish, store_t *store) {
+/* Inserts a row and updates the post-constructed secondary indexes one row at a
+time, the way regular writes do. */
+void insert_row(int i, const std::string &data, store_t *store) {
     ql::configured_limits_t limits;
 
+    cond_t dummy_interruptor;
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    write_token_t token;
+    store->new_write_token(&token);
+    store->acquire_superblock_for_write(
+        repli_timestamp_t::distant_past,
+        1, write_durability_t::SOFT,
+        &token, &txn, &superblock, &dummy_interruptor);
+    block_id_t sindex_block_id = superblock->get_sindex_block_id();
+
+    point_write_response_t response;
+
+    store_key_t pk(ql::datum_t(static_cast<double>(i)).print_primary());
+    rdb_modification_report_t mod_report(pk);
+    rdb_live_deletion_context_t deletion_context;
+    rdb_set(pk,
+            ql::to_datum(scoped_cJSON_t(cJSON_Parse(data.c_str())).get(), limits,
+                         reql_version_t::LATEST),
+            false, store->btree.get(), repli_timestamp_t::distant_past,
+            superblock.get(), &deletion_context, &response, &mod_report.info,
+            static_cast<profile::trace_t *>(NULL));
+
+    {
+        buf_lock_t sindex_block(superblock->expose_buf(),
+                                sindex_block_id,
+                                access_t::write);
+        store_t::sindex_access_vector_t sindexes;
+        store->acquire_post_constructed_sindex_superblocks_for_write(
+                 &sindex_block,
+                 &sindexes);
+        rdb_update_sindexes(store,
+                            sindexes,
+                            &mod_report,
+                            txn.get(),
+                            &deletion_context,
+                            NULL,
+                            NULL,
+                            NULL,
+                            NULL);
+
+        scoped_ptr_t<new_mutex_in_line_t> acq =
+            store->get_in_line_for_sindex_queue(&sindex_block);
+
+        store->sindex_queue_push(mod_report, acq.get());
+    }
+}
+
+void insert_rows(int start, int finish, store_t *store) {
     guarantee(start <= finish);
     for (int i = start; i < finish; ++i) {
-        cond_t dummy_interruptor;
-        scoped_ptr_t<txn_t> txn;
-        scoped_ptr_t<real_superblock_t> superblock;
-        write_token_t token;
-        store->new_write_token(&token);
-        store->acquire_superblock_for_write(
-            repli_timestamp_t::distant_past,
-            1, write_durability_t::SOFT,
-            &token, &txn, &superblock, &dummy_interruptor);
-        block_id_t sindex_block_id = superblock->get_sindex_block_id();
+        insert_row(i, strprintf("{\"id\" : %d, \"sid\" : %d}", i, i * i), store);
+    }
+}
+
+/* Like `insert_rows`, but writes all rows in a single transaction and collects
+their secondary index changes in an `sindex_update_batch_t`. */
+void insert_rows_batched(int start, int finish, store_t *store) {
+    ql::configured_limits_t limits;
 
+    guarantee(start <= finish);
+    cond_t dummy_interruptor;
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    write_token_t token;
+    store->new_write_token(&token);
+    store->acquire_superblock_for_write(
+        repli_timestamp_t::distant_past,
+        finish - start, write_durability_t::SOFT,
+        &token, &txn, &superblock, &dummy_interruptor);
+    block_id_t sindex_block_id = superblock->get_sindex_block_id();
+
+    std::vector<rdb_modification_report_t> mod_reports;
+    rdb_live_deletion_context_t deletion_context;
+    // Insert in descending order, so that the batch has to sort the keys.
+    for (int i = finish - 1; i >= start; --i) {
         std::string data = strprintf("{\"id\" : %d, \"sid\" : %d}", i, i * i);
         point_write_response_t response;
 
         store_key_t pk(ql::datum_t(static_cast<double>(i)).print_primary());
-        rdb_modification_report_t mod_report(pk);
-        rdb_live_deletion_context_t deletion_context;
+        mod_reports.push_back(rdb_modification_report_t(pk));
+        promise_t<superblock_t *> pass_back_superblock;
         rdb_set(pk,
                 ql::to_datum(scoped_cJSON_t(cJSON_Parse(data.c_str())).get(), limits,
                              reql_version_t::LATEST),
                 false, store->btree.get(), repli_timestamp_t::distant_past,
-                superblock.get(), &deletion_context, &response, &mod_report.info,
-                static_cast<profile::trace_t *>(NULL));
+                superblock.get(), &deletion_context, &response,
+                &mod_reports.back().info,
+                static_cast<profile::trace_t *>(NULL),
+                &pass_back_superblock);
+        pass_back_superblock.wait();
+    }
 
-        {
-            buf_lock_t sindex_block(superblock->expose_buf(),
-                                    sindex_block_id,
-                                    access_t::write);
-            store_t::sindex_access_vector_t sindexes;
-            store->acquire_post_constructed_sindex_superblocks_for_write(
-                     &sindex_block,
-                     &sindexes);
-            rdb_update_sindexes(store,
-                                sindexes,
-                                &mod_report,
-                                txn.get(),
-                                &deletion_context,
-                                NULL,
-                                NULL,
-                                NULL);
-
-            scoped_ptr_t<new_mutex_in_line_t> acq =
-                store->get_in_line_for_sindex_queue(&sindex_block);
-
-            store->sindex_queue_push(mod_report, acq.get());
-        }
+    buf_lock_t sindex_block(superblock->expose_buf(),
+                            sindex_block_id,
+                            access_t::write);
+    store_t::sindex_access_vector_t sindexes;
+    store->acquire_post_constructed_sindex_superblocks_for_write(
+             &sindex_block,
+             &sindexes);
+    sindex_update_batch_t batch;
+    for (const auto &mod_report : mod_reports) {
+        rdb_update_sindexes(store,
+                            sindexes,
+                            &mod_report,
+                            txn.get(),
+                            &deletion_context,
+                            &batch,
+                            NULL,
+                            NULL,
+                            NULL);
     }
+    rdb_apply_sindex_update_batch(store, sindexes, &batch, txn.get(),
+                                  &deletion_context);
+
+    scoped_ptr_t<new_mutex_in_line_t> acq =
+        store->get_in_line_for_sindex_queue(&sindex_block);
+    store->sindex_queue_push(mod_reports, acq.get());
 }
 
 void insert_rows_and_pulse_when_done(int start, int finish,
@@ -88,7 +162,9 @@ void insert_rows_and_pulse_when_done(int start, int finish,
     pulse_when_done->pulse();
 }
 
-sindex_name_t create_sindex(store_t *store) {
+sindex_name_t create_sindex(store_t *store,
+                            const std::string &field,
+                            sindex_multi_bool_t multi_bool) {
     cond_t dummy_interruptor;
     sindex_name_t sindex_name(uuid_to_str(generate_uuid()));
     write_token_t token;
@@ -103,11 +179,9 @@ sindex_name_t create_sindex(store_t *store) {
                                         &dummy_interruptor);
 
     ql::sym_t one(1);
-    ql::protob_t<const Term> mapping = ql::r::var(one)["sid"].release_counted();
+    ql::protob_t<const Term> mapping = ql::r::var(one)[field].release_counted();
     ql::map_wire_func_t m(mapping, make_vector(one), get_backtrace(mapping));
 
-    sindex_multi_bool_t multi_bool = sindex_multi_bool_t::SINGLE;
-
     write_message_t wm;
     sindex_disk_info_t sindex_info(m, sindex_reql_version_info_t::LATEST(),
                                    multi_bool, sindex_geo_bool_t::REGULAR);
@@ -128,6 +202,10 @@ sindex_name_t create_sindex(store_t *store) {
     return sindex_name;
 }
 
+sindex_name_t create_sindex(store_t *store) {
+    return create_sindex(store, "sid", sindex_multi_bool_t::SINGLE);
+}
+
 void drop_sindex(store_t *store,
                  const sindex_name_t &sindex_name) {
     cond_t dummy_interruptor;
@@ -398,6 +476,116 @@ TPTEST(RDBBtree, SindexPostConstruct) {
     check_keys_are_present(&store, sindex_name);
 }
 
+TPTEST(RDBBtree, SindexBatchedUpdate) {
+    recreate_temporary_directory(base_path_t("."));
+    temp_file_t temp_file;
+
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    dummy_cache_balancer_t balancer(GIGABYTE);
+
+    filepath_file_opener_t file_opener(temp_file.name(), &io_backender);
+    standard_serializer_t::create(
+        &file_opener,
+        standard_serializer_t::static_config_t());
+
+    standard_serializer_t serializer(
+        standard_serializer_t::dynamic_config_t(),
+        &file_opener,
+        &get_global_perfmon_collection());
+
+    store_t store(
+            &serializer,
+            &balancer,
+            "unit_test_store",
+            true,
+            &get_global_perfmon_collection(),
+            NULL,
+            &io_backender,
+            base_path_t("."),
+            scoped_ptr_t<outdated_index_report_t>(),
+            generate_uuid());
+
+    sindex_name_t sindex_name = create_sindex(&store);
+    bring_sindexes_up_to_date(&store, sindex_name);
+
+    insert_rows_batched(0, TOTAL_KEYS_TO_INSERT, &store);
+
+    check_keys_are_present(&store, sindex_name);
+}
+
+TPTEST(RDBBtree, RangeReadRecordsScannedRows) {
+    recreate_temporary_directory(base_path_t("."));
+    temp_file_t temp_file;
+
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    dummy_cache_balancer_t balancer(GIGABYTE);
+
+    filepath_file_opener_t file_opener(temp_file.name(), &io_backender);
+    standard_serializer_t::create(
+        &file_opener,
+        standard_serializer_t::static_config_t());
+
+    standard_serializer_t serializer(
+        standard_serializer_t::dynamic_config_t(),
+        &file_opener,
+        &get_global_perfmon_collection());
+
+    store_t store(
+            &serializer,
+            &balancer,
+            "unit_test_store",
+            true,
+            &get_global_perfmon_collection(),
+            NULL,
+            &io_backender,
+            base_path_t("."),
+            scoped_ptr_t<outdated_index_report_t>(),
+            generate_uuid());
+
+    insert_rows(0, TOTAL_KEYS_TO_INSERT, &store);
+
+    /* A full scan weighs on the histogram as much as reading every row on its own,
+    and spreads that weight over the keys it read instead of charging the first. */
+    key_access_histogram_t histogram;
+    {
+        cond_t dummy_interruptor;
+        read_token_t token;
+        store.new_read_token(&token);
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        store.acquire_superblock_for_read(
+                &token, &txn, &superblock, &dummy_interruptor, true);
+
+        rget_read_response_t res;
+        ql::env_t dummy_env(&dummy_interruptor,
+                            ql::return_empty_normal_batches_t::NO,
+                            reql_version_t::LATEST);
+        rdb_rget_slice(
+            store.btree.get(),
+            key_range_t::universe(),
+            superblock.get(),
+            &dummy_env,
+            ql::batchspec_t::all(),
+            std::vector<ql::transform_variant_t>(),
+            boost::optional<ql::terminal_variant_t>(),
+            sorting_t::ASCENDING,
+            &res,
+            release_superblock_t::RELEASE,
+            &histogram);
+    }
+
+    std::map<store_key_t, int64_t> loads;
+    histogram.get_loads(key_range_t::universe(), &loads);
+    int64_t total_load = 0;
+    for (const auto &pair : loads) {
+        EXPECT_LE(pair.second, KEY_ACCESS_RANGE_SAMPLE_ROWS);
+        total_load += pair.second;
+    }
+    EXPECT_EQ(TOTAL_KEYS_TO_INSERT, total_load);
+    EXPECT_LE(static_cast<size_t>(TOTAL_KEYS_TO_INSERT / KEY_ACCESS_RANGE_SAMPLE_ROWS),
+              loads.size());
+}
+
 TPTEST(RDBBtree, SindexEraseRange) {
     recreate_temporary_directory(base_path_t("."));
     temp_file_t temp_file;
@@ -478,6 +666,129 @@ TPTEST(RDBBtree, SindexEraseRange) {
     check_keys_are_NOT_present(&store, sindex_name);
 }
 
+class collect_keys_callback_t : public depth_first_traversal_callback_t {
+public:
+    explicit collect_keys_callback_t(std::vector<store_key_t> *keys_out)
+        : keys_out_(keys_out) { }
+    done_traversing_t handle_pair(scoped_key_value_t &&keyvalue) {
+        keys_out_->push_back(store_key_t(keyvalue.key()));
+        return done_traversing_t::NO;
+    }
+private:
+    std::vector<store_key_t> *keys_out_;
+};
+
+/* Reads the keys of the secondary index tree directly, so that it also works for
+indexes that haven't been marked as post-constructed. */
+std::vector<store_key_t> get_sindex_keys(store_t *store,
+                                         const sindex_name_t &sindex_name) {
+    cond_t dummy_interruptor;
+    read_token_t token;
+    store->new_read_token(&token);
+
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> super_block;
+    store->acquire_superblock_for_read(&token, &txn, &super_block,
+                                       &dummy_interruptor, false);
+
+    buf_lock_t sindex_block(super_block->expose_buf(),
+                            super_block->get_sindex_block_id(),
+                            access_t::read);
+    super_block.reset();
+
+    std::map<sindex_name_t, secondary_index_t> sindexes;
+    get_secondary_indexes(&sindex_block, &sindexes);
+    auto it = sindexes.find(sindex_name);
+    guarantee(it != sindexes.end());
+
+    sindex_superblock_t sindex_sb(
+        buf_lock_t(&sindex_block, it->second.superblock, access_t::read));
+    sindex_block.reset_buf_lock();
+
+    std::vector<store_key_t> keys;
+    collect_keys_callback_t cb(&keys);
+    btree_depth_first_traversal(&sindex_sb, key_range_t::universe(), &cb,
+                                FORWARD, release_superblock_t::RELEASE);
+    return keys;
+}
+
+/* Builds the same indexes once by updating them row by row, and once with the
+sort-based post construction, and checks that they end up with the same keys. */
+TPTEST(RDBBtree, SindexSortedPostConstructMatchesIncremental) {
+    recreate_temporary_directory(base_path_t("."));
+    temp_file_t temp_file;
+
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    dummy_cache_balancer_t balancer(GIGABYTE);
+
+    filepath_file_opener_t file_opener(temp_file.name(), &io_backender);
+    standard_serializer_t::create(
+        &file_opener,
+        standard_serializer_t::static_config_t());
+
+    standard_serializer_t serializer(
+        standard_serializer_t::dynamic_config_t(),
+        &file_opener,
+        &get_global_perfmon_collection());
+
+    store_t store(
+            &serializer,
+            &balancer,
+            "unit_test_store",
+            true,
+            &get_global_perfmon_collection(),
+            NULL,
+            &io_backender,
+            base_path_t("."),
+            scoped_ptr_t<outdated_index_report_t>(),
+            generate_uuid());
+
+    // The incrementally updated indexes exist before there is any data.
+    sindex_name_t single_incremental
+        = create_sindex(&store, "dup", sindex_multi_bool_t::SINGLE);
+    bring_sindexes_up_to_date(&store, single_incremental);
+    sindex_name_t multi_incremental
+        = create_sindex(&store, "tags", sindex_multi_bool_t::MULTI);
+    bring_sindexes_up_to_date(&store, multi_incremental);
+
+    // Many rows share a secondary key, each row has several (partly repeated)
+    // multi index keys, and some rows are missing from the indexes.
+    for (int i = 0; i < TOTAL_KEYS_TO_INSERT; ++i) {
+        std::string data = i % 11 == 0
+            ? strprintf("{\"id\" : %d}", i)
+            : strprintf("{\"id\" : %d, \"dup\" : %d, \"tags\" : [%d, %d, %d]}",
+                        i, i % 7, i % 5, i % 3, i % 5);
+        insert_row(i, data, &store);
+    }
+
+    sindex_name_t single_sorted
+        = create_sindex(&store, "dup", sindex_multi_bool_t::SINGLE);
+    sindex_name_t multi_sorted
+        = create_sindex(&store, "tags", sindex_multi_bool_t::MULTI);
+    std::set<uuid_u> sorted_ids;
+    for (const auto &pair : store.get_sindexes()) {
+        if (pair.first == single_sorted || pair.first == multi_sorted) {
+            sorted_ids.insert(pair.second.id);
+        }
+    }
+    ASSERT_EQ(2u, sorted_ids.size());
+
+    // A small sort buffer makes the traversal spill many sorted runs, which then
+    // have to be merged.
+    cond_t dummy_interruptor;
+    sindex_post_construction_progress_t progress;
+    post_construct_secondary_indexes(&store, sorted_ids, 4 * KILOBYTE,
+                                     &dummy_interruptor, &progress);
+    ASSERT_EQ(1.0, progress.guess_completion().as_double());
+
+    std::vector<store_key_t> single_keys = get_sindex_keys(&store, single_incremental);
+    std::vector<store_key_t> multi_keys = get_sindex_keys(&store, multi_incremental);
+    ASSERT_FALSE(single_keys.empty());
+    ASSERT_LT(single_keys.size(), multi_keys.size());
+    ASSERT_EQ(single_keys, get_sindex_keys(&store, single_sorted));
+    ASSERT_EQ(multi_keys, get_sindex_keys(&store, multi_sorted));
+}
+
 TPTEST(RDBBtree, SindexInterruptionViaDrop) {
     recreate_temporary_directory(base_path_t("."));
     temp_file_t temp_file;
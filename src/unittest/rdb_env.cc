@@ -77,6 +77,20 @@ void mock_namespace_interface_t::read_visitor_t::operator()(const point_read_t &
     }
 }
 
+void mock_namespace_interface_t::read_visitor_t::operator()(
+        const point_multi_read_t &get) {
+    response->response = point_multi_read_response_t();
+    point_multi_read_response_t &res =
+        boost::get<point_multi_read_response_t>(response->response);
+
+    for (const store_key_t &key : get.keys) {
+        auto it = parent->data.find(key);
+        if (it != parent->data.end()) {
+            res.data.push_back(it->second);
+        }
+    }
+}
+
 void mock_namespace_interface_t::read_visitor_t::operator()(const dummy_read_t &) {
     response->response = dummy_read_response_t();
 }
@@ -71,6 +71,7 @@ private:
 
     struct read_visitor_t : public boost::static_visitor<void> {
         void operator()(const point_read_t &get);
+        void operator()(const point_multi_read_t &get);
         void operator()(const dummy_read_t &d);
         void NORETURN operator()(const changefeed_subscribe_t &);
         void NORETURN operator()(const changefeed_limit_subscribe_t &);
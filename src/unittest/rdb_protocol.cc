@@ -1,6 +1,7 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "unittest/rdb_protocol.hpp"
 
+#include <set>
 #include <vector>
 
 #include "errors.hpp"
@@ -176,6 +177,55 @@ TEST(RDBProtocol, OvershardedGetSet) {
     run_in_thread_pool_with_namespace_interface(&run_get_set_test, true);
 }
 
+/* `MultiGet` reads many keys at once, some of which don't exist */
+void run_multi_get_test(namespace_interface_t *nsi, order_source_t *osource) {
+    const int num_keys = 1000;
+    for (int i = 0; i < num_keys; i += 2) {
+        write_t write(
+                point_write_t(store_key_t(strprintf("key%04d", i)),
+                              ql::datum_t(static_cast<double>(i))),
+                DURABILITY_REQUIREMENT_DEFAULT,
+                profile_bool_t::PROFILE,
+                ql::configured_limits_t());
+        write_response_t response;
+
+        cond_t interruptor;
+        nsi->write(write, &response, osource->check_in("unittest::run_multi_get_test(rdb_protocol.cc-A)"), &interruptor);
+        ASSERT_TRUE(boost::get<point_write_response_t>(&response.response) != NULL);
+    }
+
+    std::vector<store_key_t> keys;
+    for (int i = num_keys - 1; i >= 0; --i) {
+        keys.push_back(store_key_t(strprintf("key%04d", i)));
+    }
+    keys.push_back(store_key_t("key0000"));
+    read_t read(point_multi_read_t(std::move(keys)), profile_bool_t::PROFILE);
+    read_response_t response;
+
+    cond_t interruptor;
+    nsi->read(read, &response, osource->check_in("unittest::run_multi_get_test(rdb_protocol.cc-B)"), &interruptor);
+
+    point_multi_read_response_t *res =
+        boost::get<point_multi_read_response_t>(&response.response);
+    ASSERT_TRUE(res != NULL);
+    ASSERT_EQ(static_cast<size_t>(num_keys / 2), res->data.size());
+    std::set<int> seen;
+    for (const ql::datum_t &d : res->data) {
+        int i = static_cast<int>(d.as_num());
+        ASSERT_EQ(0, i % 2);
+        seen.insert(i);
+    }
+    ASSERT_EQ(static_cast<size_t>(num_keys / 2), seen.size());
+}
+
+TEST(RDBProtocol, MultiGet) {
+    run_in_thread_pool_with_namespace_interface(&run_multi_get_test, false);
+}
+
+TEST(RDBProtocol, OvershardedMultiGet) {
+    run_in_thread_pool_with_namespace_interface(&run_multi_get_test, true);
+}
+
 std::string create_sindex(namespace_interface_t *nsi,
                           order_source_t *osource) {
     std::string id = uuid_to_str(generate_uuid());
@@ -822,7 +872,8 @@ TPTEST(RDBProtocol, ArtificialChangefeeds) {
                     std::map<std::string, std::vector<ql::datum_t> >(),
                     store_key_t(ql::datum_t(static_cast<double>(i)).print_primary()),
                     ql::datum_t(-static_cast<double>(i)),
-                    ql::datum_t(static_cast<double>(i))}));
+                    ql::datum_t(static_cast<double>(i)),
+                    0}));
     }
     for (const auto &pair : bundles) {
         ql::batchspec_t bs(ql::batchspec_t::all()
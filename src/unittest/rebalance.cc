@@ -1,11 +1,14 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
+#include <algorithm>
 #include <string>
 
 #include "unittest/gtest.hpp"
 
+#include "clustering/administration/tables/auto_rebalancer.hpp"
 #include "clustering/administration/tables/split_points.hpp"
 #include "clustering/administration/tables/table_metadata.hpp"
 #include "btree/keys.hpp"
+#include "config/args.hpp"
 
 namespace unittest {
 
@@ -77,4 +80,96 @@ TEST(Rebalance, MaxKeyLength) {
     do_rebalance(distribution, 3);
 }
 
+TEST(Rebalance, Load) {
+    /* The documents are spread evenly over the keys "a" to "z", but almost all of
+    the recent load is on the keys from "u" on. */
+    std::map<store_key_t, int64_t> counts, loads;
+    for (char c = 'a'; c <= 'z'; ++c) {
+        counts[store_key_t(std::string(1, c))] = 100;
+        loads[store_key_t(std::string(1, c))] = (c >= 'u') ? 1000 : 10;
+    }
+
+    table_shard_scheme_t by_count = do_rebalance(counts, 2);
+    int64_t total_load;
+    double imbalance_by_count = calculate_load_imbalance(loads, by_count, &total_load);
+    EXPECT_EQ(20 * 10 + 6 * 1000, total_load);
+
+    table_shard_scheme_t by_load;
+    std::string error;
+    ASSERT_TRUE(calculate_split_points_with_load(counts, loads, 2, &by_load, &error))
+        << error;
+    ASSERT_EQ(2u, by_load.num_shards());
+    EXPECT_LT(by_count.split_points[0], by_load.split_points[0]);
+
+    double imbalance_by_load = calculate_load_imbalance(loads, by_load, &total_load);
+    EXPECT_LT(imbalance_by_load, imbalance_by_count);
+    EXPECT_GE(imbalance_by_load, 1.0);
+}
+
+TEST(Rebalance, NoLoad) {
+    /* Without any load, the split points only depend on the document counts. */
+    std::map<store_key_t, int64_t> counts, loads;
+    for (char c = 'a'; c <= 'z'; ++c) {
+        counts[store_key_t(std::string(1, c))] = 100;
+    }
+
+    table_shard_scheme_t by_count = do_rebalance(counts, 3);
+    table_shard_scheme_t by_load;
+    std::string error;
+    ASSERT_TRUE(calculate_split_points_with_load(counts, loads, 3, &by_load, &error))
+        << error;
+    EXPECT_EQ(by_count.split_points, by_load.split_points);
+
+    int64_t total_load;
+    EXPECT_EQ(0.0, calculate_load_imbalance(loads, by_load, &total_load));
+    EXPECT_EQ(0, total_load);
+}
+
+TEST(Rebalance, AutoRebalanceHysteresis) {
+    /* Resharding has to lower the imbalance by a margin. */
+    EXPECT_TRUE(table_load_rebalance_state_t::is_worth_rebalancing(
+        4.0, 4.0 / AUTO_REBALANCE_MIN_IMPROVEMENT));
+    EXPECT_TRUE(table_load_rebalance_state_t::is_worth_rebalancing(4.0, 1.0));
+    EXPECT_FALSE(table_load_rebalance_state_t::is_worth_rebalancing(
+        4.0, 4.0 / AUTO_REBALANCE_MIN_IMPROVEMENT + 0.01));
+    EXPECT_FALSE(table_load_rebalance_state_t::is_worth_rebalancing(4.0, 4.0));
+}
+
+TEST(Rebalance, AutoRebalanceBackoff) {
+    table_load_rebalance_state_t state;
+    EXPECT_FALSE(state.skip_round());
+    EXPECT_TRUE(state.check_last_rebalance(4.0));
+
+    /* A rebalance that helped doesn't hold the table back. */
+    state.note_rebalanced(4.0);
+    EXPECT_FALSE(state.skip_round());
+    EXPECT_TRUE(state.check_last_rebalance(1.5));
+    EXPECT_FALSE(state.skip_round());
+
+    /* Every rebalance in a row that doesn't help doubles how many rounds the table
+    is left alone for, up to a limit. */
+    int expected_skips = 1;
+    for (int i = 0; i < 8; ++i) {
+        state.note_rebalanced(4.0);
+        EXPECT_FALSE(state.skip_round());
+        EXPECT_FALSE(state.check_last_rebalance(3.9));
+        for (int j = 0; j < expected_skips; ++j) {
+            EXPECT_TRUE(state.skip_round());
+        }
+        EXPECT_FALSE(state.skip_round());
+        /* Until the next rebalance there's nothing more to check. */
+        EXPECT_TRUE(state.check_last_rebalance(3.9));
+        expected_skips = std::min(2 * expected_skips,
+                                  static_cast<int>(AUTO_REBALANCE_MAX_BACKOFF_ROUNDS));
+    }
+
+    /* A rebalance that helps resets the backoff. */
+    state.note_rebalanced(4.0);
+    EXPECT_TRUE(state.check_last_rebalance(2.0));
+    state.note_rebalanced(4.0);
+    EXPECT_FALSE(state.check_last_rebalance(4.0));
+    EXPECT_TRUE(state.skip_round());
+    EXPECT_FALSE(state.skip_round());
+}
+
 }  // namespace unittest
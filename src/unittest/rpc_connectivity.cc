@@ -456,6 +456,41 @@ TPTEST_MULTITHREAD(RPCConnectivityTest, BinaryData, 3) {
     EXPECT_TRUE(a2.got_spectrum);
 }
 
+/* `CompressedConnection` checks that messages get through when only one end of
+each connection asks for compression, including binary data. */
+TPTEST_MULTITHREAD(RPCConnectivityTest, CompressedConnection, 3) {
+    connectivity_cluster_t c1, c2, c3;
+    recording_test_application_t a1(&c1, 'T'), a2(&c2, 'T'), a3(&c3, 'T');
+    binary_test_application_t b1(&c1), b2(&c2);
+    connectivity_cluster_t::run_t cr1(&c1, get_unittest_addresses(), peer_address_t(),
+        ANY_PORT, 0, true);
+    connectivity_cluster_t::run_t cr2(&c2, get_unittest_addresses(), peer_address_t(),
+        ANY_PORT, 0, false);
+    connectivity_cluster_t::run_t cr3(&c3, get_unittest_addresses(), peer_address_t(),
+        ANY_PORT, 0, true);
+    cr2.join(get_cluster_local_address(&c1));
+    cr3.join(get_cluster_local_address(&c1));
+
+    let_stuff_happen();
+
+    for (int i = 0; i < 100; ++i) {
+        a1.send(i, c2.get_me());
+        a2.send(1000 + i, c3.get_me());
+        a3.send(2000 + i, c1.get_me());
+    }
+    b1.send_spectrum(c2.get_me());
+
+    let_stuff_happen();
+
+    for (int i = 0; i < 100; ++i) {
+        a2.expect(i, c1.get_me());
+        a3.expect(1000 + i, c2.get_me());
+        a1.expect(2000 + i, c3.get_me());
+    }
+    a2.expect_order(0, 99);
+    EXPECT_TRUE(b2.got_spectrum);
+}
+
 /* `PeerIDSemantics` makes sure that `peer_id_t::is_nil()` works as expected. */
 TPTEST_MULTITHREAD(RPCConnectivityTest, PeerIDSemantics, 3) {
     peer_id_t nil_peer;
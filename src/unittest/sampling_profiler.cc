@@ -0,0 +1,131 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "arch/runtime/sampling_profiler.hpp"
+
+#include <time.h>
+
+#include "arch/runtime/coroutines.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+/* A fake stack with three frames. Each frame is the caller's frame pointer followed
+by the return address, like on x86-64. */
+class fake_stack_t {
+public:
+    fake_stack_t() {
+        for (size_t i = 0; i < SIZE; ++i) {
+            words[i] = 0;
+        }
+        make_frame(2, 6, 0x1111);
+        make_frame(6, 10, 0x2222);
+        make_frame(10, SIZE, 0x3333);
+        // The outermost frame has no caller.
+        words[10] = 0;
+    }
+
+    void make_frame(size_t at, size_t caller, uintptr_t return_address) {
+        words[at] = address_of(caller);
+        words[at + 1] = return_address;
+    }
+
+    uintptr_t address_of(size_t i) {
+        return reinterpret_cast<uintptr_t>(&words[0]) + i * sizeof(uintptr_t);
+    }
+
+    int walk(uintptr_t fp, uintptr_t stack_base, void **frames, int max_frames) {
+        return sampling_profiler_t::walk_frame_pointers(
+            0x42, address_of(0), fp, stack_base, frames, max_frames);
+    }
+
+    static const size_t SIZE = 16;
+    uintptr_t words[SIZE];
+};
+
+TEST(SamplingProfilerTest, WalkFramePointers) {
+    fake_stack_t stack;
+    void *frames[8];
+
+    ASSERT_EQ(4, stack.walk(stack.address_of(2), stack.address_of(16), frames, 8));
+    EXPECT_EQ(reinterpret_cast<void *>(0x42), frames[0]);
+    EXPECT_EQ(reinterpret_cast<void *>(0x1111), frames[1]);
+    EXPECT_EQ(reinterpret_cast<void *>(0x2222), frames[2]);
+    EXPECT_EQ(reinterpret_cast<void *>(0x3333), frames[3]);
+
+    // The walk stops at `max_frames`.
+    EXPECT_EQ(2, stack.walk(stack.address_of(2), stack.address_of(16), frames, 2));
+    EXPECT_EQ(0, stack.walk(stack.address_of(2), stack.address_of(16), frames, 0));
+
+    // It never reads beyond the base of the stack.
+    EXPECT_EQ(3, stack.walk(stack.address_of(2), stack.address_of(11), frames, 8));
+
+    // If the stack pointer isn't on the stack, only the instruction is recorded.
+    EXPECT_EQ(1, stack.walk(stack.address_of(2), 0, frames, 8));
+
+    // A misaligned frame pointer ends the walk.
+    EXPECT_EQ(1, stack.walk(stack.address_of(2) + 1, stack.address_of(16), frames, 8));
+}
+
+TEST(SamplingProfilerTest, WalkStopsOnCycles) {
+    fake_stack_t stack;
+    void *frames[8];
+
+    // A frame that points back inwards would loop forever.
+    stack.make_frame(10, 2, 0x3333);
+    EXPECT_EQ(4, stack.walk(stack.address_of(2), stack.address_of(16), frames, 8));
+
+    // So would one that points at itself.
+    stack.make_frame(6, 6, 0x2222);
+    EXPECT_EQ(3, stack.walk(stack.address_of(2), stack.address_of(16), frames, 8));
+}
+
+#if defined(__linux) && defined(__x86_64__)
+
+static double thread_cpu_secs() {
+    struct timespec ts;
+    int res = clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    guarantee_err(res == 0, "clock_gettime failed");
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+TPTEST(SamplingProfilerTest, SamplesRunningCoroutine) {
+    if (SAMPLING_PROFILER_FREQUENCY_HZ == 0) {
+        return;
+    }
+    sampling_profiler_t *profiler = sampling_profiler_t::get_thread_profiler();
+    ASSERT_TRUE(profiler != NULL);
+
+    const double burn_secs = 0.5;
+    const char *spawn_site = NULL;
+    coro_t::spawn_now_dangerously([&]() {
+        spawn_site = coro_t::self()->get_spawn_site();
+        const double start = thread_cpu_secs();
+        volatile uint64_t counter = 0;
+        while (thread_cpu_secs() - start < burn_secs) {
+            ++counter;
+        }
+    });
+
+    // If an interval ended while we were burning CPU, the samples are split between
+    // the last interval and the current one.
+    sampling_profiler_t::profile_t profile, current;
+    profiler->get_profile(&profile);
+    profiler->get_current_profile(&current);
+    profile.merge(current);
+
+    uint64_t samples = 0;
+    bool has_frames = false;
+    for (auto const &pair : profile.counts) {
+        if (pair.first.first == spawn_site) {
+            samples += pair.second;
+            has_frames = has_frames || pair.first.second[0] != NULL;
+        }
+    }
+    const uint64_t expected = burn_secs * SAMPLING_PROFILER_FREQUENCY_HZ;
+    EXPECT_GE(samples, expected / 3);
+    EXPECT_TRUE(has_frames);
+}
+
+#endif  // defined(__linux) && defined(__x86_64__)
+
+}  // namespace unittest
@@ -0,0 +1,81 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include <limits.h>
+#include <sys/uio.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "arch/io/network.hpp"
+#include "arch/runtime/coroutines.hpp"
+#include "arch/timing.hpp"
+#include "concurrency/cond_var.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// More buffers than a single `::writev()` call takes.
+const size_t WRITEV_NUM_BUFFERS = 3 * IOV_MAX + 5;
+// About 25 MB in total, more than the kernel buffers of a loopback connection hold, so
+// `::writev()` has to return early while nobody reads.
+const size_t WRITEV_MAX_BUFFER_SIZE = 16 * KILOBYTE;
+
+// Not periodic in any of the buffer sizes, so that reordered buffers are noticed.
+char writev_test_byte(size_t offset) {
+    return static_cast<char>((offset * 2654435761u) >> 13);
+}
+
+TPTEST(TcpConnTest, WritevShortWritesAndManyBuffers) {
+    ip_address_t loopback("127.0.0.1");
+    std::set<ip_address_t> addresses;
+    addresses.insert(loopback);
+    scoped_ptr_t<tcp_conn_t> server_conn;
+    cond_t accepted;
+    tcp_listener_t listener(addresses, 0,
+        [&](scoped_ptr_t<tcp_conn_descriptor_t> &nconn) {
+            nconn->make_overcomplicated(&server_conn);
+            accepted.pulse();
+        });
+
+    cond_t non_interruptor;
+    tcp_conn_t client_conn(loopback, listener.get_port(), &non_interruptor);
+    accepted.wait();
+
+    // The first buffer and some of the others are empty.
+    std::vector<size_t> sizes(WRITEV_NUM_BUFFERS);
+    size_t total_size = 0;
+    for (size_t i = 0; i < WRITEV_NUM_BUFFERS; ++i) {
+        sizes[i] = (i * 7919) % WRITEV_MAX_BUFFER_SIZE;
+        total_size += sizes[i];
+    }
+    std::string sent(total_size, '\0');
+    for (size_t i = 0; i < total_size; ++i) {
+        sent[i] = writev_test_byte(i);
+    }
+    std::vector<iovec> iov(WRITEV_NUM_BUFFERS);
+    size_t offset = 0;
+    for (size_t i = 0; i < WRITEV_NUM_BUFFERS; ++i) {
+        iov[i].iov_base = &sent[offset];
+        iov[i].iov_len = sizes[i];
+        offset += sizes[i];
+    }
+
+    cond_t written;
+    coro_t::spawn_sometime([&]() {
+        client_conn.writev(iov.data(), iov.size(), &non_interruptor);
+        written.pulse();
+    });
+
+    // Nothing has been read yet, so the write can't have completed.
+    nap(100);
+    EXPECT_FALSE(written.is_pulsed());
+
+    std::string received(total_size, '\0');
+    server_conn->read(&received[0], total_size, &non_interruptor);
+    written.wait();
+    // Not `ASSERT_EQ`, which would print both strings.
+    ASSERT_TRUE(sent == received);
+}
+
+}  // namespace unittest
@@ -0,0 +1,105 @@
+#!/usr/bin/env python
+# Copyright 2010-2015 RethinkDB, all rights reserved.
+
+"""The `interface.changefeed_resume` test checks that a range changefeed reopened with the `resume_token` of the last change it delivered replays exactly the changes made while it was closed, and then continues with live changes."""
+
+import os, sys, time
+
+startTime = time.time()
+
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), os.path.pardir, 'common')))
+import driver, scenario_common, utils, vcoptparse
+
+op = vcoptparse.OptParser()
+scenario_common.prepare_option_parser_mode_flags(op)
+_, command_prefix, serve_options = scenario_common.parse_mode_flags(op.parse(sys.argv))
+
+r = utils.import_python_driver()
+dbName, tableName = utils.get_test_db_table()
+
+def read_changes(feed, count):
+    changes = [feed.next(wait=10) for i in xrange(count)]
+    for change in changes:
+        assert "resume_token" in change, change
+    return changes
+
+def summarize(changes):
+    return sorted((c.get("old_val"), c.get("new_val")) for c in changes)
+
+def assert_no_more(feed):
+    try:
+        change = feed.next(wait=1)
+    except r.RqlTimeoutError:
+        return
+    assert False, "Unexpected change: %r" % change
+
+print("Spinning up a server (%.2fs)" % (time.time() - startTime))
+with driver.Cluster(initial_servers=['a'], output_folder='.', command_prefix=command_prefix, extra_options=serve_options) as cluster:
+    cluster.check()
+
+    print("Establishing ReQL connection (%.2fs)" % (time.time() - startTime))
+    conn = r.connect(host=cluster[0].host, port=cluster[0].driver_port)
+
+    if dbName not in r.db_list().run(conn):
+        res = r.db_create(dbName).run(conn)
+        assert res["dbs_created"] == 1
+    res = r.db(dbName).table_create(tableName).run(conn)
+    assert res["tables_created"] == 1
+    tbl = r.db(dbName).table(tableName)
+
+    # With two shards the token has a position for each of them.
+    tbl.reconfigure(shards=2, replicas=1).run(conn)
+    tbl.wait().run(conn)
+
+    print("Reading changes with resume tokens (%.2fs)" % (time.time() - startTime))
+    feed = tbl.changes(include_resume_token=True).run(conn)
+    res = tbl.insert([{"id": i} for i in xrange(10)]).run(conn)
+    assert res["inserted"] == 10
+    seen = read_changes(feed, 10)
+    assert len(seen[-1]["resume_token"]) == 2, seen[-1]
+    feed.close()
+
+    print("Making changes while the changefeed is closed (%.2fs)" % (time.time() - startTime))
+    res = tbl.insert([{"id": i} for i in xrange(10, 15)]).run(conn)
+    assert res["inserted"] == 5
+    res = tbl.get(0).update({"x": 1}).run(conn)
+    assert res["replaced"] == 1
+    res = tbl.get(1).delete().run(conn)
+    assert res["deleted"] == 1
+    missed = [(None, {"id": i}) for i in xrange(10, 15)]
+    missed.append(({"id": 0}, {"id": 0, "x": 1}))
+    missed.append(({"id": 1}, None))
+
+    print("Resuming from the last change seen (%.2fs)" % (time.time() - startTime))
+    feed = tbl.changes(since=seen[-1]["resume_token"], include_resume_token=True).run(conn)
+    replayed = read_changes(feed, len(missed))
+    assert summarize(replayed) == sorted(missed), summarize(replayed)
+    assert_no_more(feed)
+
+    # Live changes follow the replayed ones, and nothing is delivered twice.
+    res = tbl.insert({"id": 15}).run(conn)
+    assert res["inserted"] == 1
+    live = read_changes(feed, 1)
+    assert summarize(live) == [(None, {"id": 15})], live
+    assert_no_more(feed)
+    feed.close()
+
+    print("Resuming from the middle of the replay (%.2fs)" % (time.time() - startTime))
+    # Every change delivered after `replayed[2]` comes back, in the same order.
+    feed = tbl.changes(since=replayed[2]["resume_token"], include_resume_token=True).run(conn)
+    rest = read_changes(feed, len(replayed) - 3 + 1)
+    assert summarize(rest) == summarize(replayed[3:] + live), summarize(rest)
+    assert_no_more(feed)
+    feed.close()
+
+    print("Checking that a token from another table is refused (%.2fs)" % (time.time() - startTime))
+    res = r.db(dbName).table_create(tableName + "_other").run(conn)
+    assert res["tables_created"] == 1
+    try:
+        r.db(dbName).table(tableName + "_other").changes(since=seen[-1]["resume_token"]).run(conn)
+        assert False, "Expected the changefeed to fail"
+    except r.RqlRuntimeError, e:
+        assert "no longer available" in str(e), e
+
+    cluster.check_and_stop()
+print("Done. (%.2fs)" % (time.time() - startTime))